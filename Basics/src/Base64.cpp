@@ -9,6 +9,7 @@
 //---------------------------------------------------------------------------
 
 #include "Base64.h"
+#include "Writer.h"
 
 #include <string.h>
 
@@ -52,8 +53,6 @@ namespace Ino
 
 //---------------------------------------------------------------------------
 
-static bool revListValid = false;
-
 static const char b64Chars[] = {
     'A','B','C','D','E','F','G','H',
     'I','J','K','L','M','N','O','P',
@@ -65,20 +64,166 @@ static const char b64Chars[] = {
     '4','5','6','7','8','9','+','/',
   };
 
-static char b64Rev[128];
+const int b64ChunkSz = 3*1024; // Input bytes per chunk for a Writer
+
+//---------------------------------------------------------------------------
+
+struct Base64RevList
+{
+  signed char rev[256]; // -1 if not a Base64 character
+
+  Base64RevList();
+};
+
+//---------------------------------------------------------------------------
+
+Base64RevList::Base64RevList()
+{
+  for (int i=0; i<256; ++i) rev[i] = -1;
+  for (int i=0; i<64; ++i) rev[(unsigned char)b64Chars[i]] = (signed char)i;
+}
+
+//---------------------------------------------------------------------------
+
+static const signed char *b64Rev()
+{
+  static const Base64RevList revList; // Built on first use, thread safe
+
+  return revList.rev;
+}
 
 //---------------------------------------------------------------------------
+// ---- SSSE3 kernels, 12 bytes <-> 16 characters per step ------------------
+// ---- See W. Mula, D. Lemire: "Faster Base64 Encoding and Decoding --------
+// ---- Using AVX2 Instructions" --------------------------------------------
+//---------------------------------------------------------------------------
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INO_B64_SSSE3
+#define INO_B64_SSSE3_TARGET __attribute__((target("ssse3")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define INO_B64_SSSE3
+#define INO_B64_SSSE3_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef INO_B64_SSSE3
 
-static void calcRevList()
+static bool detectSsse3()
 {
-  if (revListValid) return;
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info,1);
 
-  for (int i=0; i<128; ++i) b64Rev[i] = -1;
-  for (int i=0; i<64; ++i) b64Rev[(int)(b64Chars[i])] = (char)i;
+  return (info[2] & (1 << 9)) != 0;
+#else
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+static bool hasSsse3()
+{
+  static const bool has = detectSsse3(); // Once, thread safe
+
+  return has;
+}
+
+//---------------------------------------------------------------------------
+// Encodes while at least 16 bytes can be read, returns the bytes consumed,
+// always a multiple of 12
+
+INO_B64_SSSE3_TARGET
+static int encodeSsse3(const unsigned char *msg, int len, char *code)
+{
+  const __m128i shuf = _mm_set_epi8(10,11,9,10, 7,8,6,7, 4,5,3,4, 1,2,0,1);
+  const __m128i shiftLut = _mm_setr_epi8('a'-26, '0'-52, '0'-52, '0'-52,
+                                         '0'-52, '0'-52, '0'-52, '0'-52,
+                                         '0'-52, '0'-52, '0'-52, '+'-62,
+                                         '/'-63, 'A', 0, 0);
+  int done = 0;
+
+  for (; len - done >= 16; done += 12, code += 16) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(msg + done));
+    in = _mm_shuffle_epi8(in,shuf);
+
+    // Spread the 4x6 bits of each 3 bytes over 4 bytes
+
+    __m128i t0 = _mm_and_si128(in,_mm_set1_epi32(0x0fc0fc00));
+    __m128i t1 = _mm_mulhi_epu16(t0,_mm_set1_epi32(0x04000040));
+    __m128i t2 = _mm_and_si128(in,_mm_set1_epi32(0x003f03f0));
+    __m128i t3 = _mm_mullo_epi16(t2,_mm_set1_epi32(0x01000010));
+    __m128i idx = _mm_or_si128(t1,t3);
+
+    // Map 0..63 to the characters by adding a per range offset
+
+    __m128i rng = _mm_subs_epu8(idx,_mm_set1_epi8(51));
+    __m128i lt26 = _mm_cmpgt_epi8(_mm_set1_epi8(26),idx);
+    rng = _mm_or_si128(rng,_mm_and_si128(lt26,_mm_set1_epi8(13)));
+
+    __m128i out = _mm_add_epi8(_mm_shuffle_epi8(shiftLut,rng),idx);
+    _mm_storeu_si128((__m128i *)code,out);
+  }
 
-  revListValid = true;
+  return done;
 }
 
+//---------------------------------------------------------------------------
+// Decodes groups of 16 characters, stops at the first group that contains
+// other than Base64 characters. Writes 16 bytes per 12 decoded, the
+// caller must leave room for that. Returns the characters consumed.
+
+INO_B64_SSSE3_TARGET
+static int decodeSsse3(const unsigned char *msg, int len, char *data)
+{
+  const __m128i lutLo = _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11,
+                                      0x11, 0x11, 0x11, 0x11, 0x13, 0x1A,
+                                      0x1B, 0x1B, 0x1B, 0x1A);
+  const __m128i lutHi = _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08,
+                                      0x04, 0x08, 0x10, 0x10, 0x10, 0x10,
+                                      0x10, 0x10, 0x10, 0x10);
+  const __m128i lutRoll = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                        0, 0, 0, 0, 0, 0, 0, 0);
+  const __m128i pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8,
+                                     14, 13, 12, -1, -1, -1, -1);
+  const __m128i nibMsk = _mm_set1_epi8(0x0f);
+
+  int done = 0;
+
+  for (; len - done >= 16; done += 16, data += 12) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(msg + done));
+
+    __m128i hiNib = _mm_and_si128(_mm_srli_epi32(in,4),nibMsk);
+    __m128i loNib = _mm_and_si128(in,nibMsk);
+
+    __m128i lo = _mm_shuffle_epi8(lutLo,loNib);
+    __m128i hi = _mm_shuffle_epi8(lutHi,hiNib);
+
+    __m128i bad = _mm_cmpeq_epi8(_mm_and_si128(lo,hi),_mm_setzero_si128());
+    if (_mm_movemask_epi8(bad) != 0xFFFF) break;
+
+    __m128i eq2F = _mm_cmpeq_epi8(in,_mm_set1_epi8(0x2f));
+    __m128i roll = _mm_shuffle_epi8(lutRoll,_mm_add_epi8(eq2F,hiNib));
+    __m128i val  = _mm_add_epi8(in,roll);
+
+    // Join 4x6 bits into 3 bytes
+
+    __m128i ab = _mm_maddubs_epi16(val,_mm_set1_epi32(0x01400140));
+    __m128i out = _mm_madd_epi16(ab,_mm_set1_epi32(0x00011000));
+
+    _mm_storeu_si128((__m128i *)data,_mm_shuffle_epi8(out,pack));
+  }
+
+  return done;
+}
+
+#endif
+
 //---------------------------------------------------------------------------
 
 void Base64::ensureCap(int minCap)
@@ -109,7 +254,6 @@ void Base64::ensureCap(int minCap)
 Base64::Base64()
 : buf(NULL), cap(0)
 {
-  calcRevList();
 }
 
 //---------------------------------------------------------------------------
@@ -144,61 +288,9 @@ const char *Base64::encode(const char *msg, int len, int& codeLen)
 
   if (!msg || len < 0) return NULL;
 
-  if (len < 1) {
-    ensureCap(1);
-    buf[0] = '\0';
-
-    return buf;
-  }
-
-  int mod = len % 3;
-  codeLen = len;
-
-  if (mod != 0)  codeLen += 3 - mod;
-  codeLen = codeLen * 4 / 3;
-
-  ensureCap(codeLen+1);
-
-  mod = 0;
-  int msk = 0, pos = 0;
-
-  for (int i=0; i<len; ++i) {
-    msk <<= 8; msk |= (msg[i] & 0xFF);
-
-    if (mod >= 2) {
-      buf[pos+3] = b64Chars[msk & 0x3F]; msk >>= 6;
-      buf[pos+2] = b64Chars[msk & 0x3F]; msk >>= 6;
-      buf[pos+1] = b64Chars[msk & 0x3F]; msk >>= 6;
-      buf[pos]   = b64Chars[msk & 0x3F];
-
-      mod = 0;
-      msk = 0;
-      pos += 4;
-    }
-    else mod++;
-  }
-
-  if (mod == 1) {
-    buf[pos+3] = '=';
-    buf[pos+2] = '=';
-
-    msk <<= 4;
-    buf[pos+1] = b64Chars[msk & 0x3F]; msk >>= 6;
-    buf[pos]   = b64Chars[msk & 0x3F];
-
-    pos += 4;
-  }
-  else if (mod == 2) {
-    buf[pos+3] = '=';
-
-    msk <<= 2;
-    buf[pos+2] = b64Chars[msk & 0x3F]; msk >>= 6;
-    buf[pos+1] = b64Chars[msk & 0x3F]; msk >>= 6;
-    buf[pos]   = b64Chars[msk & 0x3F];
-
-    pos += 4;
-  }
+  ensureCap(encodedLength(len)+1);
 
+  codeLen = encode(msg,len,buf);
   buf[codeLen] = '\0';
 
   return buf;
@@ -227,51 +319,210 @@ const char *Base64::decode(const char *msg, int len, int& decodeLen)
 
   if (!msg || len < 0 || len % 4 != 0) return NULL;
 
-  if (len < 1) {
-    ensureCap(1);
-    buf[0] = '\0';
+  ensureCap(len/4*3+1);
+
+  int dLen = decode(msg,len,buf);
+  if (dLen < 0) return NULL;
 
-    return buf;
+  decodeLen = dLen;
+  buf[decodeLen] = '\0';
+
+  return buf;
+}
+
+//---------------------------------------------------------------------------
+/** Converts an array of 8-bit bytes to Base64 format and writes the result
+  to a Writer.
+  \param msg The data to convert, must \b not be \c NULL if \c len > 0.
+  \param len The number of valid bytes in \c data.
+  \param wrt The Writer that receives the Base64 representation.
+  \return \c false if \c len < 0 or if writing failed.
+
+  The data is converted in chunks, memory use does not depend on \c len.
+*/
+
+bool Base64::encode(const char *msg, int len, Writer& wrt)
+{
+  if (len < 0 || (len > 0 && !msg)) return false;
+
+  ensureCap(encodedLength(b64ChunkSz));
+
+  while (len > 0) {
+    int chunk = len < b64ChunkSz ? len : b64ChunkSz;
+
+    if (!wrt.write(buf,encode(msg,chunk,buf))) return false;
+
+    msg += chunk; len -= chunk;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+/** Converts an array of 8-bit bytes back from Base64 format and writes
+  the result to a Writer.
+  \param msg The data to convert back, must \b not be \c NULL if \c len > 0.
+  \param len The number of valid bytes in \c data, must be a multiple of four.
+  \param wrt The Writer that receives the decoded data.
+  \return \c false if <tt>len < 0 || len\%4 != 0</tt>, if an invalid
+  character is found or if writing failed.\n
+  In the last two cases part of the data may have been written.
+
+  The data is converted in chunks, memory use does not depend on \c len.
+*/
+
+bool Base64::decode(const char *msg, int len, Writer& wrt)
+{
+  if (len < 0 || len % 4 != 0 || (len > 0 && !msg)) return false;
+
+  const int codeChunk = encodedLength(b64ChunkSz);
+
+  ensureCap(b64ChunkSz);
+
+  while (len > 0) {
+    int chunk = len < codeChunk ? len : codeChunk;
+
+    // Padding is only allowed at the very end
+
+    if (chunk < len && msg[chunk-1] == '=') return false;
+
+    int dLen = decode(msg,chunk,buf);
+    if (dLen < 0 || !wrt.write(buf,dLen)) return false;
+
+    msg += chunk; len -= chunk;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+/** Converts an array of 8-bit bytes to Base64 format into a caller
+  supplied buffer.
+  \param msg The data to convert, must \b not be \c NULL if \c len > 0.
+  \param len The number of valid bytes in \c data, must \b not be negative.
+  \param code The buffer that receives the Base64 representation, its
+  capacity must be at least <tt>encodedLength(len)</tt> bytes.
+  \return The number of characters written to \c code.\n
+  No trailing zero character is appended.
+*/
+
+int Base64::encode(const char *msg, int len, char *code)
+{
+  const unsigned char *in = (const unsigned char *)msg;
+  char *out = code;
+
+  int i = 0;
+
+#ifdef INO_B64_SSSE3
+  if (len >= 16 && hasSsse3()) {
+    i = encodeSsse3(in,len,out);
+    out += i/3*4;
+  }
+#endif
+
+  for (; i+3 <= len; i += 3, out += 4) {
+    unsigned int msk = in[i] << 16 | in[i+1] << 8 | in[i+2];
+
+    out[0] = b64Chars[msk >> 18];
+    out[1] = b64Chars[(msk >> 12) & 0x3F];
+    out[2] = b64Chars[(msk >> 6) & 0x3F];
+    out[3] = b64Chars[msk & 0x3F];
   }
 
-  decodeLen = len/4*3;
+  int mod = len - i;
+
+  if (mod == 1) {
+    unsigned int msk = in[i] << 4;
+
+    out[0] = b64Chars[msk >> 6];
+    out[1] = b64Chars[msk & 0x3F];
+    out[2] = '=';
+    out[3] = '=';
+
+    out += 4;
+  }
+  else if (mod == 2) {
+    unsigned int msk = (in[i] << 8 | in[i+1]) << 2;
+
+    out[0] = b64Chars[msk >> 12];
+    out[1] = b64Chars[(msk >> 6) & 0x3F];
+    out[2] = b64Chars[msk & 0x3F];
+    out[3] = '=';
+
+    out += 4;
+  }
+
+  return (int)(out - code);
+}
+
+//---------------------------------------------------------------------------
+/** Converts an array of 8-bit bytes back from Base64 format into a caller
+  supplied buffer.
+  \param msg The data to convert back, must \b not be \c NULL if \c len > 0.
+  \param len The number of valid bytes in \c data, must be a multiple of four.
+  \param data The buffer that receives the decoded data, its capacity must
+  be at least <tt>len/4*3</tt> bytes.
+  \return The number of bytes written to \c data,\n
+  -1 if \c len is not a multiple of four or if a character is found that
+  could not possibly be present in a Base64 encoded string.\n
+  The character \c '=' is only accepted in the last two positions.
+*/
+
+int Base64::decode(const char *msg, int len, char *data)
+{
+  if (len < 0 || len % 4 != 0) return -1;
+  if (len < 1) return 0;
+
+  const unsigned char *in = (const unsigned char *)msg;
+  const signed char *rev = b64Rev();
+
+  int decodeLen = len/4*3;
   if (msg[len-1] == '=') decodeLen--;
   if (msg[len-2] == '=') decodeLen--;
 
-  ensureCap(decodeLen+1);
+  char *out = data;
+  int i = 0;
 
-  int msk = 0, pos = 0, mod = 0;
+#ifdef INO_B64_SSSE3
+  // Keep the last group for the scalar code, and room for 16 byte stores
 
-  for (int i=0; i<len; ++i) {
-    msk <<= 6;
+  if (len >= 24 && hasSsse3()) {
+    i = decodeSsse3(in,len-8,out);
+    out += i/4*3;
+  }
+#endif
 
-    if (msg[i] < 0) {
-      decodeLen = 0;
-      return NULL;
-    }
+  for (; i+4 < len; i += 4, out += 3) {
+    int c0 = rev[in[i]], c1 = rev[in[i+1]], c2 = rev[in[i+2]], c3 = rev[in[i+3]];
+    if ((c0 | c1 | c2 | c3) < 0) return -1;
 
-    int code = b64Rev[(int)(msg[i])];
-    if (code < 0) {
-      if (i < len-2 || msg[i] != '=') {
-        decodeLen = 0;
-        return NULL;
-      }
-    }
-    else msk |= (code & 0x3F);
+    unsigned int msk = c0 << 18 | c1 << 12 | c2 << 6 | c3;
 
-    if (mod >= 3) {
-      if (pos+2 < len) buf[pos+2] = (char)(msk & 0xFF); msk >>= 8;
-      if (pos+1 < len) buf[pos+1] = (char)(msk & 0xFF); msk >>= 8;
-      buf[pos] = (char)(msk & 0xFF);
+    out[0] = (char)(msk >> 16);
+    out[1] = (char)(msk >> 8);
+    out[2] = (char)msk;
+  }
+
+  // Last group, '=' may appear in its last two positions
+
+  unsigned int msk = 0;
 
-      mod = 0;
-      msk = 0;
-      pos += 3;
+  for (int j=0; j<4; ++j) {
+    int code = rev[in[i+j]];
+
+    if (code < 0) {
+      if (j < 2 || in[i+j] != '=') return -1;
+      code = 0;
     }
-    else mod++;
+
+    msk = msk << 6 | code;
   }
 
-  return buf;
+  char last[3] = { (char)(msk >> 16), (char)(msk >> 8), (char)msk };
+
+  for (int j=0; j<3 && out < data + decodeLen; ++j) *out++ = last[j];
+
+  return decodeLen;
 }
 
 } // namespace Ino
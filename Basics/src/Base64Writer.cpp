@@ -9,6 +9,7 @@
 //---------------------------------------------------------------------------
 
 #include "Writer.h"
+#include "Base64.h"
 
 namespace Ino {
 
@@ -25,10 +26,15 @@ static const char b64Chars[] = {
     '4','5','6','7','8','9','+','/',
   };
 
+const int b64LineBytes = 57;      // Bytes per line of 76 characters
+const int b64LineSz    = 76 + 2;  // Including CR LF
+const int b64MaxLines  = 64;      // Lines per bulk write
+
 //---------------------------------------------------------------------------
 
 Base64Writer::Base64Writer(Writer& writer, ProgressReporter *rep)
-: Writer(rep), wrt(writer), bufSz(0), mod(0), msk(0)
+: Writer(rep), wrt(writer), bufSz(0), mod(0), msk(0),
+  lineBuf(NULL)
 {
 }
 
@@ -37,6 +43,8 @@ Base64Writer::Base64Writer(Writer& writer, ProgressReporter *rep)
 Base64Writer::~Base64Writer()
 {
   flush();
+
+  delete[] lineBuf;
 }
 
 //---------------------------------------------------------------------------
@@ -115,6 +123,32 @@ bool Base64Writer::writeBuf()
   return reportProgress();
 }
 
+//---------------------------------------------------------------------------
+// Converts lineCnt complete lines at once, only at the start of a line
+
+bool Base64Writer::writeLines(const char *msg, int lineCnt)
+{
+  if (!lineBuf) lineBuf = new char[b64MaxLines*b64LineSz];
+
+  char *ln = lineBuf;
+
+  for (int i=0; i<lineCnt; ++i, msg += b64LineBytes, ln += b64LineSz) {
+    Base64::encode(msg,b64LineBytes,ln);
+
+    ln[76] = '\r';
+    ln[77] = '\n';
+  }
+
+  int sz = lineCnt * b64LineSz;
+
+  if (!wrt.write(lineBuf,sz)) return false;
+
+  bytesWritten += sz;
+  bytesInc     += sz;
+
+  return reportProgress();
+}
+
 //---------------------------------------------------------------------------
 
 bool Base64Writer::write(const char *msg, int msgLen)
@@ -122,6 +156,19 @@ bool Base64Writer::write(const char *msg, int msgLen)
   if (!msg || msgLen < 0) return false;
 
   for (int i=0; i<msgLen; ++i) {
+
+    // Whole lines go in bulk
+
+    if (mod == 0 && bufSz == 0 && msgLen-i >= b64LineBytes) {
+      int lineCnt = (msgLen-i) / b64LineBytes;
+      if (lineCnt > b64MaxLines) lineCnt = b64MaxLines;
+
+      if (!writeLines(msg+i,lineCnt)) return false;
+
+      i += lineCnt * b64LineBytes - 1;
+      continue;
+    }
+
     msk <<= 8; msk |= (msg[i] & 0xFF);
     mod++;
 
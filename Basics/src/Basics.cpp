@@ -11,6 +11,7 @@
 // 2011-03-04 Now in SVN
 
 #include "Basics.h"
+#include "NumConv.h"
 
 #include <cctype>
 #include <cwctype>
@@ -68,8 +69,8 @@ const double NumAccuracy = 1.0e-16;
 /// Conversion factor from inch to mm.
 const double InchInMm = 25.4;
 
-static char    convBuf[128]  = "";
-static wchar_t convBufW[128] = L"";
+static thread_local char    convBuf[NumBufCap]  = "";
+static thread_local wchar_t convBufW[NumBufCap] = L"";
 
 static double radToDegs = 180.0/3.141592653589793238462643383279502884197169;
 
@@ -483,14 +484,31 @@ const wchar_t *readField(const wchar_t *s, wchar_t *buf, bool trimFld)
   return s;
 }
 
+//---------------------------------------------------------------------------
+// Narrows [first,last) to exclude leading and trailing white space
+
+static void trimRange(const char *& first, const char *& last)
+{
+  while (first < last && isspace((unsigned char)*first)) first++;
+  while (last > first && isspace((unsigned char)last[-1])) last--;
+}
+
+//---------------------------------------------------------------------------
+
+static void trimRange(const wchar_t *& first, const wchar_t *& last)
+{
+  while (first < last && iswspace(*first)) first++;
+  while (last > first && iswspace(last[-1])) last--;
+}
+
 //---------------------------------------------------------------------------
 /** Converts an ASCII string to an integer.
-   It uses standard function \c strtol for the actual conversion.
+   It uses function \ref scanInt(const char*, const char*, long&) "scanInt"
+   for the actual conversion.
 
    \param s The string to read the integer from, may be \c NULL or empty.
-   A copy of this string is first \ref trim(char *) "trimmed" and then
-   converted.
-   \param intVal Receives the result.
+   Leading and trailing white space is ignored.
+   \param intVal Receives the result, 0 if no number is found.
    \return \c true if and only if the trimmed string contains a valid integer
    and no characters are left to be read after the conversion.
 
@@ -500,29 +518,24 @@ const wchar_t *readField(const wchar_t *s, wchar_t *buf, bool trimFld)
 
 bool toInt(const char *s, long& intVal)
 {
-  if (!s || strlen(s) < 1) return false;
-
-  char buf[256] = "";
-  strcpy(buf,s);
-  trim(buf);
+  if (!s || !*s) return false;
 
-  char *ep=NULL;
+  const char *first = s, *last = s + strlen(s);
+  trimRange(first,last);
 
-  intVal = strtol(buf,&ep,10);
+  intVal = 0; // As strtol, also if no number is found
 
-  if (ep != buf+strlen(buf)) return false;
-
-  return true;
+  return scanInt(first,last,intVal) == last;
 }
 
 //---------------------------------------------------------------------------
 /** Converts a Unicode string to an integer.
-   It uses standard function \c wcstol for the actual conversion.
+   It uses function \ref scanInt(const wchar_t*, const wchar_t*, long&)
+   "scanInt" for the actual conversion.
 
    \param s The string to read the integer from, may be \c NULL or empty.
-   A copy of this string is first \ref trim(wchar_t *) "trimmed" and then
-   converted.
-   \param intVal Receives the result.
+   Leading and trailing white space is ignored.
+   \param intVal Receives the result, 0 if no number is found.
    \return \c true if and only if the trimmed string contains a valid integer
    and no characters are left to be read after the conversion.\n
    
@@ -533,29 +546,24 @@ bool toInt(const char *s, long& intVal)
 
 bool toInt(const wchar_t *s, long& intVal)
 {
-  if (!s || wcslen(s) < 1) return false;
-
-  wchar_t buf[256] = L"";
-  wcscpy(buf,s);
-  trim(buf);
-
-  wchar_t *ep=NULL;
+  if (!s || !*s) return false;
 
-  intVal = wcstol(buf,&ep,10);
+  const wchar_t *first = s, *last = s + wcslen(s);
+  trimRange(first,last);
 
-  if (ep != buf+wcslen(buf)) return false;
+  intVal = 0; // As wcstol, also if no number is found
 
-  return true;
+  return scanInt(first,last,intVal) == last;
 }
 
 //---------------------------------------------------------------------------
 /** Converts an ASCII string to a double value.
-   It uses standard function \c strtod for the actual conversion.
+   It uses function \ref scanDouble(const char*, const char*, double&)
+   "scanDouble" for the actual conversion.
 
    \param s The string to read the double value from, may be \c NULL or empty.
-   A copy of this string is first \ref trim(char *) "trimmed" and then
-   converted.
-   \param dblVal Receives the result.
+   Leading and trailing white space is ignored.
+   \param dblVal Receives the result, 0 if no number is found.
    \return \c true if and only if the trimmed string contains a valid double
    value and no characters are left to be read after the conversion.
 
@@ -565,29 +573,24 @@ bool toInt(const wchar_t *s, long& intVal)
 
 bool toDouble(const char *s, double& dblVal)
 {
-  if (!s || strlen(s) < 1) return false;
-
-  char buf[256] = "";
-  strcpy(buf,s);
-  trim(buf);
-
-  char *ep=NULL;
+  if (!s || !*s) return false;
 
-  dblVal = strtod(buf,&ep);
+  const char *first = s, *last = s + strlen(s);
+  trimRange(first,last);
 
-  if (ep != buf+strlen(buf)) return false;
+  dblVal = 0.0; // As strtod, also if no number is found
 
-  return true;
+  return scanDouble(first,last,dblVal) == last;
 }
 
 //---------------------------------------------------------------------------
 /** Converts a Unicode string to a double value.
-   It uses standard function \c wcstod for the actual conversion.
+   It uses function \ref scanDouble(const wchar_t*, const wchar_t*, double&)
+   "scanDouble" for the actual conversion.
 
    \param s The string to read the double value from, may be \c NULL or empty.
-   A copy of this string is first \ref trim(wchar_t *) "trimmed" and then
-   converted.
-   \param dblVal Receives the result.
+   Leading and trailing white space is ignored.
+   \param dblVal Receives the result, 0 if no number is found.
    \return \c true if and only if the trimmed string contains a valid double
    value and no characters are left to be read after the conversion.\n
    
@@ -598,111 +601,98 @@ bool toDouble(const char *s, double& dblVal)
 
 bool toDouble(const wchar_t *s, double& dblVal)
 {
-  if (!s || wcslen(s) < 1) return false;
+  if (!s || !*s) return false;
 
-  wchar_t buf[256] = L"";
-  wcscpy(buf,s);
-  trim(buf);
+  const wchar_t *first = s, *last = s + wcslen(s);
+  trimRange(first,last);
 
-  wchar_t *ep=NULL;
+  dblVal = 0.0; // As wcstod, also if no number is found
 
-  dblVal = wcstod(buf,&ep);
-
-  if (ep != buf+wcslen(buf)) return false;
-
-  return true;
+  return scanDouble(first,last,dblVal) == last;
 }
 
 //---------------------------------------------------------------------------
 /** Converts an integer to an ASCII string.
-    This method converts an integer to a const char* string. It uses sprintf
-    for the conversion.
+    This method converts an integer to a const char* string. It uses
+    \ref formatInt(long, char*) "formatInt" for the conversion.
     \param val the integer value to convert.
-    \return A pointer to a static buffer that contains the converted string.
+    \return A pointer to a buffer that contains the converted string.
 
     \note
-    The returned string will be overwritten once this function or a similar
-    one is called.
+    The buffer is local to the calling thread, the returned string will be
+    overwritten once this function or a similar one is called on the same
+    thread.
 */
 
 const char *fromInt(long val)
 {
-  sprintf(convBuf,"%ld",val);
+  formatInt(val,convBuf);
 
   return convBuf;
 }
 
 //---------------------------------------------------------------------------
 /** Converts an integer to a Unicode string.
-    This method converts an integer to a const char* string. It uses swprintf
-    for the conversion.
+    This method converts an integer to a const wchar_t* string. It uses
+    \ref formatInt(long, wchar_t*) "formatInt" for the conversion.
     \param val the integer value to convert.
-    \return A pointer to a static buffer that contains the converted string.
+    \return A pointer to a buffer that contains the converted string.
 
     \note
-    The returned string will be overwritten once this function or a similar
-    one is called.
+    The buffer is local to the calling thread, the returned string will be
+    overwritten once this function or a similar one is called on the same
+    thread.
 */
 
 const wchar_t *fromIntW(long val)
 {
-  swprintf(convBufW,128,L"%d",val);
+  formatInt(val,convBufW);
 
   return convBufW;
 }
 
 //---------------------------------------------------------------------------
 /** Converts a double to an ASCII string.
-    This method converts a double to a const char* string. It uses sprintf
-    for the conversion.
+    This method converts a double to a const char* string. It uses
+    \ref formatDouble(double, int, char*, int) "formatDouble" for the
+    conversion.
     \param val the double value to convert.
     \param digits the number of fractional digits required,
     <tt>0 <= digits <= 17</tt>.
-    \return A pointer to a static buffer that contains the converted string.
+    \return A pointer to a buffer that contains the converted string.
 
     \note
-    The returned string will be overwritten once this function or a similar
-    one is called.
+    The buffer is local to the calling thread, the returned string will be
+    overwritten once this function or a similar one is called on the same
+    thread.
 */
 
 const char *fromDouble(double val, int digits)
 {
-  if (digits < 0) sprintf(convBuf,"%G",val);
-  else {
-    if (digits > 17) digits = 17;
-    char spec[32] = "";
-    sprintf(spec,"%%.%df",digits);
-
-    sprintf(convBuf,spec,val);
-  }
+  formatDouble(val,digits,convBuf,NumBufCap);
 
   return convBuf;
 }
 
 //---------------------------------------------------------------------------
 /** Converts a double to a Unicode string.
-    This method converts a double to a const char* string. It uses sprintf
-    for the conversion.
+    This method converts a double to a const wchar_t* string. It uses
+    \ref formatDouble(double, int, wchar_t*, int) "formatDouble" for the
+    conversion.
     \param val the double value to convert.
     \param digits the number of fractional digits that has to converted,
     <tt>0 <= digits <= 17)</tt>.
-    \return A pointer to a static buffer that contains the converted string.
+    \return A pointer to a buffer that contains the converted string.
 
     \note
-    The returned string will be overwritten once this function or a similar
-    one is called.
+    The buffer is local to the calling thread, the returned string will be
+    overwritten once this function or a similar one is called on the same
+    thread.
 */
 
 const wchar_t *fromDoubleW(double val, int digits)
 {
-  if (digits < 0) swprintf(convBufW,128,L"%G",val);
-  else {
-    if (digits > 17) digits = 17;
-    wchar_t spec[32] = L"";
-
-    swprintf(spec,32,L"%%.%df",digits);
-    swprintf(convBufW,128,spec,val);
-  }
+  formatDouble(val,digits,convBufW,NumBufCap);
 
   return convBufW;
 }
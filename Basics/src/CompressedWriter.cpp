@@ -107,7 +107,7 @@ CompressedWriter::CompressedWriter(Writer& writer, int bufCap,
                                                     ProgressReporter *rep)
 : Writer(rep), wrt(writer),
   zStr(0), inBuf(0), outBuf(0),
-  compressing(true), flushed(true), rawBytesWritten(0)
+  compressing(true), flushed(true), rawDeflate(false), rawBytesWritten(0)
 {
   if (bufCap < 128) bufCap = 128;
 
@@ -174,6 +174,38 @@ void CompressedWriter::setCompressing(bool newCompress)
   compressing = newCompress;
 }
 
+//---------------------------------------------------------------------------
+/** \fn bool CompressedWriter::isRawDeflate() const
+  Returns \c true if raw deflate data is written.
+*/
+
+//---------------------------------------------------------------------------
+/** Selects raw deflate output.
+   \param raw \c true to write raw deflate data without the zlib header and
+   trailer (as required for e.g. zip entries),\n
+   \c false to write zlib formatted data (the default).
+   \return \c true if successful,\n
+   \c false if there is pending data, call flush() first.
+
+   Data written in raw mode cannot be read back by a CompressedReader.
+*/
+
+bool CompressedWriter::setRawDeflate(bool raw)
+{
+  if (raw == rawDeflate) return true;
+  if (!flushed) return false;
+
+  deflateEnd(zStr);
+
+  if (raw) deflateInit2(zStr,Z_DEFAULT_COMPRESSION,Z_DEFLATED,-MAX_WBITS,
+                                              8,Z_DEFAULT_STRATEGY);
+  else deflateInit(zStr,Z_DEFAULT_COMPRESSION);
+
+  rawDeflate = raw;
+
+  return true;
+}
+
 //---------------------------------------------------------------------------
 /** \fn long CompressedWriter::getRawBytesWritten() const
     Returns the number of raw (i.e. \b uncompressed) bytes written.
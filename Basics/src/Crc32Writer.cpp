@@ -9,12 +9,7 @@
 //---------------------------------------------------------------------------
 
 #include "Writer.h"
-
-#include "zutil.h"      /* for STDC and FAR definitions */
-
-//---------------------------------------------------------------------------
-
-ZEXTERN uLong ZEXPORT crc32 OF((uLong crc, const Bytef *buf, uInt len));
+#include "Crc.h"
 
 //---------------------------------------------------------------------------
 
@@ -24,7 +19,7 @@ namespace Ino
 //---------------------------------------------------------------------------
 
 Crc32Writer::Crc32Writer(Writer& writer, ProgressReporter *rep)
-: Writer(rep), wrt(writer), crc(crc32(0,Z_NULL,0))
+: Writer(rep), wrt(writer), crc(0)
 {
 }
 
@@ -32,7 +27,7 @@ Crc32Writer::Crc32Writer(Writer& writer, ProgressReporter *rep)
 
 void Crc32Writer::resetCrc()
 {
-  crc = crc32(0,Z_NULL,0);
+  crc = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -68,7 +63,7 @@ bool Crc32Writer::write(const char *buf, int sz)
   bytesWritten += sz;
   bytesInc     += sz;
 
-  crc = crc32(crc,(const Bytef *)buf,sz);
+  crc = (long)updateCrc32((unsigned int)crc,buf,sz);
 
   bool ok = reportProgress();
   if (!ok) wrt.flush();
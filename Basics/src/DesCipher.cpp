@@ -9,6 +9,7 @@
 //---------------------------------------------------------------------------
 
 #include "DesCipher.h"
+#include "Basics.h"
 
 //---------------------------------------------------------------------------
 
@@ -115,17 +116,6 @@ keyTr2 = {
      44, 49, 39, 56, 34, 53,
      46, 42, 50, 36, 29, 32 };
 
-static DesOrdering
-etr = {
-     32,  1,  2,  3,  4,  5,
-      4,  5,  6,  7,  8,  9,
-      8,  9, 10, 11, 12, 13,
-     12, 13, 14, 15, 16, 17,
-     16, 17, 18, 19, 20, 21,
-     20, 21, 22, 23, 24, 25,
-     24, 25, 26, 27, 28, 29,
-     28, 29, 30, 31, 32,  1 };
-
 static DesOrdering
 ptr = {
      16,  7, 20, 21,
@@ -215,22 +205,11 @@ static int lRots[16] = {
               1,  1,  2,  2,  2,  2,  2,  2,
               1,  2,  2,  2,  2,  2,  2,  1 };
 
-static int rRots[16] = {
-              0,  1,  2,  2,  2,  2,  2,  2,
-              1,  2,  2,  2,  2,  2,  2,  1 };
-
 //---------------------------------------------------------------------------
 
 #define transpose(data,t,n,odata) {int ii; for (ii=0; ii<n; ii++)\
                                                    odata[ii]=data[t[ii]-1]; }
 
-//---------------------------------------------------------------------------
-
-static void copyBlock(const DesBlock src, DesBlock dst)
-{
-  for (int i=0; i<64; ++i) dst[i] = src[i];
-}
-
 //---------------------------------------------------------------------------
 // ---- 1 bit left rotate on two 28 bit units -------------------------------
 //---------------------------------------------------------------------------
@@ -244,116 +223,166 @@ static void lrotatel(DesBlock key)
  key[27] = k0; key[55] = k28;
 }
 
-//---------------------------------------------------------------------------
+/* ----------------------------------------------------------------------- */
+/* ---- Expand 8x8 bits to 8x8 bytes ------------------------------------- */
+/* ----------------------------------------------------------------------- */
 
-static void rrotater(DesBlock key)
+static void desExpand(const char intxt[8], DesBlock outtxt)
 {
- unsigned char k27 = key[27], k55 = key[55];
-
- for (int i=55; i>0; i--) key[i] = key[i-1];
+ for (int i=0; i<8; i++) {
+   unsigned char c = intxt[i];
 
- key[0] = k27; key[28] = k55;
+   for (int j=0; j<8; j++) {
+     *outtxt++ = (c & 128) != 0;
+     c <<= 1;
+    }
+  }
 }
 
+//---------------------------------------------------------------------------
+// ---- Lookup tables, built once from the tables above ---------------------
+// ---- Bit 1 of the DES tables is the most significant bit -----------------
 //---------------------------------------------------------------------------
 
-static void f(int i, DesBlock key, DesBlock a, DesBlock x, bool crypt)
+struct DesTables
 {
- DesBlock e, ikey, y;
+  unsigned __int64 initPerm[8][256];  // initialTr, per input byte
+  unsigned __int64 finalPerm[8][256]; // swap and finalTr, per input byte
+  unsigned int spBox[8][64];          // S-box k and ptr
 
- transpose(a, etr, 48, e);
- /* expand e to 48 bits */
+  DesTables();
+};
 
- if (crypt) {
-   for (int j=0; j<lRots[i]; j++) lrotatel(key);
- }
- else {
-   for (int j=0; j<rRots[i]; j++) rrotater(key);
- }
+//---------------------------------------------------------------------------
 
- transpose(key, keyTr2, 48, ikey);
+static void makePermTable(const DesOrdering tr, unsigned __int64 tab[8][256])
+{
+  for (int bi=0; bi<8; ++bi) {
+    for (int v=0; v<256; ++v) {
+      unsigned __int64 out = 0;
 
- for (int j=0; j<48; j++) y[j] = (e[j]) ^ (ikey[j]);
+      for (int j=0; j<64; ++j) {
+        int src = tr[j]-1;
 
- for (int k=0; k<8; k++) {
-   /* substitute part */
-   int k6=6*(k+1)-1, k4=4*(k+1)-1;
-   int r = (y[k6-5]<<5) + (y[k6]<<4) + (y[k6-4]<<3) + (y[k6-3]<<2)
-                                     + (y[k6-2]<<1) + y[k6-1];
+        if (src/8 == bi && (v & (128 >> (src%8))))
+          out |= (unsigned __int64)1 << (63-j);
+      }
 
-   unsigned char skr = s[k][r];
-   e[k4-3] = (skr & 8) != 0;
-   e[k4-2] = (skr & 4) != 0;
-   e[k4-1] = (skr & 2) != 0;
-   e[k4]   = (skr & 1) != 0;
+      tab[bi][v] = out;
+    }
   }
-
- transpose(e,ptr,32,x);
 }
 
 //---------------------------------------------------------------------------
 
-static void descrypt(DesBlock intext, DesBlock key, DesBlock outtext, bool crypt)
+DesTables::DesTables()
 {
- DesBlock a, b, x;
+  makePermTable(initialTr,initPerm);
 
- /* Initial transposition */
- transpose(intext, initialTr, 64, a);
+  DesOrdering swapFinal;
+  for (int j=0; j<64; ++j) swapFinal[j] = swap[finalTr[j]-1];
 
- /* Mixup key and reduce to 56 bits */
- copyBlock(key,x);
- transpose(x, keyTr1, 56, key);
+  makePermTable(swapFinal,finalPerm);
 
- /* 16 iterations */
- for (int i=0; i<16; i++) {
-   copyBlock(a,b);
+  for (int k=0; k<8; ++k) {
+    for (int v=0; v<64; ++v) {
+      // v holds the 6 input bits, first bit most significant
+      int row = ((v >> 4) & 2) | (v & 1), col = (v >> 1) & 15;
 
-   /* Current left = old right */
-   for (int j=0; j<32; j++) a[j] = b[j+32];
+      unsigned int sOut = (unsigned int)s[k][row*16 + col] << (28 - 4*k);
+      unsigned int out = 0;
 
-   /* Compute x = f(r[i-1],k[i]) */
-   f(i,key,a,x,crypt);
-   for (int j=0; j<32; j++) a[j+32] = (b[j]) ^ (x[j]);
+      for (int j=0; j<32; ++j) {
+        if (sOut & (0x80000000u >> (ptr[j]-1))) out |= 0x80000000u >> j;
+      }
+
+      spBox[k][v] = out;
+    }
   }
+}
 
- /* swap left and right halves */
- transpose(a,swap,64,b);
+//---------------------------------------------------------------------------
 
- /* Final transposition */
- transpose(b,finalTr,64,outtext);
+static const DesTables& desTables()
+{
+  static const DesTables tables; // Built on first use, thread safe
+
+  return tables;
 }
 
-/* ----------------------------------------------------------------------- */
-/* ---- Expand 8x8 bits to 8x8 bytes ------------------------------------- */
-/* ----------------------------------------------------------------------- */
+//---------------------------------------------------------------------------
+// ---- Key schedule: per round the 48 key bits as 8 chunks of 6 bits -------
+//---------------------------------------------------------------------------
 
-static void desExpand(const char intxt[8], DesBlock outtxt)
+static void makeKeySchedule(const char chKey[8], unsigned char keySched[16][8])
 {
- for (int i=0; i<8; i++) {
-   unsigned char c = intxt[i];
+  DesBlock expKey, key, ikey;
 
-   for (int j=0; j<8; j++) {
-     *outtxt++ = (c & 128) != 0;
-     c <<= 1;
+  desExpand(chKey,expKey);
+
+  /* Mixup key and reduce to 56 bits */
+  transpose(expKey, keyTr1, 56, key);
+
+  for (int i=0; i<16; i++) {
+    for (int j=0; j<lRots[i]; j++) lrotatel(key);
+
+    transpose(key, keyTr2, 48, ikey);
+
+    for (int k=0; k<8; k++) {
+      unsigned char chunk = 0;
+      for (int j=0; j<6; j++) chunk = (unsigned char)((chunk << 1) | ikey[6*k+j]);
+
+      keySched[i][k] = chunk;
     }
   }
 }
-/* ----------------------------------------------------------------------- */
-/* ---- Compress 8x8 bytes to 8x8 bits ----------------------------------- */
-/* ----------------------------------------------------------------------- */
 
-static void desCompress(const DesBlock intxt, char outtxt[8])
+//---------------------------------------------------------------------------
+// ---- The round function, the 6 bit groups of the expansion etr -----------
+// ---- of r are 4 bit apart, starting with bit 32 --------------------------
+//---------------------------------------------------------------------------
+
+static inline unsigned int f(unsigned int r, const unsigned char key[8],
+                                             const unsigned int spBox[8][64])
 {
- for (int i=0; i<8; i++) {
-   unsigned char c = 0;
+  unsigned int x = spBox[0][(((r >> 1) | (r << 31)) >> 26) ^ key[0]];
 
-   for (int j=0; j<8; j++) {
-     c <<= 1;
-     c |= *intxt++;
-   }
-   
-   outtxt[i] = c;
+  for (int k=1; k<8; k++) {
+    int n = 4*k - 1;
+    x |= spBox[k][(((r << n) | (r >> (32 - n))) >> 26) ^ key[k]];
   }
+
+  return x;
+}
+
+//---------------------------------------------------------------------------
+
+static void descrypt(const unsigned char keySched[16][8], const char intxt[8],
+                                                  char outtxt[8], bool crypt)
+{
+  const DesTables& tab = desTables();
+
+  /* Initial transposition */
+  unsigned __int64 a = 0;
+  for (int i=0; i<8; i++) a |= tab.initPerm[i][(unsigned char)intxt[i]];
+
+  unsigned int l = (unsigned int)(a >> 32), r = (unsigned int)a;
+
+  /* 16 iterations, decryption uses the keys in reverse order */
+  for (int i=0; i<16; i++) {
+    unsigned int x = f(r, keySched[crypt ? i : 15-i], tab.spBox);
+
+    /* Current left = old right */
+    unsigned int b = l; l = r; r = b ^ x;
+  }
+
+  /* swap left and right halves and final transposition */
+  a = ((unsigned __int64)l << 32) | r;
+
+  unsigned __int64 b = 0;
+  for (int i=0; i<8; i++) b |= tab.finalPerm[i][(unsigned char)(a >> (56-8*i))];
+
+  for (int i=0; i<8; i++) outtxt[i] = (char)(b >> (56-8*i));
 }
 
 //---------------------------------------------------------------------------
@@ -370,7 +399,7 @@ static void desCompress(const DesBlock intxt, char outtxt[8])
 DesCipher::DesCipher(const char key[8])
 {
   for (int i=0; i<8; ++i) chKey[i] = key[i];
-  desExpand(chKey,desKey);
+  makeKeySchedule(chKey,keySched);
 }
 
 //---------------------------------------------------------------------------
@@ -383,7 +412,9 @@ DesCipher::DesCipher(const char key[8])
 DesCipher::DesCipher(const DesCipher& cp)
 {
   for (int i=0; i<8; ++i) chKey[i] = cp.chKey[i];
-  for (int i=0; i<64; ++i) desKey[i] = cp.desKey[i];
+  for (int i=0; i<16; ++i) {
+    for (int k=0; k<8; ++k) keySched[i][k] = cp.keySched[i][k];
+  }
 }
 
 //---------------------------------------------------------------------------
@@ -397,7 +428,9 @@ DesCipher::DesCipher(const DesCipher& cp)
 DesCipher& DesCipher::operator=(const DesCipher& src)
 {
   for (int i=0; i<8; ++i) chKey[i] = src.chKey[i];
-  for (int i=0; i<64; ++i) desKey[i] = src.desKey[i];
+  for (int i=0; i<16; ++i) {
+    for (int k=0; k<8; ++k) keySched[i][k] = src.keySched[i][k];
+  }
 
   return *this;
 }
@@ -419,15 +452,10 @@ DesCipher& DesCipher::operator=(const DesCipher& src)
 
 bool DesCipher::encrypt(const char *plainTxt, int len, char *cipherTxt)
 {
-  DesBlock expPlain, expCipher, locKey;
-
   if (len&7) return false;
 
   while (len >= 8) {
-    desExpand(plainTxt,expPlain);
-    copyBlock(desKey,locKey);
-    descrypt(expPlain, locKey, expCipher, true);
-    desCompress(expCipher,cipherTxt);
+    descrypt(keySched, plainTxt, cipherTxt, true);
 
     plainTxt += 8; cipherTxt += 8; len -= 8;
   }
@@ -452,15 +480,10 @@ bool DesCipher::encrypt(const char *plainTxt, int len, char *cipherTxt)
 
 bool DesCipher::decrypt(const char *cipherTxt, int len, char *plainTxt)
 {
- DesBlock expPlain, expCipher, locKey;
-
  if (len&7) return false;
 
  while (len >= 8) {
-   desExpand(cipherTxt,expCipher);
-   copyBlock(desKey,locKey);
-   descrypt(expCipher, locKey, expPlain, false);
-   desCompress(expPlain,plainTxt);
+   descrypt(keySched, cipherTxt, plainTxt, false);
 
    cipherTxt += 8; plainTxt += 8; len -= 8;
   }
@@ -28,6 +28,11 @@
 
 #include "EventDispatcher.h"
 
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
 namespace Ino
 {
 
@@ -54,25 +59,357 @@ namespace Ino
     EventDispatcher::fireListeners().
 */
 
+
 //---------------------------------------------------------------------------
+// An immutable snapshot of the registered listeners. A new snapshot is
+// published for every change, firing threads keep the one they started
+// with.
 
-class EventLstEntry
+class EventDispatcherImp;
+
+class EventLstSnap
 {
-  EventLstEntry(const EventLstEntry& cp);
-  EventLstEntry& operator=(const EventLstEntry& src);
+  EventLstSnap(const EventLstSnap& cp);
+  EventLstSnap& operator=(const EventLstSnap& src);
 
 public:
-  EventLstEntry *nxt;
-  EventListener& listener;
+  std::atomic<int> users; // Fires using it, plus one while published
+  int sz;
+  EventListener **lst;
+
+  EventDispatcherImp& owner;
+  long seq;                    // Order of publishing
+  EventLstSnap *older, *newer; // Chain of live snapshots (owner.liveMtx)
 
-  EventLstEntry(EventListener& newListener);
+  EventLstSnap(EventDispatcherImp& own, int size);
+  ~EventLstSnap();
+
+  int find(const EventListener& listener) const;
+
+  void release();
 };
 
 //---------------------------------------------------------------------------
 
-EventLstEntry::EventLstEntry(EventListener& newListener)
-: nxt(0), listener(newListener)
+EventLstSnap::EventLstSnap(EventDispatcherImp& own, int size)
+: users(1), sz(size), lst(size > 0 ? new EventListener*[size] : 0),
+  owner(own), seq(0), older(0), newer(0)
+{
+}
+
+//---------------------------------------------------------------------------
+
+EventLstSnap::~EventLstSnap()
+{
+  delete[] lst;
+}
+
+//---------------------------------------------------------------------------
+
+int EventLstSnap::find(const EventListener& listener) const
+{
+  for (int i=0; i<sz; ++i) {
+    if (lst[i] == &listener) return i;
+  }
+
+  return -1;
+}
+
+//---------------------------------------------------------------------------
+// The fires in progress on this thread, innermost first
+
+struct EventFireFrame
+{
+  const EventDispatcherImp *imp;
+  EventFireFrame *outer;
+};
+
+static thread_local EventFireFrame *fireFrames = 0;
+
+//---------------------------------------------------------------------------
+
+class EventDispatcherImp
+{
+  EventDispatcherImp(const EventDispatcherImp& cp);
+  EventDispatcherImp& operator=(const EventDispatcherImp& src);
+
+public:
+  std::atomic<EventLstSnap *> snap;
+  std::atomic<int> pinning; // Threads between loading snap and using it
+  std::mutex wrtMtx;        // Serializes changes of the listener list
+
+  std::mutex liveMtx;       // Guards the chain of live snapshots
+  EventLstSnap *oldest, *newest;
+  long lastSeq;
+
+  // Queued delivery
+
+  std::mutex modeMtx, qMtx;
+  std::condition_variable qCv, doneCv;
+  std::thread *thr;
+
+  void **queue;
+  int qSz, qCap;
+  bool coalesce;   // Drop an event equal to the last queued one
+  bool delivering, stopping;
+
+  EventDispatcherImp();
+  ~EventDispatcherImp();
+
+  EventLstSnap *acquire();
+  EventLstSnap *publish(EventLstSnap *newSnap);
+  void unlink(EventLstSnap *oldSnap);
+
+  bool firingHere() const;
+  void waitForFires(long seq);
+
+  void add(EventListener& listener);
+
+  void fire(EventDispatcher& src, void *param);
+  bool enqueue(void *param);
+  void deliverLoop(EventDispatcher& src);
+};
+
+//---------------------------------------------------------------------------
+
+EventDispatcherImp::EventDispatcherImp()
+: snap(0), pinning(0), oldest(0), newest(0), lastSeq(0), thr(0),
+  queue(0), qSz(0), qCap(0), coalesce(false),
+  delivering(false), stopping(false)
+{
+  EventLstSnap *first = new EventLstSnap(*this,0);
+
+  oldest = newest = first;
+  snap.store(first);
+}
+
+//---------------------------------------------------------------------------
+
+EventDispatcherImp::~EventDispatcherImp()
+{
+  snap.load()->release();
+
+  delete[] queue;
+}
+
+//---------------------------------------------------------------------------
+// Returns the current snapshot, to be released by the caller
+
+EventLstSnap *EventDispatcherImp::acquire()
+{
+  pinning.fetch_add(1);
+
+  EventLstSnap *cur = snap.load();
+  cur->users.fetch_add(1);
+
+  pinning.fetch_sub(1);
+
+  return cur;
+}
+
+//---------------------------------------------------------------------------
+// Replaces the snapshot, wrtMtx must be locked. Returns the old one,
+// its published reference is to be released by the caller.
+
+EventLstSnap *EventDispatcherImp::publish(EventLstSnap *newSnap)
+{
+  {
+    std::unique_lock<std::mutex> lock(liveMtx);
+
+    newSnap->seq   = ++lastSeq;
+    newSnap->older = newest;
+    newest->newer  = newSnap;
+    newest = newSnap;
+  }
+
+  EventLstSnap *oldSnap = snap.exchange(newSnap);
+
+  // A thread that loaded the old snapshot has not necessarily counted
+  // itself as a user yet, this takes only a few instructions
+
+  while (pinning.load() != 0) std::this_thread::yield();
+
+  return oldSnap;
+}
+
+//---------------------------------------------------------------------------
+// Removes a snapshot that is no longer used from the chain
+
+void EventDispatcherImp::unlink(EventLstSnap *oldSnap)
+{
+  std::unique_lock<std::mutex> lock(liveMtx);
+
+  if (oldSnap->older) oldSnap->older->newer = oldSnap->newer;
+  else oldest = oldSnap->newer;
+
+  if (oldSnap->newer) oldSnap->newer->older = oldSnap->older;
+  else newest = oldSnap->older;
+}
+
+//---------------------------------------------------------------------------
+
+void EventLstSnap::release()
+{
+  if (users.fetch_sub(1) != 1) return;
+
+  owner.unlink(this);
+
+  delete this;
+}
+
+//---------------------------------------------------------------------------
+// Is this thread within a fire of this dispatcher?
+
+bool EventDispatcherImp::firingHere() const
+{
+  for (EventFireFrame *fr = fireFrames; fr; fr = fr->outer) {
+    if (fr->imp == this) return true;
+  }
+
+  return false;
+}
+
+//---------------------------------------------------------------------------
+// Waits until all snapshots published before the one with seq are no
+// longer used by any fire. wrtMtx must not be locked: a listener that
+// is waited for may add or remove listeners itself.
+// Not from within a fire of this dispatcher, that fire would wait on
+// itself.
+
+void EventDispatcherImp::waitForFires(long seq)
+{
+  if (firingHere()) return;
+
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(liveMtx);
+
+      if (!oldest || oldest->seq >= seq) return;
+    }
+
+    std::this_thread::yield();
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void EventDispatcherImp::add(EventListener& listener)
+{
+  std::unique_lock<std::mutex> lock(wrtMtx);
+
+  EventLstSnap *cur = snap.load();
+  if (cur->find(listener) >= 0) return; // Already in list
+
+  EventLstSnap *newSnap = new EventLstSnap(*this,cur->sz+1);
+
+  for (int i=0; i<cur->sz; ++i) newSnap->lst[i] = cur->lst[i];
+  newSnap->lst[cur->sz] = &listener;
+
+  EventLstSnap *oldSnap = publish(newSnap);
+
+  lock.unlock();
+
+  oldSnap->release();
+}
+
+//---------------------------------------------------------------------------
+
+void EventDispatcherImp::fire(EventDispatcher& src, void *param)
+{
+  EventLstSnap *cur = acquire();
+
+  EventFireFrame frame = { this, fireFrames };
+  fireFrames = &frame;
+
+  try {
+    for (int i=0; i<cur->sz; ++i) cur->lst[i]->actionDone(src,param);
+  }
+  catch (...) {
+    fireFrames = frame.outer;
+    cur->release();
+
+    throw;
+  }
+
+  fireFrames = frame.outer;
+  cur->release();
+}
+
+//---------------------------------------------------------------------------
+// Returns false if not in queued mode
+
+bool EventDispatcherImp::enqueue(void *param)
 {
+  {
+    std::unique_lock<std::mutex> lock(qMtx);
+
+    if (!thr || stopping) return false;
+
+    if (coalesce && qSz > 0 && queue[qSz-1] == param) return true;
+
+    if (qSz >= qCap) {
+      int newCap = qCap < 16 ? 16 : qCap*2;
+      void **newQueue = new void*[newCap];
+
+      for (int i=0; i<qSz; ++i) newQueue[i] = queue[i];
+
+      delete[] queue;
+
+      queue = newQueue;
+      qCap  = newCap;
+    }
+
+    queue[qSz++] = param;
+  }
+
+  qCv.notify_one();
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void EventDispatcherImp::deliverLoop(EventDispatcher& src)
+{
+  void **batch = 0;
+  int batchCap = 0;
+
+  std::unique_lock<std::mutex> lock(qMtx);
+
+  for (;;) {
+    while (qSz < 1 && !stopping) qCv.wait(lock);
+
+    if (qSz < 1) break; // Stopping and nothing left to deliver
+
+    // Swap the queue, so new events can be queued while delivering
+
+    void **tmp = batch;
+    int tmpCap = batchCap, batchSz = qSz;
+
+    batch = queue; batchCap = qCap;
+    queue = tmp;   qCap = tmpCap;
+    qSz = 0;
+
+    delivering = true;
+
+    lock.unlock();
+
+    for (int i=0; i<batchSz; ++i) {
+      try {
+        fire(src,batch[i]);
+      }
+      catch (...) {
+        // Nobody to report to, the other listeners still get the event
+      }
+    }
+
+    lock.lock();
+
+    delivering = false;
+    doneCv.notify_all();
+  }
+
+  delete[] batch;
 }
 
 //---------------------------------------------------------------------------
@@ -83,7 +420,13 @@ EventLstEntry::EventLstEntry(EventListener& newListener)
     Derive a class from this class to make it an \c EventDispatcher.\n
     Then call fireListeners() to fire an event to all registered listeners.
 
-    \attention This class is currently \b not \b synchronized in any way!.
+    Listeners may be added and removed from any thread, also from within
+    EventListener::actionDone(). Firing takes no locks: each fire walks the
+    list of listeners as it was when the fire started. A listener that is
+    added or removed during a fire may or may not be called by that fire.
+
+    In \link setQueued() queued \endlink mode the events are delivered
+    on a separate dispatcher thread.
 */
 
 //! Constructor.
@@ -92,70 +435,85 @@ EventLstEntry::EventLstEntry(EventListener& newListener)
 */
 
 EventDispatcher::EventDispatcher()
-: fstEnt(0)
+: imp(*new EventDispatcherImp())
 {
 }
 
 //---------------------------------------------------------------------------
 //! Destructor.
-/*! First de-registers all \link EventListener event listeners \endlink and
-    then destroys itself.
+/*! First delivers any queued events, then de-registers all
+    \link EventListener event listeners \endlink and then destroys itself.
 */
 
 EventDispatcher::~EventDispatcher()
 {
+  setQueued(false);
   removeAllListeners();
+
+  delete &imp;
 }
 
 //---------------------------------------------------------------------------
 //! Copy constructor.
 /*! After construction registers with itself all \link EventListener
     event listeners \endlink that are also registerd with 
-    dispatcher \a cp.
+    dispatcher \a cp.\n
+    The new dispatcher is not in queued mode.
     \param cp The EventDispatcher to copy construct from.
 */
 
 EventDispatcher::EventDispatcher(const EventDispatcher& cp)
-: fstEnt(0)
+: imp(*new EventDispatcherImp())
 {
-  EventLstEntry *srcEnt = cp.fstEnt;
+  EventLstSnap *srcSnap = cp.imp.acquire();
 
-  while (srcEnt) {
-    addListener(srcEnt->listener);
-    srcEnt = srcEnt->nxt;
-  }
+  for (int i=0; i<srcSnap->sz; ++i) addListener(*srcSnap->lst[i]);
+
+  srcSnap->release();
 }
 
 //---------------------------------------------------------------------------
 //! Assignment operator.
 /*! First deregisters all its \link EventListener listeners \endlink and
-    then registers all listeners from \c src to itself.
+    then registers all listeners from \c src to itself.\n
+    Does not change the queued mode.
     \param src The %EventDispatcher to use as a source.
     \return A reference to itself.
 */
 
 EventDispatcher& EventDispatcher::operator=(const EventDispatcher& src)
 {
+  if (&src == this) return *this;
+
   removeAllListeners();
 
-  EventLstEntry *srcEnt = src.fstEnt;
+  EventLstSnap *srcSnap = src.imp.acquire();
 
-  while (srcEnt) {
-    addListener(srcEnt->listener);
-    srcEnt = srcEnt->nxt;
-  }
+  for (int i=0; i<srcSnap->sz; ++i) addListener(*srcSnap->lst[i]);
+
+  srcSnap->release();
 
   return *this;
 }
 
 //---------------------------------------------------------------------------
-/** \fn bool EventDispatcher::hasListeners()
-   Returns \c true if at least one EventListener has registered itself
+/** Returns \c true if at least one EventListener has registered itself
    with this dispatcher.
    \return \c true if there is at least one listener,\n
    \c false otherwise.
 */
 
+bool EventDispatcher::hasListeners() const
+{
+  EventLstSnap *cur = imp.acquire();
+
+  bool has = cur->sz > 0;
+
+  cur->release();
+
+  return has;
+}
+
 //---------------------------------------------------------------------------
 //! Registers a new EventListener with this class.
 /*! If \a newListener is already registered with this class then nothing
@@ -165,89 +523,183 @@ EventDispatcher& EventDispatcher::operator=(const EventDispatcher& src)
 
 void EventDispatcher::addListener(EventListener& newListener)
 {
-  EventLstEntry *ent = fstEnt;
-
-  while (ent) {
-    if (&ent->listener == &newListener) return; // Already in list
-    ent = ent->nxt;
-  }
-
-  EventLstEntry *newEnt = new EventLstEntry(newListener);
-
-  if (!fstEnt) fstEnt = newEnt;
-  else {
-    ent = fstEnt;
-    while (ent->nxt) ent = ent->nxt;
-
-    ent->nxt = newEnt;
-  }
+  imp.add(newListener);
 }
 
 //---------------------------------------------------------------------------
 //! De-registers an EventListener with this class.
 /*! If \a oldListener is not currently registered with this class nothing
-    happens.
+    happens.\n
+    Unless called from within EventListener::actionDone(), this method
+    waits until fires on other threads that may still call \a oldListener
+    are done, so \a oldListener may be destroyed afterwards.
     \param oldListener The EventListener to de-register.
 */
 
 void EventDispatcher::removeListener(EventListener& oldListener)
 {
-  if (!fstEnt) return;
+  std::unique_lock<std::mutex> lock(imp.wrtMtx);
 
-  if (&fstEnt->listener == &oldListener) {
-    EventLstEntry *ent = fstEnt;
-    fstEnt = ent->nxt;
+  EventLstSnap *cur = imp.snap.load();
 
-    delete ent;
-  }
-  else {
-    EventLstEntry *prv = fstEnt, *nxt = prv->nxt;
-
-    while (nxt) {
-      if (&nxt->listener == &oldListener) {
-        prv->nxt = nxt->nxt;
-        delete nxt;
-        return;
-      }
+  int idx = cur->find(oldListener);
+  if (idx < 0) return;
 
-      prv = nxt;
-      nxt = prv->nxt;
-    }
+  EventLstSnap *newSnap = new EventLstSnap(imp,cur->sz-1);
+
+  for (int i=0, j=0; i<cur->sz; ++i) {
+    if (i != idx) newSnap->lst[j++] = cur->lst[i];
   }
+
+  EventLstSnap *oldSnap = imp.publish(newSnap);
+  long seq = newSnap->seq;
+
+  lock.unlock();
+
+  oldSnap->release();
+  imp.waitForFires(seq);
 }
 
 //---------------------------------------------------------------------------
 /*! \brief De-registers all \link Ino::EventListener EventListeners \endlink
      with this class.
+
+     Waits for fires on other threads like removeListener() does.
 */
 
 void EventDispatcher::removeAllListeners()
 {
-  while (fstEnt) {
-    EventLstEntry *ent = fstEnt;
-    fstEnt = ent->nxt;
-    delete ent;
-  }
+  std::unique_lock<std::mutex> lock(imp.wrtMtx);
+
+  if (imp.snap.load()->sz < 1) return;
+
+  EventLstSnap *newSnap = new EventLstSnap(imp,0);
+
+  EventLstSnap *oldSnap = imp.publish(newSnap);
+  long seq = newSnap->seq;
+
+  lock.unlock();
+
+  oldSnap->release();
+  imp.waitForFires(seq);
 }
 
 //---------------------------------------------------------------------------
 /*! \brief Calls EventListeners::actionDone() on all registered 
     \link Ino::EventListener listeners \endlink.
 
-    There is no guarantee that the listeners will be called in any
-    particular order.
+    The listeners are called in the order in which they were registered.\n
+    In \link setQueued() queued \endlink mode the event is queued and
+    this method returns at once.
     \param param This value is passed on as the second parameters to
     method EventListener::actionDone().
 */
 
 void EventDispatcher::fireListeners(void *param)
 {
-  EventLstEntry *ent = fstEnt;
+  if (imp.enqueue(param)) return;
+
+  imp.fire(*this,param);
+}
+
+//---------------------------------------------------------------------------
+/*! \brief Switches queued delivery on or off.
+
+    In queued mode fireListeners() only queues the event. A dispatcher
+    thread calls the listeners, in the order in which the events were
+    fired.\n
+    Exceptions thrown by listeners on the dispatcher thread are ignored.
+
+    Switching queued mode off first delivers all queued events.\n
+    Must not be called from within EventListener::actionDone().
+    \param queued \c true to deliver on the dispatcher thread.
+
+    \note A derived class whose listeners depend on the derived part
+    should call \c setQueued(false) in its destructor.
+*/
+
+void EventDispatcher::setQueued(bool queued)
+{
+  std::unique_lock<std::mutex> modeLock(imp.modeMtx);
 
-  while (ent) {
-    ent->listener.actionDone(*this,param);
-    ent = ent->nxt;
+  std::unique_lock<std::mutex> lock(imp.qMtx);
+
+  if (queued == (imp.thr != 0)) return;
+
+  if (queued) {
+    imp.stopping = false;
+    imp.thr = new std::thread(&EventDispatcherImp::deliverLoop,&imp,
+                                                           std::ref(*this));
+    return;
   }
+
+  imp.stopping = true;
+
+  lock.unlock();
+
+  imp.qCv.notify_all();
+  imp.thr->join();
+
+  lock.lock();
+
+  delete imp.thr;
+  imp.thr = 0;
+}
+
+//---------------------------------------------------------------------------
+/** Returns \c true if this dispatcher is in queued mode.
+*/
+
+bool EventDispatcher::isQueued() const
+{
+  std::unique_lock<std::mutex> lock(imp.qMtx);
+
+  return imp.thr != 0 && !imp.stopping;
+}
+
+//---------------------------------------------------------------------------
+/*! \brief Switches coalescing of queued events on or off.
+
+    When on, an event whose \c param equals that of the last event still
+    queued is dropped, so a burst of identical events is delivered once.
+    Events are never reordered.\n
+    Has no effect if not in \link setQueued() queued \endlink mode.
+    Off by default.
+    \param coalesced \c true to drop repeated events.
+*/
+
+void EventDispatcher::setCoalesced(bool coalesced)
+{
+  std::unique_lock<std::mutex> lock(imp.qMtx);
+
+  imp.coalesce = coalesced;
+}
+
+//---------------------------------------------------------------------------
+/** Returns \c true if repeated queued events are dropped.
+*/
+
+bool EventDispatcher::isCoalesced() const
+{
+  std::unique_lock<std::mutex> lock(imp.qMtx);
+
+  return imp.coalesce;
+}
+
+//---------------------------------------------------------------------------
+/*! \brief Waits until all queued events are delivered.
+
+    Returns at once if not in queued mode or if called from within
+    EventListener::actionDone() on the dispatcher thread.
+*/
+
+void EventDispatcher::flushEvents()
+{
+  std::unique_lock<std::mutex> lock(imp.qMtx);
+
+  if (!imp.thr || imp.thr->get_id() == std::this_thread::get_id()) return;
+
+  while (imp.qSz > 0 || imp.delivering) imp.doneCv.wait(lock);
 }
 
 } // namespace Ino
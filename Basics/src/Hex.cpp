@@ -9,6 +9,7 @@
 //---------------------------------------------------------------------------
 
 #include "Hex.h"
+#include "Writer.h"
 
 #include <cstring>
 #include <ctype.h>
@@ -23,17 +24,113 @@ static const char b16Chars[] = {
     '8','9','A','B','C','D','E','F',
   };
 
-static char b16Rev[128];
+const int b16ChunkSz = 4096; // Input bytes per chunk for a Writer
 
-static void calcRevList()
+//---------------------------------------------------------------------------
+
+struct HexTables
+{
+  char enc[256][2];     // Both characters of each byte
+  signed char rev[256]; // -1 if not a hex character
+
+  HexTables();
+};
+
+//---------------------------------------------------------------------------
+
+HexTables::HexTables()
 {
-  for (int i=0; i<128; ++i) b16Rev[i] = -1;
-  for (int i=0; i<16; ++i) b16Rev[(int)(b16Chars[i])] = (char)i;
-  for (int i=0; i<16; ++i) b16Rev[tolower(b16Chars[i])] = (char)i;
+  for (int i=0; i<256; ++i) {
+    enc[i][0] = b16Chars[i >> 4];
+    enc[i][1] = b16Chars[i & 0x0F];
+
+    rev[i] = -1;
+  }
+
+  for (int i=0; i<16; ++i) {
+    rev[(unsigned char)b16Chars[i]] = (signed char)i;
+    rev[tolower(b16Chars[i])] = (signed char)i;
+  }
 }
 
 //---------------------------------------------------------------------------
 
+static const HexTables& hexTables()
+{
+  static const HexTables tables; // Built on first use, thread safe
+
+  return tables;
+}
+
+//---------------------------------------------------------------------------
+// ---- SSSE3 encode kernel, 16 bytes -> 32 characters per step ------------
+//---------------------------------------------------------------------------
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define INO_HEX_SSSE3
+#define INO_HEX_SSSE3_TARGET __attribute__((target("ssse3")))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define INO_HEX_SSSE3
+#define INO_HEX_SSSE3_TARGET
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#ifdef INO_HEX_SSSE3
+
+static bool detectSsse3()
+{
+#ifdef _MSC_VER
+  int info[4];
+  __cpuid(info,1);
+
+  return (info[2] & (1 << 9)) != 0;
+#else
+  __builtin_cpu_init();
+
+  return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+//---------------------------------------------------------------------------
+
+static bool hasSsse3()
+{
+  static const bool has = detectSsse3(); // Once, thread safe
+
+  return has;
+}
+
+//---------------------------------------------------------------------------
+// Returns the bytes consumed, a multiple of 16
+
+INO_HEX_SSSE3_TARGET
+static int encodeSsse3(const char *msg, int len, char *code)
+{
+  const __m128i lut = _mm_setr_epi8('0','1','2','3','4','5','6','7',
+                                    '8','9','A','B','C','D','E','F');
+  const __m128i nibMsk = _mm_set1_epi8(0x0f);
+
+  int done = 0;
+
+  for (; len - done >= 16; done += 16, code += 32) {
+    __m128i in = _mm_loadu_si128((const __m128i *)(msg + done));
+
+    __m128i hi = _mm_shuffle_epi8(lut,_mm_and_si128(_mm_srli_epi16(in,4),nibMsk));
+    __m128i lo = _mm_shuffle_epi8(lut,_mm_and_si128(in,nibMsk));
+
+    _mm_storeu_si128((__m128i *)code,_mm_unpacklo_epi8(hi,lo));
+    _mm_storeu_si128((__m128i *)(code+16),_mm_unpackhi_epi8(hi,lo));
+  }
+
+  return done;
+}
+
+#endif
+
+//---------------------------------------------------------------------------
+
 void Hex::ensureCap(int minCap)
 {
   if (minCap < 1) minCap = 1;
@@ -61,7 +158,6 @@ void Hex::ensureCap(int minCap)
 Hex::Hex()
 : buf(NULL), cap(0)
 {
-  calcRevList();
 }
 
 //---------------------------------------------------------------------------
@@ -80,73 +176,121 @@ const char *Hex::encode(const char *msg, int len, int& codeLen)
 
   if (!msg || len < 0) return NULL;
 
-  if (len < 1) {
-    ensureCap(1);
-    buf[0] = '\0';
+  ensureCap(len*2+1);
 
-    return buf;
-  }
+  codeLen = encode(msg,len,buf);
+  buf[codeLen] = '\0';
+
+  return buf;
+}
 
-  codeLen = len * 2;
+//---------------------------------------------------------------------------
 
-  ensureCap(codeLen+1);
+const char *Hex::decode(const char *msg, int len, int& decodeLen)
+{
+  decodeLen = 0;
 
-  int h1=0, h2=0, pos=0;
+  if (!msg || len < 0) return NULL;
 
-  for (int i=0; i<len; ++i) {
-    h1 = (msg[i] & 0xF0) >> 4;
-    h2 = msg[i] & 0x0F;
+  ensureCap((len+1)/2+1);
 
-    buf[pos++] = b16Chars[h1];
-    buf[pos++] = b16Chars[h2];
-  }
+  int dLen = decode(msg,len,buf);
+  if (dLen < 0) return NULL;
 
-  buf[codeLen] = '\0';
+  decodeLen = dLen;
 
   return buf;
 }
 
 //---------------------------------------------------------------------------
+// Converts in chunks, without buffering the whole message
+bool Hex::encode(const char *msg, int len, Writer& wrt)
+{
+  if (len < 0 || (len > 0 && !msg)) return false;
 
-const char *Hex::decode(const char *msg, int len, int& decodeLen)
+  ensureCap(b16ChunkSz*2);
+
+  while (len > 0) {
+    int chunk = len < b16ChunkSz ? len : b16ChunkSz;
+
+    if (!wrt.write(buf,encode(msg,chunk,buf))) return false;
+
+    msg += chunk; len -= chunk;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// Converts in chunks, without buffering the whole message
+bool Hex::decode(const char *msg, int len, Writer& wrt)
 {
-  decodeLen = 0;
+  if (len < 0 || (len > 0 && !msg)) return false;
 
-  if (!msg || len < 0) return NULL;
+  ensureCap(b16ChunkSz);
+
+  while (len > 0) {
+    int chunk = len < b16ChunkSz*2 ? len : b16ChunkSz*2;
+
+    int dLen = decode(msg,chunk,buf);
+    if (dLen < 0 || !wrt.write(buf,dLen)) return false;
+
+    msg += chunk; len -= chunk;
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// code must hold at least 2*len characters
+int Hex::encode(const char *msg, int len, char *code)
+{
+  const HexTables& tbl = hexTables();
+
+  int i = 0;
 
-  if (len < 1) {
-    ensureCap(1);
-    buf[0] = '\0';
+#ifdef INO_HEX_SSSE3
+  if (len >= 16 && hasSsse3()) i = encodeSsse3(msg,len,code);
+#endif
 
-    return buf;
+  for (; i<len; ++i) {
+    const char *enc = tbl.enc[(unsigned char)msg[i]];
+
+    code[2*i]   = enc[0];
+    code[2*i+1] = enc[1];
   }
 
-  decodeLen = (len+1)/2;
+  return len*2;
+}
+
+//---------------------------------------------------------------------------
+// data must hold at least (len+1)/2 bytes, returns -1 if msg is not valid hex
+int Hex::decode(const char *msg, int len, char *data)
+{
+  if (len < 0) return -1;
 
-  ensureCap(decodeLen+1);
+  const signed char *rev = hexTables().rev;
+  const unsigned char *in = (const unsigned char *)msg;
 
   int pos = 0;
 
-  for (int i=0; i<len; ++i) {
-
-    if (msg[i] < 0) {
-      decodeLen = 0;
-      return NULL;
-    }
-
-    int code = b16Rev[(int)(msg[i])];
-    if (code < 0) {
-       decodeLen = 0;
-       return NULL;
-    } else {
-      if (i % 2 == 0)
-        buf[pos] = (code << 4) & 0xF0; 
-      else
-        buf[pos++] |= code; 
-    }
+  for (int i=0; i+1<len; i += 2) {
+    int hi = rev[in[i]], lo = rev[in[i+1]];
+    if ((hi | lo) < 0) return -1;
+
+    data[pos++] = (char)(hi << 4 | lo);
   }
 
-  return buf;
+  // Odd length, the last nibble goes into the high half
+
+  if (len % 2 != 0) {
+    int hi = rev[in[len-1]];
+    if (hi < 0) return -1;
+
+    data[pos++] = (char)(hi << 4);
+  }
+
+  return pos;
 }
 
 } // namespace Ino
@@ -0,0 +1,470 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- Re-entrant number formatting and parsing --------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "NumConv.h"
+#include "Basics.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <climits>
+#include <cwchar>
+#include <cwctype>
+#include <cctype>
+
+#ifdef _WIN32
+#define snprintf _snprintf
+#endif
+
+namespace Ino
+{
+
+//---------------------------------------------------------------------------
+/** \addtogroup general_functions General Functions
+ @{
+*/
+
+//---------------------------------------------------------------------------
+/** \file NumConv.h
+  Number formatting and parsing functions that work on caller supplied
+  buffers and character ranges.
+
+  They neither allocate memory nor use static buffers, so they may be
+  called from any thread. Fixed point doubles and plain decimal numbers
+  are converted without going through the C library, the results are the
+  same as those of \c printf("%.*f") and \c strtod.
+*/
+
+//---------------------------------------------------------------------------
+
+static const char digitPairs[] =
+  "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+  "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+  "8081828384858687888990919293949596979899";
+
+static const double dblPow10[] = {
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+static const unsigned __int64 intPow10[] = {
+  1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+  10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+  100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+  100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+  100000000000000000ULL
+};
+
+const int MaxFixedDigits = 17;
+
+// Fixed point values below this bound (after scaling) are rounded
+// directly, the relative error of the scaling is 2^-53.
+
+const double FixedScaledMax = 1e15;
+const double FixedScaleErr  = 2.3e-16;
+
+//---------------------------------------------------------------------------
+// Writes the digits of val backwards, ending just before end.
+// Returns the start of the digits.
+
+static char *putDigits(unsigned __int64 val, char *end)
+{
+  while (val >= 100) {
+    int pr = (int)(val % 100) * 2;
+    val /= 100;
+
+    *--end = digitPairs[pr+1];
+    *--end = digitPairs[pr];
+  }
+
+  if (val >= 10) {
+    int pr = (int)val * 2;
+
+    *--end = digitPairs[pr+1];
+    *--end = digitPairs[pr];
+  }
+  else *--end = (char)('0' + val);
+
+  return end;
+}
+
+//---------------------------------------------------------------------------
+// Writes n / 10^digits with exactly digits fractional digits
+
+static int putFixed(unsigned __int64 n, int digits, bool neg, char *buf,
+                                                                    int cap)
+{
+  char tmp[48];
+  char *end = tmp + sizeof(tmp);
+  char *s = end;
+
+  if (digits > 0) {
+    unsigned __int64 frac = n % intPow10[digits];
+    n /= intPow10[digits];
+
+    char *fs = putDigits(frac,s);
+    while (s - fs < digits) *--fs = '0';
+
+    s = fs;
+    *--s = '.';
+  }
+
+  s = putDigits(n,s);
+  if (neg) *--s = '-';
+
+  int len = (int)(end - s);
+  if (len >= cap) return -1;
+
+  for (int i=0; i<len; ++i) buf[i] = s[i];
+  buf[len] = '\0';
+
+  return len;
+}
+
+//---------------------------------------------------------------------------
+
+static int checkPrinted(int len, char *buf, int cap)
+{
+  if (len < 0 || len >= cap) {
+    buf[0] = '\0';
+    return -1;
+  }
+
+  return len;
+}
+
+//---------------------------------------------------------------------------
+
+static int widen(const char *s, int len, wchar_t *buf)
+{
+  for (int i=0; i<=len; ++i) buf[i] = (wchar_t)(unsigned char)s[i];
+
+  return len;
+}
+
+//---------------------------------------------------------------------------
+/** Converts an integer to an ASCII string.
+  \param val The value to convert.
+  \param buf Receives the zero terminated result, its capacity must be at
+  least 24 characters.
+  \return The number of characters written, excluding the terminating zero.
+*/
+
+int formatInt(long val, char *buf)
+{
+  char tmp[24];
+  char *end = tmp + sizeof(tmp);
+
+  unsigned __int64 mag = val < 0 ? 0ULL - (unsigned __int64)val
+                                 : (unsigned __int64)val;
+
+  char *s = putDigits(mag,end);
+  if (val < 0) *--s = '-';
+
+  int len = (int)(end - s);
+
+  for (int i=0; i<len; ++i) buf[i] = s[i];
+  buf[len] = '\0';
+
+  return len;
+}
+
+//---------------------------------------------------------------------------
+/** Converts an integer to a Unicode string.
+  \param val The value to convert.
+  \param buf Receives the zero terminated result, its capacity must be at
+  least 24 characters.
+  \return The number of characters written, excluding the terminating zero.
+*/
+
+int formatInt(long val, wchar_t *buf)
+{
+  char tmp[24];
+
+  return widen(tmp,formatInt(val,tmp),buf);
+}
+
+//---------------------------------------------------------------------------
+/** Converts a double to an ASCII string.
+  \param val The value to convert.
+  \param digits The number of fractional digits, at most 17.\n
+  If negative, the value is converted like \c printf("%G") does.
+  \param buf Receives the zero terminated result.
+  \param cap The capacity of \c buf, \ref NumBufCap is always enough.
+  \return The number of characters written, excluding the terminating zero,
+  or -1 if \c buf is too small.
+
+  The result is the same as that of \c printf("%.*f",digits,val).
+*/
+
+int formatDouble(double val, int digits, char *buf, int cap)
+{
+  if (!buf || cap < 1) return -1;
+
+  if (digits < 0) return checkPrinted(snprintf(buf,cap,"%G",val),buf,cap);
+
+  if (digits > MaxFixedDigits) digits = MaxFixedDigits;
+
+  if (std::isfinite(val)) {
+    double x = std::fabs(val) * dblPow10[digits];
+
+    if (x < FixedScaledMax) {
+      double fl = std::floor(x), frac = x - fl;
+
+      // Too close to a tie to decide on the scaled value
+
+      if (std::fabs(frac - 0.5) > x * FixedScaleErr) {
+        unsigned __int64 n = (unsigned __int64)fl + (frac > 0.5 ? 1 : 0);
+
+        return putFixed(n,digits,std::signbit(val),buf,cap);
+      }
+    }
+  }
+
+  return checkPrinted(snprintf(buf,cap,"%.*f",digits,val),buf,cap);
+}
+
+//---------------------------------------------------------------------------
+/** Converts a double to a Unicode string.
+  \see formatDouble(double val, int digits, char *buf, int cap)
+*/
+
+int formatDouble(double val, int digits, wchar_t *buf, int cap)
+{
+  if (!buf || cap < 1) return -1;
+
+  char tmp[NumBufCap];
+
+  int len = formatDouble(val,digits,tmp,cap < NumBufCap ? cap : NumBufCap);
+  if (len < 0) {
+    buf[0] = L'\0';
+    return -1;
+  }
+
+  return widen(tmp,len,buf);
+}
+
+//---------------------------------------------------------------------------
+
+template <class C> static inline bool isDigit(C c)
+{
+  return c >= '0' && c <= '9';
+}
+
+//---------------------------------------------------------------------------
+
+static bool isSpace(char c)    { return isspace((unsigned char)c) != 0; }
+static bool isSpace(wchar_t c) { return iswspace(c) != 0; }
+
+static double strToD(const char *s, char **ep)       { return strtod(s,ep); }
+static double strToD(const wchar_t *s, wchar_t **ep) { return wcstod(s,ep); }
+
+//---------------------------------------------------------------------------
+
+template <class C>
+static const C *scanIntImp(const C *first, const C *last, long& val)
+{
+  const C *p = first;
+
+  bool neg = false;
+  if (p < last && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+  const unsigned long lim = neg ? (unsigned long)LONG_MAX + 1 : LONG_MAX;
+
+  const C *digs = p;
+  unsigned long mag = 0;
+  bool ovf = false;
+
+  for (; p < last && isDigit(*p); ++p) {
+    unsigned long d = (unsigned long)(*p - '0');
+
+    if (mag > (lim - d) / 10) ovf = true;
+    else mag = mag * 10 + d;
+  }
+
+  if (p == digs) return first;
+
+  if (ovf) mag = lim;
+
+  val = neg ? (long)(0UL - mag) : (long)mag;
+
+  return p;
+}
+
+//---------------------------------------------------------------------------
+// Lets the C library convert [first,last), for anything the fast path
+// does not handle exactly
+
+template <class C>
+static const C *scanDoubleLib(const C *first, const C *last, double& val)
+{
+  if (first >= last || isSpace(*first)) return first;
+
+  int len = (int)(last - first);
+
+  C tmp[128];
+  C *s = len < 128 ? tmp : new C[len+1];
+
+  for (int i=0; i<len; ++i) s[i] = first[i];
+  s[len] = 0;
+
+  C *ep = NULL;
+  double v = strToD(s,&ep);
+
+  const C *res = first + (ep - s);
+
+  if (s != tmp) delete[] s;
+
+  if (res != first) val = v;
+
+  return res;
+}
+
+//---------------------------------------------------------------------------
+
+template <class C>
+static const C *scanDoubleImp(const C *first, const C *last, double& val)
+{
+  const C *p = first;
+
+  bool neg = false;
+  if (p < last && (*p == '-' || *p == '+')) neg = *p++ == '-';
+
+  unsigned __int64 mant = 0;
+  int sigDigs = 0, exp10 = 0, digCnt = 0;
+  bool exact = true;
+
+  for (; p < last && isDigit(*p); ++p, ++digCnt) {
+    int d = *p - '0';
+
+    if (mant == 0 && d == 0) continue;
+
+    if (sigDigs < 19) {
+      mant = mant * 10 + d;
+      sigDigs++;
+    }
+    else {
+      exp10++;
+      if (d != 0) exact = false;
+    }
+  }
+
+  if (p < last && *p == '.') {
+    for (++p; p < last && isDigit(*p); ++p, ++digCnt) {
+      int d = *p - '0';
+
+      if (mant == 0 && d == 0) exp10--;
+      else if (sigDigs < 19) {
+        mant = mant * 10 + d;
+        sigDigs++;
+        exp10--;
+      }
+      else if (d != 0) exact = false;
+    }
+  }
+
+  // Infinity, NaN and hexadecimal notation
+
+  if (digCnt < 1 || (p < last && (*p == 'x' || *p == 'X')))
+    return scanDoubleLib(first,last,val);
+
+  if (p < last && (*p == 'e' || *p == 'E')) {
+    const C *q = p + 1;
+
+    bool expNeg = false;
+    if (q < last && (*q == '-' || *q == '+')) expNeg = *q++ == '-';
+
+    if (q < last && isDigit(*q)) {
+      int e = 0;
+
+      for (; q < last && isDigit(*q); ++q) {
+        if (e < 100000) e = e * 10 + (*q - '0');
+      }
+
+      exp10 += expNeg ? -e : e;
+      p = q;
+    }
+  }
+
+  if (mant == 0) {
+    val = neg ? -0.0 : 0.0;
+    return p;
+  }
+
+  // Both the mantissa and the power of ten are exact doubles, so a single
+  // multiplication or division rounds correctly
+
+  if (exact && mant <= (1ULL << 53) && exp10 >= -22 && exp10 <= 22) {
+    double v = (double)mant;
+
+    if (exp10 < 0) v /= dblPow10[-exp10];
+    else v *= dblPow10[exp10];
+
+    val = neg ? -v : v;
+    return p;
+  }
+
+  return scanDoubleLib(first,p,val);
+}
+
+//---------------------------------------------------------------------------
+/** Reads a decimal integer from an ASCII character range.
+  \param first The first character to read, must not be white space.
+  \param last The end of the range, the range need not be zero terminated.
+  \param val Receives the value if a number is read.\n
+  Values that do not fit are clamped to \c LONG_MIN or \c LONG_MAX, as
+  \c strtol does.
+  \return The position after the number, or \c first if no number is found.
+*/
+
+const char *scanInt(const char *first, const char *last, long& val)
+{
+  return scanIntImp(first,last,val);
+}
+
+//---------------------------------------------------------------------------
+/** Reads a decimal integer from a Unicode character range.
+  \see scanInt(const char *first, const char *last, long& val)
+*/
+
+const wchar_t *scanInt(const wchar_t *first, const wchar_t *last, long& val)
+{
+  return scanIntImp(first,last,val);
+}
+
+//---------------------------------------------------------------------------
+/** Reads a double value from an ASCII character range.
+  \param first The first character to read, must not be white space.
+  \param last The end of the range, the range need not be zero terminated.
+  \param val Receives the value if a number is read.
+  \return The position after the number, or \c first if no number is found.
+
+  Accepts the same syntax as \c strtod does. Plain decimal numbers with at
+  most 19 significant digits and a small exponent are converted directly,
+  anything else is passed to \c strtod.
+*/
+
+const char *scanDouble(const char *first, const char *last, double& val)
+{
+  return scanDoubleImp(first,last,val);
+}
+
+//---------------------------------------------------------------------------
+/** Reads a double value from a Unicode character range.
+  \see scanDouble(const char *first, const char *last, double& val)
+*/
+
+const wchar_t *scanDouble(const wchar_t *first, const wchar_t *last,
+                                                              double& val)
+{
+  return scanDoubleImp(first,last,val);
+}
+
+/** @} */
+
+} // namespace Ino
+
+//---------------------------------------------------------------------------
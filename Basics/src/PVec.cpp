@@ -28,10 +28,10 @@ PVec2::PVec2(const Vec2& v)
 // --------------------------------------------------------------------------
 // Persistence Section
 
-static const char fldX[]   = "X";
-static const char fldY[]   = "Y";
-static const char fldZ[]   = "Z";
-static const char fldDer[] = "IsDer";
+static const PersistentField fldX("X");
+static const PersistentField fldY("Y");
+static const PersistentField fldZ("Z");
+static const PersistentField fldDer("IsDer");
 
 // --------------------------------------------------------------------------
 
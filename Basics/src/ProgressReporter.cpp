@@ -10,6 +10,8 @@
 
 #include "Basics.h"
 
+#include <climits>
+
 namespace Ino
 {
 
@@ -62,6 +64,10 @@ namespace Ino
     "progressReport". That will tell the Reader or Writer to stop reading
     or writing and return -1 from the \ref Reader::read(char *, int)
     "read" or \ref Writer::write(const char *, int) "write" method.
+    \n
+    setProgress() and incProgress() are meant for a reporter that is
+    used by a single thread. \ref addProgress(long) "addProgress" may be
+    called from any number of threads at once, see also ProgressChild.
 
     \author C. Wolters
     \date Jul 2005
@@ -105,11 +111,42 @@ namespace Ino
 ProgressReporter::ProgressReporter(long maxProgress, long reportIncrement,
                                                              long maxScale)
 : reportInc(reportIncrement), maxProg(maxProgress), maxSc(maxScale),
-  curProg(0), curSc(0), abort(false)
+  curSc(0), curProg(0), nextProg(0), abort(false), polled(false),
+  parentRep(NULL)
+{
+  reporting.clear();
+
+  if (reportInc < 1) reportInc = 1;
+  if (maxProg < 1) maxProg = 1;
+  if (maxSc < 1)   maxSc   = 1;
+
+  nextProg = stepAbove(0);
+}
+
+//---------------------------------------------------------------------------
+/** Constructor for a child reporter, see ProgressChild.
+   \param parent The reporter whose mustAbort() status is also the abort
+   status of this reporter.
+   \param maxProgress See
+   \ref ProgressReporter(long maxProgress, long reportIncrement, long maxScale)
+   "the public constructor".
+   \param reportIncrement Idem.
+   \param maxScale Idem.
+*/
+
+ProgressReporter::ProgressReporter(ProgressReporter& parent,
+                long maxProgress, long reportIncrement, long maxScale)
+: reportInc(reportIncrement), maxProg(maxProgress), maxSc(maxScale),
+  curSc(0), curProg(0), nextProg(0), abort(false), polled(false),
+  parentRep(&parent)
 {
+  reporting.clear();
+
   if (reportInc < 1) reportInc = 1;
-  if (maxProg < 1) maxProg   = 1;
-  if (maxScale < 1) maxScale = 1;
+  if (maxProg < 1) maxProg = 1;
+  if (maxSc < 1)   maxSc   = 1;
+
+  nextProg = stepAbove(0);
 }
 
 //---------------------------------------------------------------------------
@@ -129,8 +166,52 @@ void ProgressReporter::reset(long maxProgress, long maxScale)
   maxProg = maxProgress;
   maxSc   = maxScale;
 
-  if (maxProg < 1)  maxProg  = 1;
-  if (maxScale < 1) maxScale = 1;
+  if (maxProg < 1) maxProg = 1;
+  if (maxSc < 1)   maxSc   = 1;
+
+  nextProg = stepAbove(0);
+}
+
+//---------------------------------------------------------------------------
+
+long ProgressReporter::scaled(long prog) const
+{
+  return (long)(1.0 * prog / maxProg * maxSc);
+}
+
+//---------------------------------------------------------------------------
+// Returns the lowest progress value that scales to more than sc
+
+long ProgressReporter::stepAbove(long sc) const
+{
+  double est = 1.0 * (sc+1) * maxProg / maxSc;
+  if (est >= LONG_MAX/2) return LONG_MAX;
+
+  long prog = (long)est;
+
+  while (scaled(prog-1) > sc) prog--;
+  while (scaled(prog) <= sc) prog++;
+
+  return prog;
+}
+
+//---------------------------------------------------------------------------
+// Calls progressReport() if the scaled value of prog differs from the
+// previous one
+
+bool ProgressReporter::report(long prog)
+{
+  long newSc = scaled(prog);
+
+  nextProg.store(stepAbove(newSc),std::memory_order_relaxed);
+
+  if (newSc == curSc) return !mustAbort();
+
+  curSc = newSc;
+
+  if (!progressReport(curSc)) abort = true;
+
+  return !mustAbort();
 }
 
 //---------------------------------------------------------------------------
@@ -163,21 +244,14 @@ bool ProgressReporter::setProgress(int newProgress)
 
   curProg = newProgress;
 
-  long newSc = (long)(1.0 * curProg / maxProg * maxSc);
-
-  if (newSc == curSc) return true;
-
-  curSc = newSc;
-
-  abort = !progressReport(curSc);
-
-  return !abort;
+  return report(newProgress);
 }
 
 //---------------------------------------------------------------------------
-/** <b>Do not call:</b> Progress report method called by a Reader or Writer
+/** \fn bool ProgressReporter::incProgress(int progInc)
+    <b>Do not call:</b> Progress report method called by a Reader or Writer
     to report its progress to this class.
-    \param progressInc The incremental progress that the Reader or Writer
+    \param progInc The incremental progress that the Reader or Writer
     has made.
     \return \c true if reading or writing is to continue.\n
     \c false if the operation is to be aborted.\n
@@ -185,23 +259,74 @@ bool ProgressReporter::setProgress(int newProgress)
     The return value is determined by the value returned
     by your implementation of method \ref progressReport(int progScale)
     "progressReport".
+
+    This method is inline and costs no more than an addition and a
+    comparison until the scaled progress value changes, so it may be
+    called from within tight loops.
 */
 
-bool ProgressReporter::incProgress(int progressInc)
+//---------------------------------------------------------------------------
+/** Adds progress, may be called from several threads at once.
+    \param progInc The incremental progress.
+    \return \c false if the operation is to be aborted.
+
+    If the scaled progress value changes, the calling thread calls
+    \ref progressReport(int progScale) "progressReport", unless another
+    thread is reporting at that moment or this reporter is
+    \ref setPolled() "polled". So progressReport is never called by two
+    threads at once.\n
+    This method must not be mixed with setProgress() or incProgress().
+*/
+
+bool ProgressReporter::addProgress(long progInc)
 {
-  if (abort) return false;
+  long prog = curProg.fetch_add(progInc) + progInc;
 
-  curProg += progressInc;
+  if (polled.load(std::memory_order_relaxed) ||
+                          prog < nextProg.load(std::memory_order_relaxed))
+    return !mustAbort();
 
-  long newSc = (long)(1.0 * curProg / maxProg * maxSc);
+  // Progress added while another thread reports is picked up by
+  // that thread, after it releases the flag
 
-  if (newSc == curSc) return true;
+  while (!reporting.test_and_set()) {
+    if (!abort) report(curProg.load());
 
-  curSc = newSc;
+    reporting.clear();
+
+    if (curProg.load() < nextProg.load()) break;
+  }
+
+  return !mustAbort();
+}
+
+//---------------------------------------------------------------------------
+/** \fn void ProgressReporter::setPolled(bool poll)
+    Sets the polled mode.
+    \param poll If \c true, addProgress() never calls
+    \ref progressReport(int progScale) "progressReport", the thread that
+    owns this reporter must call poll() instead.
+*/
+
+//---------------------------------------------------------------------------
+/** Reports the progress added by addProgress(), for a polled reporter.
+    \return \c false if the operation is to be aborted.
+
+    Call this method regularly from the thread that owns this reporter,
+    for instance the user interface thread while worker threads run.
+    \ref progressReport(int progScale) "progressReport" is called if the
+    scaled progress value changed since the previous report.
+*/
 
-  abort = !progressReport(curSc);
+bool ProgressReporter::poll()
+{
+  if (!reporting.test_and_set()) {
+    if (!abort) report(curProg.load());
+
+    reporting.clear();
+  }
 
-  return !abort;
+  return !mustAbort();
 }
 
 //---------------------------------------------------------------------------
@@ -233,10 +358,82 @@ bool ProgressReporter::incProgress(int progressInc)
 //---------------------------------------------------------------------------
 /** \fn bool ProgressReporter::mustAbort() const
    Returns the abort status.
-   \return \c true If the operation will continue,\n
-   \c false If the operation must be aborted at the next opportunity.
+   \return \c true If the operation must be aborted at the next
+   opportunity, also if the parent of a ProgressChild must abort.\n
+   \c false If the operation will continue.
+*/
+
+//---------------------------------------------------------------------------
+/** \fn void ProgressReporter::requestAbort()
+   Sets the abort status, may be called from any thread.
+
+   All children of this reporter will abort as well.
+*/
+
+//---------------------------------------------------------------------------
+/** \class ProgressChild
+    A ProgressReporter that passes its progress on to a parent reporter.
+
+    Use one child per worker thread or task. The child is updated by its
+    own thread only, with the usual setProgress() or incProgress() calls,
+    and adds its progress to the parent with
+    \ref ProgressReporter::addProgress(long) "addProgress" each time its
+    own scaled value changes. Its scale is its share of the parent's
+    progress, so it never adds more than \c shareOfParent in total.\n
+    A child aborts as soon as its parent (or an ancestor) aborts.
 */
 
+//---------------------------------------------------------------------------
+/** Constructor.
+   \param parentRep The reporter to pass the progress on to, a
+   ProgressChild may itself be a parent.
+   \param shareOfParent The parent progress that corresponds with the
+   completion of this child.
+   \param maxProgress The progress value of this child that indicates
+   completion.
+   \param reportIncrement The report increment for Readers or Writers
+   that use this child.
+*/
+
+ProgressChild::ProgressChild(ProgressReporter& parentRep, long shareOfParent,
+                                     long maxProgress, long reportIncrement)
+: ProgressReporter(parentRep,maxProgress,reportIncrement,shareOfParent),
+  parent(parentRep), share(shareOfParent), reported(0)
+{
+  if (share < 1) share = 1;
+}
+
+//---------------------------------------------------------------------------
+/** Passes the progress made since the previous call on to the parent.
+   \param progScale The progress in parent units.
+   \return \c false if the parent aborts.
+*/
+
+bool ProgressChild::progressReport(int progScale)
+{
+  long inc = progScale - reported;
+  reported = progScale;
+
+  return parent.addProgress(inc);
+}
+
+//---------------------------------------------------------------------------
+/** Adds the rest of the share of this child to the parent.
+
+   Call it when the task is done, whatever its progress was.
+   \return \c false if the parent aborts.
+*/
+
+bool ProgressChild::finish()
+{
+  long inc = share - reported;
+  reported = share;
+
+  if (inc == 0) return !mustAbort();
+
+  return parent.addProgress(inc);
+}
+
 } // namespace Ino
 
 //---------------------------------------------------------------------------
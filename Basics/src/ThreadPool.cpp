@@ -0,0 +1,285 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- Fixed size pool of worker threads ---------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "ThreadPool.h"
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Ino
+{
+
+//---------------------------------------------------------------------------
+/** \class ThreadPool
+  A fixed number of worker threads that run submitted tasks in FIFO order.
+
+  A task is an instance of a subclass of ThreadPool::Task that implements
+  method \c run().\n
+  The caller owns the tasks and may wait for an individual task or
+  for all submitted tasks. A task must not be destroyed or submitted
+  again before it is done.
+*/
+
+//---------------------------------------------------------------------------
+
+static thread_local bool onWorker = false; // Set on the worker threads
+
+class ThreadPoolImp
+{
+  ThreadPoolImp(const ThreadPoolImp& cp);             // No copying
+  ThreadPoolImp& operator=(const ThreadPoolImp& src); // No assignment
+
+public:
+  std::thread *thrLst;
+  int thrCnt;
+
+  std::mutex mtx;
+  std::condition_variable workCv, doneCv;
+
+  ThreadPool::Task *first, *last;
+  int pending; // Submitted but not yet done
+  bool stopping, anyFailed;
+
+  ThreadPoolImp(int threadCount);
+  ~ThreadPoolImp();
+
+  static void runTask(ThreadPool::Task& task);
+
+  void workLoop();
+};
+
+//---------------------------------------------------------------------------
+
+ThreadPoolImp::ThreadPoolImp(int threadCount)
+: thrLst(NULL), thrCnt(threadCount), first(NULL), last(NULL),
+  pending(0), stopping(false), anyFailed(false)
+{
+  if (thrCnt < 1) return;
+
+  thrLst = new std::thread[thrCnt];
+
+  for (int i=0; i<thrCnt; ++i)
+    thrLst[i] = std::thread(&ThreadPoolImp::workLoop,this);
+}
+
+//---------------------------------------------------------------------------
+
+ThreadPoolImp::~ThreadPoolImp()
+{
+  {
+    std::unique_lock<std::mutex> lock(mtx);
+    stopping = true;
+  }
+
+  workCv.notify_all();
+
+  for (int i=0; i<thrCnt; ++i) thrLst[i].join();
+
+  delete[] thrLst;
+}
+
+//---------------------------------------------------------------------------
+
+void ThreadPoolImp::runTask(ThreadPool::Task& task)
+{
+  try {
+    task.run();
+  }
+  catch (...) {
+    task.failed = true;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void ThreadPoolImp::workLoop()
+{
+  onWorker = true;
+
+  std::unique_lock<std::mutex> lock(mtx);
+
+  for (;;) {
+    while (!first && !stopping) workCv.wait(lock);
+
+    if (!first) return; // Stopping and nothing left to do
+
+    ThreadPool::Task *task = first;
+    first = task->nextQ;
+    if (!first) last = NULL;
+
+    lock.unlock();
+
+    runTask(*task);
+
+    lock.lock();
+
+    task->nextQ = NULL;
+    task->done  = true;
+    if (task->failed) anyFailed = true;
+
+    pending--;
+
+    doneCv.notify_all();
+  }
+}
+
+//---------------------------------------------------------------------------
+/** Constructor.
+  \param threadCount The number of worker threads.\n
+  If negative, processorCount() threads are created,\n
+  if zero, no threads are created and each task is run on the calling
+  thread when it is submitted.
+*/
+
+ThreadPool::ThreadPool(int threadCount)
+: imp(*new ThreadPoolImp(threadCount < 0 ? processorCount() : threadCount))
+{
+}
+
+//---------------------------------------------------------------------------
+/** Destructor.
+
+  Waits until all submitted tasks are done.
+*/
+
+ThreadPool::~ThreadPool()
+{
+  waitAll();
+
+  delete &imp;
+}
+
+//---------------------------------------------------------------------------
+/** Returns the number of processors (hardware threads), at least one.
+*/
+
+int ThreadPool::processorCount()
+{
+  int cnt = (int)std::thread::hardware_concurrency();
+
+  return cnt < 1 ? 1 : cnt;
+}
+
+//---------------------------------------------------------------------------
+/** Returns \c true if called on a worker thread of any pool.
+
+  Code that may run within a task can use this to do its work serially
+  rather than start another pool, which would create a pool of threads
+  for each worker.
+*/
+
+bool ThreadPool::isWorkerThread()
+{
+  return onWorker;
+}
+
+//---------------------------------------------------------------------------
+/** Returns the number of worker threads.
+*/
+
+int ThreadPool::getThreadCount() const
+{
+  return imp.thrCnt;
+}
+
+//---------------------------------------------------------------------------
+/** Submits a task for execution.
+  \param task The task to run, must remain valid until it is done.
+*/
+
+void ThreadPool::submit(Task& task)
+{
+  task.done   = false;
+  task.failed = false;
+  task.nextQ  = NULL;
+
+  if (imp.thrCnt < 1) {
+    ThreadPoolImp::runTask(task);
+
+    task.done = true;
+    if (task.failed) imp.anyFailed = true;
+
+    return;
+  }
+
+  {
+    std::unique_lock<std::mutex> lock(imp.mtx);
+
+    if (imp.last) imp.last->nextQ = &task;
+    else imp.first = &task;
+
+    imp.last = &task;
+
+    imp.pending++;
+  }
+
+  imp.workCv.notify_one();
+}
+
+//---------------------------------------------------------------------------
+/** Returns \c true if \c task is done (or was never submitted).
+*/
+
+bool ThreadPool::isDone(const Task& task) const
+{
+  std::unique_lock<std::mutex> lock(imp.mtx);
+
+  return task.done;
+}
+
+//---------------------------------------------------------------------------
+/** Waits until a task is done.
+  \param task The task to wait for.
+  \return \c false if the task threw an exception, \c true otherwise.
+*/
+
+bool ThreadPool::wait(Task& task)
+{
+  std::unique_lock<std::mutex> lock(imp.mtx);
+
+  while (!task.done) imp.doneCv.wait(lock);
+
+  return !task.failed;
+}
+
+//---------------------------------------------------------------------------
+/** Waits until all submitted tasks are done.
+  \return \c false if any task threw an exception since the previous call
+  of this method, \c true otherwise.
+*/
+
+bool ThreadPool::waitAll()
+{
+  std::unique_lock<std::mutex> lock(imp.mtx);
+
+  while (imp.pending > 0) imp.doneCv.wait(lock);
+
+  bool ok = !imp.anyFailed;
+  imp.anyFailed = false;
+
+  return ok;
+}
+
+//---------------------------------------------------------------------------
+/** Runs a number of tasks and waits until they are all done.
+  \param taskLst The tasks to run.
+  \param taskCnt The number of tasks in \c taskLst.
+  \return \c false if any task threw an exception, \c true otherwise.
+
+  \note Other tasks submitted earlier are waited for as well.
+*/
+
+bool ThreadPool::runAll(Task **taskLst, int taskCnt)
+{
+  for (int i=0; i<taskCnt; ++i) submit(*taskLst[i]);
+
+  return waitAll();
+}
+
+} // namespace Ino
+
+//---------------------------------------------------------------------------
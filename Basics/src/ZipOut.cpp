@@ -12,6 +12,8 @@
 #include "ZipOut.h"
 
 #include "Exceptions.h"
+#include "ThreadPool.h"
+#include "Crc.h"
 
 #include "zlib.h"
 
@@ -21,6 +23,10 @@
 
 namespace Ino {
 
+static const char emptyDeflate[] = { 0x03, 0x00 }; // Empty final block
+
+static const __int64 Max32 = 0xFFFFFFFFLL; // Beyond this ZIP64 is needed
+
 //---------------------------------------------------------------------------
 
 class ZipFile
@@ -33,16 +39,22 @@ class ZipFile
   ZipFile& operator=(const ZipFile& src);
 
 public:
-  long startPos;
-  long rawSz, sz, crc;
+  __int64 startPos;
+  __int64 rawSz, sz;
+  long crc;
   short dosDate, dosTime;
+  short flags;            // General purpose flags
   bool compressed;
+  bool queued;            // Added with queueFile()
   bool written;
 
-  ZipFile(long curPos, const char* filePath, bool compressing);
+  ZipFile(__int64 curPos, const char* filePath, bool compressing);
   ~ZipFile();
 
   const char *getPath() const { return path; }
+
+  bool needsZip64() const
+                { return sz >= Max32 || rawSz >= Max32 || startPos >= Max32; }
 };
 
 //---------------------------------------------------------------------------
@@ -63,7 +75,7 @@ public:
 
   int size() const { return sz; }
 
-  ZipFile& append(long curPos, const char* path, bool compressing);
+  ZipFile& append(__int64 curPos, const char* path, bool compressing);
 
   ZipFile& operator[](int idx);
 };
@@ -73,6 +85,7 @@ public:
 class ZipWriter : public Writer
 {
   Writer& wrt;
+  __int64 pos;
 
   ZipWriter(const ZipWriter& cp);
   ZipWriter& operator=(const ZipWriter& src);
@@ -82,6 +95,8 @@ public:
 
   Writer& getWriter() { return wrt; }
 
+  __int64 getPos() const { return pos; }
+
   virtual bool isClosed() const { return wrt.isClosed(); }
   virtual bool isAborted() const { return wrt.isAborted(); }
   virtual long getErrorCode() const { return wrt.getErrorCode(); }
@@ -92,6 +107,51 @@ public:
   virtual bool flush() { return wrt.flush(); }
 };
 
+//---------------------------------------------------------------------------
+// Crc and compression of a queued entry, run on a worker thread
+
+class ZipJob : public ThreadPool::Task
+{
+  ZipJob(const ZipJob& cp);             // No copying
+  ZipJob& operator=(const ZipJob& src); // No assignment
+
+public:
+  ZipFile& zf;
+  char *data;
+  int dataSz;
+
+  long crc;
+  ByteArrayWriter out;
+  bool ok;                // Crc and compression succeeded
+
+  ZipJob(ZipFile& zipFile, const char *buf, int sz);
+  ~ZipJob();
+
+  virtual void run();
+};
+
+//---------------------------------------------------------------------------
+// Queued entries in the order they must be written
+
+class ZipJobQueue
+{
+  ZipJobQueue(const ZipJobQueue& cp);             // No copying
+  ZipJobQueue& operator=(const ZipJobQueue& src); // No assignment
+
+public:
+  int thrCnt;
+  ThreadPool *pool;
+
+  ZipJob **lst;
+  int cap, first, sz;
+
+  ZipJobQueue();
+  ~ZipJobQueue();
+
+  void start(ZipJob& job);
+  ZipJob *next();
+};
+
 //---------------------------------------------------------------------------
 //------- ZipFile Methods ----------------------------------------------------
 //---------------------------------------------------------------------------
@@ -113,9 +173,10 @@ void ZipFile::dosDateTime()
 
 //---------------------------------------------------------------------------
 
-ZipFile::ZipFile(long curPos, const char* filePath, bool compressing)
+ZipFile::ZipFile(__int64 curPos, const char* filePath, bool compressing)
 : path(dupStr(filePath)), startPos(curPos), rawSz(0), sz(0), crc(0),
-  dosDate(0), dosTime(0), compressed(compressing), written(false)
+  dosDate(0), dosTime(0), flags(0), compressed(compressing),
+  queued(false), written(false)
 {
   if (!path) return;
 
@@ -134,7 +195,7 @@ ZipFile::ZipFile(long curPos, const char* filePath, bool compressing)
 
   dosDateTime();
 
-  crc = crc32(0,Z_NULL,0);
+  crc = 0;
 }
 
 //---------------------------------------------------------------------------
@@ -175,7 +236,8 @@ ZipFileList::~ZipFileList()
 
 //---------------------------------------------------------------------------
 
-ZipFile& ZipFileList::append(long curPos, const char* path, bool compressing)
+ZipFile& ZipFileList::append(__int64 curPos, const char* path,
+                                                         bool compressing)
 {
   ensureCapacity(sz+1);
 
@@ -200,7 +262,7 @@ ZipFile& ZipFileList::operator[](int idx)
 //---------------------------------------------------------------------------
 
 ZipWriter::ZipWriter(Writer& writer)
-: Writer(NULL), wrt(writer)
+: Writer(NULL), wrt(writer), pos(0)
 {
 }
 
@@ -214,23 +276,134 @@ bool ZipWriter::write(const char *buf, int sz)
 
   bytesWritten += sz;
   bytesInc     += sz;
+  pos          += sz;
 
   return true;
 }
 
 //---------------------------------------------------------------------------
-//------- ZipOut Methods ----------------------------------------------------
+//------- ZipJob Methods ----------------------------------------------------
+//---------------------------------------------------------------------------
+
+ZipJob::ZipJob(ZipFile& zipFile, const char *buf, int sz)
+: zf(zipFile), data(new char[sz > 0 ? sz : 1]), dataSz(sz),
+  crc(0), out(zipFile.compressed ? sz/2 + 64 : 0,0), ok(false)
+{
+  if (sz > 0) memcpy(data,buf,sz);
+}
+
+//---------------------------------------------------------------------------
+
+ZipJob::~ZipJob()
+{
+  delete[] data;
+}
+
+//---------------------------------------------------------------------------
+
+void ZipJob::run()
+{
+  crc = (long)updateCrc32(0,data,dataSz);
+
+  if (!zf.compressed) {
+    ok = true;
+    return;
+  }
+
+  if (dataSz < 1) ok = out.write(emptyDeflate,2);
+  else {
+    CompressedWriter cWrt(out,16*1024);
+    cWrt.setRawDeflate(true);
+
+    ok = cWrt.write(data,dataSz) && cWrt.flush();
+  }
+
+  delete[] data; // No longer needed
+  data = NULL;
+}
+
+//---------------------------------------------------------------------------
+//------- ZipJobQueue Methods -----------------------------------------------
+//---------------------------------------------------------------------------
+
+ZipJobQueue::ZipJobQueue()
+: thrCnt(-1), pool(NULL), lst(NULL), cap(0), first(0), sz(0)
+{
+}
+
 //---------------------------------------------------------------------------
 
-ZipOut::ZipOut(Writer& writer)
+ZipJobQueue::~ZipJobQueue()
+{
+  while (sz > 0) delete next(); // Waits for the running jobs
+
+  if (pool) delete pool;
+
+  delete[] lst;
+}
+
+//---------------------------------------------------------------------------
+
+void ZipJobQueue::start(ZipJob& job)
+{
+  if (!pool) {
+    pool = new ThreadPool(thrCnt);
+
+    cap = 2 * pool->getThreadCount() + 1;
+    lst = new ZipJob*[cap];
+  }
+
+  lst[(first + sz++) % cap] = &job;
+
+  pool->submit(job);
+}
+
+//---------------------------------------------------------------------------
+
+ZipJob *ZipJobQueue::next()
+{
+  if (sz < 1) return NULL;
+
+  ZipJob *job = lst[first];
+
+  first = (first + 1) % cap;
+  sz--;
+
+  if (!pool->wait(*job)) job->ok = false; // Threw an exception
+
+  return job;
+}
+
+//---------------------------------------------------------------------------
+//------- ZipOut Methods ----------------------------------------------------
+//---------------------------------------------------------------------------
+/** Constructor.
+    \param writer The Writer the archive is written to.
+    \param streamEntries If \c true, each entry is written to \c writer as
+    its data arrives. The local header is then written by addFile(),
+    with general purpose flag bit 3 set, zero crc and sizes and a ZIP64
+    extra field, and the crc and sizes follow the data in a data
+    descriptor. Memory use is then independent of the entry sizes.\n
+    Otherwise each entry is buffered in memory until the next call to
+    addFile() or close().
+
+    ZIP64 records are written where needed, so neither the archive nor
+    its entries are limited to 4 GB or to 65535 entries.
+*/
+
+ZipOut::ZipOut(Writer& writer, bool streamEntries)
 : Writer(NULL), wrt(*new ZipWriter(writer)),
-  bWrt(*new ByteArrayWriter(100*1024,0)),
-  cWrt(*new CompressedWriter(bWrt,4096)),
+  bWrt(*new ByteArrayWriter(streamEntries ? 0 : 100*1024,0)),
+  cWrt(*new CompressedWriter(streamEntries ? (Writer&)wrt : (Writer&)bWrt,
+                                                                    4096)),
   dWrt(*new DataWriter(wrt)),
   fileLst(*new ZipFileList),
-  closed(false)
+  jobQ(*new ZipJobQueue),
+  streaming(streamEntries), closed(false)
 {
   dWrt.writeLittleEndian();
+
+  if (streaming) cWrt.setRawDeflate(true); // No need to strip zlib hdr
 }
 
 //---------------------------------------------------------------------------
@@ -239,6 +412,7 @@ ZipOut::~ZipOut()
 {
   close();
   
+  delete &jobQ;
   delete &fileLst;
   delete &dWrt;
   delete &bWrt;
@@ -283,17 +457,94 @@ bool ZipOut::isBuffered() const
 
 //---------------------------------------------------------------------------
 
+bool ZipOut::writeLocalHeader(ZipFile& zf)
+{
+  // With a data descriptor the sizes are not known yet, the ZIP64 extra
+  // field (with zero sizes) tells readers the descriptor has 8 byte sizes
+
+  bool zip64 = zf.sz >= Max32 || zf.rawSz >= Max32 || (zf.flags & 0x08);
+
+  if (!dWrt.writeInt(0x04034b50)) return false; // File hdr Signature
+  if (!dWrt.writeShort(zip64 ? 45 : 20)) return false; // Min required version
+  if (!dWrt.writeShort(zf.flags)) return false; // General purpose flags
+
+  if (zf.compressed) {
+    if (!dWrt.writeShort(8)) return false;        // Compression method (none)
+  }
+  else if (!dWrt.writeShort(0)) return false;
+
+  if (!dWrt.writeShort(zf.dosTime)) return false; // File modification time
+  if (!dWrt.writeShort(zf.dosDate)) return false; // File modification date
+
+  if (!dWrt.writeInt(zf.crc)) return false;   // Crc
+
+  if (zip64) {
+    if (!dWrt.writeInt((long)Max32)) return false; // In extra field
+    if (!dWrt.writeInt((long)Max32)) return false;
+  }
+  else {
+    if (!dWrt.writeInt((long)zf.sz)) return false;    // Compressed size
+    if (!dWrt.writeInt((long)zf.rawSz)) return false; // Uncompressed size
+  }
+
+  size_t pathLen = 0;
+  if (zf.getPath()) pathLen = strlen(zf.getPath());
+  if (!dWrt.writeShort((short)pathLen)) return false;   // Path name length
+
+  if (!dWrt.writeShort(zip64 ? 20 : 0)) return false;   // Extra field length
+
+  if (pathLen > 0) {
+    if (!dWrt.write(zf.getPath(),pathLen)) return false; // Path name
+  }
+
+  if (zip64) {
+    if (!dWrt.writeShort(1)) return false;        // ZIP64 extra field tag
+    if (!dWrt.writeShort(16)) return false;       // Size of extra field
+    if (!dWrt.writeLong(zf.rawSz)) return false;  // Uncompressed size
+    if (!dWrt.writeLong(zf.sz)) return false;     // Compressed size
+  }
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
 bool ZipOut::writeLastFile()
 {
   int sz = fileLst.size();
   if (sz < 1) return true;
 
   ZipFile& zf = fileLst[sz-1];
+  if (zf.queued) return writeQueued(true);
   if (zf.written) return true;
 
+  zf.written = true;
+
+  if (streaming) {
+    // Data has already been written, only the data descriptor remains
+
+    if (zf.compressed) {
+      if (!cWrt.flush()) return false;
+
+      if (zf.rawSz < 1) { // Nothing was deflated
+        if (!wrt.write(emptyDeflate,2)) return false;
+      }
+    }
+
+    zf.sz = wrt.getPos() - zf.startPos - zf.sz; // zf.sz held the hdr size
+
+    if (!dWrt.writeInt(0x08074b50)) return false; // Data descriptor Signature
+    if (!dWrt.writeInt(zf.crc)) return false;     // Crc
+
+    // ZIP64 sizes, as announced by the local header
+
+    if (!dWrt.writeLong(zf.sz)) return false;     // Compressed size
+    return dWrt.writeLong(zf.rawSz);              // Uncompressed size
+  }
+
   if (zf.compressed) cWrt.flush();
 
-  char *dataBuf = bWrt.getBuffer();
+  const char *dataBuf = bWrt.getBuffer();
 
   if (zf.compressed) {
     cWrt.flush();
@@ -318,42 +569,63 @@ bool ZipOut::writeLastFile()
       zf.sz    = 0;
       zf.rawSz = 0;
     }
+
+    if (zf.rawSz < 1) { // Nothing was deflated
+      dataBuf = emptyDeflate;
+      zf.sz   = 2;
+    }
   }
   else {
     zf.sz    = bWrt.getSize();
     zf.rawSz = zf.sz;
   }
 
-  zf.written = true;
+  if (!writeLocalHeader(zf)) return false;
 
-  if (!dWrt.writeInt(0x04034b50)) return false; // File hdr Signature
-  if (!dWrt.writeShort(20)) return false;       // Minimum required version
-  if (!dWrt.writeShort(0)) return false;        // General purpose flags
+  // Write the file data:
+  return wrt.write(dataBuf,(int)zf.sz);
+}
 
-  if (zf.compressed) {
-    if (!dWrt.writeShort(8)) return false;        // Compression method (none)
-  }
-  else if (!dWrt.writeShort(0)) return false;
+//---------------------------------------------------------------------------
+// Writes the queued entries that are done, in order.
+// If all is true all queued entries are waited for and written,
+// else only as many as needed to make room for one more.
 
-  if (!dWrt.writeShort(zf.dosTime)) return false; // File modification time
-  if (!dWrt.writeShort(zf.dosDate)) return false; // File modification date
+bool ZipOut::writeQueued(bool all)
+{
+  bool ok = true;
 
-  if (!dWrt.writeInt(zf.crc)) return false;   // Crc
-  if (!dWrt.writeInt(zf.sz)) return false;   // Compressed size
-  if (!dWrt.writeInt(zf.rawSz)) return false;   // Uncompressed size
+  while (jobQ.sz > 0) {
+    if (!all && jobQ.sz < jobQ.cap) break;
 
-  size_t pathLen = 0;
-  if (zf.getPath()) pathLen = strlen(zf.getPath());
-  if (!dWrt.writeShort((short)pathLen)) return false;   // Path name length
+    ZipJob *job = jobQ.next();
+    ZipFile& zf = job->zf;
 
-  if (!dWrt.writeShort(0)) return false;         // Extra field length
+    if (!job->ok) { // Do not write a corrupt entry
+      ok = false;
+      delete job;
+      continue;
+    }
 
-  if (pathLen > 0) {
-    if (!dWrt.write(zf.getPath(),pathLen)) return false; // Path name
+    zf.written  = true;
+    zf.startPos = wrt.getPos();
+    zf.crc      = job->crc;
+    zf.rawSz    = job->dataSz;
+
+    const char *dataBuf = job->data;
+
+    if (zf.compressed) {
+      dataBuf = job->out.getBuffer();
+      zf.sz   = job->out.getSize();
+    }
+    else zf.sz = zf.rawSz;
+
+    if (!writeLocalHeader(zf) || !wrt.write(dataBuf,(int)zf.sz)) ok = false;
+
+    delete job;
   }
 
-  // Write the file data:
-  return wrt.write(dataBuf,zf.sz);
+  return ok;
 }
 
 //---------------------------------------------------------------------------
@@ -367,8 +639,15 @@ bool ZipOut::addFile(const char *path, bool compressed)
   bWrt.setSize(0);
   cWrt.resetBytesWritten();
 
-  int curPos = wrt.getBytesWritten();
-  fileLst.append(curPos,path,compressed);
+  ZipFile& zf = fileLst.append(wrt.getPos(),path,compressed);
+
+  if (!streaming) return true;
+
+  zf.flags = 0x08; // Crc and sizes in data descriptor
+
+  if (!writeLocalHeader(zf)) return false;
+
+  zf.sz = wrt.getPos() - zf.startPos; // Remember the header size
 
   return true;
 }
@@ -383,28 +662,95 @@ bool ZipOut::write(const char *buf, int sz)
   if (fSz < 1) return false;
 
   ZipFile& zf = fileLst[fSz-1];
-  zf.crc = crc32(zf.crc,(const Bytef *)buf,sz);
+  if (zf.queued) return false;
+
+  zf.crc = (long)updateCrc32((unsigned int)zf.crc,buf,sz);
 
-  if (zf.compressed)
-       return cWrt.write(buf,sz);
-  else return bWrt.write(buf,sz);
+  if (!streaming) {
+    if (zf.compressed) return cWrt.write(buf,sz);
+    return bWrt.write(buf,sz);
+  }
+
+  zf.rawSz += sz;
+
+  if (zf.compressed) return cWrt.write(buf,sz);
+
+  return wrt.write(buf,sz);
 }
 
 //---------------------------------------------------------------------------
+/** Sets the number of threads that compress queued entries.
+    \param threadCount As for ThreadPool, the default is one thread per
+    processor.
+    \return \c false if called after the first queueFile().
+*/
 
-bool ZipOut::writeDirectory()
+bool ZipOut::setThreadCount(int threadCount)
+{
+  if (jobQ.pool) return false;
+
+  jobQ.thrCnt = threadCount;
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+/** Adds a complete entry.
+    \param path The path of the entry in the archive.
+    \param data The contents, copied before this method returns.
+    \param sz The number of bytes in \c data.
+    \param compressed If \c true the entry is deflated.
+    \return \c false if the archive is closed or if writing an earlier
+    entry failed.
+
+    The data is compressed on a worker thread while the caller
+    continues. The entries are written in the order in which they were
+    added.
+*/
+
+bool ZipOut::queueFile(const char *path, const char *data, int sz,
+                                                           bool compressed)
 {
-  int startPos = wrt.getBytesWritten();
+  if (isClosed()) return false;
+
+  if (!data || sz < 0)
+    throw IllegalArgumentException("ZipOut::queueFile");
 
   int fSz = fileLst.size();
 
+  if (fSz > 0 && !fileLst[fSz-1].queued && !writeLastFile()) return false;
+
+  if (!writeQueued(false)) return false;
+
+  ZipFile& zf = fileLst.append(0,path,compressed);
+  zf.queued = true;
+
+  jobQ.start(*new ZipJob(zf,data,sz));
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+bool ZipOut::writeDirectory()
+{
+  __int64 startPos = wrt.getPos();
+
+  int fSz = fileLst.size(), dirCnt = 0;
+
   for (int i=0; i<fSz; ++i) {
     ZipFile& zf = fileLst[i];
+    if (zf.queued && !zf.written) continue; // Its job failed, left out
+
+    dirCnt++;
+
+    bool zip64 = zf.needsZip64();
+    bool ver45 = zip64 || (zf.flags & 0x08); // As in the local header
 
     if (!dWrt.writeInt(0x02014b50)) return false; // Hdr Signature
-    if (!dWrt.writeShort(0)) return false;        // Version made by
-    if (!dWrt.writeShort(20)) return false;       // Minimum required version
-    if (!dWrt.writeShort(0)) return false;        // General purpose flags
+    if (!dWrt.writeShort(ver45 ? 45 : 0)) return false; // Version made by
+    if (!dWrt.writeShort(ver45 ? 45 : 20)) return false; // Min required version
+    if (!dWrt.writeShort(zf.flags)) return false; // General purpose flags
 
     if (zf.compressed) {
       if (!dWrt.writeShort(8)) return false;        // Compression method (none)
@@ -415,52 +761,111 @@ bool ZipOut::writeDirectory()
     if (!dWrt.writeShort(zf.dosDate)) return false; // File modification date
 
     if (!dWrt.writeInt(zf.crc)) return false;
-    if (!dWrt.writeInt(zf.sz)) return false;
-    if (!dWrt.writeInt(zf.rawSz)) return false;
+
+    if (zip64) {   // All three are in the extra field
+      if (!dWrt.writeInt((long)Max32)) return false;
+      if (!dWrt.writeInt((long)Max32)) return false;
+    }
+    else {
+      if (!dWrt.writeInt((long)zf.sz)) return false;
+      if (!dWrt.writeInt((long)zf.rawSz)) return false;
+    }
 
     size_t pathLen = 0;
     if (zf.getPath()) pathLen = strlen(zf.getPath());
     if (!dWrt.writeShort((short)pathLen)) return false;   // Path name length
 
-    if (!dWrt.writeShort(0)) return false;         // Extra field length
+    if (!dWrt.writeShort(zip64 ? 28 : 0)) return false; // Extra field length
     if (!dWrt.writeShort(0)) return false;         // File comment length
     if (!dWrt.writeShort(0)) return false;         // Disk number start
     if (!dWrt.writeShort(0)) return false;         // Internal file attributes
     if (!dWrt.writeInt(0))   return false;         // External file attributes
-    if (!dWrt.writeInt(zf.startPos)) return false; // Local header offset
+
+    if (zip64) {
+      if (!dWrt.writeInt((long)Max32)) return false;
+    }
+    else if (!dWrt.writeInt((long)zf.startPos)) return false; // Local hdr offset
 
     if (pathLen > 0) {
       if (!dWrt.write(zf.getPath(),pathLen)) return false; // Path name
     }
+
+    if (zip64) {
+      if (!dWrt.writeShort(1)) return false;          // ZIP64 extra field tag
+      if (!dWrt.writeShort(24)) return false;         // Size of extra field
+      if (!dWrt.writeLong(zf.rawSz)) return false;    // Uncompressed size
+      if (!dWrt.writeLong(zf.sz)) return false;       // Compressed size
+      if (!dWrt.writeLong(zf.startPos)) return false; // Local header offset
+    }
+  }
+
+  __int64 curPos = wrt.getPos();
+  __int64 dirSz  = curPos - startPos;
+
+  bool zip64 = dirCnt >= 0xFFFF || dirSz >= Max32 || startPos >= Max32;
+
+  if (zip64) {
+    if (!dWrt.writeInt(0x06064b50)) return false; // Zip64 end of central dir
+    if (!dWrt.writeLong(44)) return false;        // Size of remaining record
+    if (!dWrt.writeShort(45)) return false;       // Version made by
+    if (!dWrt.writeShort(45)) return false;       // Minimum required version
+    if (!dWrt.writeInt(0)) return false;          // Number of this disk
+    if (!dWrt.writeInt(0)) return false;          // Disk with the central dir
+    if (!dWrt.writeLong(dirCnt)) return false;    // Number of files on disk
+    if (!dWrt.writeLong(dirCnt)) return false;    // Number of files
+    if (!dWrt.writeLong(dirSz)) return false;     // Size of central dir
+    if (!dWrt.writeLong(startPos)) return false;  // Startpos of central dir
+
+    if (!dWrt.writeInt(0x07064b50)) return false; // Zip64 end of dir locator
+    if (!dWrt.writeInt(0)) return false;          // Disk with zip64 end of dir
+    if (!dWrt.writeLong(curPos)) return false;    // Pos of zip64 end of dir
+    if (!dWrt.writeInt(1)) return false;          // Total number of disks
   }
 
-  int curPos = wrt.getBytesWritten();
+  short cnt16 = zip64 ? (short)0xFFFF : (short)dirCnt;
 
   if (!dWrt.writeInt(0x06054b50)) return false; // End of central dir signature
   if (!dWrt.writeShort(0)) return false;        // Number of this disk
   if (!dWrt.writeShort(0)) return false;        // Number of the disk with the centrel dir
-  if (!dWrt.writeShort((short)fSz)) return false;      // Number of files in the dir on this disk
-  if (!dWrt.writeShort((short)fSz)) return false;      // Number of files in the dir
+  if (!dWrt.writeShort(cnt16)) return false;    // Number of files in the dir on this disk
+  if (!dWrt.writeShort(cnt16)) return false;    // Number of files in the dir
 
-  if (!dWrt.writeInt(curPos-startPos)) return false; // Size of central dir
+  if (zip64) {
+    if (!dWrt.writeInt((long)Max32)) return false; // In zip64 end of dir
+    if (!dWrt.writeInt((long)Max32)) return false;
+  }
+  else {
+    if (!dWrt.writeInt((long)dirSz)) return false;    // Size of central dir
+    if (!dWrt.writeInt((long)startPos)) return false; // Startpos of central dir
+  }
 
-  if (!dWrt.writeInt(startPos)) return false;   // Startpos of central dir
   if (!dWrt.writeShort(0)) return false;        // Comment length
 
   return true;
 }
 
 //---------------------------------------------------------------------------
+/** Writes the remaining entries and the central directory.
+    \return \c false if writing failed or if an entry was left out
+    because the compression of a queued entry failed. The archive is
+    then still valid, but lacks that entry.
+*/
 
 bool ZipOut::close()
 {
   if (closed) return true;
   closed = true;
 
-  bool ok = writeLastFile() && writeDirectory();
+  bool ok = writeLastFile();
+
+  if (!writeDirectory()) ok = false;
 
   wrt.flush();
 
+  for (int i=0; i<fileLst.size(); ++i) {
+    if (fileLst[i].queued && !fileLst[i].written) ok = false;
+  }
+
   return ok;
 }
 
@@ -0,0 +1,155 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- CRC Check and Benchmark -------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+// Checks Ino::updateCrc32 against zlib crc32() and Ino::crc16 against the
+// original byte wise implementation, for all lengths up to 600 bytes at
+// every alignment within 16 bytes and for buffers fed in pieces.
+// Then prints the throughput of each on a 1 MB buffer.
+// Returns 0 if all checks pass.
+
+#include "Crc.h"
+#include "zlib.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+//---------------------------------------------------------------------------
+// ---- Original 16 bit CRC -------------------------------------------------
+//---------------------------------------------------------------------------
+
+static unsigned short refTab[256];
+
+static void refInit()
+{
+ unsigned short bin=2, idx=1;
+
+ refTab[0] = 0; refTab[1] = 0x1021; /* CCITT in hex */
+
+ do {
+   refTab[bin] = refTab[idx]<<1;
+   if (refTab[idx] & 0x8000) refTab[bin] = refTab[bin]^refTab[1];
+
+   for (idx=1; idx<bin; idx++) refTab[bin+idx]=refTab[bin]^refTab[idx];
+
+   idx = bin; bin <<= 1;
+  }
+  while (bin <= 128);
+}
+
+//---------------------------------------------------------------------------
+
+static void refCrc16(const char *data, int len, char chksum[2])
+{
+  unsigned short wrd = 0;
+
+  for (int i=0; i<len; i++) {
+    wrd = ((wrd<<8) | ((*data++)&0xff)) ^ refTab[(unsigned short)wrd>>8];
+  }
+
+  for (int i=0; i<2; i++) {
+    wrd =  (wrd<<8) ^ refTab[(unsigned short)wrd>>8];
+  }
+
+  chksum[0] = (unsigned short)wrd>>8;
+  chksum[1] = wrd & 0xff;
+}
+
+//---------------------------------------------------------------------------
+
+static bool check(const char *buf)
+{
+  bool ok = true;
+
+  for (int off=0; off<16; ++off) {
+    for (int len=0; len<=600; ++len) {
+      const char *p = buf + off;
+
+      unsigned int zc = crc32(0,(const Bytef *)p,len);
+      if (Ino::updateCrc32(0,p,len) != zc) {
+        printf("crc32 differs, offset %d length %d\n",off,len);
+        ok = false;
+      }
+
+      int split = len/3;
+      unsigned int pc = Ino::updateCrc32(0,p,split);
+      pc = Ino::updateCrc32(pc,p+split,len-split);
+      if (pc != zc) {
+        printf("crc32 in pieces differs, offset %d length %d\n",off,len);
+        ok = false;
+      }
+
+      char c16[2], r16[2];
+      Ino::crc16(p,len,c16);
+      refCrc16(p,len,r16);
+      if (memcmp(c16,r16,2)) {
+        printf("crc16 differs, offset %d length %d\n",off,len);
+        ok = false;
+      }
+    }
+  }
+
+  return ok;
+}
+
+//---------------------------------------------------------------------------
+
+enum CrcKind { InoCrc32, ZlibCrc32, InoCrc16, RefCrc16 };
+
+static void bench(const char *name, CrcKind kind, const char *buf, int len)
+{
+  enum { Reps = 50 };
+
+  unsigned int sum = 0;
+  char c16[2];
+
+  clock_t t0 = clock();
+
+  for (int r=0; r<Reps; ++r) {
+    switch (kind) {
+      case InoCrc32:  sum += Ino::updateCrc32(0,buf,len); break;
+      case ZlibCrc32: sum += crc32(0,(const Bytef *)buf,len); break;
+      case InoCrc16:  Ino::crc16(buf,len,c16); sum += c16[0]; break;
+      case RefCrc16:  refCrc16(buf,len,c16); sum += c16[0]; break;
+    }
+  }
+
+  double sec = (double)(clock() - t0) / CLOCKS_PER_SEC;
+  if (sec <= 0) sec = 1e-6;
+
+  printf("%-14s %8.0f MB/s  (%08x)\n",name,
+                              (double)len*Reps/(1024*1024)/sec,sum);
+}
+
+//---------------------------------------------------------------------------
+
+int main()
+{
+  enum { BufSz = 1024*1024 };
+
+  char *buf = new char[BufSz];
+
+  srand(1);
+  for (int i=0; i<BufSz; ++i) buf[i] = (char)rand();
+
+  refInit();
+
+  bool ok = check(buf);
+
+  bench("updateCrc32",InoCrc32,buf,BufSz);
+  bench("zlib crc32",ZlibCrc32,buf,BufSz);
+  bench("crc16",InoCrc16,buf,BufSz);
+  bench("crc16 original",RefCrc16,buf,BufSz);
+
+  delete[] buf;
+
+  printf("CrcBench: %s\n",ok ? "passed" : "FAILED");
+
+  return ok ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
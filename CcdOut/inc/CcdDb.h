@@ -20,6 +20,7 @@
 #include "CsArray.h"  //template array class
                       //use whatever other array template...      
 #include <string.h>
+#include <stdio.h>
 
 /* 
   Vector File DB Structure:
@@ -38,16 +39,39 @@ namespace Ino
 
 //---------------------------------------------------------------------------
 
+class Writer;
+
 class CcdDb2
 {
   //minimal Vector file dbase structure
   //and some tool functions to put something in the DB 
+  //entity indices are 32 bits, above 32767 entities save() writes
+  //format 2.1, which stores the counts and the selection in 32 bits
+  //if spooled, entities go to a temporary file when added
+
+  long   m_nent;         //number of entities, in m_ent or spooled
+  double m_box[4];       //lx,ly,hx,hy around all entities added so far
+
+  bool    m_spooled;     //entities are written to a temporary file
+  bool    m_spoolOk;     //false if an entity could not be spooled
+  FILE   *m_spoolFd;
+  Writer *m_spoolWrt;
+  CWFile *m_spool;
 
   void calcModelBox(double& lx, double& ly, double& hx, double& hy);
+  void addToModelBox(const __recentity& ent);
+
+  bool isVer21() const;
+
+  bool openSpool();
+  void closeSpool();
+
+  CcdDb2(const CcdDb2& cp);             // No Copying
+  CcdDb2& operator=(const CcdDb2& src); // No Assignment
 
 public:
-  CArray<short>     m_selection;  //CSmallArray<int>    
-  CArray<CcdEntity> m_ent;        //CSmallArray<Entity> < 64K --> use CSmallArray<Entity*>
+  CArray<long>      m_selection;  //entity indices (>0) of selected entities
+  CArray<CcdEntity> m_ent;        //empty if the entities are spooled
   CArray<CcdLayer>  m_layer;      //Table(index,string) implemented as array
   double            m_size;       //dont care
 
@@ -63,18 +87,24 @@ protected:
   int saveEntities(CAbstractWFile* pstream);
   int saveViewPorts(CAbstractWFile* pstream);
   
-  short addselection(const short& index);
+  long addselection(long index);
   
   public:   
-  CcdDb2() : m_size(1)  {  clear(); }
+  CcdDb2(bool spooled=false);
+  ~CcdDb2();
   
   int save(CAbstractWFile& pstream); 
 
   void clear();
-  short addent(const CcdEntity& ent);
+
+  bool isSpooled() const { return m_spooled; }
+  long entityCount() const { return m_nent; }
+
+  long addent(const CcdEntity& ent);
+  long addEntities(const CcdEntity *ents, long n);
   short addlayer(const CcdLayer& layer);
 
-  CcdEntity& getEnt(short index);
+  CcdEntity& getEnt(long index); // Not available if spooled
 
   CcdLayer* findLayer(short ilayer);
 };
@@ -20,6 +20,8 @@ namespace Ino
 class CAbstractWFile
 {
 public:
+  virtual ~CAbstractWFile() {}
+
   virtual int put(const char& c) = 0;
   virtual int put(const char * s,int n) = 0;
 
@@ -11,20 +11,37 @@
 
 #include "CcdDb.h"
 
+#include "Writer.h"
+
 #include <math.h>
 
 namespace Ino
 {
 
+const long ccdMaxCount = 32767; // Counts and indices are 16 bits in 2.0
+
 //---------------------------------------------------------------------------
 //Incremental differences in ccd file format 2.0 :
 //(1) CcdDb2::saveHeader(CAbstractWFile* ps);
 //(2) CcdDb2::saveInfo(CAbstractWFile* ps);      
 //(3) CcdDb2::saveViewPorts(CAbstractWFile* ps)
+//
+//Incremental differences in ccd file format 2.1 :
+//(1) CcdDb2::saveInfo(CAbstractWFile* ps): counts are 32 bits
+//(2) CcdDb2::saveSelection(CAbstractWFile* ps): indices are 32 bits
+//Version 2.1 is only written if a count exceeds the 16 bits of 2.0
+
+bool CcdDb2::isVer21() const
+{
+  return m_nent > ccdMaxCount || m_selection.size() > ccdMaxCount;
+}
+
+//---------------------------------------------------------------------------
 
 int CcdDb2::saveHeader(CAbstractWFile* ps) {
   char buf[80];
-  strcpy(buf,"LSNAH-Magic Ver 2.0 ");  // Special "Hans l" Header
+  if (isVer21()) strcpy(buf,"LSNAH-Magic Ver 2.1 ");
+  else strcpy(buf,"LSNAH-Magic Ver 2.0 ");  // Special "Hans l" Header
   return ps->put(buf,(int)(strlen(buf)+1));
 }       
 
@@ -40,12 +57,19 @@ int CcdDb2::saveInfo(CAbstractWFile* ps)
   double size=m_size;
   long id=0; 
 
-  nument=(short)m_ent.size();
-  nsel=(short)m_selection.size();
+  if (isVer21()) {
+    ps->putInt32(m_nent);
+    ps->putInt32(npntrs);
+    ps->putInt32(m_selection.size());
+  }
+  else {
+    nument=(short)m_nent;
+    nsel=(short)m_selection.size();
 
-  ps->putInt16(nument);
-  ps->putInt16(npntrs);
-  ps->putInt16(nsel);
+    ps->putInt16(nument);
+    ps->putInt16(npntrs);
+    ps->putInt16(nsel);
+  }
   ps->putInt16(idum);
     
   ps->putDouble(size);
@@ -132,9 +156,14 @@ int CcdDb2::saveAxismat(CAbstractWFile* ps)
 int CcdDb2::saveSelection(CAbstractWFile* ps)
 {
   short icode = 3;
+  bool ver21 = isVer21();
   ps->putInt16(icode);
-  for (short i=0; i<m_selection.size(); i++)
-    if (!ps->putInt16(m_selection[i])) return 0;
+  for (long i=0; i<m_selection.size(); i++) {
+    if (ver21) {
+      if (!ps->putInt32(m_selection[i])) return 0;
+    }
+    else if (!ps->putInt16((short)m_selection[i])) return 0;
+  }
   
   return 1;    
 }  
@@ -146,10 +175,31 @@ int CcdDb2::saveEntities(CAbstractWFile* ps)
   short icode = 1;
   
   ps->putInt16(icode);
-  for (short i = 0; i < m_ent.size(); i++) 
-    if (!m_ent[i].save(ps)) return 0;      
+
+  if (!m_spooled) {
+    for (long i = 0; i < m_ent.size(); i++) 
+      if (!m_ent[i].save(ps)) return 0;      
   
-  return 1;
+    return 1;
+  }
+
+  if (!m_spoolOk) return 0;  // An entity could not be spooled
+  if (!m_spoolFd) return 1; // Nothing was added
+
+  if (!m_spoolWrt->flush()) return 0;
+
+  rewind(m_spoolFd);
+
+  char buf[8192];
+
+  for (;;) {
+    size_t len = fread(buf,1,sizeof(buf),m_spoolFd);
+    if (len < 1) break;
+
+    if (!ps->put(buf,(int)len)) return 0;
+  }
+
+  return !ferror(m_spoolFd);
 }      
 
 //---------------------------------------------------------------------------
@@ -316,14 +366,60 @@ int CcdDb2::save(CAbstractWFile& ps)
 
 //---------------------------------------------------------------------------
 
-short CcdDb2::addselection(const short& index){
-  short n=(short)m_selection.size();
+CcdDb2::CcdDb2(bool spooled)
+: m_nent(0), m_spooled(spooled), m_spoolOk(true), m_spoolFd(NULL),
+  m_spoolWrt(NULL), m_spool(NULL), m_size(1)
+{
+  clear();
+}
+
+//---------------------------------------------------------------------------
+
+CcdDb2::~CcdDb2()
+{
+  closeSpool();
+}
+
+//---------------------------------------------------------------------------
+
+bool CcdDb2::openSpool()
+{
+  m_spoolFd = tmpfile();
+
+  if (!m_spoolFd) {  // Fall back to keeping the entities in memory
+    m_spooled = false;
+    return false;
+  }
+
+  m_spoolWrt = new StdioWriter(m_spoolFd,false);
+  m_spool    = new CWFile(*m_spoolWrt);
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+
+void CcdDb2::closeSpool()
+{
+  delete m_spool;
+  m_spool = NULL;
+
+  delete m_spoolWrt;
+  m_spoolWrt = NULL;
+
+  if (m_spoolFd) fclose(m_spoolFd);
+  m_spoolFd = NULL;
+}
+
+//---------------------------------------------------------------------------
+
+long CcdDb2::addselection(long index){
+  long n=m_selection.size();
     
   assert(index>0);
     
-   if (n>=m_selection.capacity()){ //Expand
-     const short grow=100;
-     m_selection.resize(m_selection.capacity()+grow);
+   if (n>=m_selection.capacity()){ //Expand geometrically
+     m_selection.resize(n < 50 ? 100 : 2*n);
      m_selection.trim(n);
    }   
    m_selection.trim(n+1);
@@ -334,29 +430,60 @@ short CcdDb2::addselection(const short& index){
 
 //---------------------------------------------------------------------------
 
-short CcdDb2::addent(const CcdEntity& ent){
+long CcdDb2::addent(const CcdEntity& ent){
   //input : ent
   //ouput : index=indexarray+1
     
-  const short maxent=30000;
-  short n=(short)m_ent.size();
-        
-   if (n>=m_ent.capacity()){  //Expand
-     const short grow=100;
-     m_ent.resize(m_ent.capacity()+grow);
-     m_ent.trim(n);
-   }   
-     
-   assert(n<=maxent);
-     
-   m_ent.trim(n+1);
-   m_ent[n]=ent;
-     
-   short index=n+1;       //(index>0) 
-   if (ent.getPick())
-     addselection(index); //add to selection
+  if (m_spooled) {
+    if (!m_spoolFd && !openSpool()) return addent(ent);
+
+    CcdEntity& e = const_cast<CcdEntity&>(ent); // save() is not const
+    if (!e.save(m_spool)) m_spoolOk = false;    // save() will fail
+  }
+  else {
+    long n=m_ent.size();
+
+    if (n>=m_ent.capacity()){  //Expand geometrically
+      m_ent.resize(n < 50 ? 100 : 2*n);
+      m_ent.trim(n);
+    }   
+
+    m_ent.trim(n+1);
+    m_ent[n]=ent;
+  }
+
+  addToModelBox(ent.prec);
+
+  long index=++m_nent;    //(index>0) 
+  if (ent.getPick())
+    addselection(index); //add to selection
      
-   return index; //ouput : index=indexarray+1
+  return index; //ouput : index=indexarray+1
+}
+
+//---------------------------------------------------------------------------
+
+long CcdDb2::addEntities(const CcdEntity *ents, long n)
+{
+  //input : ents[0..n-1]
+  //ouput : index of the first entity added, zero if none
+
+  if (!ents || n < 1) return 0;
+
+  if (!m_spooled) {
+    long sz = m_ent.size();
+
+    if (sz+n > m_ent.capacity()) {  //Expand once
+      m_ent.resize(sz+n < 2*sz ? 2*sz : sz+n);
+      m_ent.trim(sz);
+    }
+  }
+
+  long first = addent(ents[0]);
+
+  for (long i=1; i<n; i++) addent(ents[i]);
+
+  return first;
 }
 
 //---------------------------------------------------------------------------
@@ -367,8 +494,7 @@ short CcdDb2::addlayer(const CcdLayer& CcdLayer){
   short n=(short)m_layer.size();
         
    if (n>=m_layer.capacity()){ //Expand
-     const short grow=100;
-     m_layer.resize(m_ent.capacity()+grow);
+     m_layer.resize(n < 5 ? 10 : 2*n);
      m_layer.trim(n);
    }   
      
@@ -387,10 +513,16 @@ void CcdDb2::clear()
 {
   m_selection.resize(100);
   m_selection.trim(0);
-  m_ent.resize(100);
+  m_ent.resize(m_spooled ? 0 : 100);
   m_ent.trim(0);
   m_layer.resize(10);
   m_layer.trim(0);        
+
+  m_nent = 0;
+  m_spoolOk = true;
+  m_box[0] = m_box[1] = m_box[2] = m_box[3] = 0.0;
+
+  closeSpool();
 };
 
 //---------------------------------------------------------------------------
@@ -443,50 +575,60 @@ static void calcArcBox(const __recentity& ent,
 }
 
 //---------------------------------------------------------------------------
-// Calculate bounding around all entities
+// Extend the bounding box around all entities with ent
 
-void CcdDb2::calcModelBox(double& lx, double& ly, double& hx, double& hy)
+void CcdDb2::addToModelBox(const __recentity& ent)
 {
-  for (int i=0; i < m_ent.size(); i++) {
-    const __recentity& ent = m_ent[i].prec;
+  double hlx=0.0, hly=0.0, hhx=0.0, hhy=0.0;
 
-    double hlx=0.0, hly=0.0, hhx=0.0, hhy=0.0;
+  switch (ent.type) {
+  case TPOINT:
+    hlx = hhx = ent.p.coord[0];
+    hly = hhy = ent.p.coord[1];
+    break;
 
-    switch (ent.type) {
-    case TPOINT:
-      hlx = hhx = ent.p.coord[0];
-      hly = hhy = ent.p.coord[1];
-      break;
+  case TLINE:
+    hlx = ent.l.coord[0]; 
+    hly = ent.l.coord[1];
 
-    case TLINE:
-      hlx = ent.l.coord[0]; 
-      hly = ent.l.coord[1];
+    hhx = ent.l.coord2[0];
+    hhy = ent.l.coord2[1];
+    break;
 
-      hhx = ent.l.coord2[0];
-      hhy = ent.l.coord2[1];
-      break;
+  case TARC:
+    calcArcBox(ent,hlx,hly,hhx,hhy);
+    break;
+  }
 
-    case TARC:
-      calcArcBox(ent,hlx,hly,hhx,hhy);
-      break;
-    }
+  if (hlx > hhx) { double h = hlx; hlx = hhx; hhx = h; } // Swap
+  if (hly > hhy) { double h = hly; hly = hhy; hhy = h; } // Swap
 
-    if (hlx > hhx) { double h = hlx; hlx = hhx; hhx = h; } // Swap
-    if (hly > hhy) { double h = hly; hly = hhy; hhy = h; } // Swap
+  bool first = m_nent < 1;
 
-    if (i < 1 || hlx < lx) lx = hlx;
-    if (i < 1 || hly < ly) ly = hly;
+  if (first || hlx < m_box[0]) m_box[0] = hlx;
+  if (first || hly < m_box[1]) m_box[1] = hly;
 
-    if (i < 1 || hhx > hx) hx = hhx;
-    if (i < 1 || hhy > hy) hy = hhy;
-  }
+  if (first || hhx > m_box[2]) m_box[2] = hhx;
+  if (first || hhy > m_box[3]) m_box[3] = hhy;
+}
+
+//---------------------------------------------------------------------------
+// Bounding box around all entities
+
+void CcdDb2::calcModelBox(double& lx, double& ly, double& hx, double& hy)
+{
+  if (m_nent < 1) return;
+
+  lx = m_box[0]; ly = m_box[1];
+  hx = m_box[2]; hy = m_box[3];
 }
 
 //---------------------------------------------------------------------------
 
-CcdEntity& CcdDb2::getEnt(short index)
+CcdEntity& CcdDb2::getEnt(long index)
 {
   //to show shift in index:
+  assert(!m_spooled);
   assert(index>=1);
   assert(index<=m_ent.size());
 
@@ -39,8 +39,11 @@ namespace Ino
 
   Vector is a CAD/CAM program by Centriforce BV, The Netherlands.\n
   \n
-  The data for an entire drawing is first stored in a memory data structure.\n
-  The data is then written to the output stream when method flush() is called.
+  The data for an entire drawing is first stored in a data structure.\n
+  The data is then written to the output stream when method flush() is called.\n
+  The entities themselves are spooled to a temporary file as they are added,
+  so there is no limit on the number of entities and memory use does not
+  grow with the size of the drawing.
 
   \attention When flush() is called the memory data structure is cleared
   immediately after the data has been written.\n
@@ -131,7 +134,7 @@ void CcdOut::newLayer(const char *name, bool selected)
 
   selElems = selected;
 
-  if (!db) db = new CcdDb2;
+  if (!db) db = new CcdDb2(true);
 
   layer.setString(name);
   layer.prec.ilayer = db->addlayer(layer);
@@ -180,7 +183,7 @@ void CcdOut::setCurrentColor(unsigned char red, unsigned char green,
 void CcdOut::addPoint(const Vec3& p)
 {
   if (!db) {
-    db = new CcdDb2;
+    db = new CcdDb2(true);
     newLayer("0");
   }
 
@@ -209,7 +212,7 @@ void CcdOut::addPoint(const Vec3& p)
 void CcdOut::addLine(const Vec3& p1, const Vec3& p2)
 {
   if (!db) {
-    db = new CcdDb2;
+    db = new CcdDb2(true);
     newLayer("0");
   }
 
@@ -232,6 +235,51 @@ void CcdOut::addLine(const Vec3& p1, const Vec3& p2)
   db->addent(line);
 }
 
+//---------------------------------------------------------------------------
+/** Adds a polyline.
+
+    The polyline is added as a series of solid lines to the current layer
+    with the current color.
+
+    \param ptLst The points of the polyline.
+    \param listLen The number of points in \c ptLst.
+
+    \throw NullPointerException if <tt>ptLst == NULL</tt>.
+*/
+
+void CcdOut::addPolyLine(const Vec3 *ptLst, int listLen)
+{
+  if (!ptLst) throw NullPointerException("CcdOut::addPolyLine");
+  if (listLen < 2) return;
+
+  if (!db) {
+    db = new CcdDb2(true);
+    newLayer("0");
+  }
+
+  CcdEntity *lines = new CcdEntity[listLen-1];
+
+  for (int i=1; i<listLen; i++) {
+    Vec3 lp1(ptLst[i-1]), lp2(ptLst[i]);
+
+    if (unit == Inch) {
+      lp1 /= InchInMm; lp2 /= InchInMm;
+    }
+
+    CcdEntity& line = lines[i-1];
+
+    line.makeLine(lp1.x,lp1.y,lp1.z,lp2.x,lp2.y,lp2.z);
+    line.setLayer(layer.prec.ilayer);
+    line.setPick(selElems ? 1 : 0);
+    line.setColor(col);
+    line.prec.l.style = LS_SOLID;
+  }
+
+  db->addEntities(lines,listLen-1);
+
+  delete[] lines;
+}
+
 //---------------------------------------------------------------------------
 /** Adds an arc.
     A solid arc is added to the current layer with the current color.
@@ -255,7 +303,7 @@ void CcdOut::addArc(const Vec3& c, double radius,
                           double startAng, double endAng, const Trf3& trf)
 {
   if (!db) {
-    db = new CcdDb2;
+    db = new CcdDb2(true);
     newLayer("0");
   }
 
@@ -313,7 +361,7 @@ void CcdOut::addArc(const Vec3& c, double radius,
 void CcdOut::addCircle(const Vec3& c, double radius, const Trf3& trf)
 {
   if (!db) {
-    db = new CcdDb2;
+    db = new CcdDb2(true);
     newLayer("0");
   }
 
@@ -355,6 +403,9 @@ void CcdOut::addCircle(const Vec3& c, double radius, const Trf3& trf)
     \return \c true If the data was successfully written,\n
     if \c false is returned, inspect the Writer to find out what was wrong.
 
+    With more than 32767 entities CCD format 2.1 is written, which stores
+    the entity counts and the selection in 32 bits instead of 16.
+
     \note The method may be called explicitly, but, if not, it will be called
     by the destructor instead.
 */
@@ -363,9 +414,9 @@ bool CcdOut::flush()
 {
   CWFile cwFile(wrt);
 
-  db->save(cwFile);
+  bool ok = db->save(cwFile) != 0;
 
-  bool ok = wrt.flush();
+  if (!wrt.flush()) ok = false;
   delete db;
   db = NULL;
 
@@ -14,6 +14,7 @@
 #include "DxfReader.h"
 
 #include "Exceptions.h"
+#include "NumConv.h"
 
 #include <cstring>
 #include <cstdlib>
@@ -129,12 +130,12 @@ int DxfReader::toInt()
   trim(value);
   valueSz = strlen(value);
 
-  char *endPt;
+  long val = 0;
 
-  int val = strtol(value,&endPt,10);
-  if (endPt - value < valueSz) throw NumberFormatException("Not an integer");
+  if (scanInt(value,value+valueSz,val) != value+valueSz)
+    throw NumberFormatException("Not an integer");
 
-  return val;
+  return (int)val;
 }
 
 //---------------------------------------------------------------------------
@@ -144,10 +145,10 @@ double DxfReader::toDouble()
   trim(value);
   valueSz = strlen(value);
 
-  char *endPt;
+  double val = 0.0;
 
-  double val = strtod(value,&endPt);
-  if (endPt - value < valueSz) throw NumberFormatException("Not a double");
+  if (scanDouble(value,value+valueSz,val) != value+valueSz)
+    throw NumberFormatException("Not a double");
 
   return val;
 }
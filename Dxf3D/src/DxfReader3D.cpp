@@ -14,6 +14,7 @@
 #include "DxfReader3D.h"
 
 #include "Exceptions.h"
+#include "NumConv.h"
 
 #include <cstring>
 #include <cstdlib>
@@ -131,12 +132,12 @@ int DxfReader3D::toInt()
   trim(value);
   valueSz = strlen(value);
 
-  char *endPt;
+  long val = 0;
 
-  int val = strtol(value,&endPt,10);
-  if (endPt - value < valueSz) throw NumberFormatException("Not an integer");
+  if (scanInt(value,value+valueSz,val) != value+valueSz)
+    throw NumberFormatException("Not an integer");
 
-  return val;
+  return (int)val;
 }
 
 //---------------------------------------------------------------------------
@@ -146,10 +147,10 @@ double DxfReader3D::toDouble()
   trim(value);
   valueSz = strlen(value);
 
-  char *endPt;
+  double val = 0.0;
 
-  double val = strtod(value,&endPt);
-  if (endPt - value < valueSz) throw NumberFormatException("Not a double");
+  if (scanDouble(value,value+valueSz,val) != value+valueSz)
+    throw NumberFormatException("Not a double");
 
   return val;
 }
@@ -22,8 +22,10 @@
 #include "Trf.h"
 
 #include "Writer.h"
+#include "NumConv.h"
 
 #include <string.h>
+#include <ctype.h>
 #include <math.h>
 
 enum { BufCap = 256 };
@@ -160,7 +162,10 @@ public:
   bool bKey;
   long nKey;
 
+  int nextHash; // Next layer index in the same hash bucket or -1
+
   void setName(const char *name);
+  void takeName(Layer& src);
   const char *getName() const { return name; }
 };
 
@@ -168,7 +173,7 @@ public:
 
 DxfOut::Layer::Layer()
 : name(NULL), sysLayer(false), handle(0),
-  col(ColBlackWhite), bKey(false), nKey(-2)
+  col(ColBlackWhite), bKey(false), nKey(-2), nextHash(-1)
 {
 }
 
@@ -194,6 +199,16 @@ void DxfOut::Layer::setName(const char *newName)
 
 //---------------------------------------------------------------------------
 
+void DxfOut::Layer::takeName(Layer& src)
+{
+  delete[] name;
+
+  name = src.name;
+  src.name = NULL;
+}
+
+//---------------------------------------------------------------------------
+
 void DxfOut::writeGroup(int code, const char *val)
 {
   char buf[BufCap];
@@ -204,7 +219,7 @@ void DxfOut::writeGroup(int code, const char *val)
 
   buf[BufCap-1]=0;
 
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  if (outWrtr) outWrtr->write(buf,strlen(buf));
 }
 
 //---------------------------------------------------------------------------
@@ -219,7 +234,7 @@ void DxfOut::writeGroup(int code, int val)
 
   buf[BufCap-1]=0;
 
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  if (outWrtr) outWrtr->write(buf,strlen(buf));
 }
 
 //---------------------------------------------------------------------------
@@ -234,37 +249,57 @@ void DxfOut::writeHexGroup(int code, int val)
 
   buf[BufCap-1]=0;
 
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  if (outWrtr) outWrtr->write(buf,strlen(buf));
 }
 
 //---------------------------------------------------------------------------
 
-void DxfOut::writeGroup(int code, double val)
+int DxfOut::putEol(char *buf) const
+{
+  if (crlf) {
+    buf[0] = '\r'; buf[1] = '\n';
+    return 2;
+  }
+
+  buf[0] = '\n';
+  return 1;
+}
+
+//---------------------------------------------------------------------------
+
+int DxfOut::putValue(int code, double val, char *buf) const
 {
   if (abs(val) <= zeroTol) val = 0.0;
 
-  char buf[BufCap];
+  int len = formatInt(code,buf);
+  len += putEol(buf+len);
+  len += formatDouble(val,decimals,buf+len,NumBufCap);
+  len += putEol(buf+len);
 
-  snprintf(buf,BufCap-1,dblFormat,code,val);
+  return len;
+}
 
-  buf[BufCap-1]=0;
+//---------------------------------------------------------------------------
+
+void DxfOut::writeGroup(int code, double val)
+{
+  char buf[NumBufCap+32];
 
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  int len = putValue(code,val,buf);
+
+  if (outWrtr) outWrtr->write(buf,len);
 }
 
 //---------------------------------------------------------------------------
 
 void DxfOut::writePoint(double x, double y)
 {
-  if (abs(x) <= zeroTol) x = 0.0;
-  if (abs(y) <= zeroTol) y = 0.0;
+  char buf[2*(NumBufCap+32)];
 
-  char buf[BufCap];
-  
-  snprintf(buf,BufCap-1,pnt2Format,x,y);
-  buf[BufCap-1]=0;
-  
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  int len = putValue(10,x,buf);
+  len += putValue(20,y,buf+len);
+
+  if (outWrtr) outWrtr->write(buf,len);
 }
 
 //---------------------------------------------------------------------------
@@ -278,16 +313,13 @@ void DxfOut::writePoint2D(const Vec2& pt)
 
 void DxfOut::writePoint(double x, double y, double z)
 {
-  if (abs(x) <= zeroTol) x = 0.0;
-  if (abs(y) <= zeroTol) y = 0.0;
-  if (abs(z) <= zeroTol) z = 0.0;
+  char buf[3*(NumBufCap+32)];
 
-  char buf[BufCap];
+  int len = putValue(10,x,buf);
+  len += putValue(20,y,buf+len);
+  len += putValue(30,z,buf+len);
 
-  snprintf(buf,BufCap-1,pnt3Format,x,y,z);
-  buf[BufCap-1]=0;
-
-  if (wrtr) wrtr->write(buf,strlen(buf));
+  if (outWrtr) outWrtr->write(buf,len);
 }
 
 //---------------------------------------------------------------------------
@@ -740,7 +772,11 @@ void DxfOut::writeBlocks()
 
 void DxfOut::writeProlog()
 {
-  if (prologWritten) return;
+  if (entitiesStarted) return;
+  entitiesStarted = true;
+
+  if (spoolTables && openSpool()) return; // Tables are written by finish()
+
   prologWritten = true;
 
   writeHeader();
@@ -753,6 +789,59 @@ void DxfOut::writeProlog()
 
 //---------------------------------------------------------------------------
 
+bool DxfOut::openSpool()
+{
+  spoolFd = tmpfile();
+  if (!spoolFd) return false; // Fall back to writing the tables right away
+
+  spoolWrtr = new StdioWriter(spoolFd,false);
+  outWrtr = spoolWrtr;
+
+  return true;
+}
+
+//---------------------------------------------------------------------------
+// Writes the prolog to the real output, followed by the spooled entities
+
+void DxfOut::writeSpooled()
+{
+  if (!spoolWrtr) return;
+
+  spoolWrtr->flush();
+
+  outWrtr = wrtr;
+
+  if (seedVal <= handleId) seedVal = handleId + 1;
+
+  prologWritten = true;
+
+  writeHeader();
+  writeTables();
+  writeBlocks();
+
+  writeGroup(0,"SECTION");
+  writeGroup(2,"ENTITIES");
+
+  rewind(spoolFd);
+
+  char buf[8192];
+
+  for (;;) {
+    size_t len = fread(buf,1,sizeof(buf),spoolFd);
+    if (len < 1) break;
+
+    if (!wrtr->write(buf,(int)len)) break;
+  }
+
+  delete spoolWrtr;
+  spoolWrtr = NULL;
+
+  fclose(spoolFd);
+  spoolFd = NULL;
+}
+
+//---------------------------------------------------------------------------
+
 void DxfOut::writeObjects()
 {
   writeGroup(0,"SECTION");
@@ -814,11 +903,14 @@ void DxfOut::writeEpilog()
 //---------------------------------------------------------------------------
 
 DxfOut::DxfOut(Writer &writer, bool appendCrLf)
-: wrtr(&writer), prologWritten(false), epilogWritten(false),
+: wrtr(&writer), outWrtr(&writer), spoolFd(NULL), spoolWrtr(NULL),
+  spoolTables(false), entitiesStarted(false),
+  prologWritten(false), epilogWritten(false),
   reverseExtrusionDir(false), crlf(appendCrLf), version2007(false),
   handleId(0x200), seedVal(0x8000),
   userUnit(Mm), extMin(*new Vec3()), extMax(*new Vec3()),
   layLst(new Layer[20]), laySz(0), layCap(20),
+  layHash(NULL), hashCap(0),
   currentLayer(0), currentColor(ColBlackWhite),forceElemColor(false),
   decimals(6), zeroTol(1e-6)
 {
@@ -828,9 +920,11 @@ DxfOut::DxfOut(Writer &writer, bool appendCrLf)
   layLst[0].sysLayer = true;
   laySz++;
 
+  rehashLayers(31);
+
   setDecimals(6);
 
-  if (writer.isClosed()) wrtr = NULL;
+  if (writer.isClosed()) wrtr = outWrtr = NULL;
 }
 
 //---------------------------------------------------------------------------
@@ -839,6 +933,10 @@ DxfOut::~DxfOut()
 {
   finish();
 
+  if (spoolWrtr) delete spoolWrtr;
+  if (spoolFd) fclose(spoolFd);
+
+  delete[] layHash;
   delete[] layLst;
 
   delete &extMin;
@@ -851,10 +949,11 @@ void DxfOut::finish()
 {
   if (!wrtr) return;
 
+  writeSpooled();
   writeEpilog();
 
   wrtr->flush();
-  wrtr = NULL;
+  wrtr = outWrtr = NULL;
 }
 
 //---------------------------------------------------------------------------
@@ -868,25 +967,13 @@ bool DxfOut::isOpen() const
 
 bool DxfOut::setDecimals(int decs)
 {
-  if (!wrtr || prologWritten) return false;
+  if (!wrtr || entitiesStarted) return false;
 
   if (decs < MinDecimals) decs = MinDecimals;
   if (decs > MaxDecimals) decs = MaxDecimals;
 
   decimals = decs;
 
-  if (crlf) {
-    sprintf(dblFormat,"%%d\r\n%%.%df\r\n",decs);
-    sprintf(pnt2Format,"10\r\n%%.%df\r\n20\r\n%%.%df\r\n",decs,decs);
-    sprintf(pnt3Format,"10\r\n%%.%df\r\n20\r\n%%.%df\r\n30\r\n%%.%df\r\n",
-                                                             decs,decs,decs);
-  }
-  else {
-    sprintf(dblFormat,"%%d\n%%.%df\n",decs);
-    sprintf(pnt2Format,"10\n%%.%df\n20\n%%.%df\n",decs,decs);
-    sprintf(pnt3Format,"10\n%%.%df\n20\n%%.%df\n30\n%%.%df\n",decs,decs,decs);
-  }
-
   zeroTol = 1.0;
   for (int i=0; i<decs; ++i) zeroTol /= 10.0;
 
@@ -897,13 +984,32 @@ bool DxfOut::setDecimals(int decs)
 
 bool DxfOut::setReversedExtrusionDir(bool reverse)
 {
-  if (!wrtr || prologWritten) return false;
+  if (!wrtr || entitiesStarted) return false;
 
   reverseExtrusionDir = reverse;
 
   return true;
 }
 
+//---------------------------------------------------------------------------
+// Spooled tables:
+// After setSpooledTables(true) the entities are streamed to a temporary
+// file as they are added and the HEADER, TABLES and BLOCKS sections are
+// only written by finish(). Layers may then be added and the units and
+// extents may then be set at any time before finish() and the hand seed
+// is determined automatically.
+// setDecimals() and setReversedExtrusionDir() must still be called
+// before the first entity is added.
+
+bool DxfOut::setSpooledTables(bool spool)
+{
+  if (!wrtr || entitiesStarted) return false;
+
+  spoolTables = spool;
+
+  return true;
+}
+
 //---------------------------------------------------------------------------
 
 bool DxfOut::setUnits(Units newUnit)
@@ -956,12 +1062,16 @@ long DxfOut::getLayer(const char *name) const
 {
   if (!name || strlen(name) < 1) return -1;
 
-  for (int i=0; i<laySz; i++) {
+  int i = layHash[hashName(name) % hashCap];
+
+  while (i >= 0) {
 #ifdef _WIN32
     if (!_stricmp(layLst[i].getName(),name)) return i;
 #else
     if (!strcasecmp(layLst[i].getName(),name)) return i;
 #endif
+
+    i = layLst[i].nextHash;
   }
 
   return -1;
@@ -974,40 +1084,35 @@ long DxfOut::addLayer(const char *name, Color col, bool bKey, long nKey)
   if (!wrtr || prologWritten || !name ||
           strlen(name) < 1 || col < ColRed) return -1;
 
-  if (laySz >= layCap) {
-    layCap += 20;
-    Layer *newLst = new Layer[layCap];
+  long idx = getLayer(name);
 
-    if (layLst) {
-      for (int i=0; i<laySz; i++) {
-        newLst[i].sysLayer = layLst[i].sysLayer;
-        newLst[i].handle   = layLst[i].handle;
-        newLst[i].col      = layLst[i].col;
-        newLst[i].bKey     = layLst[i].bKey;
-        newLst[i].nKey     = layLst[i].nKey;
-        newLst[i].setName(layLst[i].getName());
-      }
+  if (idx >= 0) {
+    layLst[idx].col  = col;
+    layLst[idx].bKey = bKey;
+    layLst[idx].nKey = nKey;
 
-      delete[] layLst;
+    currentLayer = idx;
 
-      layLst = newLst;
-    }
+    return idx;
   }
 
-  for (int i=0; i<laySz; i++) {
-#ifdef _WIN32
-    if (!_stricmp(layLst[i].getName(),name)) {
-#else
-    if (!strcasecmp(layLst[i].getName(),name)) {
-#endif
-      layLst[i].col  = col;
-      layLst[i].bKey = bKey;
-      layLst[i].nKey = nKey;
-
-      currentLayer = i;
+  if (laySz >= layCap) {
+    layCap *= 2;
+    Layer *newLst = new Layer[layCap];
 
-      return i;
+    for (int i=0; i<laySz; i++) {
+      newLst[i].sysLayer = layLst[i].sysLayer;
+      newLst[i].handle   = layLst[i].handle;
+      newLst[i].col      = layLst[i].col;
+      newLst[i].bKey     = layLst[i].bKey;
+      newLst[i].nKey     = layLst[i].nKey;
+      newLst[i].nextHash = layLst[i].nextHash;
+      newLst[i].takeName(layLst[i]);
     }
+
+    delete[] layLst;
+
+    layLst = newLst;
   }
 
   layLst[laySz].handle = handleId++;
@@ -1016,9 +1121,15 @@ long DxfOut::addLayer(const char *name, Color col, bool bKey, long nKey)
   layLst[laySz].nKey   = nKey;
   layLst[laySz].setName(name);
 
+  hashLayer(laySz);
+
   currentLayer = laySz;
 
-  return laySz++;
+  laySz++;
+
+  if (laySz > hashCap) rehashLayers(hashCap*2+1);
+
+  return currentLayer;
 }
 
 //---------------------------------------------------------------------------
@@ -1090,7 +1201,7 @@ bool DxfOut::addPoint(const Vec3& p1)
 {
   if (!wrtr) return false;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"POINT");
   writeHexGroup(5,handleId++);
@@ -1113,7 +1224,7 @@ bool DxfOut::addLine(const Vec3& p1, const Vec3& p2)
   if (p1.distTo3(p2) < Vec3::IdentDist)
     return addPoint(p1);
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"LINE");
   writeHexGroup(5,handleId++);
@@ -1133,6 +1244,41 @@ bool DxfOut::addLine(const Vec3& p1, const Vec3& p2)
 
 //---------------------------------------------------------------------------
 
+unsigned int DxfOut::hashName(const char *name)
+{
+  unsigned int h = 0;
+
+  while (*name) h = h*31 + (unsigned char)tolower((unsigned char)*name++);
+
+  return h;
+}
+
+//---------------------------------------------------------------------------
+
+void DxfOut::hashLayer(int layIdx)
+{
+  int& bucket = layHash[hashName(layLst[layIdx].getName()) % hashCap];
+
+  layLst[layIdx].nextHash = bucket;
+  bucket = layIdx;
+}
+
+//---------------------------------------------------------------------------
+
+void DxfOut::rehashLayers(int newCap)
+{
+  delete[] layHash;
+
+  hashCap = newCap;
+  layHash = new int[hashCap];
+
+  for (int i=0; i<hashCap; ++i) layHash[i] = -1;
+
+  for (int i=0; i<laySz; ++i) hashLayer(i);
+}
+
+//---------------------------------------------------------------------------
+
 DxfOut::Color DxfOut::currentElemColor() const
 {
   if (!forceElemColor || currentColor != ColByLayer) return currentColor;
@@ -1168,7 +1314,7 @@ bool DxfOut::addArc(const Vec3& c, double radius,
 {
   if (!wrtr) return false;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"ARC");
   writeHexGroup(5,handleId++);
@@ -1226,7 +1372,7 @@ bool DxfOut::addCircle(const Vec3& c, double radius, const Trf3& trf)
 {
   if (!wrtr) return false;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"CIRCLE");
   writeHexGroup(5,handleId++);
@@ -1259,7 +1405,7 @@ bool DxfOut::add2DPoly(const Vec2 *ptLst, int listLen)
 {
   if (!wrtr || !ptLst || listLen < 1) return false;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"LWPOLYLINE");
   writeHexGroup(5,handleId++);
@@ -1301,7 +1447,7 @@ bool DxfOut::write2DPoly(const Trf3& trf, const Elem_C_Cursor& from,
 
   if (!from) return true;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"LWPOLYLINE");
   writeHexGroup(5,handleId++);
@@ -1456,7 +1602,7 @@ bool DxfOut::write3DPoly(const Trf3& trf, const Elem_C_Cursor& from,
 
   if (!from) return true;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   writeGroup(0,"POLYLINE");
   writeHexGroup(5,handleId++);
@@ -1635,7 +1781,7 @@ bool DxfOut::add3DPoly(const Vec3* ptLst, int listLen)
 {
   if (!wrtr || !ptLst || listLen < 1) return false;
 
-  if (!prologWritten) writeProlog();
+  if (!entitiesStarted) writeProlog();
 
   bool closed = false;
 
@@ -13,6 +13,7 @@
 
 #include "it_gen.h"
 #include "sub_rect.hi"
+#include "Base_Arr.h"
 
 #include "cntpanic.hi"
 
@@ -22,6 +23,8 @@
 namespace Ino
 {
 
+const int Cont2_Isect_Index_Min = 256; // Contour pairs for R-trees
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -1374,6 +1377,55 @@ void Cont2_Isect_List::extract_comb_rest(Cont_D_List *cnt_list1,
   }
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Intersect the contour pairs whose rectangles meet, in the ---- */
+/* ------- order of the lists ------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont2_Isect_List::intersect_indexed(Cont_Ref_List& lst1,
+                                         Cont_Ref_List& lst2)
+{
+  int len1 = lst1.Length(), len2 = lst2.Length();
+
+  Cont_Ref **refs1 = new Cont_Ref*[len1];
+  Cont_Ref **refs2 = new Cont_Ref*[len2];
+
+  Rect_Ax *rects1 = new Rect_Ax[len1];
+  Rect_Ax *rects2 = new Rect_Ax[len2];
+
+  Cont_Ref_Cursor rc(lst1);
+
+  for (int i=0; rc; ++rc,++i) {
+    refs1[i]  = &*rc;
+    rects1[i] = rc->Cont.Rect();
+  }
+
+  rc = lst2.Begin();
+
+  for (int i=0; rc; ++rc,++i) {
+    refs2[i]  = &*rc;
+    rects2[i] = rc->Cont.Rect();
+  }
+
+  Cont_Rtree tree1, tree2;
+
+  tree1.Build(rects1,len1);
+  tree2.Build(rects2,len2);
+
+  // Same rectangle test as intersect_xy(), pairs come in list order
+
+  IB_Int_Arr pairs;
+  int pair_cnt = tree1.Overlap_Pairs(tree2,Vec2::IdentDist,pairs);
+
+  for (int i=0; i<pair_cnt; ++i)
+    intersect_xy(*refs1[pairs[2*i]],*refs2[pairs[2*i+1]]);
+
+  delete[] rects2;
+  delete[] rects1;
+  delete[] refs2;
+  delete[] refs1;
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -1386,12 +1438,16 @@ Cont2_Isect_List::Cont2_Isect_List(Cont_Ref_List& lst1, bool rev_1,
 {
   if (rlist1 == rlist2) return;
 
-  Cont_Ref_Cursor rc1(lst1);
+  if ((double)lst1.Length() * lst2.Length() >= Cont2_Isect_Index_Min)
+    intersect_indexed(lst1,lst2);
+  else {
+    Cont_Ref_Cursor rc1(lst1);
 
-  for (;rc1;++rc1) {
-    Cont_Ref_Cursor rc2(lst2);
+    for (;rc1;++rc1) {
+      Cont_Ref_Cursor rc2(lst2);
 
-    for (;rc2;++rc2) intersect_xy(*rc1,*rc2);
+      for (;rc2;++rc2) intersect_xy(*rc1,*rc2);
+    }
   }
 
   // Sort the intersections by parametric
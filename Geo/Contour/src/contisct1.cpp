@@ -11,18 +11,23 @@
 #include "contouri.hi"
 #include "El_Line.h"
 #include "El_Arc.h"
+#include "El_Cir.h"
 
 #include "it_gen.h"
 #include "sub_rect.hi"
 
 #include "cntpanic.hi"
 
+#include "ThreadPool.h"
+
 #include <math.h>
 #include <stdio.h>
 
 namespace Ino
 {
 
+const int Cont1_Isect_Par_Min_Elems = 4096; // Fewer are intersected serially
+
 typedef IT_D_C_Cursor<Cont_Isect,
                                 Cont_Isect_Alloc> Cont_Isect_D_C_Cursor;
 
@@ -292,13 +297,10 @@ void Cont_Isect::Set_To_Left()
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static bool arr_dep_tab_set = false;
 static Cont_Isect::Rel_Dir arrive_tab[4][4], depart_tab[4][4];
 
-static void set_arr_dep_tabs()
+static bool set_arr_dep_tabs()
 {
-  arr_dep_tab_set = true;
-  
   arrive_tab[Cont_Isect::tang  ][Cont_Isect::tang  ] = Cont_Isect::tang;
   arrive_tab[Cont_Isect::tang  ][Cont_Isect::a_tang] = Cont_Isect::tang;
   arrive_tab[Cont_Isect::tang  ][Cont_Isect::left  ] = Cont_Isect::tang;
@@ -338,6 +340,8 @@ static void set_arr_dep_tabs()
   depart_tab[Cont_Isect::right ][Cont_Isect::a_tang] = Cont_Isect::right;
   depart_tab[Cont_Isect::right ][Cont_Isect::left  ] = Cont_Isect::right;
   depart_tab[Cont_Isect::right ][Cont_Isect::right ] = Cont_Isect::left; 
+
+  return true;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -349,7 +353,8 @@ static void oth_arr_dep(Cont_Isect::Rel_Dir arr,
                         Cont_Isect::Rel_Dir& o_arr,
                         Cont_Isect::Rel_Dir& o_dep)
 {
-  if (!arr_dep_tab_set) set_arr_dep_tabs();
+  static const bool tabs_set = set_arr_dep_tabs(); // Once, thread safe
+  (void)tabs_set;
   
   o_arr = arrive_tab[arr][dep];
   o_dep = depart_tab[arr][dep];
@@ -1925,61 +1930,58 @@ void Cont1_Isect_List::delete_identical(double tol)
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-void Cont1_Isect_List::
-            intersect_el(Cont_Ref& cntref,
-                         const Elem_Cursor& elc1,
-                         const Elem_Cursor& elc2, double /*parlen*/)
+static bool adjacent_elems(const Elem_Cursor& elc1, const Elem_Cursor& elc2)
 {
-  Isect_Lst pair_list;
+  return elc1.Succ() == elc2.Self() || elc1.Pred() == elc2.Self();
+}
 
-  Elem &el1 = elc1->El();
-  Elem &el2 = elc2->El();
+/* ---------------------------------------------------------------------- */
+/* ------- Stretch adjacent elements to their common intersections ------ */
+/* ------- at the joint, these are removed from the pair list ----------- */
+/* ---------------------------------------------------------------------- */
 
-  bool adjacent = false;
+static void stretch_joints(Elem& el1, Elem& el2, Isect_Lst& pair_list,
+                                                          bool check = true)
+{
+  Isect_Cursor plc(pair_list);
 
-  if (elc1.Succ() == elc2.Self() ||
-      elc1.Pred() == elc2.Self()) adjacent = true;
+  if (plc->First.Par < el1.Begin_Par() + Vec2::IdentDist &&
+      plc->Last.Par  > el2.End_Par()   - Vec2::IdentDist)
+  {
+    el1.Stretch_Begin_XY(plc->P,check);
+    el2.Stretch_End_XY(plc->P,check);
 
-  // if (adjacent) el1.Intersect_XY(el2,true,pair_list); // Tangent Ok
-  // else          el1.Intersect_XY(el2,pair_list);
+    plc.Delete();
+  }
 
-  el1.Intersect_XY(el2,true,pair_list);
+  plc.To_Last(); if (!plc) return;
 
-  if (!pair_list) return;
+  if (plc->First.Par > el1.End_Par()   - Vec2::IdentDist &&
+      plc->Last.Par  < el2.Begin_Par() + Vec2::IdentDist)
+  {
+    el1.Stretch_End_XY(plc->P,check);
+    el2.Stretch_Begin_XY(plc->P,check);
 
-  // Insert results into list
+    plc.Delete();
+  }
+}
 
-  Isect_Cursor plc(pair_list);
+/* ---------------------------------------------------------------------- */
+/* ------- Insert cnt intersections from plc into the list -------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_List::add_isects(Cont_Ref& cntref,
+                                  const Elem_Cursor& elc1,
+                                  const Elem_Cursor& elc2,
+                                  Isect_Cursor& plc, int cnt)
+{
+  const Elem &el1 = elc1->El();
+  const Elem &el2 = elc2->El();
 
   Cont_Isect_D_Cursor isc1(ilist);
   Cont_Isect_D_Cursor isc2(ilist);
 
-  if (adjacent) {
-    plc.To_Begin();
-    if (plc->First.Par < el1.Begin_Par() + Vec2::IdentDist &&
-        plc->Last.Par  > el2.End_Par()   - Vec2::IdentDist)
-    {
-      el1.Stretch_Begin_XY(plc->P);
-      el2.Stretch_End_XY(plc->P);
-
-      plc.Delete();
-    }
-
-    plc.To_Last(); if (!plc) return;
-
-    if (plc->First.Par > el1.End_Par()   - Vec2::IdentDist &&
-        plc->Last.Par  < el2.Begin_Par() + Vec2::IdentDist)
-    {
-      el1.Stretch_End_XY(plc->P);
-      el2.Stretch_Begin_XY(plc->P);
-
-      plc.Delete();
-    }
-  }
-
-  plc.To_Begin();
-
-  for (;plc;++plc) {
+  for (;plc && cnt > 0;++plc,--cnt) {
     Vec3 isp(plc->P);
 
     double rpar = plc->First.Par - el1.Begin_Par();
@@ -2003,12 +2005,44 @@ void Cont1_Isect_List::
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+void Cont1_Isect_List::
+            intersect_el(Cont_Ref& cntref,
+                         const Elem_Cursor& elc1,
+                         const Elem_Cursor& elc2, double /*parlen*/)
+{
+  Isect_Lst pair_list;
+
+  Elem &el1 = elc1->El();
+  Elem &el2 = elc2->El();
+
+  // if (adjacent) el1.Intersect_XY(el2,true,pair_list); // Tangent Ok
+  // else          el1.Intersect_XY(el2,pair_list);
+
+  el1.Intersect_XY(el2,true,pair_list);
+
+  if (!pair_list) return;
+
+  // Insert results into list
+
+  if (adjacent_elems(elc1,elc2)) stretch_joints(el1,el2,pair_list);
+
+  Isect_Cursor plc(pair_list);
+
+  add_isects(cntref,elc1,elc2,plc,pair_list.Length());
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 void Cont1_Isect_List::intersect_xy(Cont_Ref& cntref, bool one_only)
 {
   Contour &cnt = (Contour &)(cntref.Cont);
 
   if (!cnt.el_rect_list) cnt.build_rect_list();
 
+  if (!one_only && intersect_xy_par(cntref)) return;
+
   Elem_Cursor el1(cnt.el_list);
   Elem_Cursor el2(cnt.el_list);
 
@@ -2069,6 +2103,612 @@ void Cont1_Isect_List::intersect_xy(Cont_Ref& cntref, bool one_only)
   }
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Parallel intersection of the element pairs ------------------- */
+/* ---------------------------------------------------------------------- */
+/* The serial loop meets a pair of elements that are not adjacent with   */
+/* the first one already stretched to both its neighbours and the second */
+/* one still as it was. The workers intersect all these pairs in that    */
+/* state, the pairs that intersect are then merged, in the order of the  */
+/* loop, with the adjacent pairs, which are done on the calling thread.  */
+/* Should an element not be in the state the workers used, all its later */
+/* pairs are intersected again: the result is the same as the serial one.*/
+/* ---------------------------------------------------------------------- */
+
+struct Cont1_Isect_Pair       // A pair of elements in the loop order
+{
+  int rct1, rct2;             // Sub rectangle indices
+  int el1, el2;               // Element indices
+  int cnt;                    // Number of intersections
+
+  bool Before(const Cont1_Isect_Pair& p) const {
+    if (rct1 != p.rct1) return rct1 < p.rct1;
+    if (rct2 != p.rct2) return rct2 < p.rct2;
+    if (el1  != p.el1)  return el1  < p.el1;
+    return el2 < p.el2;
+  }
+};
+
+/* ---------------------------------------------------------------------- */
+
+static int isect_pair_cmp(const void *p1, const void *p2)
+{
+  const Cont1_Isect_Pair& pr1 = *(const Cont1_Isect_Pair *)p1;
+  const Cont1_Isect_Pair& pr2 = *(const Cont1_Isect_Pair *)p2;
+
+  if (pr1.Before(pr2)) return -1;
+  if (pr2.Before(pr1)) return  1;
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+class Cont1_El_State          // What Intersect_XY() depends on
+{
+   Vec3 p1, p2;
+   Vec2 c;
+   double bpar, plen;
+
+  public:
+   Cont1_El_State() : p1(), p2(), c(), bpar(0.0), plen(0.0) {}
+   Cont1_El_State(const Elem& el);
+
+   bool Same(const Elem& el) const;   // Bitwise
+};
+
+/* ---------------------------------------------------------------------- */
+
+Cont1_El_State::Cont1_El_State(const Elem& el)
+  : p1(el.P1()), p2(el.P2()), c(),
+    bpar(el.Begin_Par()), plen(el.Par_Len())
+{
+  if (el.isArc())         c = ((const Elem_Arc&)el).C();
+  else if (el.isCircle()) c = ((const Elem_Circle&)el).C();
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont1_El_State::Same(const Elem& el) const
+{
+  Cont1_El_State st(el);
+
+  return p1.x == st.p1.x && p1.y == st.p1.y && p1.z == st.p1.z &&
+         p2.x == st.p2.x && p2.y == st.p2.y && p2.z == st.p2.z &&
+         c.x  == st.c.x  && c.y  == st.c.y  &&
+         bpar == st.bpar && plen == st.plen;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Elements and sub rectangles by index ------------------------- */
+/* ---------------------------------------------------------------------- */
+
+class Cont1_Isect_Par
+{
+   Cont1_Isect_Par(const Cont1_Isect_Par& cp);
+   Cont1_Isect_Par& operator=(const Cont1_Isect_Par& src);
+
+  public:
+   int el_cnt, rct_cnt;
+
+   Elem_Cursor *curs;         // Per element
+   int *el_rct;               // Its sub rectangle
+   Elem **stretched;          // Copy stretched to its neighbours
+
+   Cont1_El_State *joint_st;  // Per element i, the copy as met by (i,i+1)
+   bool *joint_met;           // (i,i+1) passed the loop's tests
+   Isect_Lst *joints;         // and its intersections
+
+   const Rect_Ax **rcts;      // Per sub rectangle
+   int *rct_first;            // Its first element, one extra at the end
+
+   Cont1_Isect_Pair *pend;    // Pairs to intersect again
+   int pend_cnt, pend_cap;
+
+   Cont1_Isect_Par(Elem_List& el_list, const Elem_Rect_List& rct_list);
+   ~Cont1_Isect_Par();
+
+   bool Ok() const { return rct_cnt > 0; }
+
+   bool Meet(int r1, int r2) const
+                  { return rcts[r1]->Intersects_XY(*rcts[r2],Vec2::IdentDist); }
+
+   bool Adjacent(int e1, int e2) const
+                               { return adjacent_elems(curs[e1],curs[e2]); }
+
+   bool Loop_Meets(int r1, int r2, const Elem& el1, const Elem& el2) const;
+
+   void Stretch(int beg, int end);
+
+   void Add_Pend(int r1, int r2, int e1, int e2);
+   void Pend_First(int e1, const Cont1_Isect_Pair& now, const bool *redo2);
+   void Pend_Second(int e2, const Cont1_Isect_Pair& now, const bool *redo1);
+};
+
+/* ---------------------------------------------------------------------- */
+
+Cont1_Isect_Par::Cont1_Isect_Par(Elem_List& el_list,
+                                 const Elem_Rect_List& rct_list)
+  : el_cnt(el_list.Length()), rct_cnt(0),
+    curs(NULL), el_rct(NULL), stretched(NULL),
+    joint_st(NULL), joint_met(NULL), joints(NULL),
+    rcts(NULL), rct_first(NULL), pend(NULL), pend_cnt(0), pend_cap(0)
+{
+  Sub_Rect_C_Cursor rc(rct_list.Begin());
+
+  int rcnt = 0;
+  for (;rc;++rc) rcnt++;
+
+  curs      = new Elem_Cursor[el_cnt];
+  el_rct    = new int[el_cnt];
+  stretched = new Elem*[el_cnt];
+  joint_st  = new Cont1_El_State[el_cnt];
+  joint_met = new bool[el_cnt];
+  joints    = new Isect_Lst[el_cnt];
+  rcts      = new const Rect_Ax*[rcnt];
+  rct_first = new int[rcnt+1];
+
+  for (int i=0; i<el_cnt; ++i) {
+    stretched[i] = NULL; joint_met[i] = false;
+  }
+
+  Elem_Cursor elc(el_list);
+  int i = 0, r = 0;
+
+  for (rc = rct_list.Begin(); rc; ++rc,++r) {
+    rcts[r] = &rc->Rect;
+    rct_first[r] = i;
+
+    for (;elc != rc->Upto;++elc,++i) {
+      if (!elc) return;          // Not Ok(), the loop would panic
+
+      curs[i] = elc; el_rct[i] = r;
+      stretched[i] = elc->El().Clone(false);
+    }
+  }
+
+  rct_first[r] = i;
+
+  if (i == el_cnt && r > 0) rct_cnt = r;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont1_Isect_Par::~Cont1_Isect_Par()
+{
+  for (int i=0; i<el_cnt; ++i) delete stretched[i];
+
+  delete[] pend;
+  delete[] rct_first;
+  delete[] rcts;
+  delete[] joints;
+  delete[] joint_met;
+  delete[] joint_st;
+  delete[] stretched;
+  delete[] el_rct;
+  delete[] curs;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Would intersect_xy() intersect these? ------------------------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont1_Isect_Par::Loop_Meets(int r1, int r2,
+                                 const Elem& el1, const Elem& el2) const
+{
+  return Meet(r1,r2) &&
+         el1.Len_XY() >= Vec2::IdentDist &&
+         el1.Rect().Intersects_XY(*rcts[r2],Vec2::IdentDist) &&
+         el2.Len_XY() >= Vec2::IdentDist;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Stretch the copies beg..end-1 as the loop stretches the ------ */
+/* ------- elements. The copy at beg is not stretched to its ------------ */
+/* ------- predecessor, that is done by the task before this one. ------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Par::Stretch(int beg, int end)
+{
+  for (int i=beg; i<end && i+1<el_cnt; ++i) {
+    Elem& el1 = *stretched[i];
+
+    Elem *nxt = i+1 < end ? stretched[i+1] : curs[i+1]->El().Clone(false);
+    Elem& el2 = *nxt;
+
+    joint_st[i]  = Cont1_El_State(el1);
+    joint_met[i] = Loop_Meets(el_rct[i],el_rct[i+1],el1,el2);
+
+    if (joint_met[i]) {
+      el1.Intersect_XY(el2,true,joints[i]);
+
+      if (joints[i]) {
+        Isect_Lst pair_list(joints[i]);
+        stretch_joints(el1,el2,pair_list,false);
+      }
+    }
+
+    if (nxt != stretched[i+1]) delete nxt;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Par::Add_Pend(int r1, int r2, int e1, int e2)
+{
+  if (pend_cnt >= pend_cap) {
+    pend_cap = pend_cap < 64 ? 64 : 2*pend_cap;
+
+    Cont1_Isect_Pair *new_pend = new Cont1_Isect_Pair[pend_cap];
+    for (int p=0; p<pend_cnt; ++p) new_pend[p] = pend[p];
+
+    delete[] pend;
+    pend = new_pend;
+  }
+
+  Cont1_Isect_Pair& pr = pend[pend_cnt++];
+
+  pr.rct1 = r1; pr.rct2 = r2;
+  pr.el1  = e1; pr.el2  = e2;
+  pr.cnt  = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- All pairs after now with e1 as first element ----------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Par::Pend_First(int e1, const Cont1_Isect_Pair& now,
+                                                      const bool *redo2)
+{
+  int r1 = el_rct[e1];
+
+  for (int r2=r1; r2<rct_cnt; ++r2) {
+    if (!Meet(r1,r2)) continue;
+
+    int j = r1 == r2 ? e1+1 : rct_first[r2];
+
+    for (;j<rct_first[r2+1];++j) {
+      Cont1_Isect_Pair pr = { r1, r2, e1, j, 0 };
+
+      if (now.Before(pr) && !redo2[j] && !Adjacent(e1,j))
+                                                   Add_Pend(r1,r2,e1,j);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- All pairs after now with e2 as second element ---------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Par::Pend_Second(int e2, const Cont1_Isect_Pair& now,
+                                                      const bool *redo1)
+{
+  int r2 = el_rct[e2];
+
+  for (int r1=0; r1<=r2; ++r1) {
+    if (!Meet(r1,r2)) continue;
+
+    int end = r1 == r2 ? e2 : rct_first[r1+1];
+
+    for (int i=rct_first[r1]; i<end; ++i) {
+      Cont1_Isect_Pair pr = { r1, r2, i, e2, 0 };
+
+      if (now.Before(pr) && !redo1[i] && !Adjacent(i,e2))
+                                                   Add_Pend(r1,r2,i,e2);
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+class Cont1_Isect_Task : public Cont_Task
+{
+   void add_hit(int r1, int r2, int e1, int e2, Isect_Lst& pair_list);
+
+   Cont1_Isect_Task(const Cont1_Isect_Task& cp);
+   Cont1_Isect_Task& operator=(const Cont1_Isect_Task& src);
+
+  public:
+   Cont1_Isect_Par *par;
+   int rct_beg, rct_end;      // Sub rectangles of this task
+
+   Cont1_Isect_Pair *hits;    // Pairs that intersect
+   int hit_cnt, hit_cap;
+   Isect_Lst pairs;           // Their intersections
+
+   Cont1_Isect_Task()
+     : par(NULL), rct_beg(0), rct_end(0),
+       hits(NULL), hit_cnt(0), hit_cap(0), pairs() {}
+   ~Cont1_Isect_Task() { delete[] hits; }
+
+   virtual void work();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Task::add_hit(int r1, int r2, int e1, int e2,
+                                                  Isect_Lst& pair_list)
+{
+  if (hit_cnt >= hit_cap) {
+    hit_cap = hit_cap < 64 ? 64 : 2*hit_cap;
+
+    Cont1_Isect_Pair *new_hits = new Cont1_Isect_Pair[hit_cap];
+    for (int h=0; h<hit_cnt; ++h) new_hits[h] = hits[h];
+
+    delete[] hits;
+    hits = new_hits;
+  }
+
+  Cont1_Isect_Pair& hit = hits[hit_cnt++];
+
+  hit.rct1 = r1; hit.rct2 = r2;
+  hit.el1  = e1; hit.el2  = e2;
+  hit.cnt  = pair_list.Length();
+
+  pair_list.Append_To(pairs);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same loop as Cont1_Isect_List::intersect_xy() ---------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont1_Isect_Task::work()
+{
+  par->Stretch(par->rct_first[rct_beg],par->rct_first[rct_end]);
+
+  const Cont1_Isect_Par& p = *par;
+
+  for (int r1=rct_beg; r1<rct_end; ++r1) {
+    for (int r2=r1; r2<p.rct_cnt; ++r2) {
+      if (!p.Meet(r1,r2)) continue;
+
+      const Rect_Ax& rct2 = *p.rcts[r2];
+
+      for (int i=p.rct_first[r1]; i<p.rct_first[r1+1]; ++i) {
+        const Elem &locel1 = *p.stretched[i];
+
+        if (locel1.Len_XY() < Vec2::IdentDist ||
+            !locel1.Rect().Intersects_XY(rct2,Vec2::IdentDist)) continue;
+
+        int j = r1 == r2 ? i+1 : p.rct_first[r2];
+
+        for (;j<p.rct_first[r2+1];++j) {
+          const Elem &locel2 = p.curs[j]->El();
+
+          if (locel2.Len_XY() >= Vec2::IdentDist && !p.Adjacent(i,j)) {
+            Isect_Lst pair_list;
+
+            locel1.Intersect_XY(locel2,true,pair_list);
+
+            if (pair_list) add_hit(r1,r2,i,j,pair_list);
+          }
+        }
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Returns false if done better serially ------------------------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont1_Isect_List::intersect_xy_par(Cont_Ref& cntref)
+{
+  Contour &cnt = (Contour &)(cntref.Cont);
+
+  int thr_cnt = Cont_Par_Pool::Thread_Count((int)cnt.el_list.Length(),
+                                             Cont1_Isect_Par_Min_Elems);
+  if (thr_cnt < 2) return false;
+
+  Cont1_Isect_Par par(cnt.el_list,*cnt.el_rect_list);
+  if (!par.Ok()) return false;
+
+  int el_cnt = par.el_cnt, rct_cnt = par.rct_cnt;
+
+  // Consecutive sub rectangles, about the same number of elements per task
+
+  int task_cnt = 4*thr_cnt;
+  if (task_cnt > rct_cnt) task_cnt = rct_cnt;
+
+  Cont1_Isect_Task *tasks = new Cont1_Isect_Task[task_cnt];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[task_cnt];
+
+  int per_task = (el_cnt + task_cnt - 1)/task_cnt, t = 0;
+
+  for (int r=0; r<rct_cnt; ++r) {
+    if (par.rct_first[r] >= (t+1)*per_task && t < task_cnt-1) {
+      tasks[t++].rct_end = r;
+      tasks[t].rct_beg = r;
+    }
+  }
+
+  tasks[t].rct_end = rct_cnt;
+
+  task_cnt = t+1;
+
+  for (t=0; t<task_cnt; ++t) {
+    tasks[t].par = &par;
+    task_lst[t] = &tasks[t];
+  }
+
+  bool ok = true;
+
+  {
+    Cont_Par_Pool pool;
+    if (!pool.Run_All(task_lst,task_cnt)) ok = false;
+  }
+
+  // All intersecting pairs in the order of the loop
+
+  int hit_cnt = 0;
+  for (t=0; t<task_cnt; ++t) hit_cnt += tasks[t].hit_cnt;
+
+  Cont1_Isect_Pair *hits = new Cont1_Isect_Pair[hit_cnt + 1];
+  Isect_Lst pairs;
+
+  hit_cnt = 0;
+
+  for (t=0; t<task_cnt; ++t) {
+    Cont1_Isect_Task& task = tasks[t];
+
+    for (int h=0; h<task.hit_cnt; ++h) hits[hit_cnt++] = task.hits[h];
+    task.pairs.Append_To(pairs);
+  }
+
+  delete[] task_lst;
+  delete[] tasks;
+
+  if (!ok) {
+    delete[] hits;
+    return false;
+  }
+
+  // The adjacent pairs, (0,el_cnt-1) too as the list is circular
+
+  int adj_cnt = 0;
+  Cont1_Isect_Pair *adjs = new Cont1_Isect_Pair[el_cnt];
+
+  for (int i=0; i<el_cnt; ++i) {
+    int j = i+1 < el_cnt ? i+1 : 0;
+
+    Cont1_Isect_Pair& adj = adjs[adj_cnt];
+
+    if (j > i) {
+      adj.rct1 = par.el_rct[i]; adj.rct2 = par.el_rct[j];
+      adj.el1  = i;             adj.el2  = j;
+    }
+    else if (el_cnt > 2) {
+      adj.rct1 = par.el_rct[j]; adj.rct2 = par.el_rct[i];
+      adj.el1  = j;             adj.el2  = i;
+    }
+    else continue;
+
+    adj.cnt = 0;
+    adj_cnt++;
+  }
+
+  qsort(adjs,adj_cnt,sizeof(Cont1_Isect_Pair),isect_pair_cmp);
+
+  // Merge: the adjacent pairs are intersected here, they stretch the
+  // elements, and so are the pairs whose elements then differ from what
+  // the workers used. The results of the others are just inserted.
+
+  bool *changed = new bool[el_cnt];  // No longer the original
+  bool *settled = new bool[el_cnt];  // Adjacent pair (i,i+1) done
+  bool *redo1   = new bool[el_cnt];  // Later pairs with i first pending
+  bool *redo2   = new bool[el_cnt];  // Later pairs with i second pending
+
+  for (int i=0; i<el_cnt; ++i) {
+    changed[i] = false; settled[i] = false;
+    redo1[i]   = false; redo2[i]   = false;
+  }
+
+  double parlen = cnt.End_Par() - cnt.Begin_Par();
+
+  Isect_Cursor plc(pairs);
+  int h = 0, a = 0, p = 0;
+
+  for (;;) {
+    const Cont1_Isect_Pair *nxt = NULL;
+    int *src = NULL;
+
+    if (h < hit_cnt) {
+      nxt = &hits[h]; src = &h;
+    }
+    if (a < adj_cnt && (!nxt || adjs[a].Before(*nxt))) {
+      nxt = &adjs[a]; src = &a;
+    }
+    if (p < par.pend_cnt && (!nxt || par.pend[p].Before(*nxt))) {
+      nxt = &par.pend[p]; src = &p;
+    }
+
+    if (!nxt) break;
+
+    Cont1_Isect_Pair pr = *nxt;
+    (*src)++;
+
+    const Elem_Cursor& elc1 = par.curs[pr.el1];
+    const Elem_Cursor& elc2 = par.curs[pr.el2];
+
+    if (src == &h) {
+      if (redo1[pr.el1] || redo2[pr.el2]) {
+        for (int k=pr.cnt; k>0; --k) ++plc;
+      }
+      else add_isects(cntref,elc1,elc2,plc,pr.cnt);
+
+      continue;
+    }
+
+    Elem &el1 = elc1->El();
+    Elem &el2 = elc2->El();
+
+    if (src == &p) {
+      if (par.Loop_Meets(pr.rct1,pr.rct2,el1,el2))
+                            intersect_el(cntref,elc1,elc2,parlen);
+      continue;
+    }
+
+    Cont1_El_State st1(el1), st2(el2);
+
+    bool next = pr.el2 == pr.el1+1;
+
+    if (next && !changed[pr.el2] && par.joint_st[pr.el1].Same(el1)) {
+
+      // As the worker met it
+
+      Isect_Lst& pair_list = par.joints[pr.el1];
+
+      if (par.joint_met[pr.el1] && pair_list) {
+        stretch_joints(el1,el2,pair_list);
+
+        Isect_Cursor jlc(pair_list);
+        add_isects(cntref,elc1,elc2,jlc,pair_list.Length());
+      }
+    }
+    else if (par.Loop_Meets(pr.rct1,pr.rct2,el1,el2))
+                            intersect_el(cntref,elc1,elc2,parlen);
+
+    bool chg1 = !st1.Same(el1), chg2 = !st2.Same(el2);
+
+    if (chg1) changed[pr.el1] = true;
+    if (chg2) changed[pr.el2] = true;
+
+    int pend_old = par.pend_cnt;
+
+    if (next) {
+      settled[pr.el1] = true; chg1 = true;
+    }
+    else if (chg2 && !redo2[pr.el2]) {
+
+      // Only the pair (0,el_cnt-1) comes before pairs with its
+      // second element as second one
+
+      redo2[pr.el2] = true;
+      par.Pend_Second(pr.el2,pr,redo1);
+    }
+
+    if (chg1 && settled[pr.el1] && !redo1[pr.el1] &&
+                      !Cont1_El_State(*par.stretched[pr.el1]).Same(el1)) {
+      redo1[pr.el1] = true;
+      par.Pend_First(pr.el1,pr,redo2);
+    }
+
+    if (par.pend_cnt > pend_old) {
+      qsort(par.pend+p,par.pend_cnt-p,sizeof(Cont1_Isect_Pair),
+                                                        isect_pair_cmp);
+    }
+  }
+
+  delete[] redo2;
+  delete[] redo1;
+  delete[] settled;
+  delete[] changed;
+  delete[] adjs;
+  delete[] hits;
+
+  return true;
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -2172,7 +2812,7 @@ void Cont1_Isect_List::Intersections_Into(Cont_PPair_List& pplist)
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static Vec2 last_gap;
+static thread_local Vec2 last_gap;
 
 const Vec2& Last_Gap()
 {
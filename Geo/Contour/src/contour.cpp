@@ -29,6 +29,7 @@
 #include <stdlib.h>
 
 #include "Exceptions.h"
+#include "ThreadPool.h"
 
 namespace Ino
 {
@@ -36,24 +37,14 @@ namespace Ino
 const int Cont_Sub_Rect_Max_Elems = 16;
 const double Cont_Sub_Rect_Max_Area_Rel = 0.25;
 
-/* ---------------------------------------------------------------------- */
+const int Cont_Polyline_Max_Steps = 65536;   // Per arc or circle
+const int Cont_Polyline_Max_Cached = 4;      // Then only finer ones added
 
-template<> Isect_Alloc *Isect_Alloc::root = NULL;
-template<> Elem_Alloc *Elem_Alloc::root = NULL;
+const int Cont_List_Index_Min = 16;          // Contours for an R-tree
 
-typedef IT_Chain_Alloc<IT_D_Item<Elem_Cursor> > Elem_Cursor_Alloc;
-template<> Elem_Cursor_Alloc* Elem_Cursor_Alloc::root = NULL;
+/* ---------------------------------------------------------------------- */
 
-template<> Sub_Rect_Alloc *Sub_Rect_Alloc::root = NULL;
-template<> Cont_PPair_Alloc *Cont_PPair_Alloc::root = NULL;
-template<> Cont_Ref_Alloc *Cont_Ref_Alloc::root = NULL;
-template<> Cont_Isect_Alloc *Cont_Isect_Alloc::root = NULL;
-template<> IT_Chain_Alloc<IT_D_Item<Cont_Isect_Cursor> >
-               *IT_Chain_Alloc<IT_D_Item<Cont_Isect_Cursor> >::root = NULL;
-template<> Cont_Alloc *Cont_Alloc::root = NULL;
-template<> Cont_Clsd_Alloc *Cont_Clsd_Alloc::root = NULL;
-template<> Cont_Nest_Alloc *Cont_Nest_Alloc::root = NULL;
-template<> Cont_Area_Alloc *Cont_Area_Alloc::root = NULL;
+typedef IT_Chain_Alloc<IT_D_Item<Elem_Cursor> > Elem_Cursor_Alloc;
 
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -83,6 +74,42 @@ void Contour::CleanupMem()
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+void Cont_Task::run()
+{
+  work();
+
+  // Nodes freed on this thread went to its own free chains
+
+  Contour::CleanupMem();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Threads to spread work over, 1 if it is to be done serially -- */
+/* ------- Also 1 on a worker thread, so no pool is started per worker -- */
+/* ---------------------------------------------------------------------- */
+
+int Cont_Par_Pool::Thread_Count(int work, int min_work)
+{
+  if (work < min_work || ThreadPool::isWorkerThread()) return 1;
+
+  return ThreadPool::processorCount();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Par_Pool::Run_All(ThreadPool::Task **task_lst, int task_cnt)
+{
+  if (!pool) pool = new ThreadPool();
+
+  return pool->runAll(task_lst,task_cnt);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 static void (*Panic)(int error_no) = NULL;
 
 /* ---------------------------------------------------------------------- */
@@ -1450,6 +1477,12 @@ void Contour::inval_rects() const
 {
   if (el_rect_list) delete el_rect_list;
   el_rect_list = NULL;
+
+  if (slabs) delete slabs;
+  slabs = NULL;
+  inside_cnt = 0;
+
+  Drop_Polylines();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -1482,6 +1515,24 @@ void Contour::build_rect_list() const
                                                      Rect_Ax::Area_XY());
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Point in (closed) contour using the slab index --------------- */
+/* ------- Returns false if undecided (p on or near the contour) -------- */
+/* ---------------------------------------------------------------------- */
+
+bool Contour::prepared_inside(const Vec2& p, bool& inside) const
+{
+  if (!slabs) {
+    if (++inside_cnt < 2) return false; // Not worth it for a single test
+
+    slabs = new Cont_Slabs(2.0 * Vec2::IdentDist);
+    slabs->Add(el_list);
+    slabs->Build();
+  }
+
+  return slabs->Pnt_Inside(p,inside);
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -1615,10 +1666,11 @@ void Contour::calc_invar(double tol)
 
 Contour::Contour()
   : Rect_Ax(), len_xy(0.0), len(0.0),
-    el_list(), el_rect_list(NULL),
+    el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+    polylines(NULL),
     intersecting_valid(false), intersecting(false),
     is_closed(false), mark(false), inert(), parent(NULL),
-    persistLstLen(0), persistLst(NULL)
+    persistLstLen(0), persistLst(NULL), persistPack(NULL)
 {
 }
 
@@ -1628,10 +1680,11 @@ Contour::Contour()
 
 Contour::Contour(const Elem_List& newellist, Elem_List* waste)
   : Rect_Ax(), len_xy(0.0), len(0.0),
-    el_list(), el_rect_list(NULL),
+    el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+    polylines(NULL),
     intersecting_valid(false), intersecting(false),
     is_closed(false), mark(false), inert(), parent(NULL),
-    persistLstLen(0), persistLst(NULL)
+    persistLstLen(0), persistLst(NULL), persistPack(NULL)
 {
   Elem_C_Cursor elc(newellist);
 
@@ -1719,7 +1772,8 @@ Contour::Contour(const Elem_List& newellist, Elem_List* waste)
 
 //Contour::Contour(Elem_List& newElList, double tol)
 //  : Rect_Ax(), len_xy(0.0), len(0.0),
-//    el_list(), el_rect_list(NULL),
+//    el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+//    polylines(NULL),
 //    intersecting_valid(false), intersecting(false),
 //    is_closed(false), mark(false), inert(), parent(NULL),
 //    persistLstLen(0), persistLst(NULL)
@@ -1785,11 +1839,12 @@ Contour::Contour(const Elem_List& newellist, Elem_List* waste)
 
 Contour::Contour(const Contour& cp)
   : Persistable(cp), Rect_Ax(cp), len_xy(cp.len_xy), len(cp.len),
-    el_list(cp.el_list), el_rect_list(NULL),
+    el_list(cp.el_list), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+    polylines(NULL),
     intersecting_valid(cp.intersecting_valid),
     intersecting(cp.intersecting), is_closed(cp.is_closed),
     mark(cp.mark), inert(cp.inert), parent(cp.parent),
-    persistLstLen(0), persistLst(NULL)
+    persistLstLen(0), persistLst(NULL), persistPack(NULL)
 {
 }
 
@@ -1799,11 +1854,12 @@ Contour::Contour(const Contour& cp)
 
 Contour::Contour(const Vec2& cntr, double rad, bool ccw)
   : Rect_Ax(), len_xy(0.0), len(0.0),
-    el_list(), el_rect_list(NULL),
+    el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+    polylines(NULL),
     intersecting_valid(true),
     intersecting(false), is_closed(true),
     mark(false), inert(), parent(NULL),
-    persistLstLen(0), persistLst(NULL)
+    persistLstLen(0), persistLst(NULL), persistPack(NULL)
 {
    Vec3 p1(cntr,0.0); p1 += Vec2(rad,0.0);
 
@@ -1820,11 +1876,12 @@ Contour::Contour(const Vec2& cntr, double rad, bool ccw)
 
 Contour::Contour(const Rect_Ax& rct)
   : Rect_Ax(), len_xy(0.0), len(0.0),
-    el_list(), el_rect_list(NULL),
+    el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+    polylines(NULL),
     intersecting_valid(true),
     intersecting(false), is_closed(true),
     mark(false), inert(), parent(NULL),
-    persistLstLen(0), persistLst(NULL)
+    persistLstLen(0), persistLst(NULL), persistPack(NULL)
 {
   Vec3 lr(rct.Ur().x,rct.Ll().y);
   Vec3 ul(rct.Ll().x,rct.Ur().y);
@@ -1844,7 +1901,12 @@ Contour::Contour(const Rect_Ax& rct)
 Contour::~Contour()
 {
   if (el_rect_list) delete el_rect_list;
+  if (slabs) delete slabs;
+
+  Drop_Polylines();
+
   if (persistLst) delete[] persistLst;
+  if (persistPack) delete persistPack;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -2572,6 +2634,62 @@ const Cont_Inert& Contour::Inert() const
   return inert;
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Polyline within chord_tol, cached until the contour ---------- */
+/* ------- changes or Drop_Polylines(), so the reference stays valid ---- */
+/* ------- that long. The tolerance is rounded down to a power of two, -- */
+/* ------- so nearby tolerances share a polyline. Once the cache holds -- */
+/* ------- Cont_Polyline_Max_Cached polylines, the coarsest one that ---- */
+/* ------- is at least as fine is returned and only a finer request ----- */
+/* ------- adds another. Like the other caches not for concurrent use --- */
+/* ------- of the same contour from several threads. -------------------- */
+/* ---------------------------------------------------------------------- */
+
+const Cont_Polyline& Contour::Polyline(double chord_tol) const
+{
+  if (chord_tol > 0.0) {
+    int exp;
+    frexp(chord_tol,&exp);
+    chord_tol = ldexp(0.5,exp);   // Largest power of two <= chord_tol
+  }
+  else chord_tol = 0.0;
+
+  Cont_Polyline *pl = polylines, *finer = NULL;
+  int cnt = 0;
+
+  for (;pl;pl=pl->next,++cnt) {
+    if (pl->chord_tol == chord_tol) return *pl;
+
+    if (pl->chord_tol < chord_tol &&
+                        (!finer || pl->chord_tol > finer->chord_tol)) {
+      finer = pl;
+    }
+  }
+
+  if (finer && cnt >= Cont_Polyline_Max_Cached) return *finer;
+
+  pl = new Cont_Polyline(chord_tol);
+  pl->build(el_list);
+
+  pl->next = polylines;
+  polylines = pl;
+
+  return *pl;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Frees the cached polylines, references to them dangle -------- */
+/* ---------------------------------------------------------------------- */
+
+void Contour::Drop_Polylines() const
+{
+  while (polylines) {
+    Cont_Polyline *nxt = polylines->next;
+    delete polylines;
+    polylines = nxt;
+  }
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -2772,6 +2890,19 @@ bool Contour::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
 
   if (!el_rect_list->Project_Pnt_XY(p,elc,pp,parm,dist_xy)) return false;
 
+  project_finish(p,elc,parm,pp,cntp,dist_xy);
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Point on contour and signed distance of a projected point ---- */
+/* ---------------------------------------------------------------------- */
+
+void Contour::project_finish(const Vec2& p, const Elem_C_Cursor& elc,
+                             double parm, const Vec3& pp,
+                             Cont_Pnt& cntp, double& dist_xy) const
+{
   Cont_Pnt cp(*this,elc,parm - elc->El().Begin_Par(),pp);
   cp.calc_point_attr();
 
@@ -2783,7 +2914,7 @@ bool Contour::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
 
   if (dist_xy <= 10.0 * NumAccuracy * pp.len2()) {
     dist_xy = 0.0;
-    return true;
+    return;
   }
 
   if (cp.tg_bef_xy.oppositeTo2(cp.tg_aft_xy)) {
@@ -2812,8 +2943,6 @@ bool Contour::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
       else dist_xy = -dist_xy;
     }
   }
-
-  return true;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -4216,66 +4345,302 @@ bool Contour::Min_Right_Rad(double& min_rad) const
 //---------------------------------------------------------------------------
 // Contour Persistence Section
 
-static const char fldElemLst[] = "elemLst";
+// Up to version 0 every element was written as a separate object in
+// elemLst. Since version 1 the elements are written as a packed record:
+// one kind, id and color per element and all begin parameters and
+// coordinates in a single double array. Both layouts are read.
+
+static const PersistentField fldElemLst("elemLst");
+static const PersistentField fldPackVer("elPackVer");
+static const PersistentField fldElKinds("elKinds");
+static const PersistentField fldElIds("elIds");
+static const PersistentField fldElColors("elColors");
+static const PersistentField fldElCoords("elCoords");
+
+//---------------------------------------------------------------------------
+
+Cont_Persist_Pack::~Cont_Persist_Pack()
+{
+  if (kinds)  delete[] kinds;
+  if (ids)    delete[] ids;
+  if (colors) delete[] colors;
+  if (coords) delete[] coords;
+}
+
+//---------------------------------------------------------------------------
+// Number of doubles an element has in the coordinate array, or -1 if the
+// kind is not valid
+
+int Cont_Persist_Pack::Coord_Cnt(int kind)
+{
+  int cnt = 0;
+
+  switch (kind & Kind_Mask) {
+    case Line:    cnt = kind & Joined ? 4 : 7; break; // bpar, p1 xyz, p2 xyz
+    case Arc_Cw:
+    case Arc_Ccw: cnt = kind & Joined ? 5 : 7; break; // bpar, p1, p2, c xy
+    case Cir_Cw:
+    case Cir_Ccw: if (kind & Joined) return -1;
+                  cnt = 5; break;                   // bpar, p1 xy, c xy
+    default:      return -1;
+  }
+
+  if (kind & Chained) --cnt;
+
+  return cnt;
+}
 
 //---------------------------------------------------------------------------
 
 void Contour::definePersistentFields(PersistentWriter& po) const
 {
-  po.addObjectArrayField(fldElemLst,(Elem **)NULL);
+  po.addField(fldPackVer,typeid(int));
+  po.addArrayField(fldElKinds,(char *)NULL);
+  po.addArrayField(fldElIds,(int *)NULL);
+  po.addArrayField(fldElColors,(int *)NULL);
+  po.addArrayField(fldElCoords,(double *)NULL);
 }
 
 //---------------------------------------------------------------------------
 
 Contour::Contour(PersistentReader& pi)
 : Rect_Ax(), len_xy(0.0), len(0.0),
-  el_list(), el_rect_list(NULL),
+  el_list(), el_rect_list(NULL), slabs(NULL), inside_cnt(0),
+  polylines(NULL),
   intersecting_valid(false), intersecting(false),
   is_closed(false), mark(false), inert(), parent(NULL),
   persistLstLen(pi.readArraySize(fldElemLst,0)),
-  persistLst((Elem **)pi.readObjArray(fldElemLst,NULL))
+  persistLst((Elem **)pi.readObjArray(fldElemLst,NULL)),
+  persistPack(NULL)
 {
+  long ver = pi.readInt(fldPackVer,0);
+
+  if (ver > Cont_Persist_Pack::Version) Cont_Panic(Cont_Bad_Persist_Pack);
+
+  if (ver > 0) {
+    persistPack = new Cont_Persist_Pack;
+
+    persistLstLen = pi.readArraySize(fldElKinds,0);
+    if (pi.readArraySize(fldElIds,0) != persistLstLen ||
+        pi.readArraySize(fldElColors,0) != persistLstLen)
+                                          Cont_Panic(Cont_Bad_Persist_Pack);
+
+    persistPack->coord_sz = pi.readArraySize(fldElCoords,0);
+
+    persistPack->kinds  = (char *)pi.readValArray(fldElKinds,NULL);
+    persistPack->ids    = (int *)pi.readValArray(fldElIds,NULL);
+    persistPack->colors = (int *)pi.readValArray(fldElColors,NULL);
+    persistPack->coords = (double *)pi.readValArray(fldElCoords,NULL);
+  }
+
   pi.callPostProcess();
 }
 
 //---------------------------------------------------------------------------
 
-
 void Contour::writePersistentObject(PersistentWriter& po) const
 {
-  persistLstLen = el_list.Length();
-  persistLst = new Elem*[persistLstLen];
+  int len = el_list.Length();
 
-  Elem_Cursor elc(el_list);
-  int idx = 0;
+  persistPack = new Cont_Persist_Pack;
+  persistPack->kinds  = new char[len];
+  persistPack->ids    = new int[len];
+  persistPack->colors = new int[len];
 
-  while (elc) {
-    persistLst[idx++] = &elc->El();
-    ++elc;
+  // First pass: the kinds and the size of the coordinate array
+
+  Elem_C_Cursor elc(el_list);
+  const Elem *prev = NULL;
+  int idx = 0, coord_sz = 0;
+
+  for (; elc; ++elc) {
+    const Elem& el = elc->El();
+
+    int kind = Cont_Persist_Pack::Line;
+
+    if (el.Type() == Elem_Type_Arc) {
+      kind = ((const Elem_Arc &)el).Ccw() ? Cont_Persist_Pack::Arc_Ccw
+                                          : Cont_Persist_Pack::Arc_Cw;
+    }
+    else if (el.Type() == Elem_Type_Circle) {
+      kind = ((const Elem_Circle &)el).Ccw() ? Cont_Persist_Pack::Cir_Ccw
+                                             : Cont_Persist_Pack::Cir_Cw;
+    }
+
+    if (prev) {
+      const Vec3& p1 = el.P1();
+      const Vec3& pp2 = prev->P2();
+
+      if (el.Type() != Elem_Type_Circle &&
+          p1.x == pp2.x && p1.y == pp2.y && p1.z == pp2.z)
+                                          kind |= Cont_Persist_Pack::Joined;
+
+      if (el.Begin_Par() == prev->End_Par())
+                                         kind |= Cont_Persist_Pack::Chained;
+    }
+
+    persistPack->kinds[idx]  = (char)kind;
+    persistPack->ids[idx]    = el.Id();
+    persistPack->colors[idx] = (int)el.getColor();
+    coord_sz += Cont_Persist_Pack::Coord_Cnt(kind);
+
+    prev = &el;
+    ++idx;
+  }
+
+  // Second pass: the coordinates
+
+  double *crd = persistPack->coords = new double[coord_sz];
+  persistPack->coord_sz = coord_sz;
+
+  for (elc.To_Begin(), idx=0; elc; ++elc, ++idx) {
+    const Elem& el = elc->El();
+    int kind = persistPack->kinds[idx];
+
+    if (!(kind & Cont_Persist_Pack::Chained)) *crd++ = el.Begin_Par();
+
+    if (!(kind & Cont_Persist_Pack::Joined)) {
+      *crd++ = el.P1().x;
+      *crd++ = el.P1().y;
+
+      if ((kind & Cont_Persist_Pack::Kind_Mask) == Cont_Persist_Pack::Line)
+                                                         *crd++ = el.P1().z;
+    }
+
+    switch (kind & Cont_Persist_Pack::Kind_Mask) {
+      case Cont_Persist_Pack::Line:
+        *crd++ = el.P2().x;
+        *crd++ = el.P2().y;
+        *crd++ = el.P2().z;
+        break;
+
+      case Cont_Persist_Pack::Arc_Cw:
+      case Cont_Persist_Pack::Arc_Ccw: {
+        const Elem_Arc& arc = (const Elem_Arc &)el;
+
+        *crd++ = arc.P2().x;
+        *crd++ = arc.P2().y;
+        *crd++ = arc.C().x;
+        *crd++ = arc.C().y;
+        break;
+      }
+
+      default: {
+        const Elem_Circle& cir = (const Elem_Circle &)el;
+
+        *crd++ = cir.C().x;
+        *crd++ = cir.C().y;
+        break;
+      }
+    }
   }
 
-  po.writeArray(fldElemLst,persistLst,persistLstLen);
+  po.writeInt(fldPackVer,Cont_Persist_Pack::Version);
+  po.writeArray(fldElKinds,persistPack->kinds,len);
+  po.writeArray(fldElIds,persistPack->ids,len);
+  po.writeArray(fldElColors,persistPack->colors,len);
+  po.writeArray(fldElCoords,persistPack->coords,coord_sz);
 
   po.callPostProcess();
 }
 
 //---------------------------------------------------------------------------
+// Rebuilds the element list from the packed record
 
-void Contour::postProcess(PersistentReader& /*pi*/)
+void Contour::unpack_persist()
 {
-  if (!persistLst) return;
+  const char *kinds  = persistPack->kinds;
+  const double *crd  = persistPack->coords;
+  const double *last = crd + persistPack->coord_sz;
+
+  if (persistLstLen > 0 && (!kinds || !persistPack->ids ||
+                            !persistPack->colors || !crd))
+                                          Cont_Panic(Cont_Bad_Persist_Pack);
 
-  el_list.Delete();
   Elem_Cursor elc(el_list);
+  const Elem *prev = NULL;
 
   for (int i=0; i<persistLstLen; ++i) {
+    int kind = kinds[i];
+    int cnt = Cont_Persist_Pack::Coord_Cnt(kind);
+
+    if (cnt < 0 || last-crd < cnt) Cont_Panic(Cont_Bad_Persist_Pack);
+    if (!prev && kind & (Cont_Persist_Pack::Joined|Cont_Persist_Pack::Chained))
+                                          Cont_Panic(Cont_Bad_Persist_Pack);
+
+    double bpar = kind & Cont_Persist_Pack::Chained ? prev->End_Par()
+                                                    : *crd++;
+    Vec3 p1;
+
+    if (kind & Cont_Persist_Pack::Joined) p1 = prev->P2();
+    else {
+      p1.x = *crd++;
+      p1.y = *crd++;
+
+      if ((kind & Cont_Persist_Pack::Kind_Mask) == Cont_Persist_Pack::Line)
+                                                               p1.z = *crd++;
+    }
+
+    Elem *el = NULL;
+
+    switch (kind & Cont_Persist_Pack::Kind_Mask) {
+      case Cont_Persist_Pack::Line:
+        el = new Elem_Line(p1,Vec3(crd[0],crd[1],crd[2]));
+        crd += 3;
+        break;
+
+      case Cont_Persist_Pack::Arc_Cw:
+      case Cont_Persist_Pack::Arc_Ccw:
+        el = new Elem_Arc(p1,Vec3(crd[0],crd[1],0.0),Vec2(crd[2],crd[3]),
+                 (kind & Cont_Persist_Pack::Kind_Mask) ==
+                                                 Cont_Persist_Pack::Arc_Ccw);
+        crd += 4;
+        break;
+
+      default:
+        el = new Elem_Circle(p1,0.0,Vec2(crd[0],crd[1]),
+                 (kind & Cont_Persist_Pack::Kind_Mask) ==
+                                                 Cont_Persist_Pack::Cir_Ccw);
+        crd += 2;
+        break;
+    }
+
+    el->Begin_Par(bpar);
+    el->Id(persistPack->ids[i]);
+    el->setColor(persistPack->colors[i]);
+
     elc.To_End();
     elc.Insert(Elem_Ref());
-    elc->setElem(persistLst[i]);
+    elc->setElem(el);
+
+    prev = el;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void Contour::postProcess(PersistentReader& /*pi*/)
+{
+  if (!persistLst && !persistPack) return;
+
+  el_list.Delete();
+
+  if (persistPack) unpack_persist();
+  else {
+    Elem_Cursor elc(el_list);
+
+    for (int i=0; i<persistLstLen; ++i) {
+      elc.To_End();
+      elc.Insert(Elem_Ref());
+      elc->setElem(persistLst[i]);
+    }
   }
 
   if (persistLst) delete[] persistLst;
-  persistLst = NULL;
+  if (persistPack) delete persistPack;
+
+  persistLst    = NULL;
+  persistPack   = NULL;
   persistLstLen = 0;
 
   calc_invar();
@@ -4286,8 +4651,10 @@ void Contour::postProcess(PersistentReader& /*pi*/)
 void Contour::postProcess(PersistentWriter& /*po*/) const
 {
   if (persistLst) delete[] persistLst;
+  if (persistPack) delete persistPack;
 
   persistLst    = NULL;
+  persistPack   = NULL;
   persistLstLen = 0;
 }
 
@@ -4709,6 +5076,8 @@ void Cont_Clsd::Merge_Elems(bool limit_arcs)
 
 void Cont_List::calc_invar()
 {
+  drop_index();
+
   Cont_Cursor cc(contlst);
 
   Rect_Ax::operator=(Rect_Ax());
@@ -4731,8 +5100,23 @@ void Cont_List::calc_invar()
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+void Cont_List::drop_index() const
+{
+  if (rtree) delete rtree;
+  rtree = NULL;
+
+  if (rtree_cnts) delete[] rtree_cnts;
+  rtree_cnts = NULL;
+
+  proj_cnt = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 Cont_List::Cont_List()
- : Rect_Ax(), contlst()
+ : Rect_Ax(), contlst(), rtree(NULL), rtree_cnts(NULL), proj_cnt(0)
 {
 }
 
@@ -4741,7 +5125,8 @@ Cont_List::Cont_List()
 /* ---------------------------------------------------------------------- */
 
 Cont_List::Cont_List(const Cont_List& cp)
- : Rect_Ax(cp), contlst(cp.contlst)
+ : Rect_Ax(cp), contlst(cp.contlst), rtree(NULL), rtree_cnts(NULL),
+   proj_cnt(0)
 {
 }
 
@@ -4749,8 +5134,19 @@ Cont_List::Cont_List(const Cont_List& cp)
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+Cont_List::~Cont_List()
+{
+  drop_index();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 Cont_List& Cont_List::operator=(const Cont_List& src)
 {
+  drop_index();
+
   Rect_Ax::operator=(src);
 
   contlst = src.contlst;
@@ -4802,6 +5198,7 @@ Cont_List& Cont_List::operator=(const Cont_Area& src)
 
 void Cont_List::Move_To(Cont_List& dst)
 {
+  dst.drop_index();
   dst.Rect_Ax::operator=(*this);
 
   contlst.Move_To(dst.contlst);
@@ -4826,6 +5223,8 @@ void Cont_List::Delete()
 
 void Cont_List::Begin_Par(double par)
 {
+  drop_index();
+
   Cont_Cursor cc(contlst);
 
   for (;cc;++cc) {
@@ -4931,6 +5330,56 @@ bool Cont_List::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
 {
   cntp = Cont_Pnt();
 
+  int len = contlst.Length();
+
+  if (!rtree && len >= Cont_List_Index_Min && ++proj_cnt > 1) {
+    // Not worth it for a single projection
+    rtree = new Cont_Rtree;
+    rtree->Build(*this);
+
+    rtree_cnts = new const Contour*[len];
+
+    Cont_C_Cursor cc(contlst);
+    for (int i=0; cc; ++cc,++i) rtree_cnts[i] = &*cc;
+  }
+
+  if (rtree) {
+    // Contours by ascending rectangle distance, same result as below
+
+    Cont_Rtree::Near near(*rtree,p);
+
+    int best, id;
+    double rdist;
+
+    if (near.Next(best,rdist)) {
+      int first = best;
+
+      if (!rtree_cnts[best]->Project_Pnt_XY(p,cntp,dist_xy))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+      while (near.Next(id,rdist) && rdist < fabs(dist_xy) + Vec2::IdentDist) {
+        Cont_Pnt curpnt;
+        double curdist;
+
+        if (!rtree_cnts[id]->Project_Pnt_XY(p,curpnt,curdist))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+        // Equal distances: the first in list order after the nearest
+        // rectangle wins, as in the loop below
+
+        if (fabs(curdist) < fabs(dist_xy) ||
+            (fabs(curdist) == fabs(dist_xy) &&
+             (id - first + len) % len < (best - first + len) % len)) {
+          best    = id;
+          dist_xy = curdist;
+          cntp    = curpnt;
+        }
+      }
+
+      return true;
+    }
+  }
+
   Cont_C_Cursor cc(contlst);
 
   if (!cc) return false;
@@ -4980,6 +5429,8 @@ bool Cont_List::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
 
 void Cont_List::Reverse()
 {
+  drop_index();
+
   Cont_Cursor cc(contlst);
 
   if (!cc) return;
@@ -5023,6 +5474,8 @@ void Cont_List::Del_Info()
 
 void Cont_List::Merge_Elems(bool limit_arcs)
 {
+  drop_index();
+
   Cont_Cursor cc(contlst);
 
   for (;cc;++cc) cc->Merge_Elems(limit_arcs);
@@ -5497,14 +5950,26 @@ bool Cont_Nest::Offset_Into(double offdist, Cont_Area& ar_list) const
 
   if ((offdist > 0.0) == lccw) {   // Outer offset inward
 
-    if (!ar_list.Empty()) {
-      while (++cc) {
-        Cont_Area ar2;
+    if (!ar_list.Empty() && ++cc) {
+
+      // Unite the grown holes first, then take them out of the outer
+
+      Cont_Area_List offlst;
+      Cont_Area_Cursor offc(offlst);
+
+      for (;cc;++cc) {
+        offc.To_End(); offc.Insert(Cont_Area());
+
+        if (!cc->Offset_Into(offdist,*offc))
+                                      Cont_Panic(Cont_Nest_Cant_Offset);
+      }
 
-        if (!cc->Offset_Into(offdist,ar2)) Cont_Panic(Cont_Nest_Cant_Offset);
+      Cont_Area holes;
+      Cont_Area::Combine_All(offlst,offdist > 0.0,holes);
 
+      if (!holes.Empty()) {
         Cont_Area arhlp;
-        ar_list.Combine_With(false,ar2,false,offdist > 0.0,arhlp);
+        ar_list.Combine_With(false,holes,false,offdist > 0.0,arhlp);
 
         arhlp.Move_To(ar_list);
       }
@@ -5561,6 +6026,21 @@ void Cont_Nest::Reverse()
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+void Cont_Nest::Transform(const Trf2& trf)
+{
+  Cont_Clsd_Cursor cc(contlst);
+
+  for (;cc;++cc) cc->Transform(trf);
+
+  calc_invar();
+
+  inert.invalidate();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 void Cont_Nest::Del_Info()
 {
   Cont_Clsd_Cursor cc(contlst);
@@ -5699,32 +6179,396 @@ Cont_Area::Cont_Area(const Cont_Area& cp)
 }
 
 /* ---------------------------------------------------------------------- */
-/* ------- Load up elements and sort them ------------------------------- */
+/* ------- Self intersection test of many contours ---------------------- */
+/* ------- Runs on worker threads, the results are cached in the -------- */
+/* ------- contours themselves ------------------------------------------ */
 /* ---------------------------------------------------------------------- */
 
-Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
-                                          Cont_PPair_List& intersections)
- : Rect_Ax(), nestlst(), lccw(true), z(0.0), inert()
+class Cont_Self_Isect_Task : public Cont_Task
 {
-  nestlst.Delete(); calc_invar();
-  lst.contlst.Delete(); lst.calc_invar();
-  intersections.Delete();
+   Cont_Self_Isect_Task(const Cont_Self_Isect_Task& cp);
+   Cont_Self_Isect_Task& operator=(const Cont_Self_Isect_Task& src);
 
-  Cont_Cursor cc(lst.contlst);
-  
-  Elem_Sort elsrt(src, 0.001);
+  public:
+   const Contour **conts;
+   int cnt;
 
-  for (;;) {
-    cc.To_End(); cc.Insert(Contour());
-    
-    if (elsrt.Chain(cc->el_list))
-       cc->calc_invar();
-    else {
-       cc.Delete();
-       break;
-    }
+   Cont_Self_Isect_Task() : conts(NULL), cnt(0) {}
+
+   virtual void work();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Self_Isect_Task::work()
+{
+  for (int i=0; i<cnt; ++i) conts[i]->Self_Intersecting();
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void test_self_isect(const Cont_D_List& contlst, Cont_Par_Pool& pool)
+{
+  int cont_cnt = 0, el_cnt = 0;
+
+  Cont_C_Cursor cc(contlst);
+
+  for (;cc;++cc) {
+    if (cc->Closed()) {
+      cont_cnt++; el_cnt += cc->Elem_Count();
+    }
+  }
+
+  int thr_cnt = Cont_Par_Pool::Thread_Count(el_cnt);
+  if (thr_cnt < 2 || cont_cnt < 2) return;
+
+  const Contour **conts = new const Contour*[cont_cnt];
+
+  cont_cnt = 0;
+  for (cc.To_Begin();cc;++cc) {
+    if (cc->Closed()) conts[cont_cnt++] = &*cc;
+  }
+
+  // Consecutive contours, about the same number of elements per task
+
+  int task_cnt = 4*thr_cnt;
+  if (task_cnt > cont_cnt) task_cnt = cont_cnt;
+
+  Cont_Self_Isect_Task *tasks = new Cont_Self_Isect_Task[task_cnt];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[task_cnt];
+
+  int per_task = (el_cnt + task_cnt - 1)/task_cnt, t = 0, done = 0;
+
+  tasks[0].conts = conts;
+
+  for (int i=0; i<cont_cnt; ++i) {
+    if (done >= (t+1)*per_task && t < task_cnt-1) {
+      tasks[++t].conts = conts + i;
+    }
+
+    tasks[t].cnt++;
+    done += conts[i]->Elem_Count();
+  }
+
+  task_cnt = t+1;
+  for (t=0; t<task_cnt; ++t) task_lst[t] = &tasks[t];
+
+  pool.Run_All(task_lst,task_cnt);
+
+  delete[] task_lst;
+  delete[] tasks;
+  delete[] conts;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Closed contours that may touch one of the others ------------- */
+/* ------- Only element rectangles are compared, with twice the margin -- */
+/* ------- of the rectangle test in Elem::Intersect_XY(). A contour ----- */
+/* ------- that is not found cannot intersect any of the others, so ----- */
+/* ------- nest assembly skips its intersection test with the area ------ */
+/* ---------------------------------------------------------------------- */
+
+const int Cont_Touch_Chunk = 32; // Elements per chunk rectangle
+
+class Cont_Touch_Set
+{
+   const Cont_Clsd **conts;    // Sorted by the lower x of their rectangle
+   int cont_cnt;
+
+   int *chunk_first;           // Per contour its first chunk
+   Rect_Ax *chunk_rects;
+   int *el_first;              // Per chunk its first element
+   Rect_Ax *el_rects;
+
+   bool known;                 // False: all contours may touch
+   const Cont_Clsd **touching; // Sorted by address
+   int touch_cnt;
+
+   bool touch(int c1, int c2) const;
+
+   Cont_Touch_Set(const Cont_Touch_Set& cp);             // No copying
+   Cont_Touch_Set& operator=(const Cont_Touch_Set& src); // No assignment
+
+  public:
+   Cont_Touch_Set(const Cont_Clsd_D_List& clist, Cont_Par_Pool& pool);
+   ~Cont_Touch_Set();
+
+   bool May_Touch(const Cont_Clsd& cnt) const;
+
+   friend class Cont_Touch_Task;
+};
+
+/* ---------------------------------------------------------------------- */
+
+class Cont_Touch_Task : public Cont_Task
+{
+   Cont_Touch_Task(const Cont_Touch_Task& cp);
+   Cont_Touch_Task& operator=(const Cont_Touch_Task& src);
+
+  public:
+   const Cont_Touch_Set *set;
+   int first, step;  // Contours first, first+step, ...
+   bool *touch;      // Per contour, set by this task only
+
+   Cont_Touch_Task() : set(NULL), first(0), step(1), touch(NULL) {}
+
+   virtual void work();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Touch_Task::work()
+{
+  double margin = 2*Vec2::IdentDist;
+
+  for (int c1=first; c1<set->cont_cnt; c1+=step) {
+    const Rect_Ax& r1 = set->conts[c1]->Rect();
+
+    for (int c2=c1+1; c2<set->cont_cnt; ++c2) {
+      const Rect_Ax& r2 = set->conts[c2]->Rect();
+
+      if (r2.Ll().x > r1.Ur().x + 2*margin) break; // And all that follow
+
+      if ((touch[c1] && touch[c2]) || !r1.Intersects_XY(r2,margin)) continue;
+
+      if (set->touch(c1,c2)) touch[c1] = touch[c2] = true;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Touch_Set::touch(int c1, int c2) const
+{
+  double margin = 2*Vec2::IdentDist;
+
+  const Rect_Ax& cr2 = conts[c2]->Rect();
+
+  for (int k1=chunk_first[c1]; k1<chunk_first[c1+1]; ++k1) {
+    const Rect_Ax& kr1 = chunk_rects[k1];
+    if (!kr1.Intersects_XY(cr2,margin)) continue;
+
+    for (int k2=chunk_first[c2]; k2<chunk_first[c2+1]; ++k2) {
+      const Rect_Ax& kr2 = chunk_rects[k2];
+      if (!kr1.Intersects_XY(kr2,margin)) continue;
+
+      for (int e1=el_first[k1]; e1<el_first[k1+1]; ++e1) {
+        const Rect_Ax& er1 = el_rects[e1];
+        if (!er1.Intersects_XY(kr2,margin)) continue;
+
+        for (int e2=el_first[k2]; e2<el_first[k2+1]; ++e2) {
+          if (er1.Intersects_XY(el_rects[e2],margin)) return true;
+        }
+      }
+    }
+  }
+
+  return false;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int cont_lo_x_cmp(const void *c1, const void *c2)
+{
+  double x1 = (*(const Cont_Clsd **)c1)->Rect().Ll().x;
+  double x2 = (*(const Cont_Clsd **)c2)->Rect().Ll().x;
+
+  return x1 < x2 ? -1 : x1 > x2 ? 1 : 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int cont_addr_cmp(const void *c1, const void *c2)
+{
+  size_t a1 = (size_t)*(const Cont_Clsd **)c1;
+  size_t a2 = (size_t)*(const Cont_Clsd **)c2;
+
+  return a1 < a2 ? -1 : a1 > a2 ? 1 : 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Touch_Set::Cont_Touch_Set(const Cont_Clsd_D_List& clist,
+                                                  Cont_Par_Pool& pool)
+ : conts(NULL), cont_cnt(0), chunk_first(NULL), chunk_rects(NULL),
+   el_first(NULL), el_rects(NULL), known(false), touching(NULL),
+   touch_cnt(0)
+{
+  int el_cnt = 0, chunk_cnt = 0;
+
+  Cont_Clsd_C_Cursor clc(clist);
+
+  for (;clc;++clc) {
+    cont_cnt++; el_cnt += clc->Elem_Count();
+    chunk_cnt += (clc->Elem_Count() + Cont_Touch_Chunk - 1)/Cont_Touch_Chunk;
+  }
+
+  if (cont_cnt < 2 || el_cnt < Cont_Par_Min_Elems) return;
+
+  conts = new const Cont_Clsd*[cont_cnt];
+
+  int c = 0;
+  for (clc.To_Begin();clc;++clc) conts[c++] = &*clc;
+
+  qsort(conts,cont_cnt,sizeof(const Cont_Clsd *),cont_lo_x_cmp);
+
+  // The element rectangles per chunk of consecutive elements
+
+  chunk_first = new int[cont_cnt+1];
+  chunk_rects = new Rect_Ax[chunk_cnt > 0 ? chunk_cnt : 1];
+  el_first    = new int[chunk_cnt+1];
+  el_rects    = new Rect_Ax[el_cnt > 0 ? el_cnt : 1];
+
+  int k = 0, e = 0;
+
+  for (c=0; c<cont_cnt; ++c) {
+    chunk_first[c] = k;
+
+    Elem_C_Cursor elc(conts[c]->List());
+
+    for (int n=0; elc; ++elc,++n) {
+      el_rects[e] = elc->El().Rect();
+
+      if (n % Cont_Touch_Chunk == 0) {
+        el_first[k] = e;
+        chunk_rects[k++] = el_rects[e];
+      }
+      else chunk_rects[k-1] += el_rects[e];
+
+      e++;
+    }
+  }
+
+  chunk_first[cont_cnt] = k;
+  el_first[k] = e;
+
+  // Each task takes every task_cnt-th contour, as those with a low x
+  // tend to have the most candidates. Serially this still beats testing
+  // each contour against the whole area.
+
+  int thr_cnt = Cont_Par_Pool::Thread_Count(el_cnt);
+
+  int task_cnt = thr_cnt > 1 ? 4*thr_cnt : 1;
+  if (task_cnt > cont_cnt) task_cnt = cont_cnt;
+
+  Cont_Touch_Task *tasks = new Cont_Touch_Task[task_cnt];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[task_cnt];
+  bool *touch = new bool[task_cnt*cont_cnt];
+
+  for (int i=0; i<task_cnt*cont_cnt; ++i) touch[i] = false;
+
+  for (int t=0; t<task_cnt; ++t) {
+    tasks[t].set   = this;
+    tasks[t].first = t;
+    tasks[t].step  = task_cnt;
+    tasks[t].touch = touch + t*cont_cnt;
+
+    task_lst[t] = &tasks[t];
+  }
+
+  bool ok = true;
+
+  if (task_cnt > 1) ok = pool.Run_All(task_lst,task_cnt);
+  else tasks[0].run();
+
+  if (ok) {
+    touching = new const Cont_Clsd*[cont_cnt];
+
+    for (c=0; c<cont_cnt; ++c) {
+      for (int t=0; t<task_cnt; ++t) {
+        if (touch[t*cont_cnt + c]) {
+          touching[touch_cnt++] = conts[c];
+          break;
+        }
+      }
+    }
+
+    qsort(touching,touch_cnt,sizeof(const Cont_Clsd *),cont_addr_cmp);
+
+    known = true;
+  }
+
+  delete[] touch;
+  delete[] task_lst;
+  delete[] tasks;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Touch_Set::~Cont_Touch_Set()
+{
+  delete[] touching;
+  delete[] el_rects;
+  delete[] el_first;
+  delete[] chunk_rects;
+  delete[] chunk_first;
+  delete[] conts;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Touch_Set::May_Touch(const Cont_Clsd& cnt) const
+{
+  if (!known) return true;
+
+  const Cont_Clsd *key = &cnt;
+
+  return bsearch(&key,touching,touch_cnt,sizeof(const Cont_Clsd *),
+                                                   cont_addr_cmp) != NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Appends the intersections of cnt with the area, returns ------ */
+/* ------- false if there are none -------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+static bool area_isects(const Cont_Area& ar, const Cont_Clsd& cnt,
+                                          Cont_PPair_List& intersections)
+{
+  Cont_Ref_List arref(ar); Cont_Ref_List cntref(cnt);
+
+  Cont2_Isect_List isctlst(arref,false,cntref,false,true);
+
+  if (isctlst.Empty()) return false;
+
+  Cont_PPair_List pplst;
+  isctlst.Intersections_Into(pplst); pplst.Append_To(intersections);
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Load up elements and sort them ------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
+                                          Cont_PPair_List& intersections)
+ : Rect_Ax(), nestlst(), lccw(true), z(0.0), inert()
+{
+  nestlst.Delete(); calc_invar();
+  lst.contlst.Delete(); lst.calc_invar();
+  intersections.Delete();
+
+  Cont_Cursor cc(lst.contlst);
+  
+  Elem_Sort elsrt(src, 0.001);
+  elsrt.Chain_All();
+
+  for (;;) {
+    cc.To_End(); cc.Insert(Contour());
+    
+    if (elsrt.Chain(cc->el_list))
+       cc->calc_invar();
+    else {
+       cc.Delete();
+       break;
+    }
   }
 
+  Cont_Par_Pool pool;
+
+  test_self_isect(lst.contlst,pool);
+
   Cont_Clsd_D_List clist;
   Cont_Clsd_Cursor clc(clist);
 
@@ -5741,6 +6585,8 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
   }
 
   if (clc) {
+    Cont_Touch_Set touching(clist,pool);
+
     clc.To_Begin(); 
     Cont_Clsd_Cursor clcend(clist); clcend.To_End();
 
@@ -5756,15 +6602,8 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
     calc_invar();
 
     while (clc) {
-      Cont_Ref_List arref(*this); Cont_Ref_List cntref(*clc);
-  
-      Cont2_Isect_List isctlst(arref,false,cntref,false,true);
-  
-      if (!isctlst.Empty()) {
-        Cont_PPair_List pplst;
-        isctlst.Intersections_Into(pplst); pplst.Append_To(intersections);
+      if (touching.May_Touch(*clc) && area_isects(*this,*clc,intersections))
         ++clc;
-      }
       else {
         nsc.To_Begin();
         for (;nsc;++nsc) {
@@ -5840,6 +6679,7 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
   Cont_Cursor cc(lst.contlst);
   
   Elem_Sort elsrt(src, tol);
+  elsrt.Chain_All();
 
   for (;;) {
     cc.To_End(); cc.Insert(Contour());
@@ -5852,6 +6692,10 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
     }
   }
 
+  Cont_Par_Pool pool;
+
+  test_self_isect(lst.contlst,pool);
+
   Cont_Clsd_D_List clist;
   Cont_Clsd_Cursor clc(clist);
 
@@ -5868,6 +6712,8 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
   }
 
   if (clc) {
+    Cont_Touch_Set touching(clist,pool);
+
     clc.To_Begin(); 
     Cont_Clsd_Cursor clcend(clist); clcend.To_End();
 
@@ -5883,15 +6729,8 @@ Cont_Area::Cont_Area(Elem_List& src, Cont_List& lst,
     calc_invar();
 
     while (clc) {
-      Cont_Ref_List arref(*this); Cont_Ref_List cntref(*clc);
-  
-      Cont2_Isect_List isctlst(arref,false,cntref,false,true);
-  
-      if (!isctlst.Empty()) {
-        Cont_PPair_List pplst;
-        isctlst.Intersections_Into(pplst); pplst.Append_To(intersections);
+      if (touching.May_Touch(*clc) && area_isects(*this,*clc,intersections))
         ++clc;
-      }
       else {
         nsc.To_Begin();
         for (;nsc;++nsc) {
@@ -6502,8 +7341,6 @@ bool Cont_Area::Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
       mindist = curdist;
       minsc   = nsc;
     }
-    
-    ++nsc;
   }
 
   nsc = minsc;
@@ -6604,17 +7441,19 @@ bool Cont_Area::Offset_Into(double offdist, Cont_Area& ar_list) const
   else {                          // Offset outward
     if (ar_list.Empty()) Cont_Panic(Cont_Area_Cant_Offset);
 
-    while (++srcc) {
-      Cont_Area ar2;
+    Cont_Area_List offlst;
+    Cont_Area_Cursor offc(offlst);
 
-      if (!srcc->Offset_Into(offdist,ar2) || ar2.Empty())
-                                       Cont_Panic(Cont_Area_Cant_Offset);
+    offc.Insert(Cont_Area()); ar_list.Move_To(*offc);
 
-      Cont_Area arhlp;
-      ar_list.Combine_With(false,ar2,false,offdist > 0.0,arhlp);
+    while (++srcc) {
+      offc.To_End(); offc.Insert(Cont_Area());
 
-      arhlp.Move_To(ar_list);
+      if (!srcc->Offset_Into(offdist,*offc) || offc->Empty())
+                                       Cont_Panic(Cont_Area_Cant_Offset);
     }
+
+    Combine_All(offlst,offdist > 0.0,ar_list);
   }
 
   ar_list.calc_invar();
@@ -6633,6 +7472,88 @@ bool Cont_Area::Offset_Into(double offdist, Cont_Area& ar_list) const
   return true;
 }
 
+/* ---------------------------------------------------------------------- */
+/** Offsets the area over a number of distances in one call.
+  \param offdists The offset distances, in any order.
+  \param cnt The number of distances.
+  \param rings Receives one area per distance, in the order of
+  \c offdists, as Offset_Into() would have produced it.
+  \return \c false if this area is empty.
+
+  Offsetting over d1 and then over d2-d1 (d1 and d2 of equal sign,
+  |d1| < |d2|) gives the same area as offsetting over d2 at once.
+  So the distances at either side are handled from small to large, each
+  ring offset from the previous one over the difference. Every step then
+  only works on what is left of the area after the previous step, and
+  once an inward offset is empty the larger ones are not computed at all.
+*/
+
+bool Cont_Area::Offset_Ladder(const double *offdists, int cnt,
+                                            Cont_Area_List& rings) const
+{
+  rings.Delete();
+
+  if (cnt < 1) return false;
+
+  Cont_Area **ars = new Cont_Area*[cnt];
+  IB_Int_Arr order(cnt);
+
+  Cont_Area_Cursor arc(rings);
+
+  for (int i=0; i<cnt; ++i) {
+    arc.To_End(); arc.Insert(Cont_Area());
+
+    ars[i] = &*arc;
+    order[i] = i;
+  }
+
+  if (Empty()) {
+    delete[] ars;
+    return false;
+  }
+
+  // Sort on absolute distance, equal distances keep their order
+
+  for (int i=1; i<cnt; ++i) {
+    int idx = order[i];
+    double dist = fabs(offdists[idx]);
+
+    int j = i;
+    for (; j > 0 && fabs(offdists[order[j-1]]) > dist; --j)
+                                                     order[j] = order[j-1];
+    order[j] = idx;
+  }
+
+  for (int inward=1; inward>=0; --inward) {
+    const Cont_Area *prev = this;
+    double prevdist = 0.0;
+
+    for (int i=0; i<cnt; ++i) {
+      double offdist = offdists[order[i]];
+      Cont_Area& ring = *ars[order[i]];
+
+      if (fabs(offdist) < Vec2::IdentDist) {  // Just copy
+        if (inward) ring = *this;
+        continue;
+      }
+
+      if (((offdist > 0.0) == lccw) != (inward != 0)) continue;
+
+      if (prev->Empty()) continue;  // Nothing left to offset
+
+      if (fabs(offdist - prevdist) < Vec2::IdentDist) ring = *prev;
+      else prev->Offset_Into(offdist - prevdist,ring);
+
+      prev     = &ring;
+      prevdist = offdist;
+    }
+  }
+
+  delete[] ars;
+
+  return true;
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -6826,26 +7747,218 @@ bool Cont_Area::Combine_With(bool rev1, const Cont_Area& ar2, bool rev2,
 }
 
 /* ---------------------------------------------------------------------- */
-/* ---------------------------------------------------------------------- */
+/* ------- Combine many areas pairwise, in a balanced tree -------------- */
 /* ---------------------------------------------------------------------- */
 
-void Cont_Area::Reverse()
+// Combines ar2 into ar1 as ar1.Combine_With(false,ar2,false,to_left,...)
+// would, ar2 is emptied. If common is set the result is the common part
+// of the areas, so an empty area gives an empty result, otherwise it is
+// their union and empty areas are skipped.
+
+bool Cont_Area::combine_pair(Cont_Area& ar1, Cont_Area& ar2,
+                                              bool to_left, bool common)
 {
-  Cont_Nest_Cursor nsc(nestlst);
+  if (ar1.Empty() || ar2.Empty()) {
+    if (common) {
+      ar1.Delete(); ar2.Delete();
+    }
+    else if (ar1.Empty()) ar2.Move_To(ar1);
 
-  if (nsc) {
-    double begpar = Begin_Par();
+    return true;
+  }
 
-    for (;nsc;++nsc) nsc->Reverse();
+  double begpar = ar1.Begin_Par();
 
-    nestlst.Reverse();
+  if (!ar1.Rect_Ax::Intersects_XY(ar2,Vec2::IdentDist)) {
 
-    Begin_Par(begpar);
-  }
+    // Disjoint, no intersections: an area is kept if it lies at the
+    // to_left side of the other one, so outside a ccw area is right
 
-  lccw = !lccw;
-  
-  if (inert.area_valid) inert.area = -inert.area;
+    if (to_left == ar2.lccw) ar1.nestlst.Delete();
+    if (to_left != ar1.lccw) ar2.nestlst.Append_To(ar1.nestlst);
+
+    ar2.Delete();
+
+    ar1.calc_invar();
+    ar1.inert.invalidate();
+
+    ar1.Begin_Par(begpar);
+
+    return true;
+  }
+
+  Cont_Area arhlp;
+  bool ok = ar1.Combine_With(false,ar2,false,to_left,arhlp);
+
+  ar2.Delete();
+
+  double z = ar1.z;
+  arhlp.Move_To(ar1);
+  ar1.z = z;
+
+  return ok;
+}
+
+/* ---------------------------------------------------------------------- */
+
+class Cont_Combine_Task : public Cont_Task
+{
+   Cont_Combine_Task(const Cont_Combine_Task& cp);
+   Cont_Combine_Task& operator=(const Cont_Combine_Task& src);
+
+  public:
+   Cont_Area *ar1, *ar2;
+   bool to_left, common, ok;
+
+   Cont_Combine_Task()
+    : ar1(NULL), ar2(NULL), to_left(false), common(false), ok(true) {}
+
+   virtual void work();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Combine_Task::work()
+{
+  ok = Cont_Area::combine_pair(*ar1,*ar2,to_left,common);
+}
+
+/* ---------------------------------------------------------------------- */
+/** Combines a number of areas of the same sense into one.
+  \param arlst The areas, the list is emptied.
+  \param to_left As with Combine_With(), if \c to_left differs from the
+  sense of the areas the result is their union (empty areas are skipped),
+  otherwise it is their common part.
+  \param into The result.
+  \return \c false if the result is empty or if one of the combinations
+  failed.
+
+  The result is the same as combining the areas one by one with
+  Combine_With(), but the areas are combined in pairs, the results again
+  in pairs and so on. This way no area takes part in more than about
+  log2(n) combinations instead of n. Pairs whose bounding rectangles do
+  not overlap are simply joined and when there is enough work the pairs
+  of each level are combined on worker threads.
+*/
+
+bool Cont_Area::Combine_All(Cont_Area_List& arlst, bool to_left,
+                                                     Cont_Area& into)
+{
+  into.Delete();
+
+  int cnt = arlst.Length();
+  if (cnt < 1) return false;
+
+  Cont_Area **ars = new Cont_Area*[cnt];
+
+  Cont_Area_Cursor arc(arlst);
+  for (int i=0; arc; ++arc) ars[i++] = &*arc;
+
+  bool common = false;
+
+  for (arc.To_Begin(); arc; ++arc) {
+    if (!arc->Empty()) {
+      common = to_left == arc->lccw;
+      break;
+    }
+  }
+
+  Cont_Combine_Task *tasks = new Cont_Combine_Task[cnt/2 + 1];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[cnt/2 + 1];
+  Cont_Par_Pool pool;
+
+  bool ok = true, failed = false;
+
+  for (int step=1; step<cnt && !failed; step*=2) {
+
+    // Combine area i+step into area i, i a multiple of 2*step
+
+    int task_cnt = 0, el_cnt = 0;
+
+    for (int i=0; i+step<cnt; i+=2*step) {
+      Cont_Area& ar1 = *ars[i];
+      Cont_Area& ar2 = *ars[i+step];
+
+      if (ar1.Empty() || ar2.Empty() ||
+          !ar1.Rect_Ax::Intersects_XY(ar2,Vec2::IdentDist)) {
+        combine_pair(ar1,ar2,to_left,common); // Cheap, do it right away
+        continue;
+      }
+
+      Cont_Combine_Task& task = tasks[task_cnt];
+      task.ar1 = &ar1; task.ar2 = &ar2;
+      task.to_left = to_left; task.common = common;
+
+      task_lst[task_cnt++] = &task;
+
+      el_cnt += ar1.Elem_Count() + ar2.Elem_Count();
+    }
+
+    if (task_cnt > 1 && Cont_Par_Pool::Thread_Count(el_cnt) > 1) {
+      if (!pool.Run_All(task_lst,task_cnt)) failed = true;
+    }
+    else {
+      for (int t=0; t<task_cnt; ++t) {
+        tasks[t].ok = combine_pair(*tasks[t].ar1,*tasks[t].ar2,
+                                                        to_left,common);
+      }
+    }
+
+    for (int t=0; t<task_cnt; ++t) {
+      if (!tasks[t].ok) ok = false;
+    }
+  }
+
+  delete[] task_lst;
+  delete[] tasks;
+
+  if (!failed) ars[0]->Move_To(into);
+
+  delete[] ars;
+
+  arlst.Delete();
+
+  if (failed) Cont_Panic(Cont_Area_Cant_Combine);
+
+  return ok && !into.Empty();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Area::Reverse()
+{
+  Cont_Nest_Cursor nsc(nestlst);
+
+  if (nsc) {
+    double begpar = Begin_Par();
+
+    for (;nsc;++nsc) nsc->Reverse();
+
+    nestlst.Reverse();
+
+    Begin_Par(begpar);
+  }
+
+  lccw = !lccw;
+  
+  if (inert.area_valid) inert.area = -inert.area;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Area::Transform(const Trf2& trf)
+{
+  Cont_Nest_Cursor nsc(nestlst);
+
+  for (;nsc;++nsc) nsc->Transform(trf);
+
+  calc_invar();
+
+  inert.invalidate();
 }
 
 /* ---------------------------------------------------------------------- */
@@ -7027,6 +8140,3432 @@ bool Cont_Area::Min_Right_Rad(double& min_rad) const
   return found;
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Prepared contour, nest or area ------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ------- For many point in area tests against the same (unchanged) ---- */
+/* ------- object. All contours go into one slab index, so a test costs - */
+/* ------- about the same for an area with many contours as for a ------- */
+/* ------- single contour. Only points on or very near a contour fall --- */
+/* ------- back to the (slow) projection based test. -------------------- */
+/* ------- The source must not be changed or destroyed as long as the --- */
+/* ------- Cont_Prepared is used. A nest or area must be well formed ---- */
+/* ------- (no intersecting contours, holes inside their outer ---------- */
+/* ------- contour), as after Cont_Area::build_from(). ------------------ */
+/* ---------------------------------------------------------------------- */
+
+Cont_Prepared::Cont_Prepared(const Cont_Clsd& cnt)
+: clsd(&cnt), nest(NULL), area(NULL),
+  slabs(new Cont_Slabs(2.0*Vec2::IdentDist))
+{
+  slabs->Add(cnt.List());
+  slabs->Build();
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Prepared::Cont_Prepared(const Cont_Nest& nst)
+: clsd(NULL), nest(&nst), area(NULL),
+  slabs(new Cont_Slabs(2.0*Vec2::IdentDist))
+{
+  build(nst.List());
+  slabs->Build();
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Prepared::Cont_Prepared(const Cont_Area& ar)
+: clsd(NULL), nest(NULL), area(&ar),
+  slabs(new Cont_Slabs(2.0*Vec2::IdentDist))
+{
+  Cont_Nest_C_Cursor nsc(ar);
+
+  for (;nsc;++nsc) build(nsc->List());
+
+  slabs->Build();
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Prepared::~Cont_Prepared()
+{
+  delete slabs;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Prepared::build(const Cont_Clsd_D_List& cnt_list)
+{
+  Cont_Clsd_C_Cursor cc(cnt_list);
+
+  for (;cc;++cc) slabs->Add(cc->List());
+}
+
+/* ---------------------------------------------------------------------- */
+
+const Rect_Ax& Cont_Prepared::Rect() const
+{
+  if (clsd) return clsd->Rect();
+  if (nest) return nest->Rect();
+
+  return area->Rect();
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Prepared::Pnt_Inside(const Vec2& p) const
+{
+  bool on_cnt;
+
+  return Pnt_Inside(p,on_cnt);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same result as Pt_Inside() for the source object ------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Prepared::Pnt_Inside(const Vec2& p, bool& on_cnt) const
+{
+  on_cnt = false;
+
+  if (!Rect().Point_Inside(p,Vec2::IdentDist)) return false;
+
+  bool inside = false;
+
+  if (slabs->Pnt_Inside(p,inside)) return inside;
+
+  // On or near a contour
+
+  if (clsd) return Pt_Inside(p,*clsd,on_cnt);
+
+  Cont_Clsd_C_Cursor closest;
+
+  if (nest) return Pt_Inside(p,*nest,on_cnt,closest);
+
+  return Pt_Inside(p,*area,on_cnt,closest);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Is contour inside (closed, not intersecting) ----------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Prepared::Cnt_Inside(const Contour& cnt,
+                                         const Contour* &colinear) const
+{
+  // The point tests of these use the slab index of each contour
+
+  if (clsd) return Ino::Cnt_Inside(cnt,*clsd,colinear);
+  if (nest) return Ino::Cnt_Inside(cnt,*nest,colinear);
+
+  return Ino::Cnt_Inside(cnt,*area,colinear);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Batch point projection --------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ------- Every contour gets a uniform grid over its elements. A query - */
+/* ------- first projects on the element hit by the previous query, ----- */
+/* ------- which bounds the search to the grid cells within that -------- */
+/* ------- distance. Queries are sorted along a Z-order curve so that --- */
+/* ------- consecutive queries are close together. ---------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Projector::Cont_Projector(const Contour& cnt)
+: cont(cnt), items(NULL), item_cnt(cnt.Elem_Count()),
+  cell_beg(NULL), cell_items(NULL), nx(1), ny(1),
+  x0(0.0), y0(0.0), cell_w(1.0), cell_h(1.0)
+{
+  if (item_cnt < 1) return;
+
+  items = new Item[item_cnt];
+
+  Elem_C_Cursor elc(cnt.List());
+
+  for (int i=0; elc; ++elc, ++i) {
+    const Rect_Ax& rct = elc->El().Rect();
+
+    items[i].elc  = elc;
+    items[i].xmin = rct.Ll().x; items[i].ymin = rct.Ll().y;
+    items[i].xmax = rct.Ur().x; items[i].ymax = rct.Ur().y;
+  }
+
+  // About two elements per cell, cells about square
+
+  const Rect_Ax& rct = cnt.Rect();
+
+  x0 = rct.Ll().x;
+  y0 = rct.Ll().y;
+
+  double w = rct.Width(), h = rct.Height();
+  double cells = item_cnt/2 + 1;
+
+  if (w > Vec2::IdentDist && h > Vec2::IdentDist) {
+    double sz = sqrt(w*h/cells);
+
+    nx = (int)(w/sz) + 1;
+    ny = (int)(h/sz) + 1;
+  }
+  else if (w > h) nx = (int)cells;
+  else ny = (int)cells;
+
+  if (nx > 4096) nx = 4096;
+  if (ny > 4096) ny = 4096;
+
+  cell_w = w > 0.0 ? w/nx : 1.0;
+  cell_h = h > 0.0 ? h/ny : 1.0;
+
+  int cell_cnt = nx*ny;
+
+  cell_beg = new int[cell_cnt+1];
+  for (int c=0; c<=cell_cnt; ++c) cell_beg[c] = 0;
+
+  for (int i=0; i<item_cnt; ++i) {
+    const Item& it = items[i];
+
+    int cx1 = cell_x(it.xmin), cx2 = cell_x(it.xmax);
+    int cy1 = cell_y(it.ymin), cy2 = cell_y(it.ymax);
+
+    for (int cy=cy1; cy<=cy2; ++cy) {
+      for (int cx=cx1; cx<=cx2; ++cx) cell_beg[cy*nx+cx+1]++;
+    }
+  }
+
+  for (int c=0; c<cell_cnt; ++c) cell_beg[c+1] += cell_beg[c];
+
+  cell_items = new int[cell_beg[cell_cnt]];
+
+  int *fill = new int[cell_cnt];
+  for (int c=0; c<cell_cnt; ++c) fill[c] = cell_beg[c];
+
+  for (int i=0; i<item_cnt; ++i) {
+    const Item& it = items[i];
+
+    int cx1 = cell_x(it.xmin), cx2 = cell_x(it.xmax);
+    int cy1 = cell_y(it.ymin), cy2 = cell_y(it.ymax);
+
+    for (int cy=cy1; cy<=cy2; ++cy) {
+      for (int cx=cx1; cx<=cx2; ++cx) cell_items[fill[cy*nx+cx]++] = i;
+    }
+  }
+
+  delete[] fill;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Projector::~Cont_Projector()
+{
+  delete[] items;
+  delete[] cell_beg;
+  delete[] cell_items;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Projector::cell_x(double x) const
+{
+  double c = (x - x0)/cell_w;
+
+  if (c < 1.0) return 0;
+  if (c >= nx) return nx-1;
+
+  return (int)c;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Projector::cell_y(double y) const
+{
+  double c = (y - y0)/cell_h;
+
+  if (c < 1.0) return 0;
+  if (c >= ny) return ny-1;
+
+  return (int)c;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Nearest element among those within rad of p ------------------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Projector::search(const Vec2& p, double rad, int& best,
+                    Vec3& pp, double& parm, double& dist_xy) const
+{
+  double qxmin = p.x - rad, qymin = p.y - rad;
+
+  int cx1 = cell_x(qxmin), cx2 = cell_x(p.x + rad);
+  int cy1 = cell_y(qymin), cy2 = cell_y(p.y + rad);
+
+  double best_dist = 0.0;
+  best = -1;
+
+  for (int cy=cy1; cy<=cy2; ++cy) {
+    for (int cx=cx1; cx<=cx2; ++cx) {
+      int cell = cy*nx+cx;
+
+      for (int k=cell_beg[cell]; k<cell_beg[cell+1]; ++k) {
+        int i = cell_items[k];
+        const Item& it = items[i];
+
+        // An element is in several cells: only test it in the cell
+        // with the lower left corner of its overlap with the query
+
+        if (cell_x(it.xmin > qxmin ? it.xmin : qxmin) != cx ||
+            cell_y(it.ymin > qymin ? it.ymin : qymin) != cy) continue;
+
+        double dx = it.xmin - p.x;
+        if (p.x - it.xmax > dx) dx = p.x - it.xmax;
+        if (dx < 0.0) dx = 0.0;
+
+        double dy = it.ymin - p.y;
+        if (p.y - it.ymax > dy) dy = p.y - it.ymax;
+        if (dy < 0.0) dy = 0.0;
+
+        double lim = best >= 0 && best_dist < rad ? best_dist : rad;
+        if (dx > lim + Vec2::IdentDist || dy > lim + Vec2::IdentDist ||
+            dx*dx + dy*dy > (lim + Vec2::IdentDist)*(lim + Vec2::IdentDist))
+                                                                   continue;
+
+        double lpar,ldist;
+        Vec3 lpp;
+
+        if (!it.elc->El().Project_Pnt_XY(p,Sub_Rect_Project_Tol,true,
+                                                      lpp,lpar,ldist))
+                                          Cont_Panic(SubRect_Project_No_Elem);
+
+        ldist = fabs(ldist);
+
+        // Equal distances: the first element in the contour wins
+
+        if (best < 0 || ldist < best_dist ||
+                                       (ldist == best_dist && i < best)) {
+          best = i;
+          best_dist = ldist;
+          pp = lpp;
+          parm = lpar;
+        }
+      }
+    }
+  }
+
+  dist_xy = best_dist;
+
+  return best >= 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Projector::Project(const Vec2& p, int& hint, Cont_Pnt& cntp,
+                                                   double& dist_xy) const
+{
+  cntp = Cont_Pnt();
+  dist_xy = 0.0;
+
+  if (item_cnt < 1) return false;
+
+  double rad = cell_w > cell_h ? cell_w : cell_h;
+
+  if (hint >= 0 && hint < item_cnt) {
+    double lpar;
+    Vec3 lpp;
+
+    if (items[hint].elc->El().Project_Pnt_XY(p,Sub_Rect_Project_Tol,true,
+                                                   lpp,lpar,dist_xy))
+                                                    rad = fabs(dist_xy);
+  }
+
+  double out_dist = cont.Rect().Dist_To_XY(p);
+  if (rad < out_dist) rad = out_dist;
+
+  int best;
+  double parm;
+  Vec3 pp;
+
+  // All elements within dist_xy of p were tested once dist_xy <= rad
+
+  for (;;) {
+    if (search(p,rad,best,pp,parm,dist_xy)) {
+      if (dist_xy <= rad) break;
+      rad = dist_xy;
+    }
+    else rad *= 2.0;
+  }
+
+  hint = best;
+
+  cont.project_finish(p,items[best].elc,parm,pp,cntp,dist_xy);
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Proj_Set::Cont_Proj_Set(const Contour& cnt)
+: projs(new Cont_Projector*[1]), proj_cnt(0), rtree(NULL),
+  area(NULL), nests(NULL), nest_beg(NULL), nest_cnt(0)
+{
+  add(cnt);
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Proj_Set::Cont_Proj_Set(const Cont_List& lst)
+: projs(new Cont_Projector*[lst.List().Length()+1]), proj_cnt(0),
+  rtree(NULL), area(NULL), nests(NULL), nest_beg(NULL), nest_cnt(0)
+{
+  Cont_C_Cursor cc(lst.List());
+
+  for (;cc;++cc) add(*cc);
+
+  if (proj_cnt >= Cont_List_Index_Min) {
+    rtree = new Cont_Rtree;
+    rtree->Build(lst);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Proj_Set::Cont_Proj_Set(const Cont_Area& ar)
+: projs(NULL), proj_cnt(0), rtree(NULL),
+  area(&ar), nests(NULL), nest_beg(NULL), nest_cnt(0)
+{
+  const Cont_Nest_D_List& nestlst = ar;
+
+  int cnt_cnt = 0;
+
+  Cont_Nest_C_Cursor nsc(nestlst);
+
+  for (;nsc;++nsc) {
+    ++nest_cnt;
+    cnt_cnt += nsc->List().Length();
+  }
+
+  projs    = new Cont_Projector*[cnt_cnt+1];
+  nests    = new const Cont_Nest*[nest_cnt+1];
+  nest_beg = new int[nest_cnt+1];
+
+  int n = 0;
+
+  for (nsc.To_Begin(); nsc; ++nsc, ++n) {
+    nests[n]    = &*nsc;
+    nest_beg[n] = proj_cnt;
+
+    Cont_Clsd_C_Cursor cc(nsc->List());
+
+    for (;cc;++cc) add(*cc);
+  }
+
+  nest_beg[n] = proj_cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Proj_Set::~Cont_Proj_Set()
+{
+  for (int i=0; i<proj_cnt; ++i) delete projs[i];
+
+  delete[] projs;
+  delete[] nests;
+  delete[] nest_beg;
+
+  if (rtree) delete rtree;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Proj_Set::add(const Contour& cnt)
+{
+  projs[proj_cnt++] = new Cont_Projector(cnt);
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Proj_Set::Project(const Vec2& p, int *hints, Cont_Pnt& cntp,
+                                                  double& dist_xy) const
+{
+  if (area) return project_area(p,hints,cntp,dist_xy);
+
+  if (proj_cnt == 1) return projs[0]->Project(p,hints[0],cntp,dist_xy);
+
+  return project_list(p,hints,cntp,dist_xy);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same decisions as Cont_List::Project_Pnt_XY() ---------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Proj_Set::project_list(const Vec2& p, int *hints,
+                                 Cont_Pnt& cntp, double& dist_xy) const
+{
+  cntp = Cont_Pnt();
+
+  if (proj_cnt < 1) return false;
+
+  if (rtree) {
+    Cont_Rtree::Near near(*rtree,p);
+
+    int best, c;
+    double rdist;
+
+    if (near.Next(best,rdist)) {
+      int first = best;
+
+      if (!projs[best]->Project(p,hints[best],cntp,dist_xy))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+      while (near.Next(c,rdist) && rdist < fabs(dist_xy) + Vec2::IdentDist) {
+        Cont_Pnt curpnt;
+        double curdist;
+
+        if (!projs[c]->Project(p,hints[c],curpnt,curdist))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+        if (fabs(curdist) < fabs(dist_xy) ||
+            (fabs(curdist) == fabs(dist_xy) &&
+             (c - first + proj_cnt) % proj_cnt <
+                                     (best - first + proj_cnt) % proj_cnt)) {
+          best    = c;
+          dist_xy = curdist;
+          cntp    = curpnt;
+        }
+      }
+
+      return true;
+    }
+  }
+
+  int minc = 0;
+  double mindist = projs[0]->Cont().Rect().Dist_To_XY(p);
+
+  for (int c=1; c<proj_cnt && mindist > 0.0; ++c) {
+    double curdist = projs[c]->Cont().Rect().Dist_To_XY(p);
+
+    if (curdist < mindist) {
+      mindist = curdist;
+      minc    = c;
+    }
+  }
+
+  if (!projs[minc]->Project(p,hints[minc],cntp,dist_xy))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+  for (int c=(minc+1)%proj_cnt; c != minc; c=(c+1)%proj_cnt) {
+    if (projs[c]->Cont().Rect().Dist_To_XY(p) <
+                                       fabs(dist_xy) + Vec2::IdentDist) {
+      Cont_Pnt curpnt;
+      double curdist;
+
+      if (!projs[c]->Project(p,hints[c],curpnt,curdist))
+                                           Cont_Panic(Cont_List_Cant_Project);
+
+      if (fabs(curdist) < fabs(dist_xy)) {
+        dist_xy = curdist;
+        cntp = curpnt;
+      }
+    }
+  }
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same decisions as Cont_Nest::Project_Pnt_XY() ---------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Proj_Set::project_nest(int n, const Vec2& p, int *hints,
+                                 Cont_Pnt& cntp, double& dist_xy) const
+{
+  cntp = Cont_Pnt();
+
+  int beg = nest_beg[n], end = nest_beg[n+1];
+  bool lccw = nests[n]->Ccw();
+
+  if (beg >= end) return false;
+
+  if (!projs[beg]->Project(p,hints[beg],cntp,dist_xy))
+                                           Cont_Panic(Cont_Nest_Cant_Project);
+
+  if ((dist_xy < 0.0) == lccw || beg+1 >= end) return true;
+
+  int minc = beg+1;
+  double mindist = projs[minc]->Cont().Rect().Dist_To_XY(p);
+
+  for (int c=minc+1; c<end && mindist > 0.0; ++c) {
+    double curdist = projs[c]->Cont().Rect().Dist_To_XY(p);
+
+    if (curdist < mindist) {
+      mindist = curdist;
+      minc    = c;
+    }
+  }
+
+  int c = minc;
+
+  do {
+    if (projs[c]->Cont().Rect().Dist_To_XY(p) <
+                                       fabs(dist_xy) + Vec2::IdentDist) {
+      Cont_Pnt curpnt;
+      double curdist;
+
+      if (!projs[c]->Project(p,hints[c],curpnt,curdist))
+                                           Cont_Panic(Cont_Nest_Cant_Project);
+
+      if ((curdist < 0.0) == lccw) {
+        dist_xy = curdist;
+        cntp = curpnt;
+        return true;
+      }
+
+      if (fabs(curdist) < fabs(dist_xy)) {
+        dist_xy = curdist;
+        cntp = curpnt;
+      }
+    }
+
+    if (++c >= end) c = beg+1;
+  } while (c != minc);
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same decisions as Cont_Area::Project_Pnt_XY() ---------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Proj_Set::project_area(const Vec2& p, int *hints,
+                                 Cont_Pnt& cntp, double& dist_xy) const
+{
+  cntp = Cont_Pnt();
+
+  if (nest_cnt < 1) return false;
+
+  bool lccw = area->Ccw();
+
+  int minn = 0;
+  double mindist = nests[0]->Rect().Dist_To_XY(p);
+
+  for (int n=1; n<nest_cnt && mindist > 0.0; ++n) {
+    double curdist = nests[n]->Rect().Dist_To_XY(p);
+
+    if (curdist < mindist) {
+      mindist = curdist;
+      minn    = n;
+    }
+  }
+
+  if (!project_nest(minn,p,hints,cntp,dist_xy))
+                                           Cont_Panic(Cont_Area_Cant_Project);
+
+  if ((dist_xy > 0.0) == lccw) return true;
+
+  for (int n=(minn+1)%nest_cnt; n != minn; n=(n+1)%nest_cnt) {
+    Cont_Pnt curpnt;
+    double curdist;
+
+    if (!project_nest(n,p,hints,curpnt,curdist))
+                                           Cont_Panic(Cont_Area_Cant_Project);
+
+    if ((curdist > 0.0) == lccw) {
+      cntp = curpnt;
+      dist_xy = curdist;
+      return true;
+    }
+
+    if (fabs(curdist) < fabs(dist_xy)) {
+      cntp = curpnt;
+      dist_xy = curdist;
+    }
+  }
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+
+struct Cont_Proj_Key
+{
+  unsigned int key;
+  int idx;
+};
+
+/* ---------------------------------------------------------------------- */
+
+static int proj_key_cmp(const void *k1, const void *k2)
+{
+  const Cont_Proj_Key& key1 = *(const Cont_Proj_Key *)k1;
+  const Cont_Proj_Key& key2 = *(const Cont_Proj_Key *)k2;
+
+  if (key1.key != key2.key) return key1.key < key2.key ? -1 : 1;
+
+  return key1.idx - key2.idx;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static unsigned int spread_bits(unsigned int v)
+{
+  v = (v | (v << 8)) & 0x00FF00FFu;
+  v = (v | (v << 4)) & 0x0F0F0F0Fu;
+  v = (v | (v << 2)) & 0x33333333u;
+  v = (v | (v << 1)) & 0x55555555u;
+
+  return v;
+}
+
+/* ---------------------------------------------------------------------- */
+
+class Cont_Project_Task : public Cont_Task
+{
+   Cont_Project_Task(const Cont_Project_Task& cp);
+   Cont_Project_Task& operator=(const Cont_Project_Task& src);
+
+  public:
+   const Cont_Proj_Set *set;
+   const Vec2 *pnts;
+   const Cont_Proj_Key *order;
+   int cnt;
+
+   Cont_Pnt *cntps;
+   double *dists_xy;
+
+   Cont_Project_Task()
+     : set(NULL), pnts(NULL), order(NULL), cnt(0),
+       cntps(NULL), dists_xy(NULL) {}
+
+   virtual void work();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Project_Task::work()
+{
+  int hint_cnt = set->Proj_Count();
+  int *hints = new int[hint_cnt];
+
+  for (int h=0; h<hint_cnt; ++h) hints[h] = -1;
+
+  for (int i=0; i<cnt; ++i) {
+    int idx = order[i].idx;
+
+    set->Project(pnts[idx],hints,cntps[idx],dists_xy[idx]);
+  }
+
+  delete[] hints;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Proj_Set::Project_All(const Vec2 *pnts, int cnt,
+                                Cont_Pnt *cntps, double *dists_xy) const
+{
+  if (cnt < 1) return proj_cnt > 0;
+
+  // Sort the points along a Z-order curve over their bounding box
+
+  double xmin = pnts[0].x, xmax = xmin, ymin = pnts[0].y, ymax = ymin;
+
+  for (int i=1; i<cnt; ++i) {
+    if (pnts[i].x < xmin) xmin = pnts[i].x;
+    if (pnts[i].x > xmax) xmax = pnts[i].x;
+    if (pnts[i].y < ymin) ymin = pnts[i].y;
+    if (pnts[i].y > ymax) ymax = pnts[i].y;
+  }
+
+  double sx = xmax > xmin ? 65535.0/(xmax-xmin) : 0.0;
+  double sy = ymax > ymin ? 65535.0/(ymax-ymin) : 0.0;
+
+  Cont_Proj_Key *order = new Cont_Proj_Key[cnt];
+
+  for (int i=0; i<cnt; ++i) {
+    unsigned int qx = (unsigned int)((pnts[i].x - xmin)*sx);
+    unsigned int qy = (unsigned int)((pnts[i].y - ymin)*sy);
+
+    order[i].key = spread_bits(qx) | (spread_bits(qy) << 1);
+    order[i].idx = i;
+  }
+
+  qsort(order,cnt,sizeof(Cont_Proj_Key),proj_key_cmp);
+
+  // Consecutive runs of sorted points, each with its own hints
+
+  int thr_cnt = Cont_Par_Pool::Thread_Count(cnt);
+  int task_cnt = thr_cnt > 1 ? 4*thr_cnt : 1;
+
+  Cont_Project_Task *tasks = new Cont_Project_Task[task_cnt];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[task_cnt];
+
+  int per_task = (cnt + task_cnt - 1)/task_cnt;
+
+  for (int t=0; t<task_cnt; ++t) {
+    int beg = t*per_task, end = beg + per_task;
+    if (end > cnt) end = cnt;
+
+    tasks[t].set      = this;
+    tasks[t].pnts     = pnts;
+    tasks[t].order    = order + beg;
+    tasks[t].cnt      = end > beg ? end - beg : 0;
+    tasks[t].cntps    = cntps;
+    tasks[t].dists_xy = dists_xy;
+
+    task_lst[t] = &tasks[t];
+  }
+
+  if (task_cnt > 1) {
+    Cont_Par_Pool pool;
+    pool.Run_All(task_lst,task_cnt);
+  }
+  else tasks[0].run();
+
+  delete[] task_lst;
+  delete[] tasks;
+  delete[] order;
+
+  return proj_cnt > 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Project many points ------------------------------------------ */
+/* ---------------------------------------------------------------------- */
+/* ------- Same results as Project_Pnt_XY() on each point; on a tie ----- */
+/* ------- the point on the contour may be a different but equally ----- */
+/* ------- near one. cntps and dists_xy must hold cnt entries. ---------- */
+/* ---------------------------------------------------------------------- */
+
+bool Contour::Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                              Cont_Pnt *cntps, double *dists_xy) const
+{
+  if (!el_list) {
+    for (int i=0; i<cnt; ++i) {
+      cntps[i] = Cont_Pnt();
+      dists_xy[i] = 0.0;
+    }
+
+    return false;
+  }
+
+  Cont_Proj_Set set(*this);
+
+  return set.Project_All(pnts,cnt,cntps,dists_xy);
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_List::Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                                Cont_Pnt *cntps, double *dists_xy) const
+{
+  Cont_Proj_Set set(*this);
+
+  if (set.Proj_Count() < 1) {
+    for (int i=0; i<cnt; ++i) {
+      cntps[i] = Cont_Pnt();
+      dists_xy[i] = 0.0;
+    }
+
+    return false;
+  }
+
+  return set.Project_All(pnts,cnt,cntps,dists_xy);
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Area::Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                                Cont_Pnt *cntps, double *dists_xy) const
+{
+  if (!nestlst) {
+    for (int i=0; i<cnt; ++i) {
+      cntps[i] = Cont_Pnt();
+      dists_xy[i] = 0.0;
+    }
+
+    return false;
+  }
+
+  Cont_Proj_Set set(*this);
+
+  return set.Project_All(pnts,cnt,cntps,dists_xy);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Sampler for many parameters along a contour ------------------ */
+/* ------- Parameters are found by walking forward from the element of -- */
+/* ------- the previous one, so ascending parameters cost about one ----- */
+/* ------- element step each. The source contour must not be changed ---- */
+/* ------- or destroyed as long as the Cont_Sampler is used. ------------ */
+/* ---------------------------------------------------------------------- */
+
+Cont_Sampler::Cont_Sampler(const Contour& cnt)
+: cont(cnt), elc(), beg_par(0.0), end_par(0.0)
+{
+  if (cnt.Empty()) return;
+
+  beg_par = cnt.Begin_Par();
+  end_par = cnt.End_Par();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Element of par, par limited as Cont_Pnt(cnt,par) does -------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Sampler::to_par(double& par)
+{
+  if (cont.Empty()) return false;
+
+  if (par < beg_par - Vec2::IdentDist ||
+                            par > end_par + Vec2::IdentDist) return false;
+
+  if (par < beg_par) par = beg_par;
+  else if (par >= end_par) {
+    par = end_par;
+    if (cont.Closed()) par = beg_par;
+  }
+
+  // Walk a few elements forward, else search from the start
+
+  int steps = 0;
+
+  while (elc && elc->El().End_Par() <= par &&
+                                    steps < Cont_Sub_Rect_Max_Elems) {
+    ++elc;
+    ++steps;
+  }
+
+  if (!elc || par < elc->El().Begin_Par() ||
+                                      elc->El().End_Par() <= par) {
+    if (!cont.el_rect_list) {
+      cont.build_rect_list();
+      if (!cont.el_rect_list) return false;
+    }
+
+    if (!cont.el_rect_list->Find_Elem_At_Par(par,elc)) {
+      elc = Elem_C_Cursor();
+      return false;
+    }
+  }
+
+  if (!elc) {
+    elc = Elem_C_Cursor(cont.el_list);
+    elc.To_Last();
+  }
+
+  return elc;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same as Cont_Pnt(cnt,par) ------------------------------------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Sampler::To_Par(double par, Cont_Pnt& cntp)
+{
+  cntp = Cont_Pnt();
+
+  if (!to_par(par)) return false;
+
+  const Elem& el = elc->El();
+
+  Vec3 pt;
+  el.At_Par(par,pt);
+
+  Cont_Pnt cp(cont,elc,par - el.Begin_Par(),pt);
+  cp.calc_point_attr();
+
+  cntp = cp;
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Sample attributes at many parameters ------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ------- attrs selects the arrays to fill (Pnt, Tang, Tang_XY, Curve), - */
+/* ------- the others may be NULL. The tangents and curvature are those - */
+/* ------- after the point, as Cont_Pnt::Tang_After() etc. Returns ------ */
+/* ------- false if a parameter is outside the contour, its entries ----- */
+/* ------- are zero then. ----------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Sampler::Sample(const double *pars, int cnt, int attrs,
+                          Vec3 *pnts, Vec3 *tangs, Vec2 *tangs_xy,
+                          double *curves)
+{
+  bool all = true;
+
+  for (int i=0; i<cnt; ++i) {
+    double par = pars[i];
+
+    if (!to_par(par)) {
+      if (attrs & Pnt)     pnts[i] = Vec3();
+      if (attrs & Tang)    tangs[i] = Vec3();
+      if (attrs & Tang_XY) tangs_xy[i] = Vec2();
+      if (attrs & Curve)   curves[i] = 0.0;
+
+      all = false;
+      continue;
+    }
+
+    const Elem& el = elc->El();
+
+    if (attrs & Pnt) el.At_Par(par,pnts[i]);
+
+    if (!(attrs & (Tang|Tang_XY|Curve))) continue;
+
+    double rel_par = par - el.Begin_Par();
+
+    if (rel_par < Vec2::IdentDist ||
+                          el.Par_Len() - rel_par < Vec2::IdentDist) {
+      // At a joint: the attributes may come from the next element
+
+      Cont_Pnt cp(cont,elc,rel_par,Vec3());
+      cp.calc_point_attr();
+
+      if (attrs & Tang)    tangs[i] = cp.tg_aft;
+      if (attrs & Tang_XY) tangs_xy[i] = cp.tg_aft_xy;
+      if (attrs & Curve)   curves[i] = cp.curve_aft;
+    }
+    else {
+      par = rel_par + el.Begin_Par(); // As Cont_Pnt
+
+      if (attrs & Tang)    el.Tangent_At(par,tangs[i]);
+      if (attrs & Tang_XY) el.Tangent_At_XY(par,tangs_xy[i]);
+      if (attrs & Curve)   el.Curve_At(par,curves[i]);
+    }
+  }
+
+  return all;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Polyline approximation of a contour -------------------------- */
+/* ------- Built and cached by Contour::Polyline(). Arcs and circles ---- */
+/* ------- are split in equal steps that stay within chord_tol of the --- */
+/* ------- arc, all element end points are vertices. Elem_Indices() ----- */
+/* ------- has Count() entries, the last one repeats the last element. -- */
+/* ------- Pnt_Inside() is an even-odd test on the polyline, so it is --- */
+/* ------- only as exact as chord_tol. ---------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Polyline::Cont_Polyline(double tol)
+: chord_tol(tol), pnts(NULL), elems(NULL), pnt_cnt(0), pnt_cap(0),
+  next(NULL)
+{
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Polyline::~Cont_Polyline()
+{
+  if (pnts) delete[] pnts;
+  if (elems) delete[] elems;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Polyline::add(const Vec2& p, int el_idx)
+{
+  if (pnt_cnt >= pnt_cap) {
+    int new_cap = pnt_cap < 16 ? 16 : pnt_cap * 2;
+
+    Vec2 *new_pnts = new Vec2[new_cap];
+    int *new_elems = new int[new_cap];
+
+    for (int i=0; i<pnt_cnt; ++i) {
+      new_pnts[i]  = pnts[i];
+      new_elems[i] = elems[i];
+    }
+
+    if (pnts) delete[] pnts;
+    if (elems) delete[] elems;
+
+    pnts = new_pnts; elems = new_elems; pnt_cap = new_cap;
+  }
+
+  pnts[pnt_cnt]  = p;
+  elems[pnt_cnt] = el_idx;
+  ++pnt_cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Points after p1 of an arc around c (not its endpoint) -------- */
+/* ---------------------------------------------------------------------- */
+/* ------- The radius vector is rotated by a fixed step, so sin/cos ----- */
+/* ------- are evaluated once per arc instead of once per point. -------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Polyline::add_arc(const Vec2& p1, const Vec2& c, double span,
+                            bool circle, int el_idx)
+{
+  double dx = p1.x - c.x, dy = p1.y - c.y;
+  double r = sqrt(dx*dx + dy*dy);
+
+  if (r < Vec2::IdentDist) return;
+
+  int steps = Cont_Polyline_Max_Steps;
+
+  // Chord of angle a stays within r*(1 - cos(a/2)) of the arc
+  if (chord_tol >= r) steps = (int)ceil(fabs(span) / Vec2::Pi);
+  else if (chord_tol > 0.0) {
+    double step = 2.0 * acos(1.0 - chord_tol/r);
+    double cnt = ceil(fabs(span) / step);
+
+    if (cnt < steps) steps = (int)cnt;
+  }
+
+  if (circle && steps < 3) steps = 3;
+  if (steps < 1) steps = 1;
+
+  double ang = span / steps;
+  double cs = cos(ang), sn = sin(ang);
+
+  for (int i=1; i<steps; ++i) {
+    double rx = dx*cs - dy*sn;
+    dy = dx*sn + dy*cs;
+    dx = rx;
+
+    add(Vec2(c.x + dx, c.y + dy),el_idx);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Polyline::build(const Elem_List& el_list)
+{
+  pnt_cnt = 0;
+
+  Elem_C_Cursor elc(el_list);
+  int idx = 0;
+
+  for (;elc;++elc,++idx) {
+    const Elem& el = elc->El();
+    Vec2 p1(el.P1());
+
+    if (pnt_cnt < 1 || pnts[pnt_cnt-1].distTo2(p1) > Vec2::IdentDist)
+      add(p1,idx);
+    else elems[pnt_cnt-1] = idx;
+
+    switch (el.Type()) {
+      case Elem_Type_Arc: {
+        const Elem_Arc& arc = (const Elem_Arc&)el;
+        add_arc(p1,arc.C(),arc.Span_Angle(),false,idx);
+      }
+      break;
+
+      case Elem_Type_Circle: {
+        const Elem_Circle& cir = (const Elem_Circle&)el;
+        add_arc(p1,cir.C(),cir.Span_Angle(),true,idx);
+      }
+      break;
+
+      default: break;
+    }
+
+    add(el.P2(),idx);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Point inside the polyline (even-odd), p on it is undecided --- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Polyline::Pnt_Inside(const Vec2& p) const
+{
+  bool inside = false;
+
+  for (int i=0; i<pnt_cnt; ++i) {  // Closed by the last -> first segment
+    const Vec2& a = pnts[i > 0 ? i-1 : pnt_cnt-1];
+    const Vec2& b = pnts[i];
+
+    if ((a.y > p.y) == (b.y > p.y)) continue;
+
+    double x = a.x + (p.y - a.y) * (b.x - a.x) / (b.y - a.y);
+
+    if (x > p.x) inside = !inside;
+  }
+
+  return inside;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Minkowski sums and no fit polygons --------------------------- */
+/* ---------------------------------------------------------------------- */
+
+static bool nfp_arc_data(const Elem& el, Vec2& c, bool& ccw, double& span)
+{
+  if (el.Type() == Elem_Type_Arc) {
+    const Elem_Arc& arc = (const Elem_Arc &)el;
+    c = arc.C(); ccw = arc.Ccw();
+  }
+  else if (el.Type() == Elem_Type_Circle) {
+    const Elem_Circle& cir = (const Elem_Circle &)el;
+    c = cir.C(); ccw = cir.Ccw();
+  }
+  else return false;
+
+  span = el.Span_Angle();
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static Vec2 nfp_on_circle(const Vec2& c, double r, double ang)
+{
+  return Vec2(c.x + r * cos(ang), c.y + r * sin(ang));
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Copy of a nest with its arcs replaced by polygons that lie --- */
+/* ------- within tol outside of the nest's material -------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Area::polygon_around(const Cont_Nest& src, double tol,
+                                                       Cont_Nest& poly)
+{
+  poly = src;
+
+  Cont_Clsd_Cursor cc(poly.contlst);
+
+  for (;cc;++cc) {
+    Elem_List lines;
+    bool changed = false;
+
+    Elem_C_Cursor elc(cc->cont.el_list);
+
+    for (;elc;++elc) {
+      const Elem& el = elc->El();
+
+      Vec2 c; bool ccw; double span;
+
+      if (!nfp_arc_data(el,c,ccw,span)) {
+        lines.Push_Back(el);
+        continue;
+      }
+
+      changed = true;
+
+      Vec2 p1 = el.P1(), p2 = el.P2();
+      double r = p1.distTo2(c);
+
+      // Material at the centre side: tangent polygon, else chords
+
+      bool outside = ccw == src.lccw;
+
+      double max_ang = Vec2::Pi/2.0;
+
+      if (r > tol) {
+        double ang = outside ? 2.0 * acos(r/(r + tol))
+                             : 2.0 * acos(1.0 - tol/r);
+        if (ang < max_ang) max_ang = ang;
+      }
+
+      int parts = (int)ceil(fabs(span)/max_ang);
+      if (parts < 1) parts = 1;
+
+      double step = span/parts;
+      double ang0 = (p1 - c).angle();
+
+      Vec2 prv = p1;
+
+      if (outside) {
+        double ro = r/cos(step/2.0);
+
+        for (int i=0; i<parts; ++i) {
+          Vec2 p = nfp_on_circle(c,ro,ang0 + (i + 0.5) * step);
+          lines.Push_Back(Elem_Line(Vec3(prv),Vec3(p)));
+          prv = p;
+        }
+      }
+      else {
+        for (int i=1; i<parts; ++i) {
+          Vec2 p = nfp_on_circle(c,r,ang0 + i * step);
+          lines.Push_Back(Elem_Line(Vec3(prv),Vec3(p)));
+          prv = p;
+        }
+      }
+
+      lines.Push_Back(Elem_Line(Vec3(prv),Vec3(p2)));
+    }
+
+    if (!changed) continue;
+
+    double begpar = cc->Begin_Par();
+
+    lines.Move_To(cc->cont.el_list);
+
+    cc->cont.inval_rects();
+    cc->cont.calc_invar();
+    cc->Begin_Par(begpar);
+  }
+
+  poly.calc_invar();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Minkowski sum of polygon nests ------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+// The sum of nests A and C, polygons with the material at the left, is
+// bounded by parts of the reduced convolution: the edges of one moved to
+// those convex vertices of the other whose corner the edge direction fits
+// in. These segments are split where they cross or touch and a part is
+// kept if just left of it is inside the sum and just right of it is not.
+// Point x is inside if A and x-C overlap, so if x-c is in A for a point c
+// of C, x-v is in C for a point v of some contour of A, or an edge e of A
+// touches an edge f of x-C, i.e. x is in parallelogram e+f. The kept parts
+// are chained into contours. Splitting and the point in nest tests use
+// exact orientation signs, so segments that overlap or touch (which
+// Combine_With() does not take) are split consistently. The parallelogram
+// tests are not exact: in_sum() compares floating point cross products and
+// in_para() only drops segments inside by a margin of 1e-9 of the size, so
+// a piece within rounding of a parallelogram side may be classified
+// wrongly. All pairs of edges with a parallelogram are kept, so time and
+// memory grow with the product of the vertex counts.
+
+class Cont_Mink_Sum
+{
+   struct Loop { int beg, cnt; };         // Vertices vtx[beg..beg+cnt)
+   struct Nest { int loop_beg, loop_cnt; };
+
+   struct Para                            // o + s*u + t*v, s,t in [0,1]
+   {
+     Vec2 o, u, v;
+     double cr;                           // u x v, positive
+     double xmin,ymin,xmax,ymax;
+   };
+
+   struct Seg                             // Convolution segment
+   {
+     Vec2 s, e;
+     double xmin,ymin,xmax,ymax;
+   };
+
+   struct Split { int seg; double t; Vec2 p; };
+
+   struct Grid                            // Items by cell, counting sorted
+   {
+     double x0, y0, cell;
+     int nx, ny;
+     int *cell_beg, *cell_items;
+
+     Grid() : x0(0.0), y0(0.0), cell(1.0), nx(0), ny(0),
+              cell_beg(NULL), cell_items(NULL) {}
+     ~Grid() { delete[] cell_beg; delete[] cell_items; }
+
+     int cell_x(double x) const;
+     int cell_y(double y) const;
+
+     template <class T> void Build(const T *items, int cnt, double cell_sz);
+   };
+
+   Vec2 *vtx;   int vtx_cnt,  vtx_cap;
+   Loop *loops; int loop_cnt, loop_cap;
+   Nest *nests; int nest_cnt, nest_cap;
+   bool *of_first;                        // Per nest: of the first area
+
+   Para  *paras;  int para_cnt,  para_cap;
+   Seg   *segs;   int seg_cnt,   seg_cap;
+   Split *splits; int split_cnt, split_cap;
+
+   Grid para_grid;
+
+   // Sum edges between point ids, after splitting and snapping
+
+   Vec2 *pnts;  int pnt_cnt;
+   int  *edges; int edge_cnt;             // 2 ids per edge
+   bool *used;
+   int  *out_beg, *out_edges;             // Edges leaving each point
+   int  *trace;                           // Edges of the loop being traced
+
+   void add_conv(const Nest& na, const Nest& nb);
+   void add_paras(const Nest& na, const Nest& nc);
+
+   void add_split(int seg, const Vec2& p);
+   void split_pair(int i, int j);
+   void split_all();
+
+   bool in_nest(const Vec2& p, const Nest& nst) const;
+   bool in_sum(const Vec2& p) const;
+   bool in_para(const Seg& sg) const;
+
+   void make_edges();
+
+   Cont_Mink_Sum(const Cont_Mink_Sum& cp);             // No copying
+   Cont_Mink_Sum& operator=(const Cont_Mink_Sum& src); // No assignment
+
+  public:
+   Cont_Mink_Sum();
+   ~Cont_Mink_Sum();
+
+   void Add_Nest(const Cont_Nest& poly, bool first);
+   void Build();
+
+   bool Next_Loop(Elem_List& loop);
+};
+
+/* ---------------------------------------------------------------------- */
+
+template <class T> static void mink_room(T *&arr, int cnt, int& cap)
+{
+  if (cnt < cap) return;
+
+  int new_cap = cap < 64 ? 64 : 2 * cap;
+
+  T *new_arr = new T[new_cap];
+  for (int i=0; i<cnt; ++i) new_arr[i] = arr[i];
+
+  delete[] arr;
+  arr = new_arr; cap = new_cap;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static double mink_cross(const Vec2& a, const Vec2& b)
+{
+  return a.x * b.y - a.y * b.x;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Mink_Sum::Grid::cell_x(double x) const
+{
+  int ix = (int)floor((x - x0)/cell);
+  return ix < 0 ? 0 : ix >= nx ? nx-1 : ix;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Mink_Sum::Grid::cell_y(double y) const
+{
+  int iy = (int)floor((y - y0)/cell);
+  return iy < 0 ? 0 : iy >= ny ? ny-1 : iy;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Put items in all cells their rectangle covers ---------------- */
+/* ---------------------------------------------------------------------- */
+
+template <class T>
+void Cont_Mink_Sum::Grid::Build(const T *items, int cnt, double cell_sz)
+{
+  double x1 = 0.0, y1 = 0.0;
+
+  for (int i=0; i<cnt; ++i) {
+    const T& it = items[i];
+
+    if (i == 0 || it.xmin < x0) x0 = it.xmin;
+    if (i == 0 || it.ymin < y0) y0 = it.ymin;
+    if (i == 0 || it.xmax > x1) x1 = it.xmax;
+    if (i == 0 || it.ymax > y1) y1 = it.ymax;
+  }
+
+  // Never more than 512 cells in a direction
+
+  double wmax = x1 - x0 > y1 - y0 ? x1 - x0 : y1 - y0;
+
+  cell = cell_sz;
+  if (cell < wmax/512.0) cell = wmax/512.0;
+  if (cell <= 0.0) cell = 1.0;
+
+  nx = (int)((x1 - x0)/cell) + 1;
+  ny = (int)((y1 - y0)/cell) + 1;
+
+  cell_beg = new int[nx*ny + 1];
+  for (int c=0; c<=nx*ny; ++c) cell_beg[c] = 0;
+
+  for (int i=0; i<cnt; ++i) {
+    const T& it = items[i];
+
+    int cx1 = cell_x(it.xmin), cx2 = cell_x(it.xmax);
+    int cy1 = cell_y(it.ymin), cy2 = cell_y(it.ymax);
+
+    for (int cy=cy1; cy<=cy2; ++cy) {
+      for (int cx=cx1; cx<=cx2; ++cx) cell_beg[cy*nx + cx + 1]++;
+    }
+  }
+
+  for (int c=0; c<nx*ny; ++c) cell_beg[c+1] += cell_beg[c];
+
+  cell_items = new int[cell_beg[nx*ny] > 0 ? cell_beg[nx*ny] : 1];
+
+  int *fill = new int[nx*ny];
+  for (int c=0; c<nx*ny; ++c) fill[c] = cell_beg[c];
+
+  for (int i=0; i<cnt; ++i) {
+    const T& it = items[i];
+
+    int cx1 = cell_x(it.xmin), cx2 = cell_x(it.xmax);
+    int cy1 = cell_y(it.ymin), cy2 = cell_y(it.ymax);
+
+    for (int cy=cy1; cy<=cy2; ++cy) {
+      for (int cx=cx1; cx<=cx2; ++cx) cell_items[fill[cy*nx + cx]++] = i;
+    }
+  }
+
+  delete[] fill;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Mink_Sum::Cont_Mink_Sum()
+: vtx(NULL), vtx_cnt(0), vtx_cap(0),
+  loops(NULL), loop_cnt(0), loop_cap(0),
+  nests(NULL), nest_cnt(0), nest_cap(0), of_first(NULL),
+  paras(NULL), para_cnt(0), para_cap(0),
+  segs(NULL), seg_cnt(0), seg_cap(0),
+  splits(NULL), split_cnt(0), split_cap(0),
+  para_grid(),
+  pnts(NULL), pnt_cnt(0), edges(NULL), edge_cnt(0), used(NULL),
+  out_beg(NULL), out_edges(NULL), trace(NULL)
+{
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Mink_Sum::~Cont_Mink_Sum()
+{
+  delete[] trace;
+  delete[] out_edges;
+  delete[] out_beg;
+  delete[] used;
+  delete[] edges;
+  delete[] pnts;
+  delete[] splits;
+  delete[] segs;
+  delete[] paras;
+  delete[] of_first;
+  delete[] nests;
+  delete[] loops;
+  delete[] vtx;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Add a nest of lines of one of the areas ---------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::Add_Nest(const Cont_Nest& poly, bool first)
+{
+  if (nest_cnt >= nest_cap) {
+    int cap = nest_cap;
+    mink_room(nests,nest_cnt,nest_cap);
+
+    bool *new_first = new bool[nest_cap];
+    for (int n=0; n<nest_cnt && n<cap; ++n) new_first[n] = of_first[n];
+
+    delete[] of_first;
+    of_first = new_first;
+  }
+
+  Nest& nst = nests[nest_cnt];
+  nst.loop_beg = loop_cnt; nst.loop_cnt = 0;
+
+  Cont_Clsd_C_Cursor cc(poly.List());
+
+  for (;cc;++cc) {
+    mink_room(loops,loop_cnt,loop_cap);
+
+    Loop& lp = loops[loop_cnt];
+    lp.beg = vtx_cnt; lp.cnt = 0;
+
+    Elem_C_Cursor elc(cc->List());
+
+    for (;elc;++elc) {
+      Vec2 p = elc->El().P1();
+
+      // Leave out repeated vertices
+
+      if (lp.cnt > 0 && p.x == vtx[vtx_cnt-1].x &&
+                        p.y == vtx[vtx_cnt-1].y) continue;
+
+      mink_room(vtx,vtx_cnt,vtx_cap);
+      vtx[vtx_cnt++] = p;
+      lp.cnt++;
+    }
+
+    while (lp.cnt > 1 && vtx[lp.beg].x == vtx[vtx_cnt-1].x &&
+                         vtx[lp.beg].y == vtx[vtx_cnt-1].y) {
+      vtx_cnt--; lp.cnt--;
+    }
+
+    if (lp.cnt < 3) {
+      vtx_cnt = lp.beg;
+      continue;
+    }
+
+    loop_cnt++;
+    nst.loop_cnt++;
+  }
+
+  if (nst.loop_cnt < 1) return;
+
+  of_first[nest_cnt++] = first;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Edges of na moved to the fitting convex vertices of nb ------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::add_conv(const Nest& na, const Nest& nb)
+{
+  for (int lb=0; lb<nb.loop_cnt; ++lb) {
+    const Loop& lpb = loops[nb.loop_beg + lb];
+
+    for (int j=0; j<lpb.cnt; ++j) {
+      const Vec2& v  = vtx[lpb.beg + j];
+      const Vec2& vp = vtx[lpb.beg + (j + lpb.cnt - 1) % lpb.cnt];
+      const Vec2& vn = vtx[lpb.beg + (j + 1) % lpb.cnt];
+
+      Vec2 d_in = v - vp, d_out = vn - v;
+
+      int turn = Geo_Cross_Sign(d_in,d_out);
+
+      if (turn < 0) continue;                       // Reflex
+      if (turn == 0 && d_in * d_out > 0.0) continue; // Straight on
+
+      for (int la=0; la<na.loop_cnt; ++la) {
+        const Loop& lpa = loops[na.loop_beg + la];
+
+        for (int i=0; i<lpa.cnt; ++i) {
+          const Vec2& a = vtx[lpa.beg + i];
+          const Vec2& b = vtx[lpa.beg + (i + 1) % lpa.cnt];
+
+          Vec2 dir = b - a;
+
+          if (Geo_Cross_Sign(d_in,dir) < 0) continue;
+          if (Geo_Cross_Sign(dir,d_out) < 0) continue;
+
+          mink_room(segs,seg_cnt,seg_cap);
+
+          Seg& sg = segs[seg_cnt++];
+          sg.s = a + v; sg.e = b + v;
+
+          sg.xmin = sg.s.x < sg.e.x ? sg.s.x : sg.e.x;
+          sg.xmax = sg.s.x < sg.e.x ? sg.e.x : sg.s.x;
+          sg.ymin = sg.s.y < sg.e.y ? sg.s.y : sg.e.y;
+          sg.ymax = sg.s.y < sg.e.y ? sg.e.y : sg.s.y;
+        }
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Parallelograms e+f, e of na running along the outward -------- */
+/* ------- normal of f of nc (the others are not needed) ---------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::add_paras(const Nest& na, const Nest& nc)
+{
+  for (int la=0; la<na.loop_cnt; ++la) {
+    const Loop& lpa = loops[na.loop_beg + la];
+
+    for (int i=0; i<lpa.cnt; ++i) {
+      const Vec2& a = vtx[lpa.beg + i];
+      Vec2 u = vtx[lpa.beg + (i + 1) % lpa.cnt] - a;
+
+      for (int lc=0; lc<nc.loop_cnt; ++lc) {
+        const Loop& lpc = loops[nc.loop_beg + lc];
+
+        for (int j=0; j<lpc.cnt; ++j) {
+          const Vec2& p = vtx[lpc.beg + j];
+          Vec2 v = vtx[lpc.beg + (j + 1) % lpc.cnt] - p;
+
+          double cr = mink_cross(u,v);
+          if (cr <= 0.0) continue;
+
+          mink_room(paras,para_cnt,para_cap);
+
+          Para& pa = paras[para_cnt++];
+          pa.o = a + p; pa.u = u; pa.v = v; pa.cr = cr;
+
+          double xs[3] = { pa.o.x + u.x, pa.o.x + v.x, pa.o.x + u.x + v.x };
+          double ys[3] = { pa.o.y + u.y, pa.o.y + v.y, pa.o.y + u.y + v.y };
+
+          pa.xmin = pa.xmax = pa.o.x;
+          pa.ymin = pa.ymax = pa.o.y;
+
+          for (int k=0; k<3; ++k) {
+            if (xs[k] < pa.xmin) pa.xmin = xs[k];
+            if (xs[k] > pa.xmax) pa.xmax = xs[k];
+            if (ys[k] < pa.ymin) pa.ymin = ys[k];
+            if (ys[k] > pa.ymax) pa.ymax = ys[k];
+          }
+        }
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split segment at p, known to be on its line ------------------ */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::add_split(int seg, const Vec2& p)
+{
+  const Seg& sg = segs[seg];
+
+  if ((p.x == sg.s.x && p.y == sg.s.y) ||
+      (p.x == sg.e.x && p.y == sg.e.y)) return;
+
+  Vec2 d = sg.e - sg.s;
+
+  double t = ((p - sg.s) * d)/(d * d);
+  if (t <= 0.0 || t >= 1.0) return;
+
+  mink_room(splits,split_cnt,split_cap);
+
+  Split& spl = splits[split_cnt++];
+  spl.seg = seg; spl.t = t; spl.p = p;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split two segments where they cross, touch or overlap -------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::split_pair(int i, int j)
+{
+  const Seg& s1 = segs[i];
+  const Seg& s2 = segs[j];
+
+  int o1 = Geo_Orient(s1.s,s1.e,s2.s), o2 = Geo_Orient(s1.s,s1.e,s2.e);
+  if (o1 == o2 && o1 != 0) return;
+
+  int o3 = Geo_Orient(s2.s,s2.e,s1.s), o4 = Geo_Orient(s2.s,s2.e,s1.e);
+  if (o3 == o4 && o3 != 0) return;
+
+  if (o1 == 0 && o2 == 0) {                  // Collinear
+    add_split(i,s2.s); add_split(i,s2.e);
+    add_split(j,s1.s); add_split(j,s1.e);
+    return;
+  }
+
+  if (o1 * o2 < 0 && o3 * o4 < 0) {          // Proper crossing
+    Vec2 d1 = s1.e - s1.s, d2 = s2.e - s2.s, w = s2.s - s1.s;
+
+    double t1 = mink_cross(w,d2)/mink_cross(d1,d2);
+    Vec2 p = s1.s + d1 * t1;
+
+    add_split(i,p); add_split(j,p);
+    return;
+  }
+
+  if (o1 == 0) add_split(i,s2.s);            // Touching
+  if (o2 == 0) add_split(i,s2.e);
+  if (o3 == 0) add_split(j,s1.s);
+  if (o4 == 0) add_split(j,s1.e);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split all segments; each pair is handled in the cell of the -- */
+/* ------- lower left corner of the overlap of their rectangles --------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::split_all()
+{
+  if (seg_cnt < 2) return;
+
+  double len_sum = 0.0;
+
+  for (int i=0; i<seg_cnt; ++i) {
+    len_sum += segs[i].xmax - segs[i].xmin + segs[i].ymax - segs[i].ymin;
+  }
+
+  Grid grid;
+  grid.Build(segs,seg_cnt,len_sum/seg_cnt);
+
+  for (int c=0; c<grid.nx*grid.ny; ++c) {
+    int beg = grid.cell_beg[c], end = grid.cell_beg[c+1];
+
+    for (int k1=beg; k1<end; ++k1) {
+      const Seg& s1 = segs[grid.cell_items[k1]];
+
+      for (int k2=k1+1; k2<end; ++k2) {
+        const Seg& s2 = segs[grid.cell_items[k2]];
+
+        if (s1.xmin > s2.xmax || s2.xmin > s1.xmax ||
+            s1.ymin > s2.ymax || s2.ymin > s1.ymax) continue;
+
+        double ox = s1.xmin > s2.xmin ? s1.xmin : s2.xmin;
+        double oy = s1.ymin > s2.ymin ? s1.ymin : s2.ymin;
+
+        if (grid.cell_y(oy) * grid.nx + grid.cell_x(ox) != c) continue;
+
+        split_pair(grid.cell_items[k1],grid.cell_items[k2]);
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Point in nest, closed, exact for points off the contours ----- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Mink_Sum::in_nest(const Vec2& p, const Nest& nst) const
+{
+  bool inside = false;
+
+  for (int l=0; l<nst.loop_cnt; ++l) {
+    const Loop& lp = loops[nst.loop_beg + l];
+
+    for (int i=0; i<lp.cnt; ++i) {
+      const Vec2& a = vtx[lp.beg + i];
+      const Vec2& b = vtx[lp.beg + (i + 1) % lp.cnt];
+
+      if ((a.y > p.y) == (b.y > p.y)) continue;
+
+      int side = Geo_Orient(a,b,p);
+      if (side == 0) return true;
+
+      if ((side > 0) == (b.y > a.y)) inside = !inside;
+    }
+  }
+
+  return inside;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Point in the sum: A and p-C overlap, closed ------------------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Mink_Sum::in_sum(const Vec2& p) const
+{
+  if (para_cnt > 0 &&
+      p.x >= para_grid.x0 && p.y >= para_grid.y0 &&
+      p.x <= para_grid.x0 + para_grid.nx * para_grid.cell &&
+      p.y <= para_grid.y0 + para_grid.ny * para_grid.cell) {
+
+    int c = para_grid.cell_y(p.y) * para_grid.nx + para_grid.cell_x(p.x);
+
+    for (int k=para_grid.cell_beg[c]; k<para_grid.cell_beg[c+1]; ++k) {
+      const Para& pa = paras[para_grid.cell_items[k]];
+
+      if (p.x < pa.xmin || p.x > pa.xmax ||
+          p.y < pa.ymin || p.y > pa.ymax) continue;
+
+      Vec2 w = p - pa.o;
+
+      double s = mink_cross(w,pa.v), t = mink_cross(pa.u,w);
+
+      if (s >= 0.0 && s <= pa.cr && t >= 0.0 && t <= pa.cr) return true;
+    }
+  }
+
+  for (int na=0; na<nest_cnt; ++na) {
+    if (!of_first[na]) continue;
+
+    const Nest& nsa = nests[na];
+
+    for (int nc=0; nc<nest_cnt; ++nc) {
+      if (of_first[nc]) continue;
+
+      const Nest& nsc = nests[nc];
+
+      if (in_nest(p - vtx[loops[nsc.loop_beg].beg],nsa)) return true;
+
+      for (int l=0; l<nsa.loop_cnt; ++l) {
+        if (in_nest(p - vtx[loops[nsa.loop_beg + l].beg],nsc)) return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Segment strictly inside one parallelogram? ------------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Mink_Sum::in_para(const Seg& sg) const
+{
+  Vec2 mid = (sg.s + sg.e) * 0.5;
+
+  if (mid.x < para_grid.x0 || mid.y < para_grid.y0 ||
+      mid.x > para_grid.x0 + para_grid.nx * para_grid.cell ||
+      mid.y > para_grid.y0 + para_grid.ny * para_grid.cell) return false;
+
+  int c = para_grid.cell_y(mid.y) * para_grid.nx + para_grid.cell_x(mid.x);
+
+  for (int k=para_grid.cell_beg[c]; k<para_grid.cell_beg[c+1]; ++k) {
+    const Para& pa = paras[para_grid.cell_items[k]];
+
+    if (sg.xmin <= pa.xmin || sg.xmax >= pa.xmax ||
+        sg.ymin <= pa.ymin || sg.ymax >= pa.ymax) continue;
+
+    double mrg = 1e-9 * pa.cr, lim = pa.cr - mrg;
+
+    Vec2 w1 = sg.s - pa.o, w2 = sg.e - pa.o;
+
+    double s1 = mink_cross(w1,pa.v), t1 = mink_cross(pa.u,w1);
+    if (s1 <= mrg || s1 >= lim || t1 <= mrg || t1 >= lim) continue;
+
+    double s2 = mink_cross(w2,pa.v), t2 = mink_cross(pa.u,w2);
+    if (s2 <= mrg || s2 >= lim || t2 <= mrg || t2 >= lim) continue;
+
+    return true;
+  }
+
+  return false;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int mink_split_cmp(const void *p1, const void *p2)
+{
+  const double *t1 = (const double *)p1, *t2 = (const double *)p2;
+
+  return *t1 < *t2 ? -1 : *t1 > *t2 ? 1 : 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int mink_edge_cmp(const void *p1, const void *p2)
+{
+  const int *e1 = (const int *)p1, *e2 = (const int *)p2;
+
+  if (e1[0] != e2[0]) return e1[0] < e2[0] ? -1 : 1;
+  if (e1[1] != e2[1]) return e1[1] < e2[1] ? -1 : 1;
+
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split segments into edges between snapped points, keep the --- */
+/* ------- edges on the boundary of the sum ----------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::make_edges()
+{
+  // Split points per segment, sorted along it: t, x, y
+
+  int *seg_beg = new int[seg_cnt + 1];
+  for (int i=0; i<=seg_cnt; ++i) seg_beg[i] = 0;
+
+  for (int k=0; k<split_cnt; ++k) seg_beg[splits[k].seg + 1]++;
+  for (int i=0; i<seg_cnt; ++i) seg_beg[i+1] += seg_beg[i];
+
+  double *sorted = new double[3 * (split_cnt > 0 ? split_cnt : 1)];
+  int *fill = new int[seg_cnt > 0 ? seg_cnt : 1];
+
+  for (int i=0; i<seg_cnt; ++i) fill[i] = seg_beg[i];
+
+  for (int k=0; k<split_cnt; ++k) {
+    double *sp = sorted + 3 * fill[splits[k].seg]++;
+    sp[0] = splits[k].t; sp[1] = splits[k].p.x; sp[2] = splits[k].p.y;
+  }
+
+  delete[] fill;
+
+  for (int i=0; i<seg_cnt; ++i) {
+    qsort(sorted + 3 * seg_beg[i],seg_beg[i+1] - seg_beg[i],
+                              3 * sizeof(double),mink_split_cmp);
+  }
+
+  // Snap the points: points within snap of each other become one
+
+  int max_pnts = 2 * seg_cnt + split_cnt;
+
+  pnts = new Vec2[max_pnts > 0 ? max_pnts : 1];
+  pnt_cnt = 0;
+
+  int *raw_edges = new int[2 * (seg_cnt + split_cnt) + 1];
+  int raw_cnt = 0;
+
+  double snap = 0.01 * Vec2::IdentDist;
+
+  int bcnt = 16;
+  while (bcnt < max_pnts) bcnt *= 2;
+
+  int *bucket = new int[bcnt];
+  int *chain  = new int[max_pnts > 0 ? max_pnts : 1];
+  for (int b=0; b<bcnt; ++b) bucket[b] = -1;
+
+  for (int i=0; i<seg_cnt; ++i) {
+    int prv = -1;
+
+    for (int k=-1; k<=seg_beg[i+1] - seg_beg[i]; ++k) {
+      Vec2 p;
+
+      if (k < 0) p = segs[i].s;
+      else if (k == seg_beg[i+1] - seg_beg[i]) p = segs[i].e;
+      else {
+        const double *sp = sorted + 3 * (seg_beg[i] + k);
+        p = Vec2(sp[1],sp[2]);
+      }
+
+      int cx = (int)floor(p.x/snap), cy = (int)floor(p.y/snap);
+      int id = -1;
+
+      for (int dy=-1; dy<=1 && id<0; ++dy) {
+        for (int dx=-1; dx<=1 && id<0; ++dx) {
+          unsigned int h = ((unsigned)(cx+dx) * 73856093u ^
+                            (unsigned)(cy+dy) * 19349663u) & (bcnt-1);
+
+          for (int q=bucket[h]; q>=0; q=chain[q]) {
+            if (fabs(pnts[q].x - p.x) <= snap &&
+                fabs(pnts[q].y - p.y) <= snap) {
+              id = q; break;
+            }
+          }
+        }
+      }
+
+      if (id < 0) {
+        id = pnt_cnt++;
+        pnts[id] = p;
+
+        unsigned int h = ((unsigned)cx * 73856093u ^
+                          (unsigned)cy * 19349663u) & (bcnt-1);
+        chain[id] = bucket[h]; bucket[h] = id;
+      }
+
+      if (prv >= 0 && prv != id) {
+        raw_edges[2*raw_cnt] = prv; raw_edges[2*raw_cnt+1] = id;
+        raw_cnt++;
+      }
+
+      prv = id;
+    }
+  }
+
+  delete[] chain;
+  delete[] bucket;
+  delete[] sorted;
+  delete[] seg_beg;
+
+  // Same edges from overlapping segments once
+
+  qsort(raw_edges,raw_cnt,2 * sizeof(int),mink_edge_cmp);
+
+  edges = new int[2 * raw_cnt + 1];
+  edge_cnt = 0;
+
+  for (int k=0; k<raw_cnt; ++k) {
+    int id1 = raw_edges[2*k], id2 = raw_edges[2*k+1];
+
+    if (k > 0 && id1 == raw_edges[2*k-2] && id2 == raw_edges[2*k-1])
+                                                                continue;
+
+    const Vec2& p1 = pnts[id1];
+    const Vec2& p2 = pnts[id2];
+
+    Vec2 d = p2 - p1;
+    double len = d.len2();
+
+    double off = 1e-3 * len;
+    if (off > 0.1 * Vec2::IdentDist) off = 0.1 * Vec2::IdentDist;
+
+    Vec2 mid = (p1 + p2) * 0.5;
+    Vec2 lft(-d.y * off/len, d.x * off/len);
+
+    if (!in_sum(mid + lft) || in_sum(mid - lft)) continue;
+
+    edges[2*edge_cnt] = id1; edges[2*edge_cnt+1] = id2;
+    edge_cnt++;
+  }
+
+  delete[] raw_edges;
+  // Edges leaving each point
+
+  out_beg = new int[pnt_cnt + 1];
+  for (int p=0; p<=pnt_cnt; ++p) out_beg[p] = 0;
+
+  for (int k=0; k<edge_cnt; ++k) out_beg[edges[2*k] + 1]++;
+  for (int p=0; p<pnt_cnt; ++p) out_beg[p+1] += out_beg[p];
+
+  out_edges = new int[edge_cnt > 0 ? edge_cnt : 1];
+
+  int *ofill = new int[pnt_cnt > 0 ? pnt_cnt : 1];
+  for (int p=0; p<pnt_cnt; ++p) ofill[p] = out_beg[p];
+
+  for (int k=0; k<edge_cnt; ++k) out_edges[ofill[edges[2*k]]++] = k;
+
+  delete[] ofill;
+
+  used = new bool[edge_cnt > 0 ? edge_cnt : 1];
+  for (int k=0; k<edge_cnt; ++k) used[k] = false;
+
+  trace = new int[edge_cnt > 0 ? edge_cnt : 1];
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Find the boundary edges of the sum --------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Mink_Sum::Build()
+{
+  for (int na=0; na<nest_cnt; ++na) {
+    if (!of_first[na]) continue;
+
+    for (int nc=0; nc<nest_cnt; ++nc) {
+      if (of_first[nc]) continue;
+
+      add_conv(nests[na],nests[nc]);
+      add_conv(nests[nc],nests[na]);
+
+      add_paras(nests[na],nests[nc]);
+    }
+  }
+
+  // Cells of an eighth of the average parallelogram size
+
+  double size_sum = 0.0;
+
+  for (int k=0; k<para_cnt; ++k) {
+    const Para& pa = paras[k];
+    size_sum += pa.xmax - pa.xmin + pa.ymax - pa.ymin;
+  }
+
+  if (para_cnt > 0) {
+    para_grid.Build(paras,para_cnt,size_sum/para_cnt/8.0);
+
+    // Segments inside a parallelogram are inside the sum
+
+    int keep = 0;
+
+    for (int i=0; i<seg_cnt; ++i) {
+      if (!in_para(segs[i])) segs[keep++] = segs[i];
+    }
+
+    seg_cnt = keep;
+  }
+
+  split_all();
+  make_edges();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Next contour of the sum, material at the left ---------------- */
+/* ---------------------------------------------------------------------- */
+
+// Where contours meet in a point the sharpest left turn is taken, so
+// each one is traced on its own. Open chains (can only be left after a
+// near degenerate case) are dropped.
+
+bool Cont_Mink_Sum::Next_Loop(Elem_List& loop)
+{
+  loop.Delete();
+
+  for (int k0=0; k0<edge_cnt; ++k0) {
+    if (used[k0]) continue;
+
+    int *chain = trace;
+    int len = 0;
+
+    int k = k0;
+    bool closed = false;
+
+    for (;;) {
+      used[k] = true;
+      chain[len++] = k;
+
+      int at = edges[2*k+1];
+
+      if (at == edges[2*k0]) {
+        closed = true;
+        break;
+      }
+
+      const Vec2& p0 = pnts[edges[2*k]];
+      Vec2 d_in = pnts[at] - p0;
+
+      int best = -1;
+      double best_ang = 0.0;
+
+      for (int o=out_beg[at]; o<out_beg[at+1]; ++o) {
+        int kn = out_edges[o];
+        if (used[kn]) continue;
+
+        Vec2 d_out = pnts[edges[2*kn+1]] - pnts[at];
+
+        double ang = atan2(mink_cross(d_in,d_out),d_in * d_out);
+
+        if (best < 0 || ang > best_ang) {
+          best = kn; best_ang = ang;
+        }
+      }
+
+      if (best < 0) break;
+
+      k = best;
+    }
+
+    if (closed && len > 2) {
+
+      // Lines, consecutive collinear edges joined
+
+      int first = 0;
+
+      for (int i=0; i<len; ++i) {
+        int kp = chain[(i + len - 1) % len], kc = chain[i];
+
+        const Vec2& a = pnts[edges[2*kp]];
+        const Vec2& b = pnts[edges[2*kc]];
+        const Vec2& c = pnts[edges[2*kc+1]];
+
+        if (Geo_Orient(a,b,c) != 0 || (b - a) * (c - b) <= 0.0) {
+          first = i;
+          break;
+        }
+      }
+
+      int beg = edges[2*chain[first]];
+
+      for (int n=1; n<=len; ++n) {
+        int kc = chain[(first + n) % len];
+
+        const Vec2& b = pnts[edges[2*kc]];
+
+        if (n < len) {
+          const Vec2& a = pnts[beg];
+          const Vec2& c = pnts[edges[2*kc+1]];
+
+          if (Geo_Orient(a,b,c) == 0 && (b - a) * (c - b) > 0.0) continue;
+        }
+
+        loop.Push_Back(Elem_Line(Vec3(pnts[beg]),Vec3(b)));
+        beg = edges[2*kc];
+      }
+    }
+
+    if (loop.Length() > 2) return true;
+
+    loop.Delete();
+  }
+
+  return false;
+}
+
+/* ---------------------------------------------------------------------- */
+/** Minkowski sum of this area and another one.
+  \param ar2 The area to add.
+  \param tol Arcs of both areas are replaced by polygons within \c tol
+  outside of them, so the sum may be up to 2 \c tol too large.
+  \param into The sum, with the sense of this area.
+  \return \c false if the sum is empty.
+
+  The sum is the union of this area moved by every point of \c ar2.
+
+  Time and memory grow with the product of the vertex counts of both
+  areas after replacing the arcs, so a small \c tol gets expensive. Two
+  concave parts of 250 lines take about 0.5 s, of 1000 lines 10 to 20 s,
+  and two circles with \c tol 1e-5 (1500 and 900 vertices) 5 s.
+*/
+
+bool Cont_Area::Minkowski_Into(const Cont_Area& ar2, double tol,
+                                                Cont_Area& into) const
+{
+  if (&into == this || &into == &ar2) return false;
+
+  into.Delete();
+
+  if (Empty() || ar2.Empty()) return false;
+
+  Cont_Area ar1c(*this); if (!ar1c.lccw) ar1c.Reverse();
+  Cont_Area ar2c(ar2);   if (!ar2c.lccw) ar2c.Reverse();
+
+  Cont_Mink_Sum sum;
+
+  Cont_Nest_C_Cursor nsc(ar1c.nestlst);
+
+  for (;nsc;++nsc) {
+    Cont_Nest poly;
+    polygon_around(*nsc,tol,poly);
+
+    sum.Add_Nest(poly,true);
+  }
+
+  for (nsc = ar2c.nestlst.Begin(); nsc; ++nsc) {
+    Cont_Nest poly;
+    polygon_around(*nsc,tol,poly);
+
+    sum.Add_Nest(poly,false);
+  }
+
+  sum.Build();
+
+  Cont_Clsd_D_List clsd_list;
+  Cont_Clsd_Cursor cc(clsd_list);
+
+  Elem_List loop;
+
+  while (sum.Next_Loop(loop)) {
+    cc.To_End(); cc.Insert(Cont_Clsd());
+
+    loop.Move_To(cc->cont.el_list);
+
+    cc->cont.calc_invar();
+    cc->cont.is_closed = true;
+    cc->cont.Begin_Par(0.0);
+
+    cc->calc_invar();
+  }
+
+  into.build_from(clsd_list);
+
+  if (!lccw) into.Reverse();
+
+  into.Begin_Par(Begin_Par());
+  into.z = z;
+
+  return !into.Empty();
+}
+
+/* ---------------------------------------------------------------------- */
+/** No fit polygon of this (fixed) area and a moving one.
+  \param moving The moving area, positioned by its origin.
+  \param tol As with Minkowski_Into().
+  \param nfp The positions of the origin of \c moving at which it
+  overlaps this area (strictly inside \c nfp); on its contours they
+  touch.
+  \return \c false if \c nfp is empty or could not be built.
+*/
+
+bool Cont_Area::No_Fit_Into(const Cont_Area& moving, double tol,
+                                                  Cont_Area& nfp) const
+{
+  Cont_Area neg(moving);
+
+  neg.Transform(Trf2(-1.0,0.0,0.0, 0.0,-1.0,0.0));
+
+  return Minkowski_Into(neg,tol,nfp);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Cache of no fit polygons for nesting ------------------------- */
+/* ------- A part is placed by rotating it (radians, acw) around its ---- */
+/* ------- origin and then moving the origin to its position. The no ---- */
+/* ------- fit polygon of a pair is built on first use and kept: it ----- */
+/* ------- holds the positions of the moving part's origin (relative ---- */
+/* ------- to the fixed part's) at which the parts overlap, so a -------- */
+/* ------- placement test is a point in area test. Parts only touching -- */
+/* ------- do not overlap. ---------------------------------------------- */
+/* ------- Arcs of both parts are replaced by polygons within arc_tol --- */
+/* ------- outside of them, so a no fit polygon may be up to 2*arc_tol -- */
+/* ------- too large and parts that come closer than that may be -------- */
+/* ------- reported as overlapping. Not thread safe. -------------------- */
+/* ------- A no fit polygon costs a Minkowski_Into() of the parts, ------ */
+/* ------- which takes seconds for parts with about 1000 vertices, so --- */
+/* ------- keep arc_tol as coarse as the nesting allows. ---------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Nfp_Cache::Cont_Nfp_Cache(double arc_tol)
+: tol(arc_tol), parts(NULL), part_cnt(0), part_cap(0),
+  entries(NULL), entry_cnt(0), entry_cap(0),
+  buckets(NULL), bucket_msk(-1)
+{
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Nfp_Cache::~Cont_Nfp_Cache()
+{
+  Clear();
+
+  for (int i=0; i<part_cnt; ++i) delete parts[i].area;
+
+  delete[] parts;
+  delete[] entries;
+  delete[] buckets;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Forget the no fit polygons, keep the parts ------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Nfp_Cache::Clear()
+{
+  for (int i=0; i<entry_cnt; ++i) {
+    delete entries[i].prep;
+    delete entries[i].nfp;
+  }
+
+  entry_cnt = 0;
+
+  for (int b=0; b<=bucket_msk; ++b) buckets[b] = -1;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Add a part, false if its id is already there ----------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Nfp_Cache::Add_Part(int id, const Cont_Area& part)
+{
+  if (find_part(id)) return false;
+
+  if (part_cnt >= part_cap) {
+    int new_cap = part_cap < 16 ? 16 : 2 * part_cap;
+
+    Part *new_parts = new Part[new_cap];
+    for (int i=0; i<part_cnt; ++i) new_parts[i] = parts[i];
+
+    delete[] parts;
+    parts = new_parts; part_cap = new_cap;
+  }
+
+  parts[part_cnt].id = id;
+  parts[part_cnt].area = new Cont_Area(part);
+  part_cnt++;
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+
+const Cont_Nfp_Cache::Part *Cont_Nfp_Cache::find_part(int id) const
+{
+  for (int i=0; i<part_cnt; ++i) {
+    if (parts[i].id == id) return parts + i;
+  }
+
+  return NULL;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Bucket of the entry, or else the free bucket to put it in ---- */
+/* ---------------------------------------------------------------------- */
+
+int Cont_Nfp_Cache::find_bucket(int fixed_id, double fixed_rot,
+                                int moving_id, double moving_rot) const
+{
+  double key[4] = { (double)fixed_id, fixed_rot,
+                    (double)moving_id, moving_rot };
+
+  // FNV-1a over the key
+
+  const unsigned char *kp = (const unsigned char *)key;
+  unsigned int hash = 2166136261u;
+
+  for (unsigned int i=0; i<sizeof(key); ++i) {
+    hash ^= kp[i];
+    hash *= 16777619u;
+  }
+
+  int b = (int)(hash & bucket_msk);
+
+  for (;;) {
+    int idx = buckets[b];
+    if (idx < 0) return b;
+
+    const Entry& ent = entries[idx];
+
+    if (ent.fixed_id == fixed_id && ent.fixed_rot == fixed_rot &&
+        ent.moving_id == moving_id && ent.moving_rot == moving_rot)
+                                                               return b;
+
+    b = (b + 1) & bucket_msk;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Nfp_Cache::rehash(int new_cap)
+{
+  delete[] buckets;
+
+  buckets = new int[new_cap];
+  bucket_msk = new_cap - 1;
+
+  for (int b=0; b<new_cap; ++b) buckets[b] = -1;
+
+  for (int i=0; i<entry_cnt; ++i) {
+    const Entry& ent = entries[i];
+
+    buckets[find_bucket(ent.fixed_id,ent.fixed_rot,
+                        ent.moving_id,ent.moving_rot)] = i;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- No fit polygon of a moving part against a fixed one, both ---- */
+/* ------- rotated (radians, acw) around their origin. Built on first --- */
+/* ------- use; NULL if a part is unknown. ------------------------------ */
+/* ---------------------------------------------------------------------- */
+
+const Cont_Area *Cont_Nfp_Cache::Nfp(int fixed_id, double fixed_rot,
+                                     int moving_id, double moving_rot)
+{
+  if (fixed_rot == 0.0) fixed_rot = 0.0;    // No -0.0 in the key
+  if (moving_rot == 0.0) moving_rot = 0.0;
+
+  if (entry_cnt > 0) {
+    int idx = buckets[find_bucket(fixed_id,fixed_rot,moving_id,moving_rot)];
+    if (idx >= 0) return entries[idx].nfp;
+  }
+
+  const Part *fixed_part  = find_part(fixed_id);
+  const Part *moving_part = find_part(moving_id);
+
+  if (!fixed_part || !moving_part) return NULL;
+
+  Cont_Area fixed(*fixed_part->area);
+  Cont_Area moving(*moving_part->area);
+
+  if (fixed_rot != 0.0) {
+    double c = cos(fixed_rot), s = sin(fixed_rot);
+    fixed.Transform(Trf2(c,-s,0.0, s,c,0.0));
+  }
+
+  if (moving_rot != 0.0) {
+    double c = cos(moving_rot), s = sin(moving_rot);
+    moving.Transform(Trf2(c,-s,0.0, s,c,0.0));
+  }
+
+  Cont_Area *nfp = new Cont_Area;
+  fixed.No_Fit_Into(moving,tol,*nfp);
+
+  if (entry_cnt >= entry_cap) {
+    int new_cap = entry_cap < 16 ? 16 : 2 * entry_cap;
+
+    Entry *new_entries = new Entry[new_cap];
+    for (int i=0; i<entry_cnt; ++i) new_entries[i] = entries[i];
+
+    delete[] entries;
+    entries = new_entries; entry_cap = new_cap;
+  }
+
+  // Keep the load factor at most one half
+
+  if (2 * (entry_cnt + 1) > bucket_msk + 1)
+                 rehash(bucket_msk < 0 ? 32 : 2 * (bucket_msk + 1));
+
+  Entry& ent = entries[entry_cnt];
+
+  ent.fixed_id  = fixed_id;  ent.fixed_rot  = fixed_rot;
+  ent.moving_id = moving_id; ent.moving_rot = moving_rot;
+  ent.nfp  = nfp;
+  ent.prep = nfp->Empty() ? NULL : new Cont_Prepared(*nfp);
+
+  buckets[find_bucket(fixed_id,fixed_rot,moving_id,moving_rot)] = entry_cnt;
+  entry_cnt++;
+
+  return nfp;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Do two placed parts overlap? Touching is not overlapping ----- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Nfp_Cache::Overlap(int fixed_id, double fixed_rot,
+                             const Vec2& fixed_pos,
+                             int moving_id, double moving_rot,
+                             const Vec2& moving_pos)
+{
+  if (!Nfp(fixed_id,fixed_rot,moving_id,moving_rot)) return false;
+
+  if (fixed_rot == 0.0) fixed_rot = 0.0;
+  if (moving_rot == 0.0) moving_rot = 0.0;
+
+  const Entry& ent =
+     entries[buckets[find_bucket(fixed_id,fixed_rot,moving_id,moving_rot)]];
+
+  if (!ent.prep) return false;
+
+  bool on_cnt = false;
+  bool inside = ent.prep->Pnt_Inside(moving_pos - fixed_pos,on_cnt);
+
+  return inside && !on_cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- R-tree over contour or area rectangles ----------------------- */
+/* ------- Item ids are chosen by the caller, Build() from a list uses -- */
+/* ------- the position in the list. Build() loads the tree at once ----- */
+/* ------- (sort tile recursive), Insert() and Remove() keep it up to --- */
+/* ------- date afterwards, Remove() needs the rectangle the item was --- */
+/* ------- inserted with. ----------------------------------------------- */
+/* ------- Rectangles are compared as Rect_Ax::Intersects_XY(rct,tol), -- */
+/* ------- distances as Rect_Ax::Dist_To_XY(). Window() returns the ----- */
+/* ------- ids ascending, Overlap_Pairs() returns id pairs -------------- */
+/* ------- (pairs[2*i], pairs[2*i+1]) ascending, with the smaller id ---- */
+/* ------- first within the tree or with the id of this tree first ------ */
+/* ------- against another one. Near::Next() returns the items in ------- */
+/* ------- order of ascending distance to the point, equal distances ---- */
+/* ------- by ascending id. --------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+static void rtree_push(IB_Int_Arr& arr, int& cnt, int val)
+{
+  if (cnt >= (int)arr.Size()) arr.Size(cnt < 32 ? 64 : 2*cnt);
+
+  arr[cnt++] = val;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int rtree_id_cmp(const void *i1, const void *i2)
+{
+  int id1 = *(const int *)i1, id2 = *(const int *)i2;
+
+  if (id1 < id2) return -1;
+  if (id1 > id2) return 1;
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static int rtree_pair_cmp(const void *p1, const void *p2)
+{
+  const int *pr1 = (const int *)p1, *pr2 = (const int *)p2;
+
+  if (pr1[0] != pr2[0]) return pr1[0] < pr2[0] ? -1 : 1;
+  if (pr1[1] != pr2[1]) return pr1[1] < pr2[1] ? -1 : 1;
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::ent_x_cmp(const void *e1, const void *e2)
+{
+  const Box& b1 = ((const Ent *)e1)->b;
+  const Box& b2 = ((const Ent *)e2)->b;
+
+  double c1 = b1.lx + b1.hx, c2 = b2.lx + b2.hx;
+
+  if (c1 < c2) return -1;
+  if (c1 > c2) return 1;
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::ent_y_cmp(const void *e1, const void *e2)
+{
+  const Box& b1 = ((const Ent *)e1)->b;
+  const Box& b2 = ((const Ent *)e2)->b;
+
+  double c1 = b1.ly + b1.hy, c2 = b2.ly + b2.hy;
+
+  if (c1 < c2) return -1;
+  if (c1 > c2) return 1;
+  return 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same test as Rect_Ax::Intersects_XY(), a taken as this ------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::meet(const Box& a, const Box& b, double tol)
+{
+  tol += tol;
+
+  if (a.hx < b.lx-tol || a.lx > b.hx+tol) return false;
+  if (a.hy < b.ly-tol || a.ly > b.hy+tol) return false;
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Same distance as Rect_Ax::Dist_To_XY() ----------------------- */
+/* ---------------------------------------------------------------------- */
+
+double Cont_Rtree::dist(const Box& b, const Vec2& p)
+{
+  Vec2 d(0,0);
+
+  if      (p.x <= b.lx) d.x = b.lx - p.x;
+  else if (p.x >= b.hx) d.x = p.x  - b.hx;
+
+  if      (p.y <= b.ly) d.y = b.ly - p.y;
+  else if (p.y >= b.hy) d.y = p.y  - b.hy;
+
+  return d.len2();
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::Box Cont_Rtree::box_of(const Rect_Ax& rct)
+{
+  Box b;
+
+  b.lx = rct.Ll().x; b.ly = rct.Ll().y;
+  b.hx = rct.Ur().x; b.hy = rct.Ur().y;
+
+  return b;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::Cont_Rtree()
+: nodes(NULL), node_cnt(0), node_cap(0), free_nodes(-1), root(-1),
+  item_cnt(0)
+{
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::~Cont_Rtree()
+{
+  if (nodes) delete[] nodes;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Delete()
+{
+  node_cnt   = 0;
+  free_nodes = -1;
+  root       = -1;
+  item_cnt   = 0;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Node from the free chain or else a new one ------------------- */
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::new_node(bool leaf)
+{
+  int n = free_nodes;
+
+  if (n >= 0) free_nodes = nodes[n].parent;
+  else {
+    if (node_cnt >= node_cap) {
+      int new_cap = node_cap < 16 ? 16 : node_cap * 2;
+
+      Node *new_nodes = new Node[new_cap];
+
+      for (int i=0; i<node_cnt; ++i) new_nodes[i] = nodes[i];
+
+      if (nodes) delete[] nodes;
+
+      nodes = new_nodes; node_cap = new_cap;
+    }
+
+    n = node_cnt++;
+  }
+
+  nodes[n].cnt    = 0;
+  nodes[n].leaf   = leaf;
+  nodes[n].parent = -1;
+
+  return n;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::free_node(int n)
+{
+  nodes[n].cnt    = 0;
+  nodes[n].parent = free_nodes;
+  free_nodes = n;
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::Box Cont_Rtree::node_box(int n) const
+{
+  const Node& nd = nodes[n];
+
+  Box b = nd.box[0];
+
+  for (int i=1; i<nd.cnt; ++i) {
+    const Box& c = nd.box[i];
+
+    if (c.lx < b.lx) b.lx = c.lx;
+    if (c.ly < b.ly) b.ly = c.ly;
+    if (c.hx > b.hx) b.hx = c.hx;
+    if (c.hy > b.hy) b.hy = c.hy;
+  }
+
+  return b;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Sort tile recursive load, level by level: sort on x, cut ----- */
+/* ------- into vertical slices, sort those on y and fill nodes --------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::bulk_load(Ent *ents, int cnt)
+{
+  Delete();
+
+  item_cnt = cnt;
+  if (cnt < 1) return;
+
+  bool leaf = true;
+
+  for (;;) {
+    if (cnt <= Max_Fill) {
+      root = new_node(leaf);
+
+      for (int i=0; i<cnt; ++i) {
+        nodes[root].box[i] = ents[i].b;
+        nodes[root].ref[i] = ents[i].ref;
+
+        if (!leaf) nodes[ents[i].ref].parent = root;
+      }
+
+      nodes[root].cnt = cnt;
+      break;
+    }
+
+    int lvl_nodes = (cnt + Max_Fill - 1) / Max_Fill;
+    int slice_len = (int)ceil(sqrt((double)lvl_nodes)) * Max_Fill;
+
+    qsort(ents,cnt,sizeof(Ent),ent_x_cmp);
+
+    int out = 0; // Nodes made so far, never beyond the entries used
+
+    for (int s=0; s<cnt; s+=slice_len) {
+      int se = s + slice_len; if (se > cnt) se = cnt;
+
+      qsort(ents+s,se-s,sizeof(Ent),ent_y_cmp);
+
+      for (int b=s; b<se; b+=Max_Fill) {
+        int be = b + Max_Fill; if (be > se) be = se;
+
+        int n = new_node(leaf);
+        Node& nd = nodes[n];
+
+        for (int i=b; i<be; ++i) {
+          nd.box[nd.cnt] = ents[i].b;
+          nd.ref[nd.cnt] = ents[i].ref;
+          ++nd.cnt;
+
+          if (!leaf) nodes[ents[i].ref].parent = n;
+        }
+
+        ents[out].b   = node_box(n);
+        ents[out].ref = n;
+        ++out;
+      }
+    }
+
+    cnt  = out;
+    leaf = false;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Build(const Rect_Ax *rects, int cnt)
+{
+  Ent *ents = new Ent[cnt > 0 ? cnt : 1];
+
+  for (int i=0; i<cnt; ++i) {
+    ents[i].b   = box_of(rects[i]);
+    ents[i].ref = i;
+  }
+
+  bulk_load(ents,cnt);
+
+  delete[] ents;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Build(const Cont_List& lst)
+{
+  Ent *ents = new Ent[lst.List().Length()+1];
+  int idx = 0;
+
+  Cont_C_Cursor cc(lst.List());
+
+  for (;cc;++cc,++idx) {
+    ents[idx].b   = box_of(cc->Rect());
+    ents[idx].ref = idx;
+  }
+
+  bulk_load(ents,idx);
+
+  delete[] ents;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Build(const Cont_Area_List& lst)
+{
+  Ent *ents = new Ent[lst.Length()+1];
+  int idx = 0;
+
+  Cont_Area_C_Cursor ac(lst);
+
+  for (;ac;++ac,++idx) {
+    ents[idx].b   = box_of(ac->Rect());
+    ents[idx].ref = idx;
+  }
+
+  bulk_load(ents,idx);
+
+  delete[] ents;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Leaf needing the least enlargement for b --------------------- */
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::choose_leaf(const Box& b) const
+{
+  int n = root;
+
+  while (!nodes[n].leaf) {
+    const Node& nd = nodes[n];
+
+    int best = 0;
+    double best_grow = 0.0, best_area = 0.0;
+
+    for (int i=0; i<nd.cnt; ++i) {
+      const Box& c = nd.box[i];
+
+      double area = (c.hx - c.lx) * (c.hy - c.ly);
+
+      double ulx = c.lx < b.lx ? c.lx : b.lx;
+      double uly = c.ly < b.ly ? c.ly : b.ly;
+      double uhx = c.hx > b.hx ? c.hx : b.hx;
+      double uhy = c.hy > b.hy ? c.hy : b.hy;
+
+      double grow = (uhx - ulx) * (uhy - uly) - area;
+
+      if (i == 0 || grow < best_grow ||
+                           (grow == best_grow && area < best_area)) {
+        best = i; best_grow = grow; best_area = area;
+      }
+    }
+
+    n = nd.ref[best];
+  }
+
+  return n;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Add an entry to node n, split it if it is overfull ----------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::add_entry(int n, const Box& b, int ref)
+{
+  Node& nd = nodes[n];
+
+  nd.box[nd.cnt] = b;
+  nd.ref[nd.cnt] = ref;
+  ++nd.cnt;
+
+  if (!nd.leaf) nodes[ref].parent = n;
+
+  if (nd.cnt > Max_Fill) split(n);
+  else adjust(n);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split an overfull node in halves along the axis with the ----- */
+/* ------- largest spread of entry centres ------------------------------ */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::split(int n)
+{
+  int m = new_node(nodes[n].leaf);
+
+  Node& nd = nodes[n];
+  Node& md = nodes[m];
+
+  double clx = 0.0, chx = 0.0, cly = 0.0, chy = 0.0;
+
+  for (int i=0; i<nd.cnt; ++i) {
+    double cx = nd.box[i].lx + nd.box[i].hx;
+    double cy = nd.box[i].ly + nd.box[i].hy;
+
+    if (i == 0 || cx < clx) clx = cx;
+    if (i == 0 || cx > chx) chx = cx;
+    if (i == 0 || cy < cly) cly = cy;
+    if (i == 0 || cy > chy) chy = cy;
+  }
+
+  bool on_x = chx - clx >= chy - cly;
+
+  for (int i=1; i<nd.cnt; ++i) {  // Insertion sort on the centres
+    Box b = nd.box[i];
+    int ref = nd.ref[i];
+
+    double c = on_x ? b.lx + b.hx : b.ly + b.hy;
+
+    int j = i;
+
+    for (;j > 0; --j) {
+      const Box& pb = nd.box[j-1];
+      double pc = on_x ? pb.lx + pb.hx : pb.ly + pb.hy;
+
+      if (pc <= c) break;
+
+      nd.box[j] = nd.box[j-1];
+      nd.ref[j] = nd.ref[j-1];
+    }
+
+    nd.box[j] = b;
+    nd.ref[j] = ref;
+  }
+
+  int keep = nd.cnt / 2;
+
+  for (int i=keep; i<nd.cnt; ++i) {
+    md.box[md.cnt] = nd.box[i];
+    md.ref[md.cnt] = nd.ref[i];
+    ++md.cnt;
+
+    if (!md.leaf) nodes[nd.ref[i]].parent = m;
+  }
+
+  nd.cnt = keep;
+
+  if (n == root) {
+    int r = new_node(false);
+
+    nodes[r].box[0] = node_box(n); nodes[r].ref[0] = n;
+    nodes[r].box[1] = node_box(m); nodes[r].ref[1] = m;
+    nodes[r].cnt = 2;
+
+    nodes[n].parent = nodes[m].parent = r;
+    root = r;
+    return;
+  }
+
+  int p = nodes[n].parent;
+  Node& pd = nodes[p];
+
+  for (int i=0; i<pd.cnt; ++i) {
+    if (pd.ref[i] == n) {
+      pd.box[i] = node_box(n);
+      break;
+    }
+  }
+
+  add_entry(p,node_box(m),m);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Update the boxes of n's ancestors ---------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::adjust(int n)
+{
+  while (nodes[n].parent >= 0) {
+    int p = nodes[n].parent;
+    Node& pd = nodes[p];
+
+    Box b = node_box(n);
+
+    int i = 0;
+    while (pd.ref[i] != n) ++i;
+
+    Box& c = pd.box[i];
+
+    if (c.lx == b.lx && c.ly == b.ly && c.hx == b.hx && c.hy == b.hy)
+      break;
+
+    c = b;
+    n = p;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::insert_item(const Box& b, int id)
+{
+  if (root < 0) root = new_node(true);
+
+  add_entry(choose_leaf(b),b,id);
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Insert(int id, const Rect_Ax& rct)
+{
+  insert_item(box_of(rct),id);
+  ++item_cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Leaf and index of an item, searching boxes holding b --------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::find_item(int n, const Box& b, int id,
+                           int& leaf, int& idx) const
+{
+  const Node& nd = nodes[n];
+
+  for (int i=0; i<nd.cnt; ++i) {
+    const Box& c = nd.box[i];
+
+    if (nd.leaf) {
+      if (nd.ref[i] == id && c.lx == b.lx && c.ly == b.ly &&
+                             c.hx == b.hx && c.hy == b.hy) {
+        leaf = n; idx = i;
+        return true;
+      }
+    }
+    else if (c.lx <= b.lx && c.ly <= b.ly && c.hx >= b.hx && c.hy >= b.hy) {
+      if (find_item(nd.ref[i],b,id,leaf,idx)) return true;
+    }
+  }
+
+  return false;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Take the items below n and free the nodes -------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::collect_items(int n, Box *&bxs, int *&ids,
+                               int& cnt, int& cap)
+{
+  const Node& nd = nodes[n];
+
+  for (int i=0; i<nd.cnt; ++i) {
+    if (!nd.leaf) {
+      collect_items(nd.ref[i],bxs,ids,cnt,cap);
+      continue;
+    }
+
+    if (cnt >= cap) {
+      int new_cap = cap < 16 ? 16 : cap * 2;
+
+      Box *new_bxs = new Box[new_cap];
+      int *new_ids = new int[new_cap];
+
+      for (int j=0; j<cnt; ++j) {
+        new_bxs[j] = bxs[j];
+        new_ids[j] = ids[j];
+      }
+
+      if (bxs) delete[] bxs;
+      if (ids) delete[] ids;
+
+      bxs = new_bxs; ids = new_ids; cap = new_cap;
+    }
+
+    bxs[cnt] = nd.box[i];
+    ids[cnt] = nd.ref[i];
+    ++cnt;
+  }
+
+  free_node(n);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Remove an item; underfull nodes on the way up are taken ------ */
+/* ------- out and their items inserted again --------------------------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::Remove(int id, const Rect_Ax& rct)
+{
+  if (root < 0) return false;
+
+  int n = -1, idx = -1;
+
+  if (!find_item(root,box_of(rct),id,n,idx)) return false;
+
+  Node& ld = nodes[n];
+
+  --ld.cnt;
+  ld.box[idx] = ld.box[ld.cnt];
+  ld.ref[idx] = ld.ref[ld.cnt];
+
+  --item_cnt;
+
+  Box *bxs = NULL;
+  int *ids = NULL;
+  int cnt = 0, cap = 0;
+
+  while (n != root) {
+    int p = nodes[n].parent;
+    Node& pd = nodes[p];
+
+    int i = 0;
+    while (pd.ref[i] != n) ++i;
+
+    if (nodes[n].cnt < Min_Fill) {
+      --pd.cnt;
+      pd.box[i] = pd.box[pd.cnt];
+      pd.ref[i] = pd.ref[pd.cnt];
+
+      collect_items(n,bxs,ids,cnt,cap);
+    }
+    else pd.box[i] = node_box(n);
+
+    n = p;
+  }
+
+  while (!nodes[root].leaf && nodes[root].cnt == 1) {
+    int r = nodes[root].ref[0];
+
+    free_node(root);
+    root = r;
+    nodes[root].parent = -1;
+  }
+
+  if (nodes[root].cnt < 1) {
+    free_node(root);
+    root = -1;
+  }
+
+  for (int i=0; i<cnt; ++i) insert_item(bxs[i],ids[i]);
+
+  if (bxs) delete[] bxs;
+  if (ids) delete[] ids;
+
+  return true;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Items whose rectangle meets rct ------------------------------ */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::window(int n, const Box& b, double tol,
+                        IB_Int_Arr& ids, int& cnt) const
+{
+  const Node& nd = nodes[n];
+
+  for (int i=0; i<nd.cnt; ++i) {
+    if (!meet(nd.box[i],b,tol)) continue;
+
+    if (nd.leaf) rtree_push(ids,cnt,nd.ref[i]);
+    else window(nd.ref[i],b,tol,ids,cnt);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::Window(const Rect_Ax& rct, double tol, IB_Int_Arr& ids) const
+{
+  int cnt = 0;
+
+  if (root >= 0) window(root,box_of(rct),tol,ids,cnt);
+
+  if (cnt > 1) qsort((int *)ids,cnt,sizeof(int),rtree_id_cmp);
+
+  return cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Pairs of items below two nodes, of this and another tree ----- */
+/* ------- (or the same); ordered keeps this tree's id first ------------ */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::cross_pairs(int a, const Cont_Rtree& other, int b,
+                             double tol, bool ordered,
+                             IB_Int_Arr& pairs, int& cnt) const
+{
+  const Node& na = nodes[a];
+  const Node& nb = other.nodes[b];
+
+  if (na.leaf && nb.leaf) {
+    for (int i=0; i<na.cnt; ++i) {
+      for (int j=0; j<nb.cnt; ++j) {
+        if (!meet(na.box[i],nb.box[j],tol)) continue;
+
+        int id1 = na.ref[i], id2 = nb.ref[j];
+
+        if (!ordered && id2 < id1) { id1 = nb.ref[j]; id2 = na.ref[i]; }
+
+        rtree_push(pairs,cnt,id1);
+        rtree_push(pairs,cnt,id2);
+      }
+    }
+  }
+  else if (na.leaf) {  // The trees differ in height
+    Box ba = node_box(a);
+
+    for (int j=0; j<nb.cnt; ++j) {
+      if (meet(ba,nb.box[j],tol))
+        cross_pairs(a,other,nb.ref[j],tol,ordered,pairs,cnt);
+    }
+  }
+  else if (nb.leaf) {
+    Box bb = other.node_box(b);
+
+    for (int i=0; i<na.cnt; ++i) {
+      if (meet(na.box[i],bb,tol))
+        cross_pairs(na.ref[i],other,b,tol,ordered,pairs,cnt);
+    }
+  }
+  else {
+    for (int i=0; i<na.cnt; ++i) {
+      for (int j=0; j<nb.cnt; ++j) {
+        if (meet(na.box[i],nb.box[j],tol))
+          cross_pairs(na.ref[i],other,nb.ref[j],tol,ordered,pairs,cnt);
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Pairs of different items below one node ---------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::self_pairs(int n, double tol,
+                            IB_Int_Arr& pairs, int& cnt) const
+{
+  const Node& nd = nodes[n];
+
+  for (int i=0; i<nd.cnt; ++i) {
+    for (int j=i+1; j<nd.cnt; ++j) {
+      if (!meet(nd.box[i],nd.box[j],tol)) continue;
+
+      if (nd.leaf) {
+        int id1 = nd.ref[i], id2 = nd.ref[j];
+
+        if (id2 < id1) { id1 = nd.ref[j]; id2 = nd.ref[i]; }
+
+        rtree_push(pairs,cnt,id1);
+        rtree_push(pairs,cnt,id2);
+      }
+      else cross_pairs(nd.ref[i],*this,nd.ref[j],tol,false,pairs,cnt);
+    }
+
+    if (!nd.leaf) self_pairs(nd.ref[i],tol,pairs,cnt);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::Overlap_Pairs(double tol, IB_Int_Arr& pairs) const
+{
+  int cnt = 0;
+
+  if (root >= 0) self_pairs(root,tol,pairs,cnt);
+
+  cnt /= 2;
+  if (cnt > 1) qsort((int *)pairs,cnt,2*sizeof(int),rtree_pair_cmp);
+
+  return cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int Cont_Rtree::Overlap_Pairs(const Cont_Rtree& other, double tol,
+                              IB_Int_Arr& pairs) const
+{
+  int cnt = 0;
+
+  if (root >= 0 && other.root >= 0)
+    cross_pairs(root,other,other.root,tol,true,pairs,cnt);
+
+  cnt /= 2;
+  if (cnt > 1) qsort((int *)pairs,cnt,2*sizeof(int),rtree_pair_cmp);
+
+  return cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::Nearest(const Vec2& p, int& id, double& dist) const
+{
+  Near near(*this,p);
+
+  return near.Next(id,dist);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Best first search: a heap of nodes and items by distance ----- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::Near::Near(const Cont_Rtree& tr, const Vec2& pnt)
+: tree(tr), p(pnt), heap(NULL), heap_cnt(0), heap_cap(0)
+{
+  if (tree.root >= 0) push(0.0,tree.root,false);
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Rtree::Near::~Near()
+{
+  if (heap) delete[] heap;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Nodes go before items at the same distance, so all items ----- */
+/* ------- at that distance are known before the first is returned ------ */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::Near::before(const Cand& a, const Cand& b)
+{
+  if (a.dist != b.dist) return a.dist < b.dist;
+  if (a.item != b.item) return !a.item;
+  return a.ref < b.ref;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Rtree::Near::push(double dist, int ref, bool item)
+{
+  if (heap_cnt >= heap_cap) {
+    int new_cap = heap_cap < 32 ? 64 : heap_cap * 2;
+
+    Cand *new_heap = new Cand[new_cap];
+
+    for (int i=0; i<heap_cnt; ++i) new_heap[i] = heap[i];
+
+    if (heap) delete[] heap;
+
+    heap = new_heap; heap_cap = new_cap;
+  }
+
+  Cand c;
+  c.dist = dist; c.ref = ref; c.item = item;
+
+  int i = heap_cnt++;
+
+  while (i > 0) {
+    int par = (i - 1) / 2;
+
+    if (!before(c,heap[par])) break;
+
+    heap[i] = heap[par];
+    i = par;
+  }
+
+  heap[i] = c;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Rtree::Near::Next(int& id, double& dist)
+{
+  while (heap_cnt > 0) {
+    Cand top = heap[0];
+    Cand last = heap[--heap_cnt];
+
+    int i = 0;
+
+    for (;;) {
+      int ch = 2*i + 1;
+      if (ch >= heap_cnt) break;
+
+      if (ch+1 < heap_cnt && before(heap[ch+1],heap[ch])) ++ch;
+
+      if (!before(heap[ch],last)) break;
+
+      heap[i] = heap[ch];
+      i = ch;
+    }
+
+    if (heap_cnt > 0) heap[i] = last;
+
+    if (top.item) {
+      id   = top.ref;
+      dist = top.dist;
+      return true;
+    }
+
+    const Node& nd = tree.nodes[top.ref];
+
+    for (int j=0; j<nd.cnt; ++j)
+      push(Cont_Rtree::dist(nd.box[j],p),nd.ref[j],nd.leaf);
+  }
+
+  return false;
+}
+
 } // namespace Ino
   
 /* ---------------------------------------------------------------------- */
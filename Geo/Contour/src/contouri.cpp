@@ -9,7 +9,12 @@
 
 #include "contouri.hi"
 #include "cntpanic.hi"
+#include "El_Line.h"
+#include "El_Arc.h"
+#include "El_Cir.h"
+
 #include <math.h>
+#include <string.h>
 
 namespace Ino
 {
@@ -23,6 +28,12 @@ bool Pt_Inside(const Vec2& p, const Cont_Clsd& cnt, bool& on_cnt)
   on_cnt = false;
 
   if (cnt.Rect().Point_Inside(p,Vec2::IdentDist)) {
+    bool prep_in = false;
+
+    // Repeated tests use the slab index unless p is (almost) on the contour
+
+    if (((const Contour&)cnt).prepared_inside(p,prep_in)) return prep_in;
+
     Cont_Pnt pnt;
     double   dist;
 
@@ -260,6 +271,327 @@ bool Cnt_Inside(const Contour& cnt, const Cont_Area& ar,
   return false;
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Slab index for fast repeated point in contour tests ---------- */
+/* ---------------------------------------------------------------------- */
+/* ------- The elements are split into y-monotone pieces (lines and ----- */
+/* ------- left or right halves of circle arcs) that are distributed ---- */
+/* ------- over horizontal bands. A point is inside if a ray in +x ------ */
+/* ------- direction crosses an odd number of pieces, only the pieces --- */
+/* ------- of the band of the point need to be examined. ---------------- */
+/* ---------------------------------------------------------------------- */
+
+Cont_Slabs::Cont_Slabs(double dist_tol)
+: pcs(NULL), pc_sz(0), pc_cap(0), band_beg(NULL), band_pcs(NULL),
+  bands(0), y_base(0.0), band_h(1.0), tol(dist_tol), usable(true)
+{
+}
+
+/* ---------------------------------------------------------------------- */
+
+Cont_Slabs::~Cont_Slabs()
+{
+  delete[] pcs;
+  delete[] band_beg;
+  delete[] band_pcs;
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Slabs::add_piece(double x1, double y1, double x2, double y2,
+                               double cx, double cy, double r, int side)
+{
+  if (pc_sz >= pc_cap) {
+    int new_cap = pc_cap < 16 ? 16 : pc_cap * 2;
+
+    Piece *new_pcs = new Piece[new_cap];
+    if (pc_sz > 0) memcpy(new_pcs,pcs,pc_sz*sizeof(Piece));
+
+    delete[] pcs;
+    pcs    = new_pcs;
+    pc_cap = new_cap;
+  }
+
+  Piece& pc = pcs[pc_sz++];
+
+  pc.x1 = x1; pc.y1 = y1; pc.x2 = x2; pc.y2 = y2;
+  pc.cx = cx; pc.cy = cy; pc.r  = r;
+
+  pc.side = side;
+
+  // A half circle piece bulges beyond its end points in x
+
+  pc.xmin = x1 < x2 ? x1 : x2;
+  pc.xmax = x1 < x2 ? x2 : x1;
+
+  if (side > 0)      pc.xmax = cx + r;
+  else if (side < 0) pc.xmin = cx - r;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Split arc at top and bottom of its circle -------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Slabs::add_arc(const Vec2& p1, const Vec2& p2, const Vec2& c,
+                                          double r, bool ccw, bool full)
+{
+  const double half_pi = M_PI / 2.0;
+
+  double a1 = atan2(p1.y - c.y, p1.x - c.x);
+  double a2 = atan2(p2.y - c.y, p2.x - c.x);
+
+  double span = ccw ? a2 - a1 : a1 - a2;
+
+  if (full) span = 2.0 * M_PI;
+  else {
+    while (span <= 0.0)       span += 2.0 * M_PI;
+    while (span > 2.0 * M_PI) span -= 2.0 * M_PI;
+  }
+
+  double dir = ccw ? 1.0 : -1.0;
+
+  // Breaks are at odd multiples of pi/2, k counts them from a1 on
+
+  double k = ccw ? floor((a1 - half_pi) / M_PI) + 1.0
+                 : ceil ((a1 - half_pi) / M_PI) - 1.0;
+
+  Vec2   pp(p1);
+  double pa = a1;
+
+  for (;;) {
+    double ba = half_pi + k * M_PI;
+    double ds = (ba - a1) * dir;
+
+    bool last = ds >= span;
+
+    Vec2 bp(p2);
+
+    if (!last) { // Top for even k, bottom for odd k
+      bool even = fmod(fabs(k),2.0) < 0.5;
+
+      bp.x = c.x;
+      bp.y = even ? c.y + r : c.y - r;
+    }
+
+    double ma = last ? (pa + a1 + span*dir) / 2.0 : (pa + ba) / 2.0;
+
+    add_piece(pp.x,pp.y,bp.x,bp.y,c.x,c.y,r,cos(ma) >= 0.0 ? 1 : -1);
+
+    if (last) break;
+
+    pp = bp;
+    pa = ba;
+    k += dir;
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+void Cont_Slabs::Add(const Elem_List& el_list)
+{
+  Elem_C_Cursor elc(el_list);
+
+  for (;elc;++elc) {
+    const Elem& el = elc->El();
+
+    switch (el.Type()) {
+      case Elem_Type_Line:
+        add_piece(el.P1().x,el.P1().y,el.P2().x,el.P2().y,0.0,0.0,0.0,0);
+      break;
+
+      case Elem_Type_Arc: {
+        const Elem_Arc& arc = (const Elem_Arc&)el;
+        add_arc(arc.P1(),arc.P2(),arc.C(),arc.R(),arc.Ccw(),false);
+      }
+      break;
+
+      case Elem_Type_Circle: {
+        const Elem_Circle& cir = (const Elem_Circle&)el;
+        add_arc(cir.P1(),cir.P2(),cir.C(),cir.R(),cir.Ccw(),true);
+      }
+      break;
+
+      default:
+        usable = false; // Unknown element type
+      break;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Distribute the pieces over bands ----------------------------- */
+/* ---------------------------------------------------------------------- */
+
+void Cont_Slabs::Build()
+{
+  delete[] band_beg; band_beg = NULL;
+  delete[] band_pcs; band_pcs = NULL;
+  bands = 0;
+
+  if (!usable || pc_sz < 1) return;
+
+  double ymin = pcs[0].y1, ymax = ymin;
+
+  for (int i=0; i<pc_sz; ++i) {
+    const Piece& pc = pcs[i];
+
+    if (pc.y1 < ymin) ymin = pc.y1;
+    if (pc.y1 > ymax) ymax = pc.y1;
+    if (pc.y2 < ymin) ymin = pc.y2;
+    if (pc.y2 > ymax) ymax = pc.y2;
+  }
+
+  y_base = ymin - tol;
+  double height = ymax - ymin + 2.0 * tol;
+
+  // One band per piece, but limit the number of entries for pieces
+  // that span many bands
+
+  bands = pc_sz;
+  int entries = 0;
+
+  for (;;) {
+    band_h = height / bands;
+    if (band_h <= 0.0) band_h = 1.0;
+
+    entries = 0;
+
+    for (int i=0; i<pc_sz; ++i) {
+      const Piece& pc = pcs[i];
+
+      double lo = pc.y1 < pc.y2 ? pc.y1 : pc.y2;
+      double hi = pc.y1 < pc.y2 ? pc.y2 : pc.y1;
+
+      int blo = (int)((lo - tol - y_base) / band_h);
+      int bhi = (int)((hi + tol - y_base) / band_h);
+
+      if (blo < 0) blo = 0;
+      if (bhi >= bands) bhi = bands-1;
+
+      entries += bhi - blo + 1;
+    }
+
+    if (bands == 1 || entries <= 8 * pc_sz + 64) break;
+
+    bands /= 2;
+  }
+
+  band_beg = new int[bands+1];
+  band_pcs = new int[entries];
+
+  memset(band_beg,0,(bands+1)*sizeof(int));
+
+  for (int pass=0; pass<2; ++pass) {
+    for (int i=0; i<pc_sz; ++i) {
+      const Piece& pc = pcs[i];
+
+      double lo = pc.y1 < pc.y2 ? pc.y1 : pc.y2;
+      double hi = pc.y1 < pc.y2 ? pc.y2 : pc.y1;
+
+      int blo = (int)((lo - tol - y_base) / band_h);
+      int bhi = (int)((hi + tol - y_base) / band_h);
+
+      if (blo < 0) blo = 0;
+      if (bhi >= bands) bhi = bands-1;
+
+      for (int b=blo; b<=bhi; ++b) {
+        if (pass == 0) band_beg[b+1]++;
+        else band_pcs[band_beg[b]++] = i;
+      }
+    }
+
+    if (pass == 0) {
+      for (int b=0; b<bands; ++b) band_beg[b+1] += band_beg[b];
+    }
+    else {
+      for (int b=bands; b>0; --b) band_beg[b] = band_beg[b-1];
+      band_beg[0] = 0;
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Conservative test: may return true for points just outside -- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Slabs::near_piece(const Piece& pc, const Vec2& p) const
+{
+  if (p.x < pc.xmin - tol || p.x > pc.xmax + tol) return false;
+
+  double lo = pc.y1 < pc.y2 ? pc.y1 : pc.y2;
+  double hi = pc.y1 < pc.y2 ? pc.y2 : pc.y1;
+
+  if (p.y < lo - tol || p.y > hi + tol) return false;
+
+  if (pc.side != 0) {
+    double dx = p.x - pc.cx, dy = p.y - pc.cy;
+    return fabs(sqrt(dx*dx + dy*dy) - pc.r) <= tol;
+  }
+
+  double vx = pc.x2 - pc.x1, vy = pc.y2 - pc.y1;
+  double wx = p.x - pc.x1,   wy = p.y - pc.y1;
+
+  double l2 = vx*vx + vy*vy;
+  double t  = l2 > 0.0 ? (wx*vx + wy*vy) / l2 : 0.0;
+
+  if (t < 0.0) t = 0.0; else if (t > 1.0) t = 1.0;
+
+  double dx = wx - t*vx, dy = wy - t*vy;
+
+  return dx*dx + dy*dy <= tol*tol;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Does the ray from p in +x direction cross the piece? --------- */
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Slabs::crosses(const Piece& pc, const Vec2& p) const
+{
+  if ((pc.y1 > p.y) == (pc.y2 > p.y)) return false; // Half open in y
+  if (pc.xmax < p.x) return false;
+
+  double x;
+
+  if (pc.side == 0)
+    x = pc.x1 + (p.y - pc.y1) * (pc.x2 - pc.x1) / (pc.y2 - pc.y1);
+  else {
+    double dy = p.y - pc.cy;
+    double dx = pc.r*pc.r - dy*dy;
+
+    x = pc.cx + pc.side * (dx > 0.0 ? sqrt(dx) : 0.0);
+  }
+
+  return x > p.x;
+}
+
+/* ---------------------------------------------------------------------- */
+
+bool Cont_Slabs::Pnt_Inside(const Vec2& p, bool& inside) const
+{
+  inside = false;
+
+  if (!usable || bands < 1) return false;
+
+  double fb = (p.y - y_base) / band_h;
+  if (fb < 0.0 || fb >= bands) return true; // Outside all pieces
+
+  const int *pi  = band_pcs + band_beg[(int)fb];
+  const int *end = band_pcs + band_beg[(int)fb + 1];
+
+  bool odd = false;
+
+  for (;pi<end;++pi) {
+    const Piece& pc = pcs[*pi];
+
+    if (near_piece(pc,p)) return false;
+    if (crosses(pc,p)) odd = !odd;
+  }
+
+  inside = odd;
+
+  return true;
+}
+
 /* ---------------------------------------------------------------------- */
 /* ------- Remove short elements (short in 2D) -------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -27,7 +27,7 @@ namespace Ino
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static void *store = NULL;
+static thread_local void *store = NULL; // Free chain per thread
 
 struct store_arc
 {
@@ -1047,13 +1047,13 @@ bool Elem_Arc::From_3pt(const Vec2& p1, const Vec2& p2,
 //---------------------------------------------------------------------------
 // Persistable Section
 
-static const char fldP1x[] = "P1x";
-static const char fldP1y[] = "P1y";
-static const char fldP2x[] = "P2x";
-static const char fldP2y[] = "P2y";
-static const char fldcx[]  = "cx";
-static const char fldcy[]  = "cy";
-static const char fldccw[] = "ccw";
+static const PersistentField fldP1x("P1x");
+static const PersistentField fldP1y("P1y");
+static const PersistentField fldP2x("P2x");
+static const PersistentField fldP2y("P2y");
+static const PersistentField fldcx("cx");
+static const PersistentField fldcy("cy");
+static const PersistentField fldccw("ccw");
 
 //---------------------------------------------------------------------------
 
@@ -27,7 +27,7 @@ namespace Ino
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static void *store = NULL;
+static thread_local void *store = NULL; // Free chain per thread
 
 struct store_cir
 {
@@ -901,11 +901,11 @@ bool Elem_Circle::Fillet(const Elem& /*el2*/, double /*filletRad*/,
 //---------------------------------------------------------------------------
 // Persistable Section
 
-static const char fldP1x[] = "P1x";
-static const char fldP1y[] = "P1y";
-static const char fldcx[]  = "cx";
-static const char fldcy[]  = "cy";
-static const char fldccw[] = "ccw";
+static const PersistentField fldP1x("P1x");
+static const PersistentField fldP1y("P1y");
+static const PersistentField fldcx("cx");
+static const PersistentField fldcy("cy");
+static const PersistentField fldccw("ccw");
 
 //---------------------------------------------------------------------------
 
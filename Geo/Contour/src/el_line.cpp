@@ -23,7 +23,7 @@ namespace Ino
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static void *store = NULL;
+static thread_local void *store = NULL; // Free chain per thread
 
 struct store_line
 {
@@ -692,12 +692,12 @@ bool Elem_Line::Fillet(const Elem& el2, double filletRad,
 //---------------------------------------------------------------------------
 // Persistable Section
 
-static const char fldP1x[] = "P1x";
-static const char fldP1y[] = "P1y";
-static const char fldP1z[] = "P1z";
-static const char fldP2x[] = "P2x";
-static const char fldP2y[] = "P2y";
-static const char fldP2z[] = "P2z";
+static const PersistentField fldP1x("P1x");
+static const PersistentField fldP1y("P1y");
+static const PersistentField fldP1z("P1z");
+static const PersistentField fldP2x("P2x");
+static const PersistentField fldP2y("P2y");
+static const PersistentField fldP2z("P2z");
 
 //---------------------------------------------------------------------------
 
@@ -9,6 +9,7 @@
 #include "Elem.h"
 
 #include "El_Info.h"
+#include "ThreadPool.h"
 
 #include <math.h>
 
@@ -376,9 +377,9 @@ bool Elem::IsContiguous(const Elem_List& elLst, bool mustBeClosed, double tol)
 //---------------------------------------------------------------------------
 // Persistence section
 
-static const char fldBPar[]  = "bPar";
-static const char fldColor[] = "Color";
-static const char fldId[]    = "Id";
+static const PersistentField fldBPar("bPar");
+static const PersistentField fldColor("Color");
+static const PersistentField fldId("Id");
 
 void Elem::definePersistentFields(PersistentWriter& po) const
 {
@@ -479,156 +480,331 @@ void Elem_Ref::setElem(Elem *el)
 /* ------- Element Sort Optimizer --------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-typedef IT_Chain_Alloc<IT_D_Item<Elem_Cursor> > El_Cursor_Alloc;
-typedef IT_D_List<Elem_Cursor, El_Cursor_Alloc> Elem_Ptr_List;
-typedef Elem_Ptr_List::Cursor Ptr_Cursor;
+// The end points of all elements are kept in a grid of square cells that
+// are hashed into a bucket table. Cells are at least the search distance
+// wide, so the nearest end point is always found in the 3x3 block of
+// cells around the search point. Removed end points are unlinked from
+// their bucket chain, so each Chain() call costs time proportional to the
+// number of elements it chains.
 
-typedef Elem_Ptr_List Elem_Ptr_Array[Elem_Search_Size];
+class Elem_End_Grid
+{
+   Elem_End_Grid(const Elem_End_Grid& cp);             // No Copying
+   Elem_End_Grid& operator=(const Elem_End_Grid& src); // No Assignment
+
+   Vec2 base;
+   double cell;
+
+   int *bucket;         // First end point in each bucket, -1 if empty
+   int mask;            // Bucket count - 1, bucket count is a power of 2
+
+   Vec2 *ends;          // End point 2*i is P1, 2*i+1 is P2 of element i
+   int *next, *prev;    // Bucket chains, -1 terminated
+
+   int cell_idx(double val, double bval) const
+     { return (int)floor((val - bval)/cell); }
+
+   int hash(int i, int j) const
+     { return (int)(((unsigned)i * 73856093u ^ (unsigned)j * 19349663u)
+                                                             & (unsigned)mask); }
+
+   void link(int ep);
+   void unlink(int ep);
+
+  public:
+   Elem_Cursor *elcs;   // Elements in list order
+   bool *used;          // Element is chained
+   int el_cnt, first;   // Element count, first element not yet chained
+
+   Elem_End_Grid(Elem_List& list, double dist);
+   ~Elem_End_Grid();
+
+   void Remove(int el_idx) { used[el_idx] = true;
+                             unlink(2*el_idx); unlink(2*el_idx+1); }
+
+   int Find(const Vec2& srch_pt, double& mindist) const;
+   int Components(double tol, int *comp) const;
+};
 
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static int find_index(double val, int upb_idx, double base, double delta)
+Elem_End_Grid::Elem_End_Grid(Elem_List& list, double dist)
+ : base(), cell(0.0), bucket(NULL), mask(0), ends(NULL),
+   next(NULL), prev(NULL), elcs(NULL), used(NULL),
+   el_cnt(list.Length()), first(0)
 {
-  int idx, lwb = 0, upb = upb_idx-1;
+  int ep_cnt = 2*el_cnt;
+
+  elcs = new Elem_Cursor[el_cnt > 0 ? el_cnt : 1];
+  used = new bool[el_cnt > 0 ? el_cnt : 1];
+  ends = new Vec2[ep_cnt > 0 ? ep_cnt : 1];
+  next = new int[ep_cnt > 0 ? ep_cnt : 1];
+  prev = new int[ep_cnt > 0 ? ep_cnt : 1];
+
+  Elem_Cursor elc(list);
+
+  for (int i=0; elc; ++elc, ++i) {
+    const Elem& el = elc->El();
 
-  while (lwb <= upb) {
-    idx = (lwb+upb)/2;
+    elcs[i] = elc;
+    used[i] = false;
 
-    double cmpval = base + idx*delta;
-    if (cmpval > val) upb = idx-1;
-    else              lwb = idx+1;
+    ends[2*i]   = el.P1();
+    ends[2*i+1] = el.P2();
   }
 
-  if (upb < 0) upb = 0;
+  Vec2 ur;
+
+  for (int ep=0; ep<ep_cnt; ++ep) {
+    const Vec2& pt = ends[ep];
+
+    if (ep == 0) base = ur = pt;
+
+    if (pt.x < base.x) base.x = pt.x;
+    if (pt.y < base.y) base.y = pt.y;
+    if (pt.x > ur.x) ur.x = pt.x;
+    if (pt.y > ur.y) ur.y = pt.y;
+  }
+
+  // Cell size: about one end point per cell, but never less than the
+  // search distance and never so small that cell indices could overflow
+
+  double wx = ur.x - base.x, wy = ur.y - base.y;
+
+  cell = ep_cnt > 0 ? sqrt(wx*wy/ep_cnt) : 0.0;
+  if (cell < dist) cell = dist;
+
+  double wmax = wx > wy ? wx : wy;
+  if (cell < wmax/1048576.0) cell = wmax/1048576.0;
+  if (cell <= 0.0) cell = 1.0;
+
+  int bcnt = 16;
+  while (bcnt < ep_cnt) bcnt *= 2;
+
+  mask = bcnt-1;
+  bucket = new int[bcnt];
+  for (int b=0; b<bcnt; ++b) bucket[b] = -1;
 
-  return upb;
+  for (int ep=0; ep<ep_cnt; ++ep) link(ep);
 }
 
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static void find_elem_one(const Vec2& srch_pt,
-                          Elem_Ptr_Array el_arr[], int i, int j,
-                          Ptr_Cursor& ptrc, double &mindist)
+Elem_End_Grid::~Elem_End_Grid()
 {
-  Ptr_Cursor sc(el_arr[i][j]);
-  ptrc.To_End();
+  delete[] bucket;
+  delete[] prev;
+  delete[] next;
+  delete[] ends;
+  delete[] used;
+  delete[] elcs;
+}
 
-  for (;sc;++sc) {
-    Elem_Cursor& elc = *sc;
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
 
-    double dist1 = srch_pt.distTo2(elc->El().P1());
-    double dist2 = srch_pt.distTo2(elc->El().P2());
+void Elem_End_Grid::link(int ep)
+{
+  const Vec2& pt = ends[ep];
 
-    if (dist2 < dist1) dist1 = dist2;
+  int b = hash(cell_idx(pt.x,base.x),cell_idx(pt.y,base.y));
 
-    if (!ptrc || dist1 < mindist) {
-      mindist = dist1;
-      ptrc = sc;
-    }
-  }
+  prev[ep] = -1;
+  next[ep] = bucket[b];
+  if (next[ep] >= 0) prev[next[ep]] = ep;
+
+  bucket[b] = ep;
 }
 
 /* ---------------------------------------------------------------------- */
-/* ------- Determine which neighbours to search ------------------------- */
+/* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-static void find_range(const Vec2& srch_pt, double tol,
-                       int upb_x, int upb_y,
-                       const Vec2& base, const Vec2& delta,
-                       int &lwb_i, int& upb_i, int &lwb_j, int& upb_j)
+void Elem_End_Grid::unlink(int ep)
 {
-  lwb_i = upb_i = find_index(srch_pt.x,upb_x,base.x,delta.x);
-  lwb_j = upb_j = find_index(srch_pt.y,upb_y,base.y,delta.y);
-
-  // Perhaps neighbours must be checked as well
+  const Vec2& pt = ends[ep];
 
-  double dist_x = srch_pt.x - base.x + lwb_i*delta.x ;
-  double dist_y = srch_pt.y - base.y + lwb_j*delta.y ;
+  if (prev[ep] >= 0) next[prev[ep]] = next[ep];
+  else bucket[hash(cell_idx(pt.x,base.x),cell_idx(pt.y,base.y))] = next[ep];
 
-  if (lwb_i > 0 && dist_x <= tol) lwb_i--;
-  else if (upb_i < upb_x-1 &&
-               delta.x - dist_x <= tol) upb_i++;
+  if (next[ep] >= 0) prev[next[ep]] = prev[ep];
 
-  if (lwb_j > 0 && dist_y <= tol) lwb_j--;
-  else if (upb_j < upb_y-1 &&
-               delta.y - dist_y <= tol) upb_j++;
+  next[ep] = prev[ep] = -1;
 }
-            
 
 /* ---------------------------------------------------------------------- */
-/* ---------------------------------------------------------------------- */
+/* ------- Find element with end point nearest to srch_pt --------------- */
+/* ------- Returns the element index or -1 ------------------------------ */
 /* ---------------------------------------------------------------------- */
 
-static void find_elem(const Vec2& srch_pt, double tol,
-                      const Vec2& base, const Vec2& delta,
-                      Elem_Ptr_Array el_arr[], int upb_x, int upb_y,
-                      Ptr_Cursor& ptrc, double &mindist)
+int Elem_End_Grid::Find(const Vec2& srch_pt, double& mindist) const
 {
-  int lwb_i, upb_i, lwb_j, upb_j;
-
-  find_range(srch_pt,tol,upb_x,upb_y,base,delta,lwb_i,upb_i,lwb_j,upb_j);
+  int ci = cell_idx(srch_pt.x,base.x), cj = cell_idx(srch_pt.y,base.y);
 
-  ptrc.To_End();
+  int found = -1;
 
-  Ptr_Cursor sc;
+  for (int i=ci-1; i<=ci+1; i++) {
+    for (int j=cj-1; j<=cj+1; j++) {
+      for (int ep=bucket[hash(i,j)]; ep>=0; ep=next[ep]) {
+        double dist = srch_pt.distTo2(ends[ep]);
 
-  for (int i=lwb_i; i<=upb_i; i++) {
-    for (int j=lwb_j; j<=upb_j; j++) {
-      double dist = 0.0;
-      find_elem_one(srch_pt,el_arr,i,j,sc,dist);
+        // Ties go to the first element, so the result does not depend
+        // on the cell layout
 
-      if (sc && (!ptrc || dist < mindist)) {
-        mindist = dist;
-        ptrc = sc;
+        if (found < 0 || dist < mindist ||
+                             (dist == mindist && ep/2 < found)) {
+          mindist = dist;
+          found = ep/2;
+        }
       }
     }
   }
+
+  return found;
 }
 
 /* ---------------------------------------------------------------------- */
+/* ------- Number the groups of elements connected by end points -------- */
+/* ------- that lie within tol of each other ---------------------------- */
+/* ------- Groups are numbered in order of their first element, --------- */
+/* ------- chained elements get -1, returns the number of groups -------- */
 /* ---------------------------------------------------------------------- */
+
+static int find_root(int *parent, int idx)
+{
+  while (parent[idx] != idx) {
+    parent[idx] = parent[parent[idx]];
+    idx = parent[idx];
+  }
+
+  return idx;
+}
+
 /* ---------------------------------------------------------------------- */
 
-static void delete_cursor(const Vec2& srch_pt, double tol,
-                          const Vec2& base, const Vec2& delta,
-                          Elem_Ptr_Array el_arr[], int upb_x, int upb_y,
-                          const Elem_Cursor& elc)
+int Elem_End_Grid::Components(double tol, int *comp) const
 {
-  int i,j,lwb_i, upb_i, lwb_j, upb_j;
+  int *parent = new int[el_cnt > 0 ? el_cnt : 1];
 
-  find_range(srch_pt,tol,upb_x,upb_y,base,delta,lwb_i,upb_i,lwb_j,upb_j);
+  for (int el=0; el<el_cnt; ++el) parent[el] = el;
 
-  for (i=lwb_i; i<=upb_i; i++) {
-    for (j=lwb_j; j<=upb_j; j++) {
-      Ptr_Cursor sc(el_arr[i][j]);
+  for (int ep=0; ep<2*el_cnt; ++ep) {
+    if (used[ep/2]) continue;
 
-      for (;sc;++sc) {
-        if (*sc == elc) {
-          sc.Delete();
-          return;
+    const Vec2& pt = ends[ep];
+    int ci = cell_idx(pt.x,base.x), cj = cell_idx(pt.y,base.y);
+
+    for (int i=ci-1; i<=ci+1; i++) {
+      for (int j=cj-1; j<=cj+1; j++) {
+        for (int oep=bucket[hash(i,j)]; oep>=0; oep=next[oep]) {
+          if (oep/2 == ep/2 || pt.distTo2(ends[oep]) > tol) continue;
+
+          int r1 = find_root(parent,ep/2), r2 = find_root(parent,oep/2);
+
+          // Keep the lowest element as root
+          if (r1 < r2) parent[r2] = r1;
+          else if (r2 < r1) parent[r1] = r2;
         }
       }
     }
   }
 
-  // Not found, search entire array as a last resort
+  int comp_cnt = 0;
 
-  for (i=0; i<upb_x; i++) {
-    for (j=0; j<upb_y; j++) {
-      Ptr_Cursor sc(el_arr[i][j]);
+  for (int el=0; el<el_cnt; ++el) {
+    if (used[el]) comp[el] = -1;
+    else {
+      int root = find_root(parent,el);
 
-      for (;sc;++sc) {
-        if (*sc == elc) {
-          sc.Delete();
-          return;
-        }
-      }
+      if (root == el) comp[el] = comp_cnt++;
+      else comp[el] = comp[root];
     }
   }
+
+  delete[] parent;
+
+  return comp_cnt;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Chains made in advance by Elem_Sort::Chain_All() ------------- */
+/* ---------------------------------------------------------------------- */
+
+struct Elem_Chain_Set
+{
+   Elem_List *lists;    // Chained elements, one list per task
+   int task_cnt;
+
+   int *chain_list;     // Per chain, in order of the first element:
+   int *chain_len;      // its list and its number of elements
+   int chain_cnt, next;
+
+   Elem_Chain_Set(int tasks, int max_chains)
+    : lists(new Elem_List[tasks]), task_cnt(tasks),
+      chain_list(new int[max_chains > 0 ? max_chains : 1]),
+      chain_len(new int[max_chains > 0 ? max_chains : 1]),
+      chain_cnt(0), next(0) {}
+
+   ~Elem_Chain_Set() {
+      delete[] chain_len;
+      delete[] chain_list;
+      delete[] lists;
+   }
+
+  private:
+   Elem_Chain_Set(const Elem_Chain_Set& cp);             // No Copying
+   Elem_Chain_Set& operator=(const Elem_Chain_Set& src); // No Assignment
+};
+
+/* ---------------------------------------------------------------------- */
+/* ------- Chains one list of elements on a worker thread --------------- */
+/* ---------------------------------------------------------------------- */
+
+class Elem_Chain_Task : public ThreadPool::Task
+{
+   Elem_Chain_Task(const Elem_Chain_Task& cp);             // No Copying
+   Elem_Chain_Task& operator=(const Elem_Chain_Task& src); // No Assignment
+
+  public:
+   Elem_List *lst;      // In: elements, out: chained elements
+   double tol;
+
+   const int *el_idx;   // Index of each element in the caller's order
+   int *start, *len;    // Out: per chain first element index and length
+   int cnt;             // Out: number of chains
+
+   Elem_Chain_Task() : lst(NULL), tol(0.0), el_idx(NULL),
+                                    start(NULL), len(NULL), cnt(0) {}
+
+   virtual void run();
+};
+
+/* ---------------------------------------------------------------------- */
+
+void Elem_Chain_Task::run()
+{
+  Elem_Sort srt(*lst,tol);
+
+  const Elem_End_Grid& el_grid = *(const Elem_End_Grid *)srt.grid;
+
+  Elem_List chain;
+  Elem_Cursor dc(*lst);
+
+  while (srt.Chain(chain)) {
+    // Chain() started with the first unchained element
+
+    start[cnt] = el_idx[el_grid.first];
+    len[cnt]   = chain.Length();
+    cnt++;
+
+    Elem_Cursor sc(chain), ec(chain); ec.To_End();
+    dc.To_End(); dc.Re_Insert(sc,ec);
+  }
 }
 
 /* ---------------------------------------------------------------------- */
@@ -690,61 +866,38 @@ void close_gaps(Elem_List& list, bool closed)
 /* ---------------------------------------------------------------------- */
 
 Elem_Sort::Elem_Sort(Elem_List& el_lst, double dist_tol)
- : arr(NULL), upb_x(Elem_Search_Size), upb_y(Elem_Search_Size),
-   list(), base(), delta(), tol(dist_tol)
+ : grid(NULL), chains(NULL), list(), tol(dist_tol)
 {
   bubble_up_closed(tol,el_lst,list);
 
-  Rect_Ax el_rect;
-
-  Elem_Cursor elc(list);
-  if (!elc) return;
-
-  el_rect = elc->El().Rect();
-  ++elc;
-
-  for (;elc;++elc) el_rect += elc->El().Rect();
-
-  base  = el_rect.Ll();
-  delta = el_rect.Ur(); delta -= base; delta /= Elem_Search_Size;
-
-  while (upb_x > 1 && delta.x < tol) {
-    upb_x /= 2; delta.x *= 2.0;
-  }
-
-  while (upb_y > 1 && delta.y < tol) {
-    upb_y /= 2; delta.y *= 2.0;
-  }
-
-  Elem_Ptr_Array *el_arr = new Elem_Ptr_Array[Elem_Search_Size];
-  arr = el_arr;
-  if (!arr) return;
-
-  elc.To_Begin();
-
-  for (;elc;++elc) {
-    const Elem& el = elc->El();
-
-    int i = find_index(el.P1().x,upb_x,base.x,delta.x);
-    int j = find_index(el.P1().y,upb_y,base.y,delta.y);
-
-    el_arr[i][j].Push_Back(elc);
+  grid = new Elem_End_Grid(list,fabs(tol));
+}
 
-    i = find_index(el.P2().x,upb_x,base.x,delta.x);
-    j = find_index(el.P2().y,upb_y,base.y,delta.y);
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
 
-    el_arr[i][j].Push_Back(elc);
-  }
+Elem_Sort::~Elem_Sort()
+{
+  delete (Elem_Chain_Set *)chains;
+  delete (Elem_End_Grid *)grid;
 }
 
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-Elem_Sort::~Elem_Sort()
+int Elem_Sort::Elements() const
 {
-  Elem_Ptr_Array *el_arr = (Elem_Ptr_Array *)arr;
-  if (el_arr) delete[] el_arr;
+  int cnt = list.Length();
+
+  Elem_Chain_Set *set = (Elem_Chain_Set *)chains;
+
+  if (set) {
+    for (int t=0; t<set->task_cnt; ++t) cnt += set->lists[t].Length();
+  }
+
+  return cnt;
 }
 
 /* ---------------------------------------------------------------------- */
@@ -755,25 +908,46 @@ bool Elem_Sort::Chain(Elem_List& new_cont)
 {
   new_cont.Delete();
 
-  if (!arr) return false;
+  if (chains) {
+    Elem_Chain_Set& set = *(Elem_Chain_Set *)chains;
+    if (set.next >= set.chain_cnt) return false;
+
+    // The chains of each list are handed out in the order they were made
+
+    Elem_List& src = set.lists[set.chain_list[set.next]];
+
+    Elem_Cursor sc(src), ec(src);
+    for (int i=set.chain_len[set.next]; i>0; --i) ++ec;
+
+    set.next++;
+
+    Elem_Cursor newc(new_cont);
+    newc.Re_Insert(sc,ec);
+
+    return true;
+  }
+
+  Elem_End_Grid& el_grid = *(Elem_End_Grid *)grid;
+
+  // The list keeps its order, so its first element is the first unused one
+
+  while (el_grid.first < el_grid.el_cnt && el_grid.used[el_grid.first])
+    el_grid.first++;
+
+  if (el_grid.first >= el_grid.el_cnt) return false;
 
   Elem_Cursor newc(new_cont);
 
-  Elem_Cursor elc(list);
-  if (!elc) return false;
+  int el_idx = el_grid.first;
+  Elem_Cursor elc(el_grid.elcs[el_idx]);
 
   Vec2 start_pt = elc->El().P1();
   Vec2 srch_pt  = elc->El().P2();
 
-  Elem_Ptr_Array *el_arr = (Elem_Ptr_Array *)arr;
-
-  delete_cursor(start_pt, tol, base, delta, el_arr, upb_x, upb_y, elc);
-  delete_cursor(srch_pt,  tol, base, delta, el_arr, upb_x, upb_y, elc);
+  el_grid.Remove(el_idx);
 
   newc.Re_Insert(elc); newc.To_End();
 
-  Ptr_Cursor ptrc;
-
   bool closed = false;
 
   while (list) {
@@ -784,11 +958,11 @@ bool Elem_Sort::Chain(Elem_List& new_cont)
     }
 
     double dist = 0.0;
-    find_elem(srch_pt,tol,base,delta,el_arr,upb_x,upb_y,ptrc,dist);
+    el_idx = el_grid.Find(srch_pt,dist);
 
-    if (!ptrc || dist > tol) break;
+    if (el_idx < 0 || dist > tol) break;
 
-    elc = *ptrc;
+    elc = el_grid.elcs[el_idx];
     if (srch_pt.distTo2(elc->El().P1()) >
                    srch_pt.distTo2(elc->El().P2())) elc->El().Reverse();
 
@@ -799,9 +973,8 @@ bool Elem_Sort::Chain(Elem_List& new_cont)
 
     srch_pt = elc->El().P2();
 
-    ptrc.Delete();  // Delete this end and other end in array
-    delete_cursor(srch_pt, tol, base, delta, el_arr, upb_x, upb_y, elc);
-    
+    el_grid.Remove(el_idx);
+
     newc.Re_Insert(elc); newc.To_End();
   }
 
@@ -811,6 +984,185 @@ bool Elem_Sort::Chain(Elem_List& new_cont)
   return true;
 }
 
+/* ---------------------------------------------------------------------- */
+/* ------- Chain all remaining elements in advance ---------------------- */
+/* ------- Groups of elements that are connected by their end points --- */
+/* ------- cannot affect each other, so they are chained in parallel ---- */
+/* ------- Chain() then returns the same chains in the same order ------- */
+/* ------- as it would have without Chain_All() ------------------------- */
+/* ---------------------------------------------------------------------- */
+
+const int Elem_Sort_Par_Min = 4096; // Fewer elements are chained serially
+
+void Elem_Sort::Chain_All(int threadCount)
+{
+  int thr_cnt = threadCount < 0 ? ThreadPool::processorCount() : threadCount;
+  if (threadCount < 0 && ThreadPool::isWorkerThread()) thr_cnt = 1;
+
+  // Not worth it, Chain() does the same work serially
+
+  if (chains || thr_cnt < 2 || list.Length() < Elem_Sort_Par_Min) return;
+
+  Elem_End_Grid& el_grid = *(Elem_End_Grid *)grid;
+
+  int el_cnt = el_grid.el_cnt;
+
+  int *comp = new int[el_cnt > 0 ? el_cnt : 1];
+  int comp_cnt = el_grid.Components(tol,comp);
+
+  int task_cnt = 4*thr_cnt;
+  if (task_cnt > comp_cnt) task_cnt = comp_cnt > 0 ? comp_cnt : 1;
+
+  // Spread the groups over the tasks, in order of their first element
+
+  int *comp_task = new int[comp_cnt > 0 ? comp_cnt : 1];
+  int *comp_size = new int[comp_cnt > 0 ? comp_cnt : 1];
+
+  int c, el, t, todo = 0;
+
+  for (c=0; c<comp_cnt; ++c) comp_size[c] = 0;
+
+  for (el=0; el<el_cnt; ++el) {
+    if (comp[el] >= 0) {
+      comp_size[comp[el]]++; todo++;
+    }
+  }
+
+  int per_task = (todo + task_cnt - 1)/task_cnt;
+
+  for (c=0, el=0; c<comp_cnt; ++c) {
+    comp_task[c] = per_task > 0 ? el/per_task : 0;
+    el += comp_size[c];
+  }
+
+  // Move the elements to the list of their task, keeping their order
+
+  Elem_Chain_Set *set = new Elem_Chain_Set(task_cnt,todo);
+  chains = set;
+
+  Elem_Chain_Task *tasks = new Elem_Chain_Task[task_cnt];
+  ThreadPool::Task **task_lst = new ThreadPool::Task*[task_cnt];
+
+  int *el_idx = new int[todo > 0 ? todo : 1];
+  int *start  = new int[todo > 0 ? todo : 1];
+  int *len    = new int[todo > 0 ? todo : 1];
+
+  int *task_off = new int[task_cnt+1];
+
+  for (t=0; t<=task_cnt; ++t) task_off[t] = 0;
+
+  for (c=0; c<comp_cnt; ++c) task_off[comp_task[c]+1] += comp_size[c];
+
+  for (t=0; t<task_cnt; ++t) {
+    task_off[t+1] += task_off[t];
+
+    Elem_Chain_Task& task = tasks[t];
+
+    task.lst    = &set->lists[t];
+    task.tol    = tol;
+    task.el_idx = el_idx + task_off[t];
+    task.start  = start + task_off[t];
+    task.len    = len + task_off[t];
+
+    task_lst[t] = &task;
+  }
+
+  for (el=0; el<el_cnt; ++el) {
+    if (comp[el] < 0) continue;
+
+    t = comp_task[comp[el]];
+    Elem_Chain_Task& task = tasks[t];
+
+    el_idx[task_off[t]++] = el;
+
+    Elem_Cursor sc(el_grid.elcs[el]);
+    Elem_Cursor dc(*task.lst); dc.To_End();
+    dc.Re_Insert(sc);
+
+    el_grid.used[el] = true;
+  }
+
+  el_grid.first = el_cnt;
+
+  ThreadPool pool(task_cnt > 1 ? thr_cnt : 0);
+  pool.runAll(task_lst,task_cnt);
+
+  // Order the chains by their first element
+
+  int *order = comp; // Reused, indexed by element
+
+  for (el=0; el<el_cnt; ++el) order[el] = -1;
+
+  for (t=0; t<task_cnt; ++t) {
+    for (int i=0; i<tasks[t].cnt; ++i) order[tasks[t].start[i]] = t;
+
+    task_off[t] = 0; // Now the next chain of each task
+  }
+
+  for (el=0; el<el_cnt; ++el) {
+    t = order[el];
+    if (t < 0) continue;
+
+    set->chain_list[set->chain_cnt] = t;
+    set->chain_len[set->chain_cnt]  = tasks[t].len[task_off[t]++];
+    set->chain_cnt++;
+  }
+
+  delete[] task_off;
+  delete[] len;
+  delete[] start;
+  delete[] el_idx;
+  delete[] task_lst;
+  delete[] tasks;
+  delete[] comp_size;
+  delete[] comp_task;
+  delete[] comp;
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Chain all remaining elements in one pass --------------------- */
+/* ------- Returns a new[] array with chain_cnt lists, in the order ----- */
+/* ------- Chain() would return them, the caller deletes it ------------- */
+/* ---------------------------------------------------------------------- */
+
+static void move_list(Elem_List& src, Elem_List& dst)
+{
+  Elem_Cursor sc(src), ec(src); ec.To_End();
+  Elem_Cursor dc(dst); dc.To_End();
+
+  dc.Re_Insert(sc,ec);
+}
+
+/* ---------------------------------------------------------------------- */
+
+Elem_List *Elem_Sort::Chain_Lists(int& chain_cnt, int threadCount)
+{
+  Chain_All(threadCount);
+
+  int cap = 16;
+  Elem_List *lst = new Elem_List[cap];
+
+  chain_cnt = 0;
+
+  Elem_List chain;
+
+  while (Chain(chain)) {
+    if (chain_cnt >= cap) {
+      Elem_List *new_lst = new Elem_List[2*cap];
+
+      for (int i=0; i<chain_cnt; ++i) move_list(lst[i],new_lst[i]);
+
+      delete[] lst;
+
+      lst = new_lst; cap *= 2;
+    }
+
+    move_list(chain,lst[chain_cnt++]);
+  }
+
+  return lst;
+}
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
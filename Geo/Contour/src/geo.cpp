@@ -129,15 +129,443 @@ Vec2 Geo_Arc_Mid(const Vec2& p1, const Vec2& p2, const Vec2& centre,
   return dp;
 }
 
+/* --------------------------------------------------------------------- */
+/* ------------ Exact arithmetic (floating point expansions) ----------- */
+/* --------------------------------------------------------------------- */
+/* A number is held as a sum of non overlapping doubles of increasing    */
+/* magnitude, zeros left out (J.R. Shewchuk, Adaptive Precision          */
+/* Floating-Point Arithmetic and Fast Robust Geometric Predicates).      */
+/* Only used when a floating point test is within its error bound.       */
+/* --------------------------------------------------------------------- */
+
+static const double Exp_Eps      = 1.1102230246251565e-16; // 2^-53
+static const double Exp_Splitter = 134217729.0;            // 2^27 + 1
+
+static inline void fast_two_sum(double a, double b, double& x, double& y)
+{
+  x = a + b; y = b - (x - a);
+}
+
+static inline void two_sum(double a, double b, double& x, double& y)
+{
+  x = a + b;
+  double bv = x - a; double av = x - bv;
+  y = (a - av) + (b - bv);
+}
+
+static inline void two_diff(double a, double b, double& x, double& y)
+{
+  x = a - b;
+  double bv = a - x; double av = x + bv;
+  y = (a - av) + (bv - b);
+}
+
+static inline void split(double a, double& hi, double& lo)
+{
+  double c = Exp_Splitter * a;
+  hi = c - (c - a); lo = a - hi;
+}
+
+static inline void two_product(double a, double b, double& x, double& y)
+{
+  x = a * b;
+
+  double ahi, alo, bhi, blo;
+  split(a,ahi,alo); split(b,bhi,blo);
+
+  double err = x - ahi * bhi; err -= alo * bhi; err -= ahi * blo;
+  y = alo * blo - err;
+}
+
+/* --------------------------------------------------------------------- */
+
+class Exact_Num
+{
+   double *comp;
+   int len, cap;
+
+   void reserve(int sz);   // Contents are lost
+   void push(double c) { if (c != 0.0) comp[len++] = c; }
+
+   Exact_Num(const Exact_Num& cp);             // No copying
+   Exact_Num& operator=(const Exact_Num& src); // No assignment
+
+  public:
+   Exact_Num() : comp(NULL), len(0), cap(0) {}
+   ~Exact_Num() { delete[] comp; }
+
+   void Swap(Exact_Num& num);
+
+   // Operands must not be this number itself
+
+   void Set_Diff(double a, double b);
+   void Set_Prod(double a, double b);
+   void Set_Sum(const Exact_Num& a, const Exact_Num& b, bool neg_b = false);
+   void Set_Scaled(const Exact_Num& a, double b);
+   void Set_Prod(const Exact_Num& a, const Exact_Num& b);
+
+   double Estimate() const;
+
+   int Sign() const { return len < 1 ? 0 : (comp[len-1] > 0.0 ? 1 : -1); }
+};
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::reserve(int sz)
+{
+  len = 0;
+
+  if (sz <= cap) return;
+
+  delete[] comp;
+
+  cap = sz < 16 ? 16 : sz;
+  comp = new double[cap];
+}
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::Swap(Exact_Num& num)
+{
+  double *hc = comp; comp = num.comp; num.comp = hc;
+  int hl = len; len = num.len; num.len = hl;
+  hl = cap; cap = num.cap; num.cap = hl;
+}
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::Set_Diff(double a, double b)
+{
+  reserve(2);
+
+  double x, y; two_diff(a,b,x,y);
+
+  push(y); push(x);
+}
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::Set_Prod(double a, double b)
+{
+  reserve(2);
+
+  double x, y; two_product(a,b,x,y);
+
+  push(y); push(x);
+}
+
+/* --------------------------------------------------------------------- */
+/* Linear merge of two expansions (fast expansion sum)                   */
+
+void Exact_Num::Set_Sum(const Exact_Num& a, const Exact_Num& b, bool neg_b)
+{
+  reserve(a.len + b.len);
+
+  const double *e = a.comp; int elen = a.len;
+  const double *f = b.comp; int flen = b.len;
+
+  double fsgn = neg_b ? -1.0 : 1.0;
+
+  if (flen < 1) {
+    for (int i=0; i<elen; ++i) comp[len++] = e[i];
+    return;
+  }
+
+  if (elen < 1) {
+    for (int i=0; i<flen; ++i) comp[len++] = fsgn * f[i];
+    return;
+  }
+
+  int ei = 0, fi = 0;
+  double enow = e[0], fnow = fsgn * f[0];
+  double q, qnew, h;
+
+  // Take the component of smallest magnitude first
+
+  if ((fnow > enow) == (fnow > -enow)) {
+    q = enow; ei++; if (ei < elen) enow = e[ei];
+  }
+  else {
+    q = fnow; fi++; if (fi < flen) fnow = fsgn * f[fi];
+  }
+
+  if (ei < elen && fi < flen) {
+    if ((fnow > enow) == (fnow > -enow)) {
+      fast_two_sum(enow,q,qnew,h); ei++; if (ei < elen) enow = e[ei];
+    }
+    else {
+      fast_two_sum(fnow,q,qnew,h); fi++; if (fi < flen) fnow = fsgn * f[fi];
+    }
+
+    q = qnew; push(h);
+
+    while (ei < elen && fi < flen) {
+      if ((fnow > enow) == (fnow > -enow)) {
+        two_sum(q,enow,qnew,h); ei++; if (ei < elen) enow = e[ei];
+      }
+      else {
+        two_sum(q,fnow,qnew,h); fi++; if (fi < flen) fnow = fsgn * f[fi];
+      }
+
+      q = qnew; push(h);
+    }
+  }
+
+  while (ei < elen) {
+    two_sum(q,enow,qnew,h); ei++; if (ei < elen) enow = e[ei];
+    q = qnew; push(h);
+  }
+
+  while (fi < flen) {
+    two_sum(q,fnow,qnew,h); fi++; if (fi < flen) fnow = fsgn * f[fi];
+    q = qnew; push(h);
+  }
+
+  push(q);
+}
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::Set_Scaled(const Exact_Num& a, double b)
+{
+  reserve(2 * a.len);
+
+  if (a.len < 1 || b == 0.0) return;
+
+  double q, h, p1, p0, sum;
+
+  two_product(a.comp[0],b,q,h); push(h);
+
+  for (int i=1; i<a.len; ++i) {
+    two_product(a.comp[i],b,p1,p0);
+    two_sum(q,p0,sum,h); push(h);
+    fast_two_sum(p1,sum,q,h); push(h);
+  }
+
+  push(q);
+}
+
+/* --------------------------------------------------------------------- */
+
+void Exact_Num::Set_Prod(const Exact_Num& a, const Exact_Num& b)
+{
+  reserve(0);
+
+  Exact_Num part, acc;
+
+  for (int i=0; i<b.len; ++i) {
+    part.Set_Scaled(a,b.comp[i]);
+    acc.Set_Sum(*this,part);
+    Swap(acc);
+  }
+}
+
+/* --------------------------------------------------------------------- */
+
+double Exact_Num::Estimate() const
+{
+  double est = 0.0;
+
+  for (int i=0; i<len; ++i) est += comp[i];
+
+  return est;
+}
+
+/* --------------------------------------------------------------------- */
+/* ------------ Sign predicates ---------------------------------------- */
+/* --------------------------------------------------------------------- */
+
+static int float_sign(double val, double bound)
+{
+  if (val >  bound) return 1;
+  if (val < -bound) return -1;
+
+  return 0;
+}
+
+/* --------------------------------------------------------------------- */
+/* Exact a*b - c*d                                                        */
+
+static void exact_cross(const Exact_Num& a, const Exact_Num& b,
+                        const Exact_Num& c, const Exact_Num& d,
+                        Exact_Num& res)
+{
+  Exact_Num ab, cd;
+
+  ab.Set_Prod(a,b); cd.Set_Prod(c,d);
+
+  res.Set_Sum(ab,cd,true);
+}
+
+/* --------------------------------------------------------------------- */
+/* Exact a*a + b*b                                                        */
+
+static void exact_sqr_sum(const Exact_Num& a, const Exact_Num& b,
+                                                    Exact_Num& res)
+{
+  Exact_Num aa, bb;
+
+  aa.Set_Prod(a,a); bb.Set_Prod(b,b);
+
+  res.Set_Sum(aa,bb);
+}
+
+/* --------------------------------------------------------------------- */
+/* Sign of a*a - 4*b                                                      */
+
+static int exact_sqr_min_4(const Exact_Num& a, const Exact_Num& b)
+{
+  double ae = a.Estimate(), be = b.Estimate();
+
+  double aa = ae * ae, b4 = 4.0 * be;
+
+  int sgn = float_sign(aa - b4, 16.0 * Exp_Eps * (aa + fabs(b4)));
+  if (sgn) return sgn;
+
+  Exact_Num sq, quad, res;
+
+  sq.Set_Prod(a,a); quad.Set_Scaled(b,4.0);
+  res.Set_Sum(sq,quad,true);
+
+  return res.Sign();
+}
+
+/* --------------------------------------------------------------------- */
+
+int Geo_Cross_Sign(const Vec2& a, const Vec2& b)
+{
+  double l = a.x * b.y, r = a.y * b.x;
+
+  int sgn = float_sign(l - r, 3.0 * Exp_Eps * (fabs(l) + fabs(r)));
+  if (sgn) return sgn;
+
+  Exact_Num el, er, res;
+
+  el.Set_Prod(a.x,b.y); er.Set_Prod(a.y,b.x);
+  res.Set_Sum(el,er,true);
+
+  return res.Sign();
+}
+
+/* --------------------------------------------------------------------- */
+
+int Geo_Orient(const Vec2& a, const Vec2& b, const Vec2& c)
+{
+  double l = (b.x - a.x) * (c.y - a.y);
+  double r = (b.y - a.y) * (c.x - a.x);
+
+  int sgn = float_sign(l - r, (3.0 + 16.0 * Exp_Eps) * Exp_Eps *
+                                                (fabs(l) + fabs(r)));
+  if (sgn) return sgn;
+
+  Exact_Num bax, bay, cax, cay, res;
+
+  bax.Set_Diff(b.x,a.x); bay.Set_Diff(b.y,a.y);
+  cax.Set_Diff(c.x,a.x); cay.Set_Diff(c.y,a.y);
+
+  exact_cross(bax,cay,bay,cax,res);
+
+  return res.Sign();
+}
+
+/* --------------------------------------------------------------------- */
+/* Sign of cross(e-s,c-s)^2 - |e-s|^2 * |p-c|^2                          */
+
+int Geo_Line_Circle(const Vec2& s, const Vec2& e,
+                    const Vec2& c, const Vec2& p)
+{
+  double dx = e.x - s.x, dy = e.y - s.y;
+  double cx = c.x - s.x, cy = c.y - s.y;
+  double rx = p.x - c.x, ry = p.y - c.y;
+
+  double xl = dx * cy, xr = dy * cx;
+  double cr = xl - xr, crmag = fabs(xl) + fabs(xr);
+
+  double lsq = dx * dx + dy * dy, rsq = rx * rx + ry * ry;
+
+  int sgn = float_sign(cr * cr - lsq * rsq,
+                       32.0 * Exp_Eps * (crmag * crmag + lsq * rsq));
+  if (sgn) return sgn;
+
+  Exact_Num edx, edy, ecx, ecy, erx, ery;
+
+  edx.Set_Diff(e.x,s.x); edy.Set_Diff(e.y,s.y);
+  ecx.Set_Diff(c.x,s.x); ecy.Set_Diff(c.y,s.y);
+  erx.Set_Diff(p.x,c.x); ery.Set_Diff(p.y,c.y);
+
+  Exact_Num ecr, elsq, ersq, crsq, prod, res;
+
+  exact_cross(edx,ecy,edy,ecx,ecr);
+  exact_sqr_sum(edx,edy,elsq);
+  exact_sqr_sum(erx,ery,ersq);
+
+  crsq.Set_Prod(ecr,ecr); prod.Set_Prod(elsq,ersq);
+  res.Set_Sum(crsq,prod,true);
+
+  return res.Sign();
+}
+
+/* --------------------------------------------------------------------- */
+/* With l, r1, r2 the squared centre distance and radii, A = l-r1-r2 and */
+/* B = r1*r2: dist - (rad1+rad2) has the sign of A - 2*sqrt(B) and       */
+/* dist - |rad1-rad2| the sign of A + 2*sqrt(B).                         */
+
+int Geo_Circle_Circle(const Vec2& c1, const Vec2& p1,
+                      const Vec2& c2, const Vec2& p2)
+{
+  double len  = c1.distTo2(c2);
+  double rad1 = c1.distTo2(p1);
+  double rad2 = c2.distTo2(p2);
+
+  double bound = 16.0 * Exp_Eps * (len + rad1 + rad2);
+
+  int out = float_sign(len - (rad1 + rad2), bound);
+  if (out > 0) return 2;
+
+  int in = float_sign(len - fabs(rad1 - rad2), bound);
+  if (out < 0 && in) return in > 0 ? 0 : -2;
+
+  Exact_Num dx, dy, ax, ay, bx, by;
+
+  dx.Set_Diff(c2.x,c1.x); dy.Set_Diff(c2.y,c1.y);
+  ax.Set_Diff(p1.x,c1.x); ay.Set_Diff(p1.y,c1.y);
+  bx.Set_Diff(p2.x,c2.x); by.Set_Diff(p2.y,c2.y);
+
+  Exact_Num l, r1, r2, lr1, a, b;
+
+  exact_sqr_sum(dx,dy,l);
+  exact_sqr_sum(ax,ay,r1);
+  exact_sqr_sum(bx,by,r2);
+
+  lr1.Set_Sum(l,r1,true); a.Set_Sum(lr1,r2,true);
+  b.Set_Prod(r1,r2);
+
+  int as = a.Sign(), bs = b.Sign();
+
+  if (as <= 0) out = bs > 0 ? -1 : as;
+  else out = exact_sqr_min_4(a,b);
+
+  if (out > 0) return 2;
+  if (out == 0) return 1;
+
+  if (as >= 0) in = (as > 0 || bs > 0) ? 1 : 0;
+  else in = -exact_sqr_min_4(a,b);
+
+  if (in > 0) return 0;
+  if (in == 0) return -1;
+
+  return -2;
+}
+
 /* --------------------------------------------------------------------- */
 /* ------------ Is c in between a and b in acw direction? -------------- */
 /* --------------------------------------------------------------------- */
 
 bool Geo_In_Between(const Vec2& a, const Vec2& b, const Vec2& c)
 {
-  bool ab = a.x*b.y - a.y*b.x >= 0.0;
-  bool ac = a.x*c.y - a.y*c.x >= 0.0;
-  bool cb = c.x*b.y - c.y*b.x >= 0.0;
+  bool ab = Geo_Cross_Sign(a,b) >= 0;
+  bool ac = Geo_Cross_Sign(a,c) >= 0;
+  bool cb = Geo_Cross_Sign(c,b) >= 0;
 
   if (ab) return (ac && cb);
   else    return (ac || cb);
@@ -302,9 +730,33 @@ int Geo_Isct_Lines(const Vec2& s1, const Vec2& e1,
   Vec2 dir1 = e1 - s1; double len1 = dir1.len2(); dir1 /= len1;
   Vec2 dir2 = e2 - s2; double len2 = dir2.len2(); dir2 /= len2;
 
+  int sols;
+
   if (len1 > len2)
-       return Isct_Line(s1,dir1,len1,s2,e2,len2,strict,tol,ip,pr1,pr2);
-  else return Isct_Line(s2,dir2,len2,s1,e1,len1,strict,tol,ip,pr2,pr1);
+       sols = Isct_Line(s1,dir1,len1,s2,e2,len2,strict,tol,ip,pr1,pr2);
+  else sols = Isct_Line(s2,dir2,len2,s1,e1,len1,strict,tol,ip,pr2,pr1);
+
+  if (sols > 0 || !strict) return sols;
+
+  // A proper crossing (exact signs) must not be lost to the
+  // (near) parallel test above
+
+  if (Geo_Orient(s1,e1,s2) * Geo_Orient(s1,e1,e2) >= 0 ||
+      Geo_Orient(s2,e2,s1) * Geo_Orient(s2,e2,e1) >= 0) return 0;
+
+  double as = (e1.x-s1.x) * (s2.y-s1.y) - (e1.y-s1.y) * (s2.x-s1.x);
+  double ae = (e1.x-s1.x) * (e2.y-s1.y) - (e1.y-s1.y) * (e2.x-s1.x);
+
+  double t = as == ae ? 0.5 : as / (as - ae);
+  if (t < 0.0) t = 0.0; else if (t > 1.0) t = 1.0;
+
+  ip = s2 + (e2 - s2) * t;
+
+  pr2 = t * len2;
+  pr1 = (ip - s1) * dir1;
+  if (pr1 < 0.0) pr1 = 0.0; else if (pr1 > len1) pr1 = len1;
+
+  return 1;
 }
 
 /* --------------------------------------------------------------------- */
@@ -338,7 +790,9 @@ int Geo_Isct_Line_Arc(const Vec2& s1, const Vec2& e1,
 
   double c2_dist = fabs(lc2.y);
 
-  if (c2_dist > rad) {        // Tangent solution or else none
+  int side = Geo_Line_Circle(s1,e1,c2,s2);
+
+  if (side > 0) {             // Tangent solution or else none
     if (!tangok || c2_dist > rad+2.0*tol) return 0;
 
     double dist = (c2_dist - rad)/2.0;
@@ -354,8 +808,8 @@ int Geo_Isct_Line_Arc(const Vec2& s1, const Vec2& e1,
 
     double sqrtarg = sqr(rad) - sqr(lc2.y);
 
-    if (sqrtarg <= 0) dist = 0;
-    else              dist = sqrt(sqrtarg);
+    if (side == 0 || sqrtarg <= 0) dist = 0;
+    else                           dist = sqrt(sqrtarg);
 
     ipa.y = 0; ipb.y = 0;
 
@@ -437,37 +891,30 @@ int Geo_Isct_Arc_Arc(const Vec2& s1, const Vec2& e1,
 
   double rad1 = ls1.len2(); double rad2 = ls2.distTo2(lc2);
 
-  if (len < rad1) {  // c2 inside circle 1
-    double dr = rad1 - rad2;
+  int pos = Geo_Circle_Circle(c1,s1,c2,s2);
 
-    if (dr >= len || dr <= -len) {
-      if (!tangok || dr > len + tol || dr < -len - tol) return 0;
+  if (pos > 0) {              // Apart or touching outside
+    if (!tangok || rad1 + rad2 < len - tol) return 0;
 
-      if (dr > 0) ipa.x =  (rad1 + rad2 + len)/2.0;
-      else        ipa.x = -(rad1 + rad2 - len)/2.0;
-      ipa.y = 0;
+    ipa.x = (rad1 + len - rad2)/2.0;
+    ipa.y = 0;
 
-      ipb = ipa;
+    ipb = ipa;
 
-      sols = 1;
-    }
+    sols = 1;
   }
-  else {                      // c2 outside circle 1
+  else if (pos < 0) {         // One inside the other or touching inside
     double dr = rad1 - rad2;
-    double sr = rad1 + rad2;
-
-    if (sr <= len || dr <= -len) {
-     if (!tangok || sr < len - tol || dr < -len - tol) return 0;
 
-     if (rad2 > len) ipa.x = -(rad1 + rad2 - len)/2.0;
-     else            ipa.x =  (rad1 + len - rad2)/2.0;
+    if (!tangok || dr > len + tol || dr < -len - tol) return 0;
 
-     ipa.y = 0;
+    if (dr > 0) ipa.x =  (rad1 + rad2 + len)/2.0;
+    else        ipa.x = -(rad1 + rad2 - len)/2.0;
+    ipa.y = 0;
 
-     ipb = ipa;
+    ipb = ipa;
 
-     sols = 1;
-    }
+    sols = 1;
   }
 
   if (sols < 1) {              // Solution is apparently not tangent, so
@@ -0,0 +1,100 @@
+/* ---------------------------------------------------------------------- */
+/* ---------------- Contour List Index Check ---------------------------- */
+/* ---------------------------------------------------------------------- */
+
+// Cont_List::Project_Pnt_XY() builds an R-tree once a list is projected
+// on more than once. Checks that its result stays the same as that of an
+// unindexed copy after the list is changed in place. Points are taken
+// halfway between two squares, so the list order decides the result.
+// Returns 0 if all checks pass.
+
+#include "Contour.h"
+#include "Trf.h"
+
+#include <stdio.h>
+
+using namespace Ino;
+
+static int errors = 0;
+
+/* ---------------------------------------------------------------------- */
+
+static int cont_index(const Cont_List& lst, const Contour *cnt)
+{
+  Cont_C_Cursor cc(lst.List());
+
+  for (int i=0; cc; ++cc,++i) if (&*cc == cnt) return i;
+
+  return -1;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void check(const char *what, const Cont_List& lst)
+{
+  Cont_List cp(lst);   // Not indexed
+
+  for (int i=0; i<20; ++i) {
+    Vec2 p(4.0*i + 3.0, 1.0);
+
+    Cont_Pnt cntp, cp_cntp;
+    double dist, cp_dist;
+
+    lst.Project_Pnt_XY(p,cntp,dist);
+    cp.Project_Pnt_XY(p,cp_cntp,cp_dist);
+
+    int idx = cont_index(lst,cntp.Parent_Contour());
+    int cp_idx = cont_index(cp,cp_cntp.Parent_Contour());
+
+    if (idx != cp_idx || dist != cp_dist) {
+      if (++errors <= 10) {
+        fprintf(stderr,"%s point %d: contour %d, unindexed %d\n",
+                                                     what,i,idx,cp_idx);
+      }
+    }
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+int main()
+{
+  // Squares of 2 by 2, 2 apart
+
+  Cont_Area_List arlst;
+
+  for (int i=0; i<24; ++i) {
+    arlst.Push_Back(Cont_Area(Cont_Clsd(Rect_Ax(4.0*i,0,0, 4.0*i+2.0,2.0,0))));
+  }
+
+  Cont_Area ar;
+  Cont_Area::Combine_All(arlst,false,ar);
+
+  Cont_List lst;
+  lst = ar;
+
+  check("Built",lst);
+  check("Indexed",lst);
+
+  lst.Reverse();
+  check("Reverse",lst);
+
+  lst.Begin_Par(10.0);
+  check("Begin_Par",lst);
+
+  lst.Merge_Elems();
+  check("Merge_Elems",lst);
+
+  Trf2 trf(1.0,0.0,0.0, 0.0,1.0,0.0);
+  lst.Transform(trf);
+  check("Transform",lst);
+
+  if (errors) {
+    fprintf(stderr,"ListIndexTest: %d errors\n",errors);
+    return 1;
+  }
+
+  printf("ListIndexTest: passed\n");
+
+  return 0;
+}
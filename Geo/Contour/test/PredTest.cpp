@@ -0,0 +1,186 @@
+/* ---------------------------------------------------------------------- */
+/* ---------------- Sign Predicate Check -------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+// Checks Geo_Orient, Geo_Line_Circle and Geo_Circle_Circle on exactly
+// touching and collinear cases and on random points against integer
+// arithmetic. The points are small integers, scaled by 2^-20 and moved
+// by 2^20, so their coordinates are exact doubles and the floating
+// point filters cannot decide the touching cases.
+// Returns 0 if all checks pass.
+
+#include "Geo.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+using namespace Ino;
+
+typedef __int128 Big;
+
+static int errors = 0;
+
+/* ---------------------------------------------------------------------- */
+
+static int sign(Big v) { return v > 0 ? 1 : v < 0 ? -1 : 0; }
+
+/* ---------------------------------------------------------------------- */
+
+struct IPnt { long long x, y; };
+
+static double off = 0.0;
+
+static Vec2 pnt(const IPnt& p)
+{
+  return Vec2(off + ldexp((double)p.x,-20), off + ldexp((double)p.y,-20));
+}
+
+static Big sqr(Big v) { return v*v; }
+
+static Big dist2(const IPnt& a, const IPnt& b)
+{
+  return sqr(b.x - a.x) + sqr(b.y - a.y);
+}
+
+static Big cross(const IPnt& a, const IPnt& b, const IPnt& c)
+{
+  return (Big)(b.x - a.x)*(c.y - a.y) - (Big)(b.y - a.y)*(c.x - a.x);
+}
+
+/* ---------------------------------------------------------------------- */
+/* ------- Reference results -------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
+static int ref_orient(const IPnt& a, const IPnt& b, const IPnt& c)
+{
+  return sign(cross(a,b,c));
+}
+
+static int ref_line_circle(const IPnt& s, const IPnt& e,
+                           const IPnt& c, const IPnt& p)
+{
+  return sign(sqr(cross(s,e,c)) - dist2(c,p)*dist2(s,e));
+}
+
+static int ref_circle_circle(const IPnt& c1, const IPnt& p1,
+                             const IPnt& c2, const IPnt& p2)
+{
+  Big a = dist2(c1,p1), b = dist2(c2,p2);
+  Big x = dist2(c1,c2) - a - b;
+
+  int s = sign(sqr(x) - 4*a*b);
+
+  if (s < 0) return 0;
+
+  return x > 0 ? 1 + s : -1 - s;
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void check(const char *what, int got, int want, int n)
+{
+  if (got == want) return;
+
+  if (++errors <= 10) {
+    fprintf(stderr,"%s case %d: got %d, want %d\n",what,n,got,want);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static void check_all(const IPnt *p, int n)
+{
+  check("Geo_Orient",Geo_Orient(pnt(p[0]),pnt(p[1]),pnt(p[2])),
+                                           ref_orient(p[0],p[1],p[2]),n);
+
+  if (p[0].x != p[1].x || p[0].y != p[1].y) {
+    check("Geo_Line_Circle",
+          Geo_Line_Circle(pnt(p[0]),pnt(p[1]),pnt(p[2]),pnt(p[3])),
+                             ref_line_circle(p[0],p[1],p[2],p[3]),n);
+  }
+
+  if ((p[0].x != p[2].x || p[0].y != p[2].y) &&
+      (p[0].x != p[1].x || p[0].y != p[1].y) &&
+      (p[2].x != p[3].x || p[2].y != p[3].y)) {
+    check("Geo_Circle_Circle",
+          Geo_Circle_Circle(pnt(p[0]),pnt(p[1]),pnt(p[2]),pnt(p[3])),
+                            ref_circle_circle(p[0],p[1],p[2],p[3]),n);
+  }
+}
+
+/* ---------------------------------------------------------------------- */
+
+static long long rnd(long long range)
+{
+  long long v = ((long long)rand() << 31) ^ rand();
+  return v % (2*range + 1) - range;
+}
+
+/* ---------------------------------------------------------------------- */
+
+int main()
+{
+  // Touching by construction: a 3-4-5 triangle
+
+  const IPnt touch[][4] = {
+    { { -1, 7 }, {  7, 1 }, { 0, 0 }, { 3, 4 } }, // Tangent line
+    { {  0, 5 }, {  9, 5 }, { 0, 0 }, { 3, 4 } }, // Tangent line
+    { {  0, 0 }, {  3, 4 }, { 6, 8 }, { 3, 4 } }, // Touching outside
+    { {  0, 0 }, {  6, 8 }, { 3, 4 }, { 6, 8 } }, // Touching inside
+    { {  0, 0 }, {  3, 4 }, { 9,12 }, {12,16 } }  // Collinear
+  };
+
+  const int want[][3] = {
+    { -1, 0, 0 }, { -1, 0, 0 }, { 0, -1, 1 }, { 0, -1, -1 }, { 0, -1, 2 }
+  };
+
+  for (int o=0; o<3; ++o) {
+    off = o == 0 ? 0.0 : o == 1 ? ldexp(1.0,20) : -ldexp(1.0,20);
+
+    for (int n=0; n<5; ++n) {
+      const IPnt *p = touch[n];
+
+      check("Geo_Orient",Geo_Orient(pnt(p[0]),pnt(p[1]),pnt(p[2])),
+                                                         want[n][0],n);
+      check("Geo_Line_Circle",
+            Geo_Line_Circle(pnt(p[0]),pnt(p[1]),pnt(p[2]),pnt(p[3])),
+                                                         want[n][1],n);
+      check("Geo_Circle_Circle",
+            Geo_Circle_Circle(pnt(p[0]),pnt(p[1]),pnt(p[2]),pnt(p[3])),
+                                                         want[n][2],n);
+      check_all(p,n);
+
+      // One unit off in either direction must flip the touching result
+
+      for (int d=-1; d<=1; d+=2) {
+        IPnt q[4] = { p[0], p[1], p[2], p[3] };
+        q[3].x += d;
+        check_all(q,n);
+      }
+    }
+  }
+
+  // Random points, small ranges give many exact touches
+
+  srand(1);
+
+  for (int n=0; n<400000; ++n) {
+    long long range = n % 4 == 0 ? 4 : n % 4 == 1 ? 50 : 1 << 20;
+    off = n % 2 ? ldexp(1.0,20) : 0.0;
+
+    IPnt p[4];
+    for (int i=0; i<4; ++i) { p[i].x = rnd(range); p[i].y = rnd(range); }
+
+    check_all(p,n);
+  }
+
+  if (errors) {
+    fprintf(stderr,"PredTest: %d errors\n",errors);
+    return 1;
+  }
+
+  printf("PredTest: passed\n");
+
+  return 0;
+}
@@ -23,6 +23,7 @@ namespace InoRpm
 {
 
 class Capability;
+class NameIndex;
 
 //---------------------------------------------------------------------------
 
@@ -37,7 +38,10 @@ class CapabilityList : public Ino::Persistable
 
   mutable rpmds depSet;
 
+  mutable NameIndex *index; // Built on the first search, NULL if invalid
+
   void incCapacity();
+  const NameIndex& getIndex() const;
 
   CapabilityList& operator=(const CapabilityList& src); // No assignment
 
@@ -0,0 +1,56 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- InoRpm Name Index -------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#ifndef INORPM_NAMEINDEX_INC
+#define INORPM_NAMEINDEX_INC
+
+namespace InoRpm
+{
+
+//---------------------------------------------------------------------------
+
+class NameIndex
+{
+  const char **names;   // Interned names, not owned
+  unsigned int *hashes;
+  int *firstItem, *lastItem;
+  int nameSz, nameCap;
+
+  int *buckets;         // Name ids, open addressing, -1 if empty
+  int bucketMsk;
+
+  int *nextItems;       // Per item the next item with the same name
+  int itemCap;
+
+  static unsigned int hashName(const char *name);
+
+  int findBucket(const char *name, unsigned int hash) const;
+  void rehash(int newCap);
+
+  NameIndex(const NameIndex& cp);             // No copying
+  NameIndex& operator=(const NameIndex& src); // No assignment
+
+public:
+  NameIndex();
+  ~NameIndex();
+
+  void clear();
+
+  int size() const { return nameSz; }
+
+  int add(const char *name, int item);
+  int find(const char *name) const;
+
+  const char *getName(int nameId) const { return names[nameId]; }
+
+  int first(int nameId) const { return firstItem[nameId]; }
+  int next(int item) const { return nextItems[item]; }
+};
+
+} // namespace
+
+//---------------------------------------------------------------------------
+#endif
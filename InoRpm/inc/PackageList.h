@@ -19,6 +19,7 @@ namespace InoRpm
 class Package;
 class Capability;
 class CapabilityList;
+class NameIndex;
 
 //---------------------------------------------------------------------------
 
@@ -44,6 +45,9 @@ private:
 
   void remove(int idx);
 
+  int provCount() const;
+  void buildProvIndex(NameIndex& provIdx, int *provPkg) const;
+
   void buildReqLst(CapabilityList& reqLst) const;
   void buildConflictLst(CapabilityList& conflictLst) const;
 
@@ -11,6 +11,7 @@
 #include "CapabilityList.h"
 
 #include "Capability.h"
+#include "NameIndex.h"
 
 #include "Basics.h"
 #include "Exceptions.h"
@@ -38,7 +39,7 @@ void CapabilityList::incCapacity()
 CapabilityList::CapabilityList(int capType)
 : Persistable(), type(capType),
   lst(NULL), sz(0), cap(0),
-  depSet(NULL)
+  depSet(NULL), index(NULL)
 {
 }
 
@@ -60,7 +61,7 @@ static Capability **dupList(Capability **lst, int sz)
 CapabilityList::CapabilityList(const CapabilityList& cp)
 : Persistable(cp), type(cp.type),
   lst(dupList(cp.lst,cp.sz)), sz(cp.sz), cap(cp.sz),
-  depSet(NULL)
+  depSet(NULL), index(NULL)
 {
 }
 
@@ -74,11 +75,27 @@ CapabilityList::~CapabilityList()
 
   delete[] lst;
 
+  delete index;
+
 #ifndef _WIN32
   rpmdsFree(depSet);
 #endif
 }
 
+//---------------------------------------------------------------------------
+// Returns the index of the capability names, builds it if necessary
+
+const NameIndex& CapabilityList::getIndex() const
+{
+  if (index) return *index;
+
+  index = new NameIndex();
+
+  for (int i=0; i<sz; ++i) index->add(lst[i]->getName(),i);
+
+  return *index;
+}
+
 //---------------------------------------------------------------------------
 
 void CapabilityList::setType(int capType)
@@ -97,6 +114,8 @@ void CapabilityList::clear()
 
   sz = 0;
 
+  if (index) index->clear();
+
 #ifndef _WIN32
   depSet = rpmdsFree(depSet);
 #endif
@@ -150,11 +169,12 @@ const Capability *CapabilityList::find(const char *name) const
 {
   if (!name) return NULL;
 
-  for (int i=0; i<sz; ++i) {
-    if (!compareStr(name,lst[i]->getName())) return lst[i];
-  }
+  const NameIndex& idx = getIndex();
 
-  return NULL;
+  int nameId = idx.find(name);
+  if (nameId < 0) return NULL;
+
+  return lst[idx.first(nameId)];
 }
 
 //---------------------------------------------------------------------------
@@ -173,7 +193,11 @@ void CapabilityList::add(const Capability& capability)
 {
   if (sz >= cap) incCapacity();
 
-  lst[sz++] = new Capability(capability);
+  lst[sz] = new Capability(capability);
+
+  if (index) index->add(lst[sz]->getName(),sz);
+
+  sz++;
 
 #ifndef _WIN32
   depSet = rpmdsFree(depSet);
@@ -184,12 +208,16 @@ void CapabilityList::add(const Capability& capability)
 
 void CapabilityList::addUnique(const Capability& capability)
 {
-  for (int i=0; i<sz; ++i) {
-    if (!compareStr(lst[i]->getName(),capability.getName())) {
+  const NameIndex& idx = getIndex();
+
+  int nameId = idx.find(capability.getName());
+
+  if (nameId >= 0) {
+    for (int i=idx.first(nameId); i>=0; i=idx.next(i)) {
       if (&lst[i]->getPackage() == &capability.getPackage()) return;
     }
   }
-  
+
   add(capability);
 }
 
@@ -205,6 +233,9 @@ void CapabilityList::remove(int idx)
   sz--;
   memmove(lst+idx,lst+idx+1,(sz-idx)*sizeof(Capability *));
 
+  delete index; // The indices have shifted, rebuilt when needed
+  index = NULL;
+
 #ifndef _WIN32
   depSet = rpmdsFree(depSet);
 #endif
@@ -231,7 +262,7 @@ CapabilityList::CapabilityList(Ino::PersistentReader& pi)
   type(pi.readInt(fldType,0)),
   lst((Capability **)pi.readObjArray(fldLst,NULL)),
   sz(pi.readArraySize(fldLst,0)),cap(sz),
-  depSet(NULL)
+  depSet(NULL), index(NULL)
 {
   if (!lst) sz = cap = 0;
 }
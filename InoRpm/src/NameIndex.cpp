@@ -0,0 +1,195 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- InoRpm Name Index -------------------------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#include "NameIndex.h"
+
+#include <string.h>
+
+namespace InoRpm
+{
+
+//---------------------------------------------------------------------------
+// Interns names and keeps, per name, the chain of items (array indices)
+// added with that name, in the order added. An item may only be added
+// once. The names are not copied: they must outlive the index or the
+// index must be cleared first.
+
+NameIndex::NameIndex()
+: names(NULL), hashes(NULL), firstItem(NULL), lastItem(NULL),
+  nameSz(0), nameCap(0),
+  buckets(NULL), bucketMsk(-1),
+  nextItems(NULL), itemCap(0)
+{
+}
+
+//---------------------------------------------------------------------------
+
+NameIndex::~NameIndex()
+{
+  delete[] names;
+  delete[] hashes;
+  delete[] firstItem;
+  delete[] lastItem;
+  delete[] buckets;
+  delete[] nextItems;
+}
+
+//---------------------------------------------------------------------------
+
+void NameIndex::clear()
+{
+  nameSz = 0;
+
+  for (int i=0; i<=bucketMsk; ++i) buckets[i] = -1;
+}
+
+//---------------------------------------------------------------------------
+// FNV-1a
+
+unsigned int NameIndex::hashName(const char *name)
+{
+  unsigned int hash = 2166136261u;
+
+  while (*name) {
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}
+
+//---------------------------------------------------------------------------
+// Returns the bucket that holds name, or else the empty bucket to put it in
+
+int NameIndex::findBucket(const char *name, unsigned int hash) const
+{
+  int b = (int)(hash & bucketMsk);
+
+  for (;;) {
+    int id = buckets[b];
+
+    if (id < 0) return b;
+    if (hashes[id] == hash && !strcmp(names[id],name)) return b;
+
+    b = (b+1) & bucketMsk;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+void NameIndex::rehash(int newCap)
+{
+  delete[] buckets;
+
+  buckets   = new int[newCap];
+  bucketMsk = newCap-1;
+
+  for (int i=0; i<newCap; ++i) buckets[i] = -1;
+
+  for (int id=0; id<nameSz; ++id) {
+    int b = (int)(hashes[id] & bucketMsk);
+
+    while (buckets[b] >= 0) b = (b+1) & bucketMsk;
+
+    buckets[b] = id;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static void growArr(int *& arr, int sz, int newCap)
+{
+  int *newArr = new int[newCap];
+  if (sz > 0) memcpy(newArr,arr,sz*sizeof(int));
+
+  delete[] arr;
+  arr = newArr;
+}
+
+//---------------------------------------------------------------------------
+/** Adds an item under a name.
+  \param name The name, interned if not yet present.
+  \param item The item, a non negative array index that was not added
+  before.
+  \return The id of the name.
+*/
+
+int NameIndex::add(const char *name, int item)
+{
+  if (!name) name = "";
+
+  if (item >= itemCap) {
+    int newCap = itemCap < 16 ? 16 : itemCap*2;
+    while (newCap <= item) newCap *= 2;
+
+    growArr(nextItems,itemCap,newCap);
+    itemCap = newCap;
+  }
+
+  nextItems[item] = -1;
+
+  // Keep the load factor at most one half
+
+  if (2*(nameSz+1) > bucketMsk+1) rehash(bucketMsk < 0 ? 64 : 2*(bucketMsk+1));
+
+  unsigned int hash = hashName(name);
+  int b = findBucket(name,hash);
+  int id = buckets[b];
+
+  if (id >= 0) {
+    nextItems[lastItem[id]] = item;
+    lastItem[id] = item;
+
+    return id;
+  }
+
+  if (nameSz >= nameCap) {
+    int newCap = nameCap < 16 ? 16 : nameCap*2;
+
+    const char **newNames = new const char*[newCap];
+    if (nameSz > 0) memcpy(newNames,names,nameSz*sizeof(const char *));
+    delete[] names;
+    names = newNames;
+
+    unsigned int *newHashes = new unsigned int[newCap];
+    if (nameSz > 0) memcpy(newHashes,hashes,nameSz*sizeof(unsigned int));
+    delete[] hashes;
+    hashes = newHashes;
+
+    growArr(firstItem,nameSz,newCap);
+    growArr(lastItem,nameSz,newCap);
+
+    nameCap = newCap;
+  }
+
+  id = nameSz++;
+
+  names[id]     = name;
+  hashes[id]    = hash;
+  firstItem[id] = item;
+  lastItem[id]  = item;
+
+  buckets[b] = id;
+
+  return id;
+}
+
+//---------------------------------------------------------------------------
+/** Returns the id of a name, or -1 if the name was never added.
+*/
+
+int NameIndex::find(const char *name) const
+{
+  if (nameSz < 1) return -1;
+
+  if (!name) name = "";
+
+  return buckets[findBucket(name,hashName(name))];
+}
+
+} // namespace
+
+//---------------------------------------------------------------------------
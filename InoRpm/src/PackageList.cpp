@@ -13,6 +13,7 @@
 #include "Package.h"
 #include "Capability.h"
 #include "CapabilityList.h"
+#include "NameIndex.h"
 
 #include "Basics.h"
 
@@ -221,10 +222,19 @@ int PackageList::find(const char *name) const
 {
   if (!name) return -1;
 
-  for (int i=0; i<sz; ++i) {
-    if (!compareStr(name,lst[i]->getName())) return i;
+  // The list is sorted on name (see add()), find the first match
+
+  int lwb = 0, upb = sz;
+
+  while (lwb < upb) {
+    int idx = (lwb+upb)/2;
+
+    if (compareStr(lst[idx]->getName(),name) < 0) lwb = idx+1;
+    else upb = idx;
   }
 
+  if (lwb < sz && !compareStr(lst[lwb]->getName(),name)) return lwb;
+
   return -1;
 }
 
@@ -338,6 +348,41 @@ bool PackageList::buildFromInstalled(bool genFiles)
 #endif
 }
 
+//---------------------------------------------------------------------------
+// Indexes the provides of all packages that are not deleted, by name.
+// provPkg receives the package of each item, it needs room for
+// provCount() items.
+
+void PackageList::buildProvIndex(NameIndex& provIdx, int *provPkg) const
+{
+  int item = 0;
+
+  for (int i=0; i<sz; ++i) {
+    if (lst[i]->getState() == Package::StDelete) continue;
+
+    const CapabilityList& prov = lst[i]->provides;
+
+    for (int j=0; j<prov.size(); ++j) {
+      provPkg[item] = i;
+      provIdx.add(prov[j].getName(),item++);
+    }
+  }
+}
+
+//---------------------------------------------------------------------------
+
+int PackageList::provCount() const
+{
+  int cnt = 0;
+
+  for (int i=0; i<sz; ++i) {
+    if (lst[i]->getState() != Package::StDelete)
+      cnt += lst[i]->provides.size();
+  }
+
+  return cnt;
+}
+
 //---------------------------------------------------------------------------
 
 #ifdef _WIN32
@@ -355,8 +400,41 @@ void PackageList::buildConflictLst(CapabilityList& conflictLst) const
 
 //---------------------------------------------------------------------------
 
+//---------------------------------------------------------------------------
+// Returns true if a package other than a deleted one provides the current
+// entry of ds. Only the packages that provide its name are tried, the
+// version check is left to rpmdsSearch.
+
+static bool isProvided(Package **lst, const NameIndex& provIdx,
+                                        const int *provPkg, rpmds ds)
+{
+  int nameId = provIdx.find(rpmdsN(ds));
+
+  if (nameId >= 0) {
+    int lastPkg = -1;
+
+    for (int it=provIdx.first(nameId); it>=0; it=provIdx.next(it)) {
+      if (provPkg[it] == lastPkg) continue; // Same package, tried already
+      lastPkg = provPkg[it];
+
+      rpmds provDs = lst[lastPkg]->provides.getDepSet();
+
+      if (rpmdsSearch(provDs,ds) >= 0) return true;
+    }
+  }
+
+  return rpmdsSearch(rpmDepSet,ds) >= 0;
+}
+
+//---------------------------------------------------------------------------
+
 void PackageList::buildReqLst(CapabilityList& reqLst) const
 {
+  int *provPkg = new int[provCount()+1];
+  NameIndex provIdx;
+
+  buildProvIndex(provIdx,provPkg);
+
   for (int i=0; i<sz; ++i) {
     if (lst[i]->getState() == Package::StDelete) continue;
 
@@ -367,21 +445,7 @@ void PackageList::buildReqLst(CapabilityList& reqLst) const
     int idx = -1;
 
     while ((idx = rpmdsNext(reqDs)) >= 0) {
-      bool found = false;
-
-      for (int j=0; j<sz; ++j) {
-        if (lst[j]->getState() == Package::StDelete) continue;
-
-        rpmds provDs = lst[j]->provides.getDepSet();
-
-        if (rpmdsSearch(provDs,reqDs) >= 0 || 
-                             rpmdsSearch(rpmDepSet,reqDs) >= 0) {
-          found = true;
-          break;
-        }
-      }
-
-      if (!found) {
+      if (!isProvided(lst,provIdx,provPkg,reqDs)) {
         Capability reqCap(rpmdsN(reqDs),rpmdsEVR(reqDs),rpmdsFlags(reqDs));
         reqCap.pkg = lst[i];
 
@@ -389,12 +453,19 @@ void PackageList::buildReqLst(CapabilityList& reqLst) const
       }
     }
   }
+
+  delete[] provPkg;
 }
 
 //---------------------------------------------------------------------------
 
 void PackageList::buildConflictLst(CapabilityList& conflictLst) const
 {
+  int *provPkg = new int[provCount()+1];
+  NameIndex provIdx;
+
+  buildProvIndex(provIdx,provPkg);
+
   for (int i=0; i<sz; ++i) {
     if (lst[i]->getState() == Package::StDelete) continue;
 
@@ -405,21 +476,16 @@ void PackageList::buildConflictLst(CapabilityList& conflictLst) const
     int idx = -1;
 
     while ((idx = rpmdsNext(cfltDs)) >= 0) {
-      for (int j=0; j<sz; ++j) {
-        if (lst[j]->getState() == Package::StDelete) continue;
+      if (isProvided(lst,provIdx,provPkg,cfltDs)) {
+        Capability cfltCap(rpmdsN(cfltDs),rpmdsEVR(cfltDs),rpmdsFlags(cfltDs));
+        cfltCap.pkg = lst[i];
 
-        rpmds provDs = lst[j]->provides.getDepSet();
-
-        if (rpmdsSearch(provDs,cfltDs) >= 0 || 
-                             rpmdsSearch(rpmDepSet,cfltDs) >= 0) {
-          Capability cfltCap(rpmdsN(cfltDs),rpmdsEVR(cfltDs),rpmdsFlags(cfltDs));
-          cfltCap.pkg = lst[i];
-
-          conflictLst.addUnique(cfltCap);
-        }
+        conflictLst.addUnique(cfltCap);
       }
     }
   }
+
+  delete[] provPkg;
 }
 
 #endif
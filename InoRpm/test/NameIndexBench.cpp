@@ -0,0 +1,238 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- InoRpm Name Index Check and Benchmark -----------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+// Checks NameIndex and the indexed CapabilityList::find and addUnique
+// against plain linear scans on a synthetic capability set, then prints
+// the time of both. No rpm database is used.
+// Returns 0 if all checks pass.
+
+#include "NameIndex.h"
+#include "Capability.h"
+#include "CapabilityList.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+using namespace InoRpm;
+
+//---------------------------------------------------------------------------
+
+enum { NameCnt = 5000, CapCnt = 40000 };
+
+static char names[NameCnt][32];
+static int capName[CapCnt];
+
+//---------------------------------------------------------------------------
+
+static void genNames()
+{
+  srand(1);
+
+  for (int i=0; i<NameCnt; ++i) {
+    switch (i % 4) {
+      case 0:  sprintf(names[i],"lib%d.so.%d",i,i%7); break;
+      case 1:  sprintf(names[i],"perl(Mod::%d)",i); break;
+      case 2:  sprintf(names[i],"/usr/bin/tool%d",i); break;
+      default: sprintf(names[i],"pkg-%d-devel",i); break;
+    }
+  }
+
+  // Skewed: a quarter of the capabilities use the first 50 names
+
+  for (int i=0; i<CapCnt; ++i) {
+    capName[i] = (i%4 == 0) ? rand()%50 : rand()%NameCnt;
+  }
+}
+
+//---------------------------------------------------------------------------
+
+static double secSince(clock_t t0)
+{
+  return (double)(clock() - t0) / CLOCKS_PER_SEC;
+}
+
+//---------------------------------------------------------------------------
+
+static bool checkNameIndex()
+{
+  bool ok = true;
+
+  NameIndex idx;
+  int *ids = new int[NameCnt];
+
+  for (int i=0; i<NameCnt; ++i) ids[i] = -1;
+
+  for (int i=0; i<CapCnt; ++i) {
+    int id = idx.add(names[capName[i]],i);
+
+    if (ids[capName[i]] < 0) ids[capName[i]] = id;
+    else if (ids[capName[i]] != id) {
+      printf("NameIndex: name %d got a second id\n",capName[i]);
+      ok = false;
+    }
+  }
+
+  // The chain of each name must hold its items in the order added
+
+  for (int n=0; n<NameCnt && ok; ++n) {
+    int id = idx.find(names[n]);
+
+    if (id != ids[n]) {
+      printf("NameIndex: find of name %d gives %d, expected %d\n",n,id,ids[n]);
+      ok = false;
+      break;
+    }
+
+    if (id < 0) continue;
+
+    if (strcmp(idx.getName(id),names[n])) {
+      printf("NameIndex: wrong name for id %d\n",id);
+      ok = false;
+    }
+
+    int it = idx.first(id);
+
+    for (int i=0; i<CapCnt; ++i) {
+      if (capName[i] != n) continue;
+
+      if (it != i) {
+        printf("NameIndex: chain of name %d has %d, expected %d\n",n,it,i);
+        ok = false;
+        break;
+      }
+
+      it = idx.next(it);
+    }
+
+    if (ok && it >= 0) {
+      printf("NameIndex: chain of name %d too long\n",n);
+      ok = false;
+    }
+  }
+
+  if (idx.find("not-a-name") >= 0) {
+    printf("NameIndex: found a name never added\n");
+    ok = false;
+  }
+
+  idx.clear();
+  if (idx.size() != 0 || idx.find(names[0]) >= 0) {
+    printf("NameIndex: not empty after clear\n");
+    ok = false;
+  }
+
+  delete[] ids;
+
+  return ok;
+}
+
+//---------------------------------------------------------------------------
+
+static bool checkCapabilityList()
+{
+  bool ok = true;
+
+  // Indexed list
+
+  clock_t t0 = clock();
+
+  CapabilityList lst;
+  for (int i=0; i<CapCnt; ++i) {
+    lst.addUnique(Capability(names[capName[i]],"1.0",0));
+  }
+
+  int found = 0;
+  for (int r=0; r<10; ++r) {
+    for (int n=0; n<NameCnt; ++n) if (lst.find(names[n])) found++;
+  }
+
+  double idxSec = secSince(t0);
+
+  // Linear reference, as the list did before the index
+
+  t0 = clock();
+
+  const char **ref = new const char *[CapCnt];
+  int refSz = 0;
+
+  for (int i=0; i<CapCnt; ++i) {
+    const char *nm = names[capName[i]];
+    int j = 0;
+    while (j < refSz && strcmp(ref[j],nm)) j++;
+    if (j == refSz) ref[refSz++] = nm;
+  }
+
+  int refFound = 0;
+  for (int r=0; r<10; ++r) {
+    for (int n=0; n<NameCnt; ++n) {
+      int j = 0;
+      while (j < refSz && strcmp(ref[j],names[n])) j++;
+      if (j < refSz) refFound++;
+    }
+  }
+
+  double linSec = secSince(t0);
+
+  if (lst.size() != refSz || found != refFound) {
+    printf("CapabilityList: %d entries %d found, expected %d and %d\n",
+                                        lst.size(),found,refSz,refFound);
+    ok = false;
+  }
+
+  for (int i=0; i<refSz && i<lst.size() && ok; ++i) {
+    if (strcmp(lst[i].getName(),ref[i])) {
+      printf("CapabilityList: entry %d is %s, expected %s\n",
+                                            i,lst[i].getName(),ref[i]);
+      ok = false;
+    }
+  }
+
+  // The index must follow removals
+
+  while (lst.size() > 0 && ok) {
+    const char *nm = ref[lst.size()-1];
+
+    lst.remove(lst.size()-1);
+
+    if (lst.find(nm)) {
+      printf("CapabilityList: %s found after removal\n",nm);
+      ok = false;
+    }
+
+    if (lst.size() % 1000 == 0 && lst.size() > 0 && !lst.find(ref[0])) {
+      printf("CapabilityList: %s lost after removal\n",ref[0]);
+      ok = false;
+    }
+  }
+
+  delete[] ref;
+
+  printf("%d capabilities, %d names, addUnique + %d finds:\n",
+                                               CapCnt,refSz,10*NameCnt);
+  printf("  indexed %8.3f s\n",idxSec);
+  printf("  linear  %8.3f s\n",linSec);
+
+  return ok;
+}
+
+//---------------------------------------------------------------------------
+
+int main()
+{
+  genNames();
+
+  bool ok = checkNameIndex();
+
+  if (!checkCapabilityList()) ok = false;
+
+  printf("NameIndexBench: %s\n",ok ? "passed" : "FAILED");
+
+  return ok ? 0 : 1;
+}
+
+//---------------------------------------------------------------------------
@@ -163,12 +163,24 @@ public:
 
 class Struct : public Type
 {
+public:
+  struct PlanEntry
+  {
+    Field *fld;              // NULL if not in the stream
+    const type_info *valInf; // Value type fld was checked against
+    bool resolved, isRef;
+  };
+
+private:
   FieldList valList;
   FieldList refList;
 
   bool defined;
   int structSz;
 
+  PlanEntry *plan; // Indexed by PersistentField slot
+  int planSz;
+
   void calcOffsets();
 
   Struct(const Struct& cp);             // No Copying
@@ -176,7 +188,7 @@ class Struct : public Type
 
 public:
   Struct(short typeId, const PersistentBaseType& baseTp);
-  virtual ~Struct() {}
+  virtual ~Struct();
 
   const PersistentBaseType& baseType;
 
@@ -208,6 +220,8 @@ public:
   Field *getValField(const char *fldName) { return valList[fldName]; }
   Field *getRefField(const char *fldName) { return refList[fldName]; }
 
+  PlanEntry& getPlanEntry(const PersistentField& pf);
+
   virtual void write(DataWriter& dWrt) const;
 
   void writeDef(ByteArrayWriter& byteWrt);
@@ -440,7 +440,16 @@ void *InpArrayPool::getPtr(int idx, int& arrSz)
   
   if (!ia.type) return NULL;
 
-  if (!ia.arr) ia.arr = new char[ia.arrSz*ia.type->elemType.getDataSize()];
+  if (!ia.arr) {
+    // Object and array references are pointers in memory, which may
+    // be larger than the id they have in the stream
+
+    int elSz = ia.type->elemType.getDataSize();
+    if (ia.type->elemType.getCategory() != Type::CatBasic)
+                                                   elSz = sizeof(void *);
+
+    ia.arr = new char[ia.arrSz*elSz];
+  }
 
   arrSz = ia.arrSz;
 
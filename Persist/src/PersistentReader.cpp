@@ -387,15 +387,10 @@ void PersistentReader::processEof(MainPersistable *mps, bool reset)
 
 //---------------------------------------------------------------------------
 
-Field *PersistentReader::getValField(const char *fldName,
+Field *PersistentReader::checkValField(Field *fld, const char *fldName,
                                           const type_info& inf,
                                           const char *msg, bool nullOk)
 {
-  if (!curType)
-        throw IllegalStateException("PersistentReader::getValField");
-
-  Field *fld = curType->getValField(fldName);
-
   if (!fld) {
     if (nullOk) return NULL;
     else {
@@ -428,13 +423,9 @@ Field *PersistentReader::getValField(const char *fldName,
 
 //---------------------------------------------------------------------------
 
-Field *PersistentReader::getRefField(const char *fldName, bool nullOk)
+Field *PersistentReader::checkRefField(Field *fld, const char *fldName,
+                                                               bool nullOk)
 {
-  if (!curType)
-           throw IllegalStateException("PersistentReader::getRefField");
-
-  Field *fld = curType->getRefField(fldName);
-
   if (!fld) {
     if (nullOk) return NULL;
     else {
@@ -467,13 +458,9 @@ Field *PersistentReader::getRefField(const char *fldName, bool nullOk)
 
 //---------------------------------------------------------------------------
 
-Field *PersistentReader::getArrayField(const char *fldName, bool nullOk)
+Field *PersistentReader::checkArrayField(Field *fld, const char *fldName,
+                                                                 bool nullOk)
 {
-  if (!curType)
-      throw IllegalStateException("PersistentReader::getValArrayField");
-
-  Field *fld = curType->getRefField(fldName);
-
   if (!fld) {
     if (nullOk) return NULL;
     else {
@@ -504,6 +491,86 @@ Field *PersistentReader::getArrayField(const char *fldName, bool nullOk)
   return fld;
 }
 
+//---------------------------------------------------------------------------
+
+Field *PersistentReader::getValField(const char *fldName,
+                                          const type_info& inf,
+                                          const char *msg, bool nullOk)
+{
+  if (!curType)
+        throw IllegalStateException("PersistentReader::getValField");
+
+  return checkValField(curType->getValField(fldName),fldName,inf,msg,nullOk);
+}
+
+//---------------------------------------------------------------------------
+
+Field *PersistentReader::getRefField(const char *fldName, bool nullOk)
+{
+  if (!curType)
+           throw IllegalStateException("PersistentReader::getRefField");
+
+  return checkRefField(curType->getRefField(fldName),fldName,nullOk);
+}
+
+//---------------------------------------------------------------------------
+
+Field *PersistentReader::getArrayField(const char *fldName, bool nullOk)
+{
+  if (!curType)
+      throw IllegalStateException("PersistentReader::getValArrayField");
+
+  return checkArrayField(curType->getRefField(fldName),fldName,nullOk);
+}
+
+//---------------------------------------------------------------------------
+// The field handle versions resolve the name through the access plan of
+// the current type, a value field that passed the type check once is
+// returned directly from then on.
+
+Field *PersistentReader::getValField(const PersistentField& pf,
+                                          const type_info& inf,
+                                          const char *msg, bool nullOk)
+{
+  if (!curType)
+        throw IllegalStateException("PersistentReader::getValField");
+
+  Struct::PlanEntry& ent = curType->getPlanEntry(pf);
+
+  if (ent.valInf == &inf) return ent.fld;
+
+  Field *fld = checkValField(ent.isRef ? NULL : ent.fld,pf.name,inf,
+                                                              msg,nullOk);
+  if (fld) ent.valInf = &inf;
+
+  return fld;
+}
+
+//---------------------------------------------------------------------------
+
+Field *PersistentReader::getRefField(const PersistentField& pf, bool nullOk)
+{
+  if (!curType)
+           throw IllegalStateException("PersistentReader::getRefField");
+
+  Struct::PlanEntry& ent = curType->getPlanEntry(pf);
+
+  return checkRefField(ent.isRef ? ent.fld : NULL,pf.name,nullOk);
+}
+
+//---------------------------------------------------------------------------
+
+Field *PersistentReader::getArrayField(const PersistentField& pf,
+                                                              bool nullOk)
+{
+  if (!curType)
+      throw IllegalStateException("PersistentReader::getValArrayField");
+
+  Struct::PlanEntry& ent = curType->getPlanEntry(pf);
+
+  return checkArrayField(ent.isRef ? ent.fld : NULL,pf.name,nullOk);
+}
+
 //--------------------------------------------------------------------------
 
 static void skipRecord(DataReader& rdr, int bytes)
@@ -1541,6 +1608,421 @@ Persistable **PersistentReader::readObjArray(const char *fldName,
   return (Persistable **)arrayPool.getPtr(arrId,arrSz);
 }
 
+//---------------------------------------------------------------------------
+/** Checks if a field exists in the stream for the current class.
+  \see fieldExists(const char *fldName)
+*/
+
+bool PersistentReader::fieldExists(const PersistentField& pf)
+{
+  if (!curType) throw IllegalStateException(
+                        "PersistentReader::fieldExists: Illegal Call");
+
+  return curType->getPlanEntry(pf).fld != NULL;
+}
+
+//---------------------------------------------------------------------------
+/** Reads a boolean field using a field handle.
+  \see readBool(const char *fldName)
+*/
+
+bool PersistentReader::readBool(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(bool),"Boolean",false);
+
+  byteRdr.setPos(fld->getOffset());
+
+  return byteDataRdr.readBool();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a boolean field using a field handle.
+  \see readBool(const char *fldName, bool defVal)
+*/
+
+bool PersistentReader::readBool(const PersistentField& pf, bool defVal)
+{
+  Field *fld = getValField(pf,typeid(bool),"Boolean",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+
+  return byteDataRdr.readBool();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c wchar_t field using a field handle.
+  \see readWChar(const char *fldName)
+*/
+
+wchar_t PersistentReader::readWChar(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(wchar_t),"WChar",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readWChar();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c wchar_t field using a field handle.
+  \see readWChar(const char *fldName, wchar_t defVal)
+*/
+
+wchar_t PersistentReader::readWChar(const PersistentField& pf,
+                                    wchar_t defVal)
+{
+  Field *fld = getValField(pf,typeid(wchar_t),"WChar",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readWChar();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a byte (\c char) field using a field handle.
+  \see readByte(const char *fldName)
+*/
+
+char PersistentReader::readByte(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(char),"Byte",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readByte();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a byte (\c char) field using a field handle.
+  \see readByte(const char *fldName, char defVal)
+*/
+
+char PersistentReader::readByte(const PersistentField& pf, char defVal)
+{
+  Field *fld = getValField(pf,typeid(char),"Byte",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readByte();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c short field using a field handle.
+  \see readShort(const char *fldName)
+*/
+
+short PersistentReader::readShort(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(short),"Short",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readShort();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c short field using a field handle.
+  \see readShort(const char *fldName, short defVal)
+*/
+
+short PersistentReader::readShort(const PersistentField& pf, short defVal)
+{
+  Field *fld = getValField(pf,typeid(short),"Short",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readShort();
+}
+
+//---------------------------------------------------------------------------
+/** Reads an \c int or \c long field using a field handle.
+  \see readInt(const char *fldName)
+*/
+
+long PersistentReader::readInt(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(long),"Int",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readInt();
+}
+
+//---------------------------------------------------------------------------
+/** Reads an \c int or \c long field using a field handle.
+  \see readInt(const char *fldName, long defVal)
+*/
+
+long PersistentReader::readInt(const PersistentField& pf, long defVal)
+{
+  Field *fld = getValField(pf,typeid(long),"Int",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readInt();
+}
+
+//---------------------------------------------------------------------------
+/** Reads an \c __int64 field using a field handle.
+  \see readLong(const char *fldName)
+*/
+
+__int64 PersistentReader::readLong(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(__int64),"Long",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readLong();
+}
+
+//---------------------------------------------------------------------------
+/** Reads an \c __int64 field using a field handle.
+  \see readLong(const char *fldName, __int64 defVal)
+*/
+
+__int64 PersistentReader::readLong(const PersistentField& pf,
+                                   __int64 defVal)
+{
+  Field *fld = getValField(pf,typeid(__int64),"Long",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readLong();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c float field using a field handle.
+  \see readFloat(const char *fldName)
+*/
+
+float PersistentReader::readFloat(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(float),"Float",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readFloat();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c float field using a field handle.
+  \see readFloat(const char *fldName, float defVal)
+*/
+
+float PersistentReader::readFloat(const PersistentField& pf, float defVal)
+{
+  Field *fld = getValField(pf,typeid(float),"Float",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readFloat();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c double field using a field handle.
+  \see readDouble(const char *fldName)
+*/
+
+double PersistentReader::readDouble(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(double),"Double",false);
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readDouble();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c double field using a field handle.
+  \see readDouble(const char *fldName, double defVal)
+*/
+
+double PersistentReader::readDouble(const PersistentField& pf,
+                                    double defVal)
+{
+  Field *fld = getValField(pf,typeid(double),"Double",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  return byteDataRdr.readDouble();
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c wchar_t* \b string field using a field handle.
+  \see readString(const char *fldName)
+*/
+
+wchar_t *PersistentReader::readString(const PersistentField& pf)
+{
+  Field *fld = getValField(pf,typeid(wchar_t *),"String",false);
+
+  byteRdr.setPos(fld->getOffset());
+  int strId = byteDataRdr.readInt();
+
+  if (strId == 0) return NULL;
+  return stringPool.get(strId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads a \c wchar_t* \b string field using a field handle.
+  \see readString(const char *fldName, wchar_t *defVal)
+*/
+
+wchar_t *PersistentReader::readString(const PersistentField& pf,
+                                      wchar_t *defVal)
+{
+  Field *fld = getValField(pf,typeid(wchar_t *),"String",true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  int strId = byteDataRdr.readInt();
+
+  if (strId == 0) return NULL;
+  return stringPool.get(strId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an object (derived from Persistable) field using a field handle.
+  \see readObject(const char *fldName)
+*/
+
+Persistable *PersistentReader::readObject(const PersistentField& pf)
+{
+  Field *fld = getRefField(pf,false);
+
+  byteRdr.setPos(fld->getOffset());
+  int pId = byteDataRdr.readInt();
+
+  if (pId == 0) return NULL;
+
+  return structPool.get(pId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an object (derived from Persistable) field using a field handle.
+  \see readObject(const char *fldName, Persistable *defVal)
+*/
+
+Persistable *PersistentReader::readObject(const PersistentField& pf,
+                                          Persistable *defVal)
+{
+  Field *fld = getRefField(pf,true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  int pId = byteDataRdr.readInt();
+
+  if (pId == 0) return NULL;
+
+  return structPool.get(pId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads the stored array size for a field using a field handle.
+  \see readArraySize(const char *fldName)
+*/
+
+int PersistentReader::readArraySize(const PersistentField& pf)
+{
+  Field *fld = getArrayField(pf, false);
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return 0;
+
+  return arrayPool.getSize(arrId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads the stored array size for a field using a field handle.
+  \see readArraySize(const char *fldName, int defVal)
+*/
+
+int PersistentReader::readArraySize(const PersistentField& pf, int defVal)
+{
+  Field *fld = getArrayField(pf, true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return 0;
+
+  return arrayPool.getSize(arrId);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an array field of type <b>other than</b> Persistable ** using a field handle.
+  \see readValArray(const char *fldName)
+*/
+
+void *PersistentReader::readValArray(const PersistentField& pf)
+{
+  Field *fld = getArrayField(pf, false);
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return NULL;
+
+  int arrSz;
+  return arrayPool.getPtr(arrId,arrSz);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an array field of type <b>other than</b> Persistable ** using a field handle.
+  \see readValArray(const char *fldName, void *defVal)
+*/
+
+void *PersistentReader::readValArray(const PersistentField& pf,
+                                     void *defVal)
+{
+  Field *fld = getArrayField(pf, true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return NULL;
+
+  int arrSz;
+  return arrayPool.getPtr(arrId,arrSz);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an array field of type Persistable ** using a field handle.
+  \see readObjArray(const char *fldName)
+*/
+
+Persistable **PersistentReader::readObjArray(const PersistentField& pf)
+{
+  Field *fld = getArrayField(pf, false);
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return NULL;
+
+  int arrSz;
+  return (Persistable **)arrayPool.getPtr(arrId,arrSz);
+}
+
+//---------------------------------------------------------------------------
+/** Reads an array field of type Persistable ** using a field handle.
+  \see readObjArray(const char *fldName, Persistable **defVal)
+*/
+
+Persistable **PersistentReader::readObjArray(const PersistentField& pf,
+                                             Persistable **defVal)
+{
+  Field *fld = getArrayField(pf,true);
+  if (!fld) return defVal;
+
+  byteRdr.setPos(fld->getOffset());
+  int arrId = byteDataRdr.readInt();
+
+  if (arrId == 0) return NULL;
+
+  int arrSz;
+  return (Persistable **)arrayPool.getPtr(arrId,arrSz);
+}
+
 //--------------------------------------------------------------------------
 
 void PersistentReader::readArray()
@@ -1681,6 +2163,36 @@ void PersistentReader::readArrayArray(void * /*arr*/, int /*items*/,
   throw OperationNotSupportedException("PersistentReader::readArrayArray");
 }
 
+//---------------------------------------------------------------------------
+/** \class PersistentField
+  A field name for use in a persistence constructor.
+
+  A PersistentReader resolves a PersistentField only once per class in a
+  stream and caches the result, a field that is read using a field name
+  is looked up each time again.\n
+  So for classes that are restored in large numbers declare the field
+  names as (static) PersistentField instances at namespace scope instead
+  of \c char arrays.\n
+  A PersistentField converts to <tt>const char *</tt>, so the same
+  instance can be used with a PersistentWriter.
+*/
+
+int PersistentField::slotCnt = 0;
+
+//---------------------------------------------------------------------------
+/** Constructor.
+  \param fldName The name of the field, this must remain valid for the
+  lifetime of the PersistentField (normally a string literal).
+*/
+
+PersistentField::PersistentField(const char *fldName)
+: slot(slotCnt++), name(fldName)
+{
+  if (!fldName) throw NullPointerException("PersistentField::PersistentField");
+  if (strlen(fldName) < 1)
+           throw IllegalArgumentException("PersistentField::PersistentField");
+}
+
 } // namespace Ino
 
 //---------------------------------------------------------------------------
@@ -48,12 +48,61 @@ void Struct::calcOffsets()
 
 Struct::Struct(short typeId, const PersistentBaseType& baseTp)
 : Type(typeId), valList(), refList(), defined(false), structSz(0),
-  baseType(baseTp)
+  plan(NULL), planSz(0), baseType(baseTp)
 {
 }
 
 //---------------------------------------------------------------------------
 
+Struct::~Struct()
+{
+  delete[] plan;
+}
+
+//---------------------------------------------------------------------------
+// Returns the access plan entry of a field handle, resolving the field
+// name on first use only.
+// A Struct is owned by one stream and bound to one runtime type, so the
+// plan is per (stream type, runtime type).
+
+Struct::PlanEntry& Struct::getPlanEntry(const PersistentField& pf)
+{
+  int slot = pf.getSlot();
+
+  if (slot >= planSz) {
+    int newSz = PersistentField::getSlotCount();
+    if (newSz <= slot) newSz = slot+1;
+
+    PlanEntry *newPlan = new PlanEntry[newSz];
+
+    if (planSz > 0) memcpy(newPlan,plan,planSz*sizeof(PlanEntry));
+    memset(newPlan+planSz,0,(newSz-planSz)*sizeof(PlanEntry));
+
+    delete[] plan;
+    plan   = newPlan;
+    planSz = newSz;
+  }
+
+  PlanEntry& ent = plan[slot];
+
+  if (!ent.resolved) {
+    ent.fld   = valList[pf.name];
+    ent.isRef = false;
+
+    if (!ent.fld) {
+      ent.fld   = refList[pf.name];
+      ent.isRef = ent.fld != NULL;
+    }
+
+    ent.valInf   = NULL;
+    ent.resolved = true;
+  }
+
+  return ent;
+}
+
+//---------------------------------------------------------------------------
+
 int Struct::getStructSize() const
 {
   if (!defined) throw IllegalStateException("Struct::getStructSize");
@@ -77,13 +77,15 @@ struct IT_Std_Alloc
 
 /* ---------------------------------------------------------------------- */
 /* ------ Chain Allocator for Inofor Templates -------------------------- */
+/* ------ Each thread keeps its own free chain, Cleanup() only frees ---- */
+/* ------ the chain of the calling thread ------------------------------- */
 /* ---------------------------------------------------------------------- */
 
 template <class T>
 class IT_Chain_Alloc
 {
     IT_Chain_Alloc *next;
-    static IT_Chain_Alloc *root;
+    static thread_local IT_Chain_Alloc *root;
 
   public:
     static T* New();
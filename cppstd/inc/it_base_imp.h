@@ -13,6 +13,13 @@
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
+template <class T>
+thread_local IT_Chain_Alloc<T> *IT_Chain_Alloc<T>::root = NULL;
+
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+/* ---------------------------------------------------------------------- */
+
 template <class T>
 T *IT_Chain_Alloc<T>::New()
 {
@@ -14,6 +14,8 @@
 namespace Ino
 {
 
+class Writer;
+
 //---------------------------------------------------------------------------
 
 class Base64
@@ -32,6 +34,13 @@ public:
 
   const char *encode(const char *msg, int len, int& codeLen);
   const char *decode(const char *msg, int len, int& decodeLen);
+
+  bool encode(const char *msg, int len, Writer& wrt);
+  bool decode(const char *msg, int len, Writer& wrt);
+
+  static int encodedLength(int len) { return (len+2)/3*4; }
+  static int encode(const char *msg, int len, char *code);
+  static int decode(const char *msg, int len, char *data);
 };
 
 } // namespace Ino
@@ -16,6 +16,7 @@
 #endif
 
 #include <cwchar>
+#include <atomic>
 
 #ifdef __BORLANDC__
 #include <_stddef.h>
@@ -119,15 +120,30 @@ extern bool fileDateTime(wchar_t *s, size_t cap);
 class ProgressReporter
 {
   long reportInc, maxProg, maxSc;
-  long curProg, curSc;
-  bool abort;
+  long curSc;
+  std::atomic<long> curProg;
+  std::atomic<long> nextProg; // Progress at which the scaled value changes
+  std::atomic<bool> abort;
+  std::atomic_flag reporting; // Serializes reports from addProgress()
+  std::atomic<bool> polled;
+
+  ProgressReporter *parentRep;
+
+  long scaled(long prog) const;
+  long stepAbove(long sc) const;
+  bool report(long prog);
 
   ProgressReporter(const ProgressReporter& cp);
   ProgressReporter& operator=(const ProgressReporter& src);
 
+protected:
+  ProgressReporter(ProgressReporter& parent, long maxProgress,
+                                      long reportIncrement, long maxScale);
+
 public:
   ProgressReporter(long maxProgress, long reportIncrement=4096,
                                                       long maxScale=100);
+  virtual ~ProgressReporter() {}
 
   long getReportInc() const { return reportInc; }
 
@@ -136,8 +152,53 @@ public:
   bool setProgress(int newProgress);
   bool incProgress(int progInc=1);
 
+  bool addProgress(long progInc);
+
+  void setPolled(bool poll) { polled.store(poll); }
+  bool poll();
+
   virtual bool progressReport(int progScale) = 0;
-  bool mustAbort() const { return abort; }
+
+  void requestAbort() { abort.store(true); }
+
+  bool mustAbort() const {
+    return abort.load(std::memory_order_relaxed) ||
+                                        (parentRep && parentRep->mustAbort());
+  }
+};
+
+//---------------------------------------------------------------------------
+
+inline bool ProgressReporter::incProgress(int progInc)
+{
+  long prog = curProg.load(std::memory_order_relaxed) + progInc;
+  curProg.store(prog,std::memory_order_relaxed);
+
+  if (progInc >= 0 && prog < nextProg.load(std::memory_order_relaxed))
+    return !mustAbort();
+
+  if (abort.load(std::memory_order_relaxed)) return false;
+
+  return report(prog);
+}
+
+//---------------------------------------------------------------------------
+
+class ProgressChild : public ProgressReporter
+{
+  ProgressReporter& parent;
+  long share, reported;
+
+  ProgressChild(const ProgressChild& cp);
+  ProgressChild& operator=(const ProgressChild& src);
+
+public:
+  ProgressChild(ProgressReporter& parentRep, long shareOfParent,
+                          long maxProgress, long reportIncrement=4096);
+
+  virtual bool progressReport(int progScale);
+
+  bool finish();
 };
 
 } // namespace Ino
@@ -53,6 +53,7 @@ public:
                                                 unsigned char blue);
   void addPoint(const Vec3& p);
   void addLine(const Vec3& p1, const Vec3& p2);
+  void addPolyLine(const Vec3 *ptLst, int listLen);
   void addArc(const Vec3& c, double radius,
                             double startAng, double endAng, const Trf3& trf);
   void addCircle(const Vec3& c, double radius, const Trf3& trf);
@@ -22,6 +22,8 @@ extern void crc16(const char *data, int len, char chksum[2]);
 
 extern void crc16(const wchar_t *data, int len, char chksum[2]);
 
+extern unsigned int updateCrc32(unsigned int crc, const char *data, int len);
+
 } // namespace Ino
 
 //---------------------------------------------------------------------------
@@ -21,7 +21,7 @@ namespace Ino
 class DesCipher
 {
   char chKey[8];
-  unsigned char desKey[64];
+  unsigned char keySched[16][8]; // Per round 8 S-box key chunks of 6 bits
 
 public:
   DesCipher(const char key[8]);
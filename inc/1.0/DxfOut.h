@@ -13,6 +13,8 @@
 
 #include "Contour.h"
 
+#include <cstdio>
+
 //---------------------------------------------------------------------------
 
 namespace Ino
@@ -35,7 +37,13 @@ public:
 
 private:
   Writer *wrtr;
+  Writer *outWrtr; // Either wrtr or the entity spool
+
+  FILE *spoolFd;
+  Writer *spoolWrtr;
 
+  bool spoolTables;
+  bool entitiesStarted;
   bool prologWritten;
   bool epilogWritten;
   bool reverseExtrusionDir;
@@ -54,6 +62,9 @@ private:
 
   int laySz,layCap;
 
+  int *layHash;  // Case insensitive hash of layer names into layLst
+  int hashCap;
+
   long currentLayer;
   Color currentColor;
   bool forceElemColor;
@@ -61,18 +72,20 @@ private:
   long decimals;
   double zeroTol;
 
-  enum { FmtBufSz = 60 };
-  char dblFormat[FmtBufSz];
-  char pnt2Format[FmtBufSz];
-  char pnt3Format[FmtBufSz];
-
   Color currentElemColor() const;
 
+  static unsigned int hashName(const char *name);
+  void hashLayer(int layIdx);
+  void rehashLayers(int newCap);
+
   void aaa(const Vec3& zDir, Trf3& trf);
 
   void writeGroup(int code, const char *val);
   void writeGroup(int code, int val);
   void writeHexGroup(int code, int val);
+  int putEol(char *buf) const;
+  int putValue(int code, double val, char *buf) const;
+
   void writeGroup(int code, double val);
   void writePoint(double x, double y);
   void writePoint2D(const Vec2& pt);
@@ -95,6 +108,8 @@ private:
   void writeBlocks();
 
   void writeProlog();
+  bool openSpool();
+  void writeSpooled();
 
   void writeObjects();
   void writeEpilog();
@@ -114,6 +129,9 @@ public:
 
   void setVersion2007() { version2007 = true; }
 
+  bool setSpooledTables(bool spool); // Call before the first entity
+  bool getSpooledTables() const { return spoolTables; }
+
   void finish();
 
   bool isOpen() const;
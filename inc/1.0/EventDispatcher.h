@@ -27,15 +27,16 @@ public:
   virtual ~EventListener() {}
 
 friend class EventDispatcher;
+friend class EventDispatcherImp;
 };
 
 //---------------------------------------------------------------------------
 
-class EventLstEntry;
+class EventDispatcherImp;
 
 class EventDispatcher
 {
-  EventLstEntry *fstEnt;
+  EventDispatcherImp& imp;
 
 protected:
   void fireListeners(void *param=0);
@@ -51,7 +52,13 @@ public:
   void removeListener(EventListener& oldListener);
   void removeAllListeners();
 
-  bool hasListeners() { return fstEnt != 0; }
+  bool hasListeners() const;
+
+  void setQueued(bool queued);
+  bool isQueued() const;
+  void setCoalesced(bool coalesced);
+  bool isCoalesced() const;
+  void flushEvents();
 };
 
 } // namespace Ino
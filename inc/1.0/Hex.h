@@ -14,6 +14,8 @@
 namespace Ino 
 {
 
+class Writer;
+
 //---------------------------------------------------------------------------
 
 class Hex
@@ -32,6 +34,12 @@ public:
 
   const char *encode(const char *msg, int len, int& codeLen);
   const char *decode(const char *msg, int len, int& decodeLen);
+
+  bool encode(const char *msg, int len, Writer& wrt);
+  bool decode(const char *msg, int len, Writer& wrt);
+
+  static int encode(const char *msg, int len, char *code);
+  static int decode(const char *msg, int len, char *data);
 };
 
 } // namespace
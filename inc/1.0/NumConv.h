@@ -0,0 +1,40 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- Re-entrant number formatting and parsing --------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#ifndef INO_NUMCONV_INC
+#define INO_NUMCONV_INC
+
+#include <wchar.h>
+
+//---------------------------------------------------------------------------
+
+namespace Ino
+{
+
+// Large enough for any long and for any double with at most 17
+// fractional digits, including the terminating zero.
+
+enum { NumBufCap = 352 };
+
+extern int formatInt(long val, char *buf);
+extern int formatInt(long val, wchar_t *buf);
+
+extern int formatDouble(double val, int digits, char *buf, int cap);
+extern int formatDouble(double val, int digits, wchar_t *buf, int cap);
+
+extern const char    *scanInt(const char *first, const char *last, long& val);
+extern const wchar_t *scanInt(const wchar_t *first, const wchar_t *last,
+                                                               long& val);
+
+extern const char    *scanDouble(const char *first, const char *last,
+                                                             double& val);
+extern const wchar_t *scanDouble(const wchar_t *first, const wchar_t *last,
+                                                             double& val);
+
+} // namespace Ino
+
+//---------------------------------------------------------------------------
+#endif
@@ -197,6 +197,28 @@ public:
 
 //---------------------------------------------------------------------------
 
+class PersistentField
+{
+  static int slotCnt;
+
+  const int slot;
+
+  PersistentField(const PersistentField& cp);             // No Copying
+  PersistentField& operator=(const PersistentField& src); // No Assignment
+
+public:
+  explicit PersistentField(const char *fldName);
+
+  const char *const name;
+
+  int getSlot() const { return slot; }
+  static int getSlotCount() { return slotCnt; }
+
+  operator const char *() const { return name; }
+};
+
+//---------------------------------------------------------------------------
+
 using namespace InoPersist;
 
 class PersistentReader
@@ -229,11 +251,21 @@ class PersistentReader
 
   void processEof(MainPersistable *mps, bool reset);
 
+  Field *checkValField(Field *fld, const char *fldName,
+                       const type_info& inf, const char *msg, bool nullOk);
+  Field *checkRefField(Field *fld, const char *fldName, bool nullOk);
+  Field *checkArrayField(Field *fld, const char *fldName, bool nullOk);
+
   Field *getValField(const char *fldName, const type_info& inf,
                                const char *msg, bool nullOk);
   Field *getRefField(const char *fldName, bool nullOk);
   Field *getArrayField(const char *fldName, bool nullOk);
 
+  Field *getValField(const PersistentField& pf, const type_info& inf,
+                               const char *msg, bool nullOk);
+  Field *getRefField(const PersistentField& pf, bool nullOk);
+  Field *getArrayField(const PersistentField& pf, bool nullOk);
+
   const wchar_t *getString(int strId);
 
   void readStruct();
@@ -304,6 +336,49 @@ public:
 
   Persistable **readObjArray(const char *fldName);
   Persistable **readObjArray(const char *fldName, Persistable **defVal);
+
+  // Same, with a pre-resolved field handle:
+
+  bool fieldExists(const PersistentField& pf);
+
+  bool readBool(const PersistentField& pf);
+  bool readBool(const PersistentField& pf, bool defVal);
+
+  wchar_t readWChar(const PersistentField& pf);
+  wchar_t readWChar(const PersistentField& pf, wchar_t defVal);
+
+  char readByte(const PersistentField& pf);
+  char readByte(const PersistentField& pf, char defVal);
+
+  short readShort(const PersistentField& pf);
+  short readShort(const PersistentField& pf, short defVal);
+
+  long readInt(const PersistentField& pf);
+  long readInt(const PersistentField& pf, long defVal);
+
+  __int64 readLong(const PersistentField& pf);
+  __int64 readLong(const PersistentField& pf, __int64 defVal);
+
+  float readFloat(const PersistentField& pf);
+  float readFloat(const PersistentField& pf, float defVal);
+
+  double readDouble(const PersistentField& pf);
+  double readDouble(const PersistentField& pf, double defVal);
+
+  wchar_t *readString(const PersistentField& pf);
+  wchar_t *readString(const PersistentField& pf, wchar_t *defVal);
+
+  Persistable *readObject(const PersistentField& pf);
+  Persistable *readObject(const PersistentField& pf, Persistable *defVal);
+
+  int readArraySize(const PersistentField& pf);
+  int readArraySize(const PersistentField& pf, int defVal);
+
+  void *readValArray(const PersistentField& pf);
+  void *readValArray(const PersistentField& pf, void *defVal);
+
+  Persistable **readObjArray(const PersistentField& pf);
+  Persistable **readObjArray(const PersistentField& pf, Persistable **defVal);
 };
 
 //---------------------------------------------------------------------------
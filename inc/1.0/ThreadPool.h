@@ -0,0 +1,65 @@
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+//------- Fixed size pool of worker threads ---------------------------------
+//---------------------------------------------------------------------------
+//---------------------------------------------------------------------------
+
+#ifndef INOTHREADPOOL_INC
+#define INOTHREADPOOL_INC
+
+//---------------------------------------------------------------------------
+
+namespace Ino
+{
+
+class ThreadPoolImp;
+
+class ThreadPool
+{
+public:
+  class Task
+  {
+    friend class ThreadPool;
+    friend class ThreadPoolImp;
+
+    Task *nextQ;
+    bool done, failed;
+
+    Task(const Task& cp);             // No copying
+    Task& operator=(const Task& src); // No assignment
+
+  public:
+    Task() : nextQ(0), done(true), failed(false) {}
+    virtual ~Task() {}
+
+    virtual void run() = 0;
+  };
+
+private:
+  ThreadPoolImp& imp;
+
+  ThreadPool(const ThreadPool& cp);             // No copying
+  ThreadPool& operator=(const ThreadPool& src); // No assignment
+
+public:
+  ThreadPool(int threadCount = -1);
+  ~ThreadPool();
+
+  static int processorCount();
+  static bool isWorkerThread();
+
+  int getThreadCount() const;
+
+  void submit(Task& task);
+
+  bool isDone(const Task& task) const;
+  bool wait(Task& task);
+  bool waitAll();
+
+  bool runAll(Task **taskLst, int taskCnt);
+};
+
+} // namespace Ino
+
+//---------------------------------------------------------------------------
+#endif
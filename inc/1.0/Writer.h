@@ -99,6 +99,7 @@ class CompressedWriter : public Writer
 
   bool compressing;
   bool flushed;
+  bool rawDeflate;
 
   long rawBytesWritten;
 
@@ -119,6 +120,9 @@ public:
   bool isCompressing() const { return compressing; }
   void setCompressing(bool newCompress);
 
+  bool isRawDeflate() const { return rawDeflate; }
+  bool setRawDeflate(bool raw);
+
   long getRawBytesWritten() const { return rawBytesWritten; }
   virtual void resetBytesWritten();
 
@@ -307,8 +311,10 @@ class Base64Writer : public Writer
   Writer& wrt;
   char buf[84];
   int bufSz, mod, msk;
+  char *lineBuf; // Complete lines for bulk conversion
 
   bool writeBuf();
+  bool writeLines(const char *msg, int lineCnt);
 
   bool reportProgress();
 
@@ -25,20 +25,26 @@ class ZipOut : public Writer
   CompressedWriter& cWrt;
   DataWriter& dWrt;
   class ZipFileList& fileLst;
+  class ZipJobQueue& jobQ;
+  const bool streaming;
   bool closed;
 
+  bool writeLocalHeader(class ZipFile& zf);
   bool writeLastFile();
+  bool writeQueued(bool all);
   bool writeDirectory();
 
   ZipOut(const ZipOut& cp);             // No copying
   ZipOut& operator=(const ZipOut& src); // No assignment
 
 public:
-  ZipOut(Writer& writer);
+  ZipOut(Writer& writer, bool streamEntries = false);
   virtual ~ZipOut();
 
   Writer& getWriter();
 
+  bool isStreaming() const { return streaming; }
+
   virtual bool isClosed() const;
   virtual bool isAborted() const;
   virtual long getErrorCode() const;
@@ -48,6 +54,10 @@ public:
   virtual bool addFile(const char *path, bool compressed = true);
   virtual bool write(const char *buf, int sz);
 
+  bool setThreadCount(int threadCount);
+  virtual bool queueFile(const char *path, const char *data, int sz,
+                                                    bool compressed = true);
+
   virtual bool flush() { return true; }
 
   virtual bool close();
@@ -20,6 +20,7 @@
 namespace Ino
 {
   class Trf2;
+  class IB_Int_Arr;
 }
 
 namespace Ino
@@ -33,6 +34,11 @@ extern const int Cont_Sub_Rect_Max_Elems;
 extern const double Cont_Sub_Rect_Max_Area_Rel;
 
 class Elem_Rect_List;
+class Cont_Slabs;
+class Cont_Persist_Pack;
+class Cont_Projector;
+class Cont_Polyline;
+class Cont_Rtree;
 
 class Contour;
 class Cont_Clsd;
@@ -141,7 +147,7 @@ class Cont_Pnt
     const Vec2& Tang_After_XY()  const { return tg_aft_xy; }
 
     double      Curve_Before() const { return curve_bef; }
-    double      Curve_After()  const { return curve_bef; }
+    double      Curve_After()  const { return curve_aft; }
 
     Vec2        Normal_Before_XY() const;
     Vec2        Normal_After_XY () const;
@@ -168,6 +174,7 @@ class Cont_Pnt
     friend class Cont2_Isect_List;
     friend class Contour;
     friend class Cont_Final;
+    friend class Cont_Sampler;
 };
 
 /* ---------------------------------------------------------------------- */
@@ -247,6 +254,11 @@ class Contour: public Persistable, protected Rect_Ax
   mutable Elem_List el_list;
   mutable Elem_Rect_List *el_rect_list;
 
+  mutable Cont_Slabs *slabs;  // Point in contour index, see Pt_Inside()
+  mutable int inside_cnt;
+
+  mutable Cont_Polyline *polylines; // Tessellations, see Polyline()
+
   mutable bool intersecting_valid;
   mutable bool intersecting;
 
@@ -260,12 +272,17 @@ class Contour: public Persistable, protected Rect_Ax
 
   mutable int persistLstLen;
   mutable Elem **persistLst;
+  mutable Cont_Persist_Pack *persistPack;
 
   void calc_invar(double tol = Vec2::IdentDist);
+  void unpack_persist();
 
   void inval_rects() const;
   void copy_invar_to(Contour& dst) const;
   void build_rect_list() const;
+  bool prepared_inside(const Vec2& p, bool& inside) const;
+  void project_finish(const Vec2& p, const Elem_C_Cursor& elc, double parm,
+                      const Vec3& pp, Cont_Pnt& cntp, double& dist_xy) const;
   void sharpen_Offset(double limAng, bool noArcs);
 
   void cleanSingle(bool closed, double offset);
@@ -327,6 +344,11 @@ class Contour: public Persistable, protected Rect_Ax
 
   const Cont_Inert& Inert() const;
 
+  // Cached per tolerance rounded down to a power of two, valid until
+  // the contour changes or Drop_Polylines() is called
+  const Cont_Polyline& Polyline(double chord_tol) const;
+  void Drop_Polylines() const;
+
   void  Parent(void *newparent) { parent = newparent; }
   void *Parent() const { return parent; }
 
@@ -350,6 +372,8 @@ class Contour: public Persistable, protected Rect_Ax
                          bool cleanup = true) const;
 
   bool Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp, double& dist_xy) const;
+  bool Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                       Cont_Pnt *cntps, double *dists_xy) const;
 
   bool Offset_Into(double offdist, Cont_List& cnt_list) const;
   bool Offset_Into(double offdist, Cont_List& cnt_list,
@@ -427,6 +451,11 @@ class Contour: public Persistable, protected Rect_Ax
   friend class Cont_Pocket;
   friend class Cont_Final;
   friend class Cont_Mill_Old;
+  friend class Cont_Prepared;
+  friend class Cont_Projector;
+  friend class Cont_Sampler;
+
+  friend bool Pt_Inside(const Vec2& p, const Cont_Clsd& cnt, bool& on_cnt);
 };
 
 /* ---------------------------------------------------------------------- */
@@ -560,11 +589,17 @@ class Cont_List : protected Rect_Ax
 {
    Cont_D_List contlst;
 
+   mutable Cont_Rtree *rtree;         // Index for Project_Pnt_XY()
+   mutable const Contour **rtree_cnts;
+   mutable int proj_cnt;
+
    void calc_invar();
+   void drop_index() const;
 
   public:
    Cont_List();
    Cont_List(const Cont_List& cp);
+   ~Cont_List();
 
    Cont_List& operator=(const Cont_List& src);
    Cont_List& operator=(const Cont_Nest& src);
@@ -595,6 +630,8 @@ class Cont_List : protected Rect_Ax
    void Set_Elem_Cnt_Ids(int newid);
 
    bool Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp, double& dist_xy) const;
+   bool Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                        Cont_Pnt *cntps, double *dists_xy) const;
 
    void Reverse();
 
@@ -684,6 +721,8 @@ class Cont_Nest : protected Rect_Ax
 
   void Reverse();
 
+  void Transform(const Trf2& trf);
+
   void Del_Info();
 
   void Set_Elem_Z(double new_z);
@@ -711,6 +750,11 @@ typedef IT_Chain_Alloc<IT_D_Item<Cont_Nest> > Cont_Nest_Alloc;
 typedef IT_D_List<Cont_Nest, Cont_Nest_Alloc> Cont_Nest_D_List;
 typedef Cont_Nest_D_List::C_Cursor Cont_Nest_C_Cursor;
 
+typedef IT_Chain_Alloc<IT_D_Item<Cont_Area> > Cont_Area_Alloc;
+typedef IT_D_List<Cont_Area,Cont_Area_Alloc>  Cont_Area_List;
+typedef Cont_Area_List::C_Cursor              Cont_Area_C_Cursor;
+typedef Cont_Area_List::Cursor                Cont_Area_Cursor;
+
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
@@ -734,6 +778,12 @@ class Cont_Area : protected Rect_Ax
   bool compile_from_cont(Elem_List& el_lst, bool is_ccw,
                                             bool to_left, double tol);
 
+  static bool combine_pair(Cont_Area& ar1, Cont_Area& ar2,
+                                           bool to_left, bool common);
+
+  static void polygon_around(const Cont_Nest& src, double tol,
+                                                   Cont_Nest& poly);
+
  public:
   Cont_Area() : Rect_Ax(), nestlst(), lccw(false), z(0.0) {}
   Cont_Area(const Cont_Clsd& cl_cont);
@@ -800,19 +850,34 @@ class Cont_Area : protected Rect_Ax
 
   bool Project_Pnt_XY(const Vec2& p, Cont_Pnt& cntp,
                                                  double& dist_xy) const;
+  bool Project_Pnts_XY(const Vec2 *pnts, int cnt,
+                       Cont_Pnt *cntps, double *dists_xy) const;
   bool Par_Dist_Along(const Vec2& sp, const Vec2& ep,
                       Cont_Pnt& spnt, double& sdist,
                       Cont_Pnt& epnt, double& edist,
                       double& pdist, bool& rev) const;
 
   bool Offset_Into(double offdist, Cont_Area& ar_list) const;
+  bool Offset_Ladder(const double *offdists, int cnt,
+                                     Cont_Area_List& rings) const;
 
   bool Combine_With(bool rev1, const Cont_Area& ar2, bool rev2,
                                 bool to_left, Cont_Area& into,
                                 Cont_List *rest1 = NULL,
                                 Cont_List *rest2 = NULL) const;
+
+  static bool Combine_All(Cont_Area_List& arlst, bool to_left,
+                                                   Cont_Area& into);
+
+  bool Minkowski_Into(const Cont_Area& ar2, double tol,
+                                               Cont_Area& into) const;
+  bool No_Fit_Into(const Cont_Area& moving, double tol,
+                                               Cont_Area& nfp) const;
+
   void Reverse();
 
+  void Transform(const Trf2& trf);
+
   void Del_Info();
 
   void Delete_Unisource_Nests();
@@ -837,16 +902,277 @@ class Cont_Area : protected Rect_Ax
   friend class Cont_NcJob;
   friend class Cont_Pr_Lvl;
   friend class Cont_Slice;
+  friend class Cont_Combine_Task;
 };
 
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-typedef IT_Chain_Alloc<IT_D_Item<Cont_Area> > Cont_Area_Alloc;
-typedef IT_D_List<Cont_Area,Cont_Area_Alloc>  Cont_Area_List;
-typedef Cont_Area_List::C_Cursor              Cont_Area_C_Cursor;
-typedef Cont_Area_List::Cursor                Cont_Area_Cursor;
+/* ---------------------------------------------------------------------- */
+/* ------- Prepared (read only) contour, nest or area ------------------- */
+/* ---------------------------------------------------------------------- */
+
+class Cont_Prepared
+{
+   const Cont_Clsd *clsd;
+   const Cont_Nest *nest;
+   const Cont_Area *area;
+
+   Cont_Slabs *slabs;
+
+   void build(const Cont_Clsd_D_List& cnt_list);
+
+   Cont_Prepared(const Cont_Prepared& cp);             // No copying
+   Cont_Prepared& operator=(const Cont_Prepared& src); // No assignment
+
+  public:
+   Cont_Prepared(const Cont_Clsd& cnt);
+   Cont_Prepared(const Cont_Nest& nst);
+   Cont_Prepared(const Cont_Area& ar);
+   ~Cont_Prepared();
+
+   const Rect_Ax& Rect() const;
+
+   bool Pnt_Inside(const Vec2& p) const;
+   bool Pnt_Inside(const Vec2& p, bool& on_cnt) const;
+
+   bool Cnt_Inside(const Contour& cnt, const Contour* &colinear) const;
+};
+
+/* ---------------------------------------------------------------------- */
+/* ------- Sampler for many parameters along a contour ------------------ */
+/* ---------------------------------------------------------------------- */
+
+class Cont_Sampler
+{
+   const Contour& cont;
+
+   Elem_C_Cursor elc;     // Element of the last parameter
+   double beg_par, end_par;
+
+   bool to_par(double& par);
+
+   Cont_Sampler(const Cont_Sampler& cp);             // No copying
+   Cont_Sampler& operator=(const Cont_Sampler& src); // No assignment
+
+  public:
+   enum Attr { Pnt = 1, Tang = 2, Tang_XY = 4, Curve = 8 };
+
+   Cont_Sampler(const Contour& cnt);
+
+   bool To_Par(double par, Cont_Pnt& cntp);
+
+   bool Sample(const double *pars, int cnt, int attrs,
+               Vec3 *pnts, Vec3 *tangs, Vec2 *tangs_xy, double *curves);
+};
+
+/* ---------------------------------------------------------------------- */
+/* ------- Polyline approximation of a contour -------------------------- */
+/* ---------------------------------------------------------------------- */
+
+class Cont_Polyline
+{
+   double chord_tol;
+
+   Vec2 *pnts;
+   int *elems;            // Element index of segment pnts[i] -> pnts[i+1]
+   int pnt_cnt, pnt_cap;
+
+   Cont_Polyline *next;   // Next tolerance cached by the contour
+
+   void add(const Vec2& p, int el_idx);
+   void add_arc(const Vec2& p1, const Vec2& c, double span, bool circle,
+                int el_idx);
+   void build(const Elem_List& el_list);
+
+   Cont_Polyline(double tol);
+   ~Cont_Polyline();
+
+   Cont_Polyline(const Cont_Polyline& cp);             // No copying
+   Cont_Polyline& operator=(const Cont_Polyline& src); // No assignment
+
+  public:
+   double Chord_Tol() const { return chord_tol; } // As rounded
+
+   int Count() const { return pnt_cnt; }
+   const Vec2 *Points() const { return pnts; }
+   const int *Elem_Indices() const { return elems; }
+
+   bool Pnt_Inside(const Vec2& p) const;
+
+   friend class Contour;
+};
+
+/* ---------------------------------------------------------------------- */
+/* ------- Cache of no fit polygons for nesting ------------------------- */
+/* ---------------------------------------------------------------------- */
+
+class Cont_Nfp_Cache
+{
+   struct Part
+   {
+     int id;
+     Cont_Area *area;
+   };
+
+   struct Entry
+   {
+     int fixed_id, moving_id;
+     double fixed_rot, moving_rot;
+     Cont_Area *nfp;
+     Cont_Prepared *prep;
+   };
+
+   double tol;
+
+   Part *parts;
+   int part_cnt, part_cap;
+
+   Entry *entries;
+   int entry_cnt, entry_cap;
+
+   int *buckets;          // Open addressing into entries, -1 is free
+   int bucket_msk;
+
+   const Part *find_part(int id) const;
+   int find_bucket(int fixed_id, double fixed_rot,
+                   int moving_id, double moving_rot) const;
+   void rehash(int new_cap);
+
+   Cont_Nfp_Cache(const Cont_Nfp_Cache& cp);             // No copying
+   Cont_Nfp_Cache& operator=(const Cont_Nfp_Cache& src); // No assignment
+
+  public:
+   Cont_Nfp_Cache(double arc_tol);
+   ~Cont_Nfp_Cache();
+
+   bool Add_Part(int id, const Cont_Area& part);
+
+   const Cont_Area *Nfp(int fixed_id, double fixed_rot,
+                        int moving_id, double moving_rot);
+
+   bool Overlap(int fixed_id, double fixed_rot, const Vec2& fixed_pos,
+                int moving_id, double moving_rot, const Vec2& moving_pos);
+
+   int Nfp_Count() const { return entry_cnt; }
+
+   void Clear();
+};
+
+/* ---------------------------------------------------------------------- */
+/* ------- R-tree over contour or area rectangles ----------------------- */
+/* ---------------------------------------------------------------------- */
+
+class Cont_Rtree
+{
+   enum { Max_Fill = 16, Min_Fill = 6 };
+
+   struct Box
+   {
+     double lx, ly, hx, hy;
+   };
+
+   struct Node
+   {
+     int cnt;
+     bool leaf;
+     int parent;               // -1 at the root, next free if not used
+     Box box[Max_Fill+1];      // One extra while splitting
+     int ref[Max_Fill+1];      // Child node, or item id in a leaf
+   };
+
+   struct Ent
+   {
+     Box b;
+     int ref;
+   };
+
+   Node *nodes;
+   int node_cnt, node_cap;
+   int free_nodes;
+   int root;                   // -1 if empty
+   int item_cnt;
+
+   static Box box_of(const Rect_Ax& rct);
+   static bool meet(const Box& a, const Box& b, double tol);
+   static double dist(const Box& b, const Vec2& p);
+   static int ent_x_cmp(const void *e1, const void *e2);
+   static int ent_y_cmp(const void *e1, const void *e2);
+
+   int new_node(bool leaf);
+   void free_node(int n);
+   Box node_box(int n) const;
+   void bulk_load(Ent *ents, int cnt);
+
+   int choose_leaf(const Box& b) const;
+   void add_entry(int n, const Box& b, int ref);
+   void split(int n);
+   void adjust(int n);
+   void insert_item(const Box& b, int id);
+   bool find_item(int n, const Box& b, int id, int& leaf, int& idx) const;
+   void collect_items(int n, Box *&bxs, int *&ids, int& cnt, int& cap);
+
+   void window(int n, const Box& b, double tol,
+               IB_Int_Arr& ids, int& cnt) const;
+   void self_pairs(int n, double tol, IB_Int_Arr& pairs, int& cnt) const;
+   void cross_pairs(int a, const Cont_Rtree& other, int b, double tol,
+                    bool ordered, IB_Int_Arr& pairs, int& cnt) const;
+
+   Cont_Rtree(const Cont_Rtree& cp);             // No copying
+   Cont_Rtree& operator=(const Cont_Rtree& src); // No assignment
+
+  public:
+   Cont_Rtree();
+   ~Cont_Rtree();
+
+   void Build(const Rect_Ax *rects, int cnt);
+   void Build(const Cont_List& lst);
+   void Build(const Cont_Area_List& lst);
+
+   void Insert(int id, const Rect_Ax& rct);
+   bool Remove(int id, const Rect_Ax& rct);
+
+   void Delete();
+
+   int Count() const { return item_cnt; }
+
+   int Window(const Rect_Ax& rct, double tol, IB_Int_Arr& ids) const;
+
+   int Overlap_Pairs(double tol, IB_Int_Arr& pairs) const;
+   int Overlap_Pairs(const Cont_Rtree& other, double tol,
+                     IB_Int_Arr& pairs) const;
+
+   bool Nearest(const Vec2& p, int& id, double& dist) const;
+
+   class Near
+   {
+      struct Cand
+      {
+        double dist;
+        int ref;
+        bool item;
+      };
+
+      const Cont_Rtree& tree;
+      Vec2 p;
+
+      Cand *heap;
+      int heap_cnt, heap_cap;
+
+      static bool before(const Cand& a, const Cand& b);
+      void push(double dist, int ref, bool item);
+
+      Near(const Near& cp);             // No copying
+      Near& operator=(const Near& src); // No assignment
+
+     public:
+      Near(const Cont_Rtree& tr, const Vec2& pnt);
+      ~Near();
+
+      bool Next(int& id, double& dist);
+   };
+};
 
 } // namespace Ino
 
@@ -264,28 +264,29 @@ class Elem : public Persistable, protected Rect_Ax
 /* ------- Optimized Element Sort --------------------------------------- */
 /* ---------------------------------------------------------------------- */
 
-const int Elem_Search_Size = 32;
-
 class Elem_Sort
 {
-   void *arr;
-   int upb_x, upb_y;
+   void *grid;    // Hashed grid of element end points, see elem.cpp
+   void *chains;  // Chains made in advance by Chain_All()
 
    Elem_List list;
-   Vec2 base, delta;
 
    double tol;
 
    Elem_Sort(const Elem_Sort& cp);             // No Copying
    Elem_Sort& operator=(const Elem_Sort& src); // No Assignment
 
+   friend class Elem_Chain_Task;
+
   public:
    Elem_Sort(Elem_List& el_lst, double dist_tol);
    ~Elem_Sort();
 
-   int  Elements() const { return list.Length(); }
+   int  Elements() const;
 
    bool Chain(Elem_List& new_cont);
+   void Chain_All(int threadCount = -1); // -1: one thread per processor
+   Elem_List *Chain_Lists(int& chain_cnt, int threadCount = -1);
 };
 
 /* ---------------------------------------------------------------------- */
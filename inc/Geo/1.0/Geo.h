@@ -56,6 +56,35 @@ extern Vec2 Geo_Arc_Mid(const Vec2& p1, const Vec2& p2,
 
 extern bool Geo_In_Between(const Vec2& a, const Vec2& b, const Vec2& c);
 
+/* --------------------------------------------------------------------- */
+/* ------------ Exact sign predicates ---------------------------------- */
+/* --------------------------------------------------------------------- */
+/* The result is the exact sign for the given doubles: a fast floating  */
+/* point test decides unless it is within its error bound, then the     */
+/* sign is determined with exact (expansion) arithmetic.                 */
+/* --------------------------------------------------------------------- */
+
+// Sign of a x b: 1 if b is acw of a, -1 if cw, 0 if parallel
+
+extern int Geo_Cross_Sign(const Vec2& a, const Vec2& b);
+
+// Sign of (b-a) x (c-a): 1 if c is left of a->b, -1 if right, 0 if on
+
+extern int Geo_Orient(const Vec2& a, const Vec2& b, const Vec2& c);
+
+// Line through s,e against circle around c through p:
+// 1 if apart, 0 if touching, -1 if crossing
+
+extern int Geo_Line_Circle(const Vec2& s, const Vec2& e,
+                           const Vec2& c, const Vec2& p);
+
+// Circle around c1 through p1 against circle around c2 through p2:
+//  2 apart,  1 touching outside,  0 crossing,
+// -1 touching inside, -2 one inside the other
+
+extern int Geo_Circle_Circle(const Vec2& c1, const Vec2& p1,
+                             const Vec2& c2, const Vec2& p2);
+
 /* --------------------------------------------------------------------- */
 /* ------------ Project Point on a Line -------------------------------- */
 /* --------------------------------------------------------------------- */